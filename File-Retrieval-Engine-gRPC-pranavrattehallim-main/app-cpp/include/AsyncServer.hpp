@@ -0,0 +1,112 @@
+#ifndef ASYNC_SERVER_HPP
+#define ASYNC_SERVER_HPP
+
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "FileRetrievalEngineImpl.hpp"
+#include "proto/File-Retrieval-Engine.grpc.pb.h"
+
+// Thread and queue layout of the asynchronous server
+struct AsyncServerOptions {
+    size_t ingestQueues = 1;   // Completion queues serving ComputeIndex, ComputeIndexStream and ComputeDelete
+    size_t ingestThreads = 2;  // Threads polling the ingest queues
+    size_t queryQueues = 1;    // Completion queues serving ComputeSearch, ComputeSearchStream, ComputeSearchBatch, GetClientID, GetStats and Shutdown
+    size_t queryThreads = std::max(1u, std::thread::hardware_concurrency()); // Threads polling the query queues
+    bool pinThreads = false;   // Pin query threads to the first CPUs and ingest threads to the ones after them
+};
+
+// Service the async server registers. The request/response RPCs and index streams are requested from the
+// completion queues; the replication streams stay open for as long as a replica follows, so they run on gRPC's
+// synchronous threads instead of holding a polling thread, and are answered by the handlers.
+class AsyncQueueService
+    : public fre::FileRetrievalEngine::WithAsyncMethod_ComputeIndex<
+          fre::FileRetrievalEngine::WithAsyncMethod_ComputeIndexStream<
+              fre::FileRetrievalEngine::WithAsyncMethod_ComputeSearch<
+                  fre::FileRetrievalEngine::WithAsyncMethod_ComputeSearchStream<
+                      fre::FileRetrievalEngine::WithAsyncMethod_ComputeSearchBatch<
+                          fre::FileRetrievalEngine::WithAsyncMethod_ComputeDelete<
+                              fre::FileRetrievalEngine::WithAsyncMethod_GetClientID<
+                                  fre::FileRetrievalEngine::WithAsyncMethod_Shutdown<
+                                      fre::FileRetrievalEngine::WithAsyncMethod_GetStats<
+                                          fre::FileRetrievalEngine::Service>>>>>>>>> {
+public:
+    // Constructor takes the service that answers the replication streams
+    explicit AsyncQueueService(fre::FileRetrievalEngine::Service& handlers) : handlers_(handlers) {}
+
+    grpc::Status GetSnapshot(grpc::ServerContext* context, const fre::SnapshotReq* request,
+                             grpc::ServerWriter<fre::SnapshotChunk>* writer) override {
+        return handlers_.GetSnapshot(context, request, writer);
+    }
+
+    grpc::Status Replicate(grpc::ServerContext* context, const fre::ReplicateReq* request,
+                           grpc::ServerWriter<fre::ReplicationBatch>* writer) override {
+        return handlers_.Replicate(context, request, writer);
+    }
+
+private:
+    fre::FileRetrievalEngine::Service& handlers_; // Answers the replication streams
+};
+
+// gRPC server built on the async API. Indexing and query RPCs are served from separate completion queues, each
+// group polled by its own fixed pool of threads, so an indexing burst can only occupy the ingest threads and
+// searches keep their own. Handlers run on the polling thread; an indexing handler waiting for its log records to
+// become durable therefore holds one ingest thread, never a query thread.
+class AsyncServer {
+public:
+    // Constructor takes the service whose unary handlers answer requests and the engine that applies index streams
+    AsyncServer(fre::FileRetrievalEngine::Service& handlers, FileRetrievalEngineImpl& engine,
+                const AsyncServerOptions& options);
+
+    // Shuts the server down if it is still running
+    ~AsyncServer();
+
+    AsyncServer(const AsyncServer&) = delete;
+    AsyncServer& operator=(const AsyncServer&) = delete;
+
+    // Builds the server on the port, compressing replies with the algorithm, posts the first calls and starts the
+    // polling threads
+    bool start(int port, grpc_compression_algorithm compression = GRPC_COMPRESS_NONE);
+
+    // Blocks until the polling threads have exited after shutdown()
+    void wait();
+
+    // Stops accepting calls, lets in-flight calls finish and drains the completion queues
+    void shutdown();
+
+    // State of one call; the completion queue hands it back as the tag of each finished operation
+    class Call {
+    public:
+        virtual ~Call() = default;
+
+        // Advances the call after an operation completed; ok is false when it was cancelled or the stream ended
+        virtual void proceed(bool ok) = 0;
+    };
+
+private:
+    // Posts the calls a queue accepts: one per polling thread for each of its methods
+    void postIngestCalls(grpc::ServerCompletionQueue* queue, size_t count);
+    void postQueryCalls(grpc::ServerCompletionQueue* queue, size_t count);
+
+    // Polling thread body: hands every completed operation back to its call
+    static void poll(grpc::ServerCompletionQueue* queue);
+
+    // Starts a pool of polling threads over the queues, optionally pinned from firstCpu onwards
+    void startPool(const std::vector<std::unique_ptr<grpc::ServerCompletionQueue>>& queues, size_t threads,
+                   size_t firstCpu, const char* name);
+
+    fre::FileRetrievalEngine::Service& handlers_;             // Unary handlers
+    FileRetrievalEngineImpl& engine_;                         // Applies batches of index streams
+    AsyncServerOptions options_;                              // Thread and queue layout
+    AsyncQueueService service_;                               // Async method registrations
+    std::unique_ptr<grpc::Server> server_;                    // Running server
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> ingestQueues_; // Queues of indexing RPCs
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queryQueues_;  // Queues of search and control RPCs
+    std::vector<std::thread> threads_;                        // Polling threads of both pools
+    bool shutDown_ = false;                                   // Set once shutdown() has run
+};
+
+#endif // ASYNC_SERVER_HPP
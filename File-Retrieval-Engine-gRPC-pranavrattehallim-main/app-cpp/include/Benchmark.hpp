@@ -4,8 +4,7 @@
 #include <string>
 #include "ClientProcessingEngine.hpp" // Ensure the ClientProcessingEngine is included
 
-// Function prototype for benchmarking the client
-void benchmarkClient(ClientProcessingEngine& clientEngine, const std::string& dataset_path);
+// Indexes one dataset with one benchmark client; returns false if indexing failed
+bool benchmarkClient(ClientProcessingEngine& clientEngine, const std::string& dataset_path);
 
 #endif // BENCHMARK_HPP
-
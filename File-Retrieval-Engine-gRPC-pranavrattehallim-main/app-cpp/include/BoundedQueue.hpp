@@ -0,0 +1,60 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Fixed-capacity blocking queue used to hand work between pipeline stages.
+// push blocks while the queue is full, which applies backpressure to the producing stage.
+template <typename T>
+class BoundedQueue {
+public:
+    // Constructor sets the maximum number of queued items
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    // Waits for space and enqueues the item; returns false if the queue was closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+        if (closed_) {
+            return false; // Consumers are gone or the pipeline is shutting down
+        }
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // Waits for an item and dequeues it; returns false once the queue is closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return false; // Closed and nothing left to consume
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    // Closes the queue: producers stop being accepted, consumers drain what is left
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notFull_.notify_all();
+        notEmpty_.notify_all();
+    }
+
+private:
+    std::deque<T> items_;                // Queued items in FIFO order
+    size_t capacity_;                    // Maximum number of queued items
+    bool closed_ = false;                // Set once no more items will be pushed
+    std::mutex mutex_;                   // Protects items_ and closed_
+    std::condition_variable notFull_;    // Signalled when space frees up
+    std::condition_variable notEmpty_;   // Signalled when an item arrives
+};
+
+#endif // BOUNDED_QUEUE_HPP
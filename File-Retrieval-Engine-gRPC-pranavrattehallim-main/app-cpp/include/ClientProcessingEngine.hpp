@@ -13,35 +13,118 @@
 #include <grpcpp/support/channel_arguments.h> // Include for ChannelArguments
 #include <grpcpp/security/credentials.h> // Include for InsecureChannelCredentials
 #include <string> // Include string for string manipulation
+#include <thread> // Include thread for the indexing pipeline workers
+#include <string_view> // Include string_view for tokenizing file buffers in place
+#include "FileReader.hpp" // Include FileReader for the mmap/pread file reading layer
+#include "IndexWireFormat.hpp" // Include IndexWireFormat for the term dictionary of an indexing stream
 
 #include "proto/File-Retrieval-Engine.grpc.pb.h" // Include gRPC definitions
 
+// Time spent in each stage of the indexing pipeline during the last indexFolder call, in seconds.
+// Read, tokenize and serialize are summed across all tokenizer workers.
+struct IndexingStageTimes {
+    double walk = 0.0;      // Directory traversal
+    double read = 0.0;      // Reading file contents
+    double tokenize = 0.0;  // Counting words
+    double serialize = 0.0; // Building index requests from the word counts
+    double send = 0.0;      // Batching and writing to the gRPC stream, until the server's acknowledgement
+    double serverApply = 0.0;   // Time the server spent logging and applying the batches, as it reported
+    double serverLogWait = 0.0; // Time the server spent waiting for its write-ahead log, as it reported
+    double total = 0.0;     // Wall-clock time of the whole call
+    size_t documents = 0;   // Documents the server acknowledged
+    size_t bytes = 0;       // Bytes of file contents read
+    size_t sentBytes = 0;   // Serialized bytes of the batches written to the stream, before gRPC compression
+    size_t dictionaryTerms = 0; // Terms the stream's dictionary sent once each (0 without term IDs)
+    FileReadStats mmapReads;  // Files read through the mmap path, summed across workers
+    FileReadStats preadReads; // Files read through the pread path, summed across workers
+};
+
 class ClientProcessingEngine {
 public:
     // Constructor: Initializes gRPC client stub
     ClientProcessingEngine();
 
-    // Connects the client to the server with the provided IP address and port
+    // Connects the client to the server at the provided IP address and port and requests a client ID
     bool connect(const std::string& server_ip, int server_port);
 
-    // Indexes the specified folder and sends an INDEX REQUEST to the server via gRPC
+    // Indexes the specified folder and streams its documents to the server in batches via gRPC
     bool indexFolder(const std::string& folder_path);
 
-    // Sends a SEARCH REQUEST with query terms and returns the top 10 relevant documents via gRPC
+    // Sets how many documents, or how many serialized bytes, are buffered before a batch is sent
+    void setIndexBatchLimits(size_t max_documents, size_t max_bytes);
+
+    // Sets the number of tokenizer workers used by indexFolder (defaults to the hardware thread count)
+    void setIndexingWorkers(size_t workers);
+
+    // Sends each indexing stream's terms once, in the stream's dictionary, and term IDs after that (off by default)
+    void setTermIds(bool term_ids) { term_ids_ = term_ids; }
+
+    // Compresses the batches of indexing streams with the algorithm (none by default)
+    void setCompression(grpc_compression_algorithm algorithm) { compression_ = algorithm; }
+
+    // Turns the per-call indexing report on or off (on by default)
+    void setVerbose(bool verbose) { verbose_ = verbose; }
+
+    // Sets the file size at which the reader switches from pread to mmap
+    void setMmapThreshold(size_t bytes) { mmap_threshold_ = bytes; }
+
+    // Returns the per-stage timings of the last indexFolder call
+    const IndexingStageTimes& lastIndexingStageTimes() const { return last_stage_times_; }
+
+    // Sets how many results search() asks the server for (0 keeps the server default of 10)
+    void setSearchTopK(int top_k) { search_top_k_ = top_k; }
+
+    // Sends a SEARCH REQUEST with query terms and returns the top K relevant documents via gRPC
     bool search(const std::vector<std::string>& query_terms);
 
+    // Sends several searches in one ComputeSearchBatch call and prints each one's top K, in order
+    bool searchBatch(const std::vector<std::vector<std::string>>& queries);
+
+    // Streams the first page of every match, best first, and remembers the cursor to the next page
+    bool searchPage(const std::vector<std::string>& query_terms);
+
+    // Streams the page after the last one from the server that holds the search's results
+    bool nextSearchPage();
+
+    // Sets how many results a page holds (0 keeps the server default of 1000)
+    void setSearchPageSize(int page_size) { search_page_size_ = page_size; }
+
+    // Adds a read-only replica, as "host:port"; searches then rotate over the replicas instead of the server
+    void addSearchReplica(const std::string& address);
+
+    // Sends a DELETE REQUEST for a file, or for every file under a folder, as indexFolder named them
+    bool deleteDocuments(const std::string& path);
+
+    // Extracts word frequencies from the contents of a document: alphanumeric words longer than two characters,
+    // case preserved, with a trailing possessive 's dropped
+    static std::unordered_map<std::string, int> extractWordFrequencies(std::string_view contents);
+
     // Handles shutdown notification from the server
     grpc::Status Shutdown(grpc::ServerContext* context, const fre::ShutdownReq* request, fre::ShutdownRep* response);
     
     bool isShutdownRequested() const { return shutdown_requested_; }
 
 private:
+    // Reads one page of a streamed search and prints it; keeps the page's cursor for nextSearchPage()
+    bool streamSearchPage(fre::FileRetrievalEngine::Stub* stub, const fre::SearchStreamReq& request);
+
     std::unique_ptr<fre::FileRetrievalEngine::Stub> stub_; // gRPC client stub for server communication
+    std::vector<std::unique_ptr<fre::FileRetrievalEngine::Stub>> replica_stubs_; // Replicas searches rotate over
+    size_t next_replica_ = 0; // Replica that answers the next search
     std::string clientID; // Client ID used for indexing
     bool shutdown_requested_ = false;
-
-    // Extracts word frequencies from the specified document file
-    std::unordered_map<std::string, int> extractWordFrequencies(const std::string& file_path);
+    size_t max_batch_documents_ = 256; // Documents per IndexBatch before it is sent
+    size_t max_batch_bytes_ = 1 << 20; // Serialized bytes per IndexBatch before it is sent (a larger document is sent alone)
+    size_t indexing_workers_ = std::max(1u, std::thread::hardware_concurrency()); // Tokenizer workers in the pipeline
+    size_t mmap_threshold_ = 256 * 1024; // Files at least this large are memory-mapped
+    bool term_ids_ = false; // Encode indexing streams with a term dictionary
+    grpc_compression_algorithm compression_ = GRPC_COMPRESS_NONE; // Compression of indexing streams
+    IndexingStageTimes last_stage_times_; // Stage timings of the last indexFolder call
+    int search_top_k_ = 0; // Results requested per search; 0 lets the server decide
+    int search_page_size_ = 0; // Results per page of a paged search; 0 lets the server decide
+    std::string search_cursor_; // Cursor to the next page of the last paged search, empty after its last page
+    fre::FileRetrievalEngine::Stub* search_cursor_stub_ = nullptr; // Server holding the paged search's results
+    bool verbose_ = true; // Print a report after every indexFolder call
 };
 
 #endif // CLIENT_PROCESSING_ENGINE_HPP
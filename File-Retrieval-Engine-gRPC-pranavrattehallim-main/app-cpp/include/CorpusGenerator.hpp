@@ -0,0 +1,54 @@
+#ifndef CORPUS_GENERATOR_HPP
+#define CORPUS_GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Shape of a synthetic corpus
+struct CorpusOptions {
+    size_t documents = 10000;       // Number of documents
+    size_t vocabulary = 50000;      // Number of distinct words
+    double zipfExponent = 1.0;      // Skew of word frequencies: the word of rank r is drawn with weight 1 / r^s
+    size_t wordsPerDocument = 200;  // Words drawn per document
+    uint64_t seed = 42;             // Seed; the same options always give the same corpus
+};
+
+// Deterministic generator of Zipf-distributed text corpora, for benchmarks. Every document is generated from
+// its own seed, so any document can be produced on its own and in any order, and the output depends only on the
+// options (the sampling does not use the standard library's distributions, whose results vary by platform).
+class CorpusGenerator {
+public:
+    // Constructor precomputes the cumulative word distribution
+    explicit CorpusGenerator(const CorpusOptions& options);
+
+    // Options the corpus was generated with
+    const CorpusOptions& options() const { return options_; }
+
+    // Word of the given rank (0 is the most common): pronounceable lowercase letters, at least four of them
+    static std::string word(size_t rank);
+
+    // Text of a document: its words separated by spaces, with line breaks and some punctuation
+    std::string documentText(size_t document) const;
+
+    // Word frequencies of a document, exactly as the client tokenizer would count them from documentText
+    std::vector<std::pair<std::string, int>> termFrequencies(size_t document) const;
+
+    // Writes every document as a text file under folder, 1000 files per subfolder; returns false with a message
+    bool writeFolder(const std::string& folder, size_t& bytesWritten, std::string& error) const;
+
+private:
+    // Random generator seeded for one document
+    std::mt19937_64 documentRng(size_t document) const;
+
+    // Draws a word rank from the Zipf distribution
+    size_t sampleRank(std::mt19937_64& rng) const;
+
+    CorpusOptions options_;          // Shape of the corpus
+    std::vector<double> cumulative_; // Cumulative probability of ranks 0..r
+};
+
+#endif // CORPUS_GENERATOR_HPP
@@ -0,0 +1,89 @@
+#ifndef DELTA_SEGMENT_HPP
+#define DELTA_SEGMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "IndexSnapshot.hpp" // For PostingView
+
+// Postings of one indexing batch, built by the indexing thread without any shared lock and read-only once
+// published. Terms are grouped by the term dictionary shard that owns them and ordered by hash within a shard, so
+// a lookup is a binary search of one shard's range and the merger can fold the segment into the index shard by
+// shard. Term bytes and postings sit in three flat arrays, so building a segment allocates a handful of times
+// however many terms the batch holds. A separate table lists the entries in term order for prefix expansion.
+class DeltaSegment {
+public:
+    // A document number with the term frequency list to index for it (IndexStore::DocumentTerms)
+    using DocumentTerms = std::pair<int, std::vector<std::pair<std::string, int>>>;
+
+    // Builds the segment from a batch, with terms assigned to shards as termHash % shardCount
+    DeltaSegment(const std::vector<DocumentTerms>& documents, size_t shardCount);
+
+    // Postings of the term with the given FrozenTermDictionary::hash(), in document order; empty if the batch
+    // lacks the term
+    PostingView find(std::string_view term, uint64_t termHash) const;
+
+    // Range [shardBegin, shardEnd) of the entries owned by a shard
+    size_t shardBegin(size_t shard) const { return shardStart_[shard]; }
+    size_t shardEnd(size_t shard) const { return shardStart_[shard + 1]; }
+
+    // Number of distinct terms
+    size_t termCount() const { return entries_.size(); }
+
+    // Rank, in term order, of the first term not less than the given one (termCount if none)
+    size_t lowerBound(std::string_view term) const;
+
+    // Entry holding the term of the given rank in term order
+    size_t byRank(size_t rank) const { return termOrder_[rank]; }
+
+    // Shard owning an entry
+    size_t shardOf(size_t entry) const { return entries_[entry].hash % (shardStart_.size() - 1); }
+
+    // Term, hash and postings of an entry
+    std::string_view term(size_t entry) const {
+        return std::string_view(termBytes_.data() + entries_[entry].termOffset, entries_[entry].termLength);
+    }
+    uint64_t hash(size_t entry) const { return entries_[entry].hash; }
+    PostingView postings(size_t entry) const {
+        const Entry& e = entries_[entry];
+        return {documents_.data() + e.firstPosting, frequencies_.data() + e.firstPosting, e.postingCount};
+    }
+
+    // Postings across every term
+    size_t postingCount() const { return documents_.size(); }
+
+    // Heap bytes of the entries, term bytes and postings
+    size_t memoryBytes() const;
+
+private:
+    // One term of the batch
+    struct Entry {
+        uint64_t hash;         // FrozenTermDictionary::hash() of the term
+        uint32_t termOffset;   // Start of the term in termBytes_
+        uint32_t termLength;   // Length of the term
+        uint32_t firstPosting; // Start of the term's postings in documents_ and frequencies_
+        uint32_t postingCount; // Documents of the batch holding the term
+    };
+
+    std::vector<Entry> entries_;        // Ordered by shard, then hash, then term
+    std::vector<uint32_t> shardStart_;  // First entry of each shard, plus the end of the last
+    std::vector<uint32_t> termOrder_;   // Entries in ascending term byte order
+    std::vector<char> termBytes_;       // Term bytes back to back
+    std::vector<int32_t> documents_;    // Postings of every entry in entry order, each entry's in document order
+    std::vector<int32_t> frequencies_;  // Frequency of the posting at the same position
+};
+
+// A published segment and its place in publication order; the merger folds segments in that order
+struct PublishedSegment {
+    uint64_t sequence;                           // Publication number, from 1
+    std::shared_ptr<const DeltaSegment> segment; // The batch's postings
+};
+
+// Segments published and not yet folded into every shard, oldest first
+using DeltaSegmentList = std::vector<PublishedSegment>;
+
+#endif // DELTA_SEGMENT_HPP
@@ -0,0 +1,54 @@
+#ifndef DOCUMENT_TOMBSTONES_HPP
+#define DOCUMENT_TOMBSTONES_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Set of deleted (or replaced) document numbers, readable without a lock. Bits live in fixed-size chunks that are
+// allocated on first use and never freed or moved, so a search can test a document while another thread marks one.
+class DocumentTombstones {
+public:
+    // Document numbers per chunk
+    static constexpr size_t chunkBits = size_t{1} << 16;
+
+    // Constructor allocates the chunk directory, large enough for every positive int
+    DocumentTombstones();
+
+    // Frees every chunk
+    ~DocumentTombstones();
+
+    DocumentTombstones(const DocumentTombstones&) = delete;
+    DocumentTombstones& operator=(const DocumentTombstones&) = delete;
+
+    // True if the document has been marked
+    bool contains(int document) const {
+        const std::atomic<uint64_t>* chunk = chunks_[static_cast<size_t>(document) / chunkBits].load(std::memory_order_acquire);
+        if (!chunk) {
+            return false;
+        }
+        size_t bit = static_cast<size_t>(document) % chunkBits;
+        return (chunk[bit / 64].load(std::memory_order_relaxed) >> (bit % 64)) & 1;
+    }
+
+    // Marks the document; returns false if it was already marked
+    bool insert(int document);
+
+    // Number of documents marked
+    size_t size() const { return count_.load(std::memory_order_relaxed); }
+
+    // Bytes held by the directory and the allocated chunks
+    size_t memoryBytes() const;
+
+private:
+    static constexpr size_t chunkCount = (size_t{1} << 31) / chunkBits; // Covers document numbers up to INT_MAX
+
+    std::unique_ptr<std::atomic<std::atomic<uint64_t>*>[]> chunks_; // Chunk directory; null until a chunk is used
+    std::atomic<size_t> count_{0};                                  // Documents marked
+    std::atomic<size_t> allocatedChunks_{0};                        // Chunks allocated
+    std::mutex allocationMutex_;                                    // Serializes chunk allocation
+};
+
+#endif // DOCUMENT_TOMBSTONES_HPP
@@ -0,0 +1,66 @@
+#ifndef FILE_READER_HPP
+#define FILE_READER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Bytes and time spent reading files through one of the FileReader paths
+struct FileReadStats {
+    size_t files = 0;       // Files read through this path
+    size_t bytes = 0;       // Bytes read through this path
+    double seconds = 0.0;   // Time spent opening, mapping or reading
+
+    // Read throughput in bytes per second (0 if nothing was read)
+    double bytesPerSecond() const { return seconds > 0.0 ? bytes / seconds : 0.0; }
+};
+
+// FileReader hands out a file's contents as one contiguous buffer.
+// Files at or above the mmap threshold are memory-mapped with sequential access hints;
+// smaller files are read with pread into a buffer that is reused across files.
+// A reader is not thread-safe; each indexing worker owns one.
+class FileReader {
+public:
+    // How a file's contents were obtained
+    enum class Method { MemoryMap, Pread };
+
+    // Constructor sets the size at which files switch from pread to mmap
+    explicit FileReader(size_t mmapThreshold = 256 * 1024);
+
+    // Releases any mapping still held
+    ~FileReader();
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    // Reads the file and points contents at its bytes; the view stays valid until the next read.
+    // Returns false if the file cannot be opened or read.
+    bool read(const std::string& filePath, std::string_view& contents);
+
+    // Statistics for the mmap path
+    const FileReadStats& mmapStats() const { return mmapStats_; }
+
+    // Statistics for the pread path
+    const FileReadStats& preadStats() const { return preadStats_; }
+
+private:
+    size_t mmapThreshold_;        // Files at least this large are memory-mapped
+    std::vector<char> buffer_;    // Reused buffer for the pread path
+    void* mapping_ = nullptr;     // Current mapping, if the last file was memory-mapped
+    size_t mappingSize_ = 0;      // Length of the current mapping
+    FileReadStats mmapStats_;     // Totals for memory-mapped files
+    FileReadStats preadStats_;    // Totals for files read with pread
+
+    // Unmaps the previous file's mapping, if any
+    void releaseMapping();
+
+    // Maps the open file and advises the kernel that it will be read sequentially. Sets method to Pread if the
+    // mapping failed and the file was copied instead.
+    bool readMapped(int fd, size_t size, std::string_view& contents, Method& method);
+
+    // Reads the open file into the reusable buffer
+    bool readBuffered(int fd, size_t size, std::string_view& contents);
+};
+
+#endif // FILE_READER_HPP
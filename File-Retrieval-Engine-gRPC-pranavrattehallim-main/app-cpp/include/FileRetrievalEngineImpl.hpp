@@ -3,27 +3,166 @@
 
 #include "proto/File-Retrieval-Engine.grpc.pb.h"  // gRPC generated headers
 #include "IndexStore.hpp"  // Assuming IndexStore manages document indexing
+#include "WriteAheadLog.hpp" // Durable log of indexing operations
+#include "ResultCache.hpp"   // Cache of search results
+#include "ServerStats.hpp"   // Latency histograms of the RPCs
+#include "ReplicationLog.hpp" // Updates kept for replicas
+#include "ReplicaFollower.hpp" // Primary this server replicates, in replica mode
+#include "SearchCursorStore.hpp" // Result sets behind search cursors
+#include "SearchWorkerPool.hpp" // Threads the searches of a batch run on
+#include "IndexWireFormat.hpp" // Term dictionary of an indexing stream
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <grpc/grpc.h>
 #include <grpcpp/server_context.h>
 
+// One page of a streamed search, sent a chunk at a time
+struct SearchPage {
+    std::shared_ptr<const RankedSearch> search; // Ranked matches the page is cut from
+    size_t next = 0;                            // Rank of the next result to send
+    size_t end = 0;                             // Rank after the page's last result
+    size_t chunkSize = 0;                       // Results per chunk
+    fre::SearchChunk header;                    // Summary the first chunk carries
+    bool headerSent = false;                    // Whether the first chunk has been produced
+};
 
 class FileRetrievalEngineImpl : public fre::FileRetrievalEngine::Service {
 public:
+    // Largest number of results a single search may ask for
+    static constexpr size_t maxSearchResults = 1000;
+
+    // Largest number of terms a search may let one prefix term expand to
+    static constexpr size_t maxPrefixExpansions = 4096;
+
+    // Largest number of searches one batch may hold
+    static constexpr size_t maxBatchSearches = 1024;
+
+    // Results per page of a streamed search, unless the request asks otherwise, and the most it may ask for
+    static constexpr size_t defaultSearchPageResults = 1000;
+    static constexpr size_t maxSearchPageResults = 100000;
+
+    // Results per message of a streamed search, unless the request asks otherwise, and the most it may ask for
+    static constexpr size_t defaultSearchChunkResults = 256;
+    static constexpr size_t maxSearchChunkResults = 10000;
+
+    // Bytes of snapshot file per chunk sent to a bootstrapping replica
+    static constexpr size_t snapshotChunkBytes = 1 << 20;
+
+    // Bytes of updates gathered into one message to a replica (a single large batch may exceed it)
+    static constexpr size_t replicationBatchBytes = 1 << 20;
+
     // Constructor accepts a shared pointer to IndexStore for managing document data
     explicit FileRetrievalEngineImpl(std::shared_ptr<IndexStore> store);
 
     // gRPC method to handle indexing requests from the client
     grpc::Status ComputeIndex(grpc::ServerContext* context, const fre::IndexReq* request, fre::IndexRep* reply) override;
 
+    // gRPC method to handle a stream of indexing batches from the client, acknowledged once at the end
+    grpc::Status ComputeIndexStream(grpc::ServerContext* context, grpc::ServerReader<fre::IndexBatch>* reader, fre::IndexStreamRep* reply) override;
+
     // gRPC method to handle search requests from the client
     grpc::Status ComputeSearch(grpc::ServerContext* context, const fre::SearchReq* request, fre::SearchRep* reply) override;
 
+    // gRPC method to run a batch of searches side by side, looking up the terms they share once
+    grpc::Status ComputeSearchBatch(grpc::ServerContext* context, const fre::SearchBatchReq* request, fre::SearchBatchRep* reply) override;
+
+    // gRPC method to stream one page of a search's ranked results, ending with a cursor to the next page
+    grpc::Status ComputeSearchStream(grpc::ServerContext* context, const fre::SearchStreamReq* request, grpc::ServerWriter<fre::SearchChunk>* writer) override;
+
+    // Runs the search, or finds the result set behind the request's cursor, and sets up the page to send
+    grpc::Status openSearchPage(const fre::SearchStreamReq& request, SearchPage& page);
+
+    // Fills in the page's next chunk; false once the whole page has been produced. The first chunk always comes,
+    // even for an empty page, and documents deleted since the search ran are left out.
+    bool nextSearchChunk(SearchPage& page, fre::SearchChunk* chunk) const;
+
+    // gRPC method to remove a client's documents from the index, acknowledged once the deletion is logged
+    grpc::Status ComputeDelete(grpc::ServerContext* context, const fre::DeleteReq* request, fre::DeleteRep* reply) override;
+
+    // gRPC method to report latency, lock contention, index size and cache statistics
+    grpc::Status GetStats(grpc::ServerContext* context, const fre::StatsReq* request, fre::StatsRep* reply) override;
+
+    // gRPC method to stream the snapshot file to a replica that is bootstrapping
+    grpc::Status GetSnapshot(grpc::ServerContext* context, const fre::SnapshotReq* request, grpc::ServerWriter<fre::SnapshotChunk>* writer) override;
+
+    // gRPC method to stream the index updates after a replica's position, with heartbeats while there are none
+    grpc::Status Replicate(grpc::ServerContext* context, const fre::ReplicateReq* request, grpc::ServerWriter<fre::ReplicationBatch>* writer) override;
+
+    // Fills in the statistics reply; shared by the RPC and the server's stats command
+    void collectStats(fre::StatsRep* reply) const;
+
+    // Per-RPC counters, recorded by whichever server front end dispatches the calls
+    ServerStats& stats() { return stats_; }
+
+    // Logs and applies one batch of an indexing stream, resolving its term IDs through the stream's dictionary.
+    // Raises sequence to the log sequence of the batch's last record (left alone without a log); fails with
+    // INVALID_ARGUMENT, applying nothing, if the batch's term IDs do not decode.
+    grpc::Status applyIndexBatch(const fre::IndexBatch& batch, SessionTermDecoder& terms, uint64_t& sequence);
+
+    // Waits until the stream's records up to sequence are durable, then fills in the stream's acknowledgement,
+    // including the time spent applying its batches
+    grpc::Status completeIndexStream(uint64_t sequence, int64_t documentsIndexed, int64_t batchesReceived,
+                                     double applySeconds, fre::IndexStreamRep* reply);
+
+    // Logs every indexing operation to the write-ahead log before it is acknowledged (nullptr disables logging)
+    void setWriteAheadLog(std::shared_ptr<WriteAheadLog> wal);
+
+    // Answers repeated searches from the cache until the index changes (nullptr disables caching)
+    void setResultCache(std::shared_ptr<ResultCache> cache);
+
+    // Publishes every indexing operation to replicas and serves them the snapshot file (nullptr disables both)
+    void setReplicationLog(std::shared_ptr<ReplicationLog> replication, const std::string& snapshotPath);
+
+    // Keeps the ranked results of streamed searches so their later pages can be read (nullptr: one page only)
+    void setSearchCursors(std::shared_ptr<SearchCursorStore> cursors);
+
+    // Runs the searches of a batch on the pool's threads (nullptr: one after another on the handler's thread)
+    void setSearchWorkers(std::shared_ptr<SearchWorkerPool> workers);
+
+    // Makes the server a read-only replica: updates come from the follower, writes are refused and searches report
+    // the replication lag
+    void setReplica(std::shared_ptr<ReplicaFollower> replica);
+
+    // Pauses indexing, saves a snapshot that covers every logged record and empties the log
+    bool checkpoint(const std::string& snapshotPath);
+
 private:
+    // Appends encoded records to the write-ahead log and publishes them to replicas; returns the log sequence of
+    // the last one (0 without a log). checkpointMutex_ must be held shared and logOrderMutex_ held.
+    uint64_t logRecords(const std::string& records, size_t count);
+
+    // Refuses writes on a replica
+    grpc::Status rejectOnReplica() const;
+
+    // Copies the search terms of a request, dropping "and" and refusing unsupported wildcards
+    static grpc::Status parseSearchTerms(const google::protobuf::RepeatedPtrField<std::string>& requestTerms,
+                                         std::vector<std::string>& terms);
+
+    // Answers one search whose terms are parsed, from the cache when it can; plain terms found in shared (if
+    // given) are not looked up again. generation must be read before anything the search reads, shared included,
+    // so a concurrent update marks the cached entry stale instead of filing old results under the new generation.
+    void runSearch(const fre::SearchReq& request, const std::vector<std::string>& terms, fre::SearchRep* reply,
+                   const SharedPostings* shared, uint64_t generation);
+
+    // Clamps a request's expansion cap to the server's limit; 0 gives the default
+    static size_t expansionLimit(int32_t requested);
+
     std::shared_ptr<IndexStore> store_;  // Shared pointer to IndexStore
+    std::shared_ptr<WriteAheadLog> wal_; // Write-ahead log, or nullptr when running without durability
+    std::shared_ptr<ResultCache> cache_; // Search result cache, or nullptr when caching is off
+    std::shared_ptr<SearchCursorStore> cursors_; // Result sets of paginated searches, or nullptr when kept for none
+    std::shared_ptr<SearchWorkerPool> workers_; // Threads batches of searches run on, or nullptr to run them in turn
+    std::shared_ptr<ReplicationLog> replication_; // Updates kept for replicas, or nullptr when not serving any
+    std::string snapshotPath_;           // Snapshot file served to bootstrapping replicas
+    std::shared_ptr<ReplicaFollower> replica_; // Follower of the primary, or nullptr unless this is a replica
+    std::shared_mutex checkpointMutex_;  // Held shared while logging and applying, exclusively while checkpointing
+    std::mutex logOrderMutex_;           // Held from logging an update to entering it in the document table, so
+                                         // replay and replicas see replacements and deletions in the same order
+    ServerStats stats_;                  // Per-RPC latency histograms and error counts
 };
 
 #endif // FILERETRIEVALENGINEIMPL_HPP
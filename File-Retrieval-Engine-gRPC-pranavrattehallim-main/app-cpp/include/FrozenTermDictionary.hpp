@@ -0,0 +1,70 @@
+#ifndef FROZEN_TERM_DICTIONARY_HPP
+#define FROZEN_TERM_DICTIONARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Read-only set of terms numbered 0..size()-1, built once from a fixed list. The term bytes sit back to back in
+// one arena, and a minimal perfect hash (hash and displace) maps a term straight to its number: one probe of the
+// displacement table, one of the offsets and one comparison against the arena, with no per-term allocation. A
+// term that is not in the set hashes to some number too, so find() compares the bytes before answering. A second
+// table lists the numbers in term order, for prefix queries.
+class FrozenTermDictionary {
+public:
+    // Returned by find() for a term that is not in the set
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    // Hash of a term as find() expects it; the same std::hash the term dictionary shards with
+    static uint64_t hash(std::string_view term);
+
+    // Replaces the set with the given distinct terms. positions receives the number each term was given. Returns
+    // false, leaving the set empty, if no perfect hash was found or the terms do not fit 32-bit offsets.
+    bool build(const std::vector<std::string_view>& terms, std::vector<uint32_t>& positions);
+
+    // Returns the number of the term with the given hash(), or npos
+    uint32_t find(std::string_view term, uint64_t termHash) const;
+
+    // Term with the given number; stays valid until the next build (moving the dictionary keeps it valid)
+    std::string_view term(uint32_t position) const {
+        return std::string_view(arena_.data() + offsets_[position], offsets_[position + 1] - offsets_[position]);
+    }
+
+    // Number of terms
+    size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+
+    // Ranks [first, last) of the terms starting with prefix, in term order; rank r is term number byRank(r)
+    std::pair<size_t, size_t> prefixRange(std::string_view prefix) const;
+
+    // Number of the term at the given rank in term order
+    uint32_t byRank(size_t rank) const { return sorted_[rank]; }
+
+    // Heap bytes of the arena, the offsets, the displacement table and the term order
+    size_t memoryBytes() const;
+
+private:
+    // Displacement of a bucket holding a single key: the key's number, tagged with this bit
+    static constexpr uint32_t directBit = 0x80000000u;
+
+    // Mixes a term hash with the build's salt, so the buckets do not follow the shard choice
+    uint64_t mix(uint64_t termHash) const;
+
+    // Bucket of a mixed hash
+    size_t bucketOf(uint64_t mixed) const;
+
+    // Number a mixed hash gets under a bucket's seed
+    uint32_t positionOf(uint64_t mixed, uint32_t seed) const;
+
+    // One attempt at a perfect hash with the current salt; false if some bucket found no seed
+    bool place(const std::vector<uint64_t>& mixed, std::vector<uint32_t>& positions);
+
+    std::vector<char> arena_;              // Term bytes in number order
+    std::vector<uint32_t> offsets_;        // Start of each term in arena_, plus the end of the last one
+    std::vector<uint32_t> displacements_;  // Per bucket: a seed, or directBit plus the number of its one key
+    std::vector<uint32_t> sorted_;         // Term numbers in byte order of the terms
+    uint64_t salt_ = 0;                    // Salt of the build that succeeded
+};
+
+#endif // FROZEN_TERM_DICTIONARY_HPP
@@ -0,0 +1,136 @@
+#ifndef INDEX_SNAPSHOT_HPP
+#define INDEX_SNAPSHOT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a posting list stored in a snapshot, sorted by document number
+struct PostingView {
+    const int32_t* documents = nullptr;    // Document numbers in ascending order
+    const int32_t* frequencies = nullptr;  // Term frequency for the document at the same position
+    size_t size = 0;                       // Number of postings
+};
+
+// On-disk layout of a snapshot file (version 2). All integers are in host byte order and every
+// section starts on an 8-byte boundary, so the file can be used in place after mmap.
+//
+//   SnapshotHeader
+//   document key offsets   (documentCount + 1) x uint64, into the document key bytes
+//   document key bytes     "clientID:documentPath" keys of documents 1..documentCount, back to back
+//   sorted document order  documentCount x uint32, document numbers ordered by key (for key lookups)
+//   term offsets           (termCount + 1) x uint64, into the term bytes
+//   term bytes             terms in ascending byte order, back to back
+//   posting offsets        (termCount + 1) x uint64, index of each term's first posting
+//   posting documents      postingCount x int32
+//   posting frequencies    postingCount x int32
+struct SnapshotHeader {
+    char magic[8];                    // "FRESNAP" followed by a NUL byte
+    uint32_t version;                 // Format version, currently 2
+    uint32_t reserved;                // Always zero
+    uint64_t documentCount;           // Documents 1..documentCount are stored
+    uint64_t termCount;               // Distinct terms
+    uint64_t postingCount;            // Postings across all terms
+    uint64_t highestClientID;         // Highest numeric client ID that indexed a document
+    uint64_t logSequence;             // Last write-ahead log record the snapshot includes
+    uint64_t documentOffsetsOffset;   // File offset of the document key offsets
+    uint64_t documentBytesOffset;     // File offset of the document key bytes
+    uint64_t documentOrderOffset;     // File offset of the sorted document order
+    uint64_t termOffsetsOffset;       // File offset of the term offsets
+    uint64_t termBytesOffset;         // File offset of the term bytes
+    uint64_t postingOffsetsOffset;    // File offset of the posting offsets
+    uint64_t postingDocumentsOffset;  // File offset of the posting documents
+    uint64_t postingFrequenciesOffset; // File offset of the posting frequencies
+    uint64_t fileSize;                // Total file size, checked when the file is opened
+};
+
+// Contents to serialize into a snapshot; terms must be sorted and postings grouped by term in the same order
+struct SnapshotContents {
+    std::vector<std::string_view> documentKeys;  // Keys of documents 1..N, in document number order
+    std::vector<std::string_view> terms;         // Terms in ascending byte order
+    std::vector<uint64_t> postingOffsets;        // terms.size() + 1 offsets into the posting arrays
+    std::vector<int32_t> postingDocuments;       // Document numbers, sorted within each term
+    std::vector<int32_t> postingFrequencies;     // Frequencies matching postingDocuments
+    uint64_t highestClientID = 0;                // Highest numeric client ID seen
+    uint64_t logSequence = 0;                    // Last write-ahead log record included
+};
+
+// IndexSnapshot is a memory-mapped, immutable index image. Lookups binary search the mapped
+// sections directly, so opening a snapshot costs one mmap and a header check rather than a
+// deserialization pass over every term and posting.
+class IndexSnapshot {
+public:
+    // Current format version
+    static constexpr uint32_t formatVersion = 2;
+
+    // Serializes the contents to path, writing and syncing a temporary file and renaming it into place
+    static bool write(const std::string& path, const SnapshotContents& contents);
+
+    // Maps a snapshot file; returns nullptr (with a message in error) if it is missing or invalid
+    static std::shared_ptr<const IndexSnapshot> open(const std::string& path, std::string& error);
+
+    // Unmaps the file
+    ~IndexSnapshot();
+
+    IndexSnapshot(const IndexSnapshot&) = delete;
+    IndexSnapshot& operator=(const IndexSnapshot&) = delete;
+
+    // Number of documents stored (numbered 1..documentCount)
+    size_t documentCount() const { return header_.documentCount; }
+
+    // Number of distinct terms stored
+    size_t termCount() const { return header_.termCount; }
+
+    // Number of postings stored
+    size_t postingCount() const { return header_.postingCount; }
+
+    // Highest numeric client ID recorded when the snapshot was written
+    uint64_t highestClientID() const { return header_.highestClientID; }
+
+    // Last write-ahead log record included in the snapshot; later records must be replayed on top of it
+    uint64_t logSequence() const { return header_.logSequence; }
+
+    // Size of the mapped file in bytes
+    size_t mappedBytes() const { return size_; }
+
+    // Returns the "clientID:documentPath" key of a stored document (documentNumber in 1..documentCount)
+    std::string_view documentKey(int documentNumber) const;
+
+    // Returns the document number stored under the key, or 0 if it is not in the snapshot
+    int findDocument(std::string_view documentKey) const;
+
+    // Returns the term stored at the given position of the sorted dictionary
+    std::string_view term(size_t index) const;
+
+    // Returns the posting list stored for the term at the given position of the sorted dictionary
+    PostingView postings(size_t index) const;
+
+    // Returns the postings of a term (empty if the term is not in the snapshot)
+    PostingView findTerm(std::string_view term) const;
+
+    // Returns the largest frequency stored for the term at the given position; the first call per term reads it off
+    // the mapped frequencies, and later calls reuse it
+    int maxFrequency(size_t index) const;
+
+    // Returns the position of the first stored term that is not less than the given one (termCount if none)
+    size_t lowerBound(std::string_view term) const;
+
+private:
+    // Constructor adopts a validated mapping
+    IndexSnapshot(const char* data, size_t size, const SnapshotHeader& header);
+
+    const char* data_;       // Start of the mapping
+    size_t size_;            // Length of the mapping
+    SnapshotHeader header_;  // Copy of the validated header
+    std::unique_ptr<std::atomic<int>[]> maxFrequencies_; // Largest frequency of each term, 0 until first asked for
+
+    // Typed pointer to a section of the mapping
+    template <typename T>
+    const T* section(uint64_t offset) const { return reinterpret_cast<const T*>(data_ + offset); }
+};
+
+#endif // INDEX_SNAPSHOT_HPP
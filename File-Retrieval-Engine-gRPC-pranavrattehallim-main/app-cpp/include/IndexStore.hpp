@@ -1,50 +1,375 @@
 #ifndef INDEX_STORE_HPP
 #define INDEX_STORE_HPP
 
+#include <set>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <mutex>
 #include <shared_mutex>
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include "PostingList.hpp"
+#include "IndexSnapshot.hpp"
+#include "ServerStats.hpp" // For the lock wait counters
+#include "DocumentTombstones.hpp" // For deleted and replaced documents
+#include "FrozenTermDictionary.hpp" // For the frozen part of the term dictionary
+#include "DeltaSegment.hpp" // For batches published ahead of the merge
+
+// Estimated memory held by the IndexStore, broken down by structure
+struct IndexMemoryUsage {
+    size_t documentCount = 0;       // Number of live documents (deleted and replaced versions excluded)
+    size_t deletedDocuments = 0;    // Document numbers retired by a delete or a re-index
+    size_t pendingPurge = 0;        // Retired documents whose postings are still in the posting lists
+    size_t termCount = 0;           // Number of distinct terms in the inverted index
+    size_t frozenTermCount = 0;     // Terms held in the frozen dictionaries rather than the mutable overlays
+    size_t postingCount = 0;        // Total number of postings across all terms
+    size_t documentTableBytes = 0;  // Bytes used by the document table (keys, hash nodes, ID table)
+    size_t dictionaryBytes = 0;     // Bytes used by the term dictionary (term strings, hash nodes, frozen arenas)
+    size_t postingBytes = 0;        // Bytes used by the posting lists
+    size_t forwardIndexBytes = 0;   // Bytes used by the forward index and the tombstone set
+    size_t snapshotBytes = 0;       // Bytes of the memory-mapped snapshot (page cache, not heap)
+    size_t deltaSegments = 0;       // Published batches not yet merged into the shards
+    size_t deltaBytes = 0;          // Bytes held by those batches
+
+    // Total estimated heap bytes across all structures (the mapped snapshot is reported separately)
+    size_t totalBytes() const {
+        return documentTableBytes + dictionaryBytes + postingBytes + forwardIndexBytes + deltaBytes;
+    }
+};
+
+// Posting lists looked up once for a batch of searches, by term, for the terms several of its searches share.
+// Copies of a list share its frozen blocks, so handing one to each search costs no more than a lookup.
+using SharedPostings = std::unordered_map<std::string, PostingList>;
+
+// Dictionary value of a term: its postings and its slot in the shard's key table
+struct TermEntry {
+    PostingList postings; // Document numbers and frequencies, sorted by document number
+    uint32_t slot = 0;    // Index of the term in IndexShard::termKeys
+};
+
+// One hash partition of the term dictionary, guarded by its own lock. A term lives either in the frozen
+// dictionary, built by IndexStore::freezeDictionary(), or in the mutable overlay, never in both.
+struct IndexShard {
+    // Mutable overlay: terms added since the last freeze, mapped to their document numbers and frequencies
+    std::unordered_map<std::string, TermEntry> termInvertedIndex;
+
+    // The overlay's keys in term order, for prefix queries (hash node keys are stable)
+    std::set<std::string_view> overlayOrder;
+
+    // Frozen terms in one arena with a perfect hash over them, and their dictionary values by number. A frozen
+    // term whose postings were all purged keeps its entry, with no postings, until the next freeze.
+    FrozenTermDictionary frozenTerms;
+    std::vector<TermEntry> frozenEntries;
+
+    // Dictionary keys by slot, so the forward index can name a term in four bytes (hash node keys and frozen
+    // arena bytes are stable). Slots of erased terms are null and listed in freeSlots for reuse.
+    std::vector<std::string_view> termKeys;
+    std::vector<uint32_t> freeSlots;
+
+    // Sequence of the last delta segment merged into this shard; segments up to it are part of the postings above
+    uint64_t mergedSegments = 0;
+
+    // Shared mutex protecting this partition only
+    mutable std::shared_mutex mutex;
+};
 
 // IndexStore class handles document indexing and querying
 class IndexStore {
 public:
-    // Constructor initializes the document counter
-    IndexStore();
+    // Default number of term dictionary shards
+    static constexpr size_t defaultShardCount = 64;
+
+    // Pending delta segments, as a multiple of the merge threshold, at which a writer merges them itself
+    static constexpr size_t mergeBackpressure = 4;
+
+    // Largest number of dictionary terms a prefix term expands to unless the search asks otherwise
+    static constexpr size_t defaultMaxExpansions = 256;
+
+    // rankMatches counting-sorts by frequency unless the highest frequency exceeds this many times the matches
+    static constexpr size_t countingSortSpread = 4;
+
+    // Search hit: document number and the summed frequency of the query terms in that document
+    using Posting = std::pair<int, int>;
+
+    // A document number with the term frequency list to index for it
+    using DocumentTerms = std::pair<int, std::vector<std::pair<std::string, int>>>;
+
+    // Constructor initializes the document counter and splits the term dictionary into shardCount partitions
+    explicit IndexStore(size_t shardCount = defaultShardCount);
 
-    // Updates the TermInvertedIndex with terms and their frequencies for a document, including client ID
-    void updateIndex(const std::string& clientID, int documentNumber, const std::vector<std::pair<std::string, int>>& termFrequencyList);
+    // Stops the background purge and merge threads, if they were started
+    ~IndexStore();
 
-    // 1.1. Adds a document to the DocumentMap and returns a unique document number
-    int putDocument(const std::string& documentPath);
+    // Updates the TermInvertedIndex with terms and their frequencies for a document.
+    // Terms are grouped by shard so each shard is locked once per document. Once startBackgroundMerge() has run,
+    // the document is published as a delta segment instead and no shard lock is taken.
+    void updateIndex(int documentNumber, const std::vector<std::pair<std::string, int>>& termFrequencyList);
 
-    // 1.2. Retrieves the document path given a document number
+    // Updates the TermInvertedIndex for a batch of documents in one pass, locking each shard once per batch, or
+    // publishes the batch as one delta segment once startBackgroundMerge() has run
+    void updateIndexBatch(const std::vector<DocumentTerms>& documents);
+
+    // Folds every published delta segment into the shards, in publication order. Searches see the same postings
+    // before and after. Returns the number of segments merged.
+    size_t mergeDeltaSegments();
+
+    // Switches indexing to delta segments and starts a thread that merges them every interval, or early once
+    // segments are pending. A writer that finds mergeBackpressure times that many pending merges them itself.
+    void startBackgroundMerge(size_t segments, std::chrono::milliseconds interval);
+
+    // 1.1. Adds a client's document to the document table and returns a unique document number. A document that
+    // was indexed before gets a new number and its old one is tombstoned, so re-indexing replaces its postings
+    // instead of adding to them. Given replaced, the old number is appended there instead and stays searchable
+    // until the caller passes it to retireDocuments() after applying the new postings.
+    int putDocument(const std::string& clientID, const std::string& documentPath,
+                    std::vector<int>* replaced = nullptr);
+
+    // Adds a batch of a client's documents under one lock and returns their document numbers in order
+    std::vector<int> putDocuments(const std::string& clientID, const std::vector<std::string>& documentPaths,
+                                  std::vector<int>* replaced = nullptr);
+
+    // Tombstones the earlier versions handed back by putDocument(s), under one lock
+    void retireDocuments(const std::vector<int>& documentNumbers);
+
+    // Removes a client's documents from search results by tombstoning them; their postings are dropped later by
+    // purgeDeleted(). Returns the number of documents that were indexed.
+    size_t deleteDocuments(const std::string& clientID, const std::vector<std::string>& documentPaths);
+
+    // Removes the postings of tombstoned documents from the posting lists. The forward index names the terms of
+    // each document, so only those lists are visited, and only their blocks holding a removed document are
+    // re-encoded. Postings in a loaded snapshot are dropped by the next saveSnapshot instead. Returns the number
+    // of postings removed.
+    size_t purgeDeleted();
+
+    // Starts a thread that calls purgeDeleted() once minimumDocuments tombstoned documents are waiting, or every
+    // interval while any are
+    void startBackgroundPurge(size_t minimumDocuments, std::chrono::milliseconds interval);
+
+    // 1.2. Retrieves the "clientID:documentPath" key given a document number
     std::string getDocument(int documentNumber) const;
 
-    // 1.3. Queries the TermInvertedIndex for a term and returns a list of document IDs and frequencies
-    std::vector<std::pair<std::string, int>> lookupIndex(const std::string& lowertermfromPE) const;
+    // 1.3. Queries the TermInvertedIndex for a term and returns its posting list sorted by document number.
+    // Only the shard owning the term is read-locked, and only while its frozen blocks are shared with the returned
+    // copy; the query then reads that version while writers move on to their own. Postings stored in the snapshot
+    // lead the list as a view of the mapped file rather than a copy.
+    PostingList lookupIndex(const std::string& lowertermfromPE) const;
+
+    // Whether a search term is a prefix term: a non-empty prefix followed by a trailing '*'
+    static bool isPrefixTerm(const std::string& term) { return term.size() > 1 && term.back() == '*'; }
+
+    // Returns the terms starting with prefix in term order, from the snapshot, the frozen dictionaries and the
+    // overlays. At most limit are returned, the first in term order; truncated (if given) tells whether more matched.
+    std::vector<std::string> expandPrefix(std::string_view prefix, size_t limit, bool* truncated = nullptr) const;
+
+    // 1.4. Retrieves the top N results for the given terms, sorted by frequency and considering the AND search logic.
+    // A prefix term matches the union of up to maxExpansions terms it expands to; expandedTerms (if given) receives
+    // the number of terms the prefixes expanded to and expansionTruncated whether any prefix hit the cap.
+    // When totalMatches is given it receives the number of documents matching every term; totalExact (if given)
+    // is false when early termination skipped documents, making that number a lower bound. Plain terms found in
+    // shared (if given) take the list there instead of looking it up again.
+    std::vector<std::pair<std::string, int>> getTopResults(const std::vector<std::string>& terms, size_t topN,
+                                                           size_t* totalMatches = nullptr, bool* totalExact = nullptr,
+                                                           size_t maxExpansions = defaultMaxExpansions,
+                                                           size_t* expandedTerms = nullptr,
+                                                           bool* expansionTruncated = nullptr,
+                                                           const SharedPostings* shared = nullptr);
+
+    // Returns every document matching all the terms, highest summed frequency first and ties in document order (the
+    // order getTopResults uses), with prefix terms expanded as there. Documents are numbers for getDocument().
+    std::vector<Posting> rankMatches(const std::vector<std::string>& terms,
+                                     size_t maxExpansions = defaultMaxExpansions, size_t* expandedTerms = nullptr,
+                                     bool* expansionTruncated = nullptr) const;
+
+    // Whether a document number has been retired by a delete or a re-index; takes no lock
+    bool isRetired(int documentNumber) const { return tombstones.contains(documentNumber); }
+
+    // Estimates the memory held by the document table, term dictionary and posting lists
+    IndexMemoryUsage estimateMemoryUsage() const;
+
+    // Merges pending delta segments, then compresses every posting list's uncompressed tail and releases spare
+    // capacity, one shard at a time
+    void compactPostings();
+
+    // Merges pending delta segments, then moves each shard's terms into its frozen dictionary, one shard at a time, dropping terms left without
+    // postings. Terms indexed afterwards go to the mutable overlay until the next freeze. Returns the number of
+    // frozen terms.
+    size_t freezeDictionary();
+
+    // Writes the whole index (snapshot base plus in-memory updates) to a snapshot file. Tombstoned documents are
+    // left out and the rest renumbered densely. logSequence records the last write-ahead log record the index
+    // includes. Pending delta segments are merged first, so indexing must be paused for the image to be complete.
+    bool saveSnapshot(const std::string& path, uint64_t logSequence = 0);
+
+    // Maps a snapshot file as the read-only base of an empty store; returns false (with a message) on failure
+    bool loadSnapshot(const std::string& path, std::string& error);
 
-    // 1.4. Retrieves the top N results for the given terms, sorted by frequency and considering the AND search logic
-    std::vector<std::pair<std::string, int>> getTopResults(const std::vector<std::string>& terms, size_t topN);
+    // Last write-ahead log record included in the loaded snapshot (0 without one)
+    uint64_t snapshotLogSequence() const;
+
+    // Highest numeric client ID that has indexed a document, including those recorded in the snapshot
+    uint64_t highestClientID() const;
+
+    // Counter bumped after every change to the postings; search results computed at one generation stay valid
+    // until it moves on
+    uint64_t generation() const { return generationCounter.load(std::memory_order_acquire); }
+
+    // Time spent waiting for the document table lock by indexing, lookups and result resolution
+    LockWaitSummary documentLockWaits() const { return documentLockWait.summary(); }
+
+    // Time spent waiting for the term dictionary shard locks by indexing and posting list lookups
+    LockWaitSummary shardLockWaits() const { return shardLockWait.summary(); }
 
 private:
     // Document counter for generating unique document numbers
     int documentCounter;
 
-    // Mapping of document number to document path
-    std::unordered_map<int, std::string> documentMap;
+    // Read-only base loaded from a snapshot; holds documents 1..snapshotDocuments and their postings
+    std::shared_ptr<const IndexSnapshot> snapshot;
+
+    // Number of documents stored in the snapshot; documentMap starts after them
+    int snapshotDocuments = 0;
 
-    // Mapping of document path to document number
+    // Highest numeric client ID seen by putDocument or recorded in the snapshot
+    uint64_t highestClient = 0;
+
+    // Index generation, bumped once an update is fully applied so no reader can cache a half-applied state
+    std::atomic<uint64_t> generationCounter{0};
+
+    // Mapping of document number (after the snapshot's) to its "clientID:documentPath" key; points at the key owned by pathToNumber
+    std::vector<const std::string*> documentMap;
+
+    // Mapping of "clientID:documentPath" key to document number; owns the only copy of each key
     std::unordered_map<std::string, int> pathToNumber;
 
-    // Inverted index: maps terms to a list of document IDs (including client ID) and their frequencies
-    std::unordered_map<std::string, std::vector<std::pair<std::string, int>>> termInvertedIndex;
+    // Inverted index split into hash partitions of the term space, each with its own lock
+    std::vector<IndexShard> shards;
 
-    // Mutexes for protecting shared data
+    // Mutex for protecting the document table
     mutable std::shared_mutex documentMutex;         // Shared mutex for documentMap and pathToNumber
-    mutable std::shared_mutex invertedIndexMutex;    // Shared mutex for termInvertedIndex
+
+    // Document numbers retired by a delete or a re-index; searches skip them without taking a lock
+    DocumentTombstones tombstones;
+
+    // Earlier versions handed back by putDocument(s) and not yet retired, mapped to the number replacing them;
+    // guarded by documentMutex. pendingReplacements mirrors its size so searches can skip the lock while it is 0.
+    std::unordered_map<int, int> replacedBy;
+    std::atomic<size_t> pendingReplacements{0};
+
+    // Forward index: terms of each document after the snapshot's, as term references (see termReference). An
+    // entry is released once its postings are purged.
+    std::vector<std::vector<uint32_t>> forwardIndex;
+
+    // Tombstoned documents whose postings are still in the posting lists
+    std::vector<int> purgeQueue;
+
+    // Guards forwardIndex, purgeQueue and purgeThreshold. Separate from documentMutex so recording a batch's terms
+    // does not hold up path lookups; when both are taken, documentMutex comes first.
+    mutable std::mutex forwardMutex;
+
+    // Serializes purges; only a purge erases term dictionary entries and frees their key table slots
+    std::mutex purgeMutex;
+
+    // Background purge thread and its wake-up state
+    std::thread purgeThread;
+    std::mutex purgeWaitMutex;           // Guards stopPurge
+    std::condition_variable purgeCv;     // Signalled when enough documents are queued or the store is destroyed
+    bool stopPurge = false;              // Set by the destructor
+    size_t purgeThreshold = 0;           // Queued documents that wake the thread early; guarded by forwardMutex
+
+    // Delta segments published and not yet merged into every shard, replaced whole on every change so a reader
+    // can keep the list it loaded; guarded by segmentsMutex
+    std::shared_ptr<const DeltaSegmentList> pendingSegments = std::make_shared<const DeltaSegmentList>();
+    uint64_t lastSegmentSequence = 0;    // Sequence given to the last published segment; guarded by segmentsMutex
+    mutable std::mutex segmentsMutex;
+
+    // Serializes merges, so segments are folded into each shard in publication order; memory estimates take it too,
+    // so they never count a segment both in the list and in the shards
+    mutable std::mutex mergeMutex;
+
+    // Pending segments that wake the merge thread early; 0 until startBackgroundMerge() switches indexing to segments
+    std::atomic<size_t> mergeThreshold{0};
+
+    // Background merge thread and its wake-up state
+    std::thread mergeThread;
+    std::mutex mergeWaitMutex;           // Guards stopMerge
+    std::condition_variable mergeCv;     // Signalled when enough segments are pending or the store is destroyed
+    bool stopMerge = false;              // Set by the destructor
+
+    // Wait counters of the hot-path acquisitions of documentMutex and of the shard mutexes (maintenance such as
+    // snapshots and compaction is not counted)
+    mutable LockWaitCounter documentLockWait;
+    mutable LockWaitCounter shardLockWait;
+
+    // One term frequency of one document, tagged with the shard that owns the term
+    struct ShardUpdate {
+        size_t shard;                                    // Shard owning the term
+        uint64_t hash;                                   // Hash of the term, reused to probe the frozen dictionary
+        int documentNumber;                              // Document the term occurs in
+        const std::pair<std::string, int>* termFrequency; // Term and its frequency in the document
+        size_t position;                                 // Position before sorting; a document's terms are adjacent
+    };
+
+    // Returns the index of the shard that owns a term with the given FrozenTermDictionary::hash()
+    size_t shardFor(uint64_t termHash) const { return termHash % shards.size(); }
+
+    // Bits of a term reference that hold the shard; the slot in the shard's key table sits above them
+    unsigned shardBits = 0;
+
+    // Packs a shard and a key table slot into a forward index entry
+    uint32_t termReference(size_t shard, uint32_t slot) const { return (slot << shardBits) | static_cast<uint32_t>(shard); }
+
+    // Fetches the posting list of every search term, the union of its expansions for a prefix term; plain terms
+    // come from shared when it holds them
+    std::vector<PostingList> termPostings(const std::vector<std::string>& terms, size_t maxExpansions,
+                                          size_t* expandedTerms, bool* expansionTruncated,
+                                          const SharedPostings* shared = nullptr) const;
+
+    // Adds the term to the shard if it is new, giving it a key table slot; the shard's lock must be held exclusively
+    TermEntry& termEntryLocked(IndexShard& shard, const std::string& term, uint64_t termHash);
+
+    // Finds the term in the frozen dictionary, then the overlay; the shard's lock must be held
+    static const TermEntry* findTermLocked(const IndexShard& shard, const std::string& term, uint64_t termHash);
+
+    // Assigns a new document number to the key, retiring any earlier version or appending it to replaced;
+    // documentMutex must be held exclusively
+    int putDocumentLocked(std::string documentKey, std::vector<int>* replaced);
+
+    // Number of the key's live document, in memory or in the snapshot, or 0; documentMutex must be held
+    int liveDocumentLocked(const std::string& documentKey) const;
+
+    // Records the client as having indexed documents; documentMutex must be held exclusively
+    void noteClientLocked(const std::string& clientID);
+
+    // Tombstones the key's current document, if any; documentMutex must be held exclusively. Returns true if a
+    // live document was retired.
+    bool retireDocumentLocked(const std::string& documentKey);
+
+    // Tombstones one document number and queues it for purging; documentMutex must be held exclusively
+    void tombstoneLocked(int documentNumber);
+
+    // Removes the hits on an earlier version whose replacement is among the hits too, so a search racing a re-index
+    // names each path once; the order of the rest is kept. Returns the number of hits removed.
+    size_t dropReplaced(std::vector<Posting>& hits) const;
+
+    // Applies the updates grouped by shard, taking each shard's exclusive lock once, then records the forward index
+    void applyShardUpdates(std::vector<ShardUpdate>& updates);
+
+    // Builds a delta segment from the batch and makes it visible to searches, merging if the merger falls behind
+    void publishSegment(const std::vector<DocumentTerms>& documents);
+
+    // Appends (document, term reference) pairs to the forward index; the pairs of a document must be adjacent
+    void recordForwardTerms(const std::vector<std::pair<int, uint32_t>>& terms);
+
+    // Current list of pending delta segments
+    std::shared_ptr<const DeltaSegmentList> loadSegments() const;
 };
 
 #endif // INDEX_STORE_HPP
@@ -0,0 +1,61 @@
+#ifndef INDEX_WIRE_FORMAT_HPP
+#define INDEX_WIRE_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <grpc/compression.h> // For grpc_compression_algorithm
+#include "proto/File-Retrieval-Engine.pb.h"
+
+// Compact encoding of an indexing stream. The stream carries its own term dictionary: a batch lists the terms it
+// adds in new_terms, the first taking the ID after the last one the stream has assigned, and documents name their
+// terms by ID in term_ids, with the matching counts in term_counts. Each term crosses the wire once per stream,
+// and the rest of the stream is packed varints. Plain word_frequencies may be mixed in freely.
+
+// Client side: assigns IDs as the tokenizer workers encode their documents. Several workers may encode at once;
+// lookups of terms already known share the lock, so only a document with new terms takes it exclusively.
+class SessionTermEncoder {
+public:
+    // Fills in the document's term IDs and counts, giving terms seen for the first time the next IDs
+    void encode(const std::unordered_map<std::string, int>& wordFrequencies, fre::IndexReq& document);
+
+    // Moves the terms given IDs since the last call into the batch, in ID order. Called just before the batch is
+    // written, it announces every ID the batch's documents use, since they were encoded before being queued.
+    void takeNewTerms(fre::IndexBatch& batch);
+
+    // Terms given an ID so far
+    size_t termCount() const;
+
+private:
+    mutable std::shared_mutex mutex_;                // Shared for lookups, exclusive to add terms
+    std::unordered_map<std::string, uint32_t> ids_;  // ID of every term seen on the stream
+    std::vector<std::string> newTerms_;              // Terms given IDs but not yet moved into a batch, in ID order
+};
+
+// Server side: the dictionary of one indexing stream, rebuilt from the batches' new terms as they arrive
+class SessionTermDecoder {
+public:
+    // Most terms one stream may add to its dictionary
+    static constexpr size_t maxTerms = 1 << 24;
+
+    // Adds the batch's new terms, then resolves every document's term IDs and appends its plain word frequencies.
+    // Returns false with a reason if the batch names an unknown ID, has mismatched IDs and counts, has a count
+    // below 1 (or above INT_MAX), or grows the dictionary past maxTerms.
+    bool decode(const fre::IndexBatch& batch, std::vector<std::vector<std::pair<std::string, int>>>& documents,
+                std::string& error);
+
+    // Terms in the dictionary
+    size_t termCount() const { return terms_.size(); }
+
+private:
+    std::vector<std::string> terms_; // Term of each ID
+};
+
+// Parses "none", "deflate" or "gzip"; false for anything else
+bool parseCompressionAlgorithm(const std::string& name, grpc_compression_algorithm& algorithm);
+
+#endif // INDEX_WIRE_FORMAT_HPP
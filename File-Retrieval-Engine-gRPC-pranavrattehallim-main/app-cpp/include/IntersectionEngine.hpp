@@ -0,0 +1,36 @@
+#ifndef INTERSECTION_ENGINE_HPP
+#define INTERSECTION_ENGINE_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "PostingList.hpp"
+#include "DocumentTombstones.hpp"
+
+// IntersectionEngine evaluates AND queries over sorted posting lists, and the OR of a prefix term's expansions
+class IntersectionEngine {
+public:
+    // Intersects the lists, summing frequencies of matching documents; results are in document order.
+    // Lists are processed from the rarest to the most common; longer lists skip whole blocks they cannot match.
+    // Documents in deleted (if given) are left out.
+    static std::vector<std::pair<int, int>> intersect(std::vector<const PostingList*> lists,
+                                                      const DocumentTombstones* deleted = nullptr);
+
+    // Returns the k best matches of the AND query, highest summed frequency first and ties in document order.
+    // Once k matches are held, blocks and documents whose frequency bounds cannot beat the k-th score are skipped
+    // without being intersected. matches receives the number of matches seen; exact tells whether that is the
+    // full count (false once anything was skipped). Documents in deleted (if given) neither count nor score.
+    static std::vector<std::pair<int, int>> intersectTopK(std::vector<const PostingList*> lists, size_t k,
+                                                          size_t* matches = nullptr, bool* exact = nullptr,
+                                                          const DocumentTombstones* deleted = nullptr);
+
+    // Merges the lists into one, summing the frequencies of documents found in several of them. A few lists are
+    // merged through a heap keyed on each list's next document, at log(lists) per posting; many lists whose postings
+    // cover their document range densely are summed into an array indexed by document number instead.
+    static PostingList unionPostings(const std::vector<const PostingList*>& lists);
+
+    // Returns the first position at or after 'from' whose document number is >= target (size if none)
+    static size_t advanceTo(const int* documents, size_t size, size_t from, int target);
+};
+
+#endif // INTERSECTION_ENGINE_HPP
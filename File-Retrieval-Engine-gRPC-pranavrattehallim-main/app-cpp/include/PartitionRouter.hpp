@@ -0,0 +1,104 @@
+#ifndef PARTITION_ROUTER_HPP
+#define PARTITION_ROUTER_HPP
+
+#include <grpcpp/grpcpp.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "proto/File-Retrieval-Engine.grpc.pb.h"
+#include "ServerStats.hpp" // For the router's own RPC latencies
+
+// Front end of a partitioned deployment. Every document lives on exactly one file-retrieval-server (its partition),
+// chosen by hashing the "clientID:documentPath" key, so each partition holds complete posting lists for its share
+// of the documents. Indexing and deletes are routed to the owning partition; a search is sent to every partition
+// at once and their top K lists are merged.
+class PartitionRouter final : public fre::FileRetrievalEngine::Service {
+public:
+    // Constructor opens a channel to each partition, given as "host:port"; the order fixes the routing
+    explicit PartitionRouter(const std::vector<std::string>& partitionAddresses);
+
+    // Index of the partition that owns a client's document, out of partitionCount
+    static size_t partitionFor(const std::string& clientID, const std::string& documentPath, size_t partitionCount);
+
+    // Number of partitions behind the router
+    size_t partitionCount() const { return partitions_.size(); }
+
+    // Prints the router's RPC latencies and the index, lock and cache counters summed over the partitions
+    void reportStats();
+
+    // Routes the document to its partition
+    grpc::Status ComputeIndex(
+        grpc::ServerContext* context,
+        const fre::IndexReq* request,
+        fre::IndexRep* response) override;
+
+    // Splits every batch by partition and forwards the pieces over one stream per partition
+    grpc::Status ComputeIndexStream(
+        grpc::ServerContext* context,
+        grpc::ServerReader<fre::IndexBatch>* reader,
+        fre::IndexStreamRep* response) override;
+
+    // Searches every partition concurrently and merges their results
+    grpc::Status ComputeSearch(
+        grpc::ServerContext* context,
+        const fre::SearchReq* request,
+        fre::SearchRep* response) override;
+
+    // Sends the whole batch to every partition concurrently and merges their results search by search
+    grpc::Status ComputeSearchBatch(
+        grpc::ServerContext* context,
+        const fre::SearchBatchReq* request,
+        fre::SearchBatchRep* response) override;
+
+    // Sends each path to the partition that owns it
+    grpc::Status ComputeDelete(
+        grpc::ServerContext* context,
+        const fre::DeleteReq* request,
+        fre::DeleteRep* response) override;
+
+    // Client IDs are handed out by the first partition so they are unique across the deployment
+    grpc::Status GetClientID(
+        grpc::ServerContext* context,
+        const fre::ConnectReq* request,
+        fre::ConnectRep* response) override;
+
+    // Acknowledges a shutdown notification; the partitions are left running
+    grpc::Status Shutdown(
+        grpc::ServerContext* context,
+        const fre::ShutdownReq* request,
+        fre::ShutdownRep* response) override;
+
+    // Reports the router's RPC latencies with the partitions' index, lock and cache counters summed
+    grpc::Status GetStats(
+        grpc::ServerContext* context,
+        const fre::StatsReq* request,
+        fre::StatsRep* response) override;
+
+private:
+    // Connection to one partition
+    struct Partition {
+        std::string address;                                    // "host:port" of the partition's server
+        std::unique_ptr<fre::FileRetrievalEngine::Stub> stub;   // Stub shared by all calls to the partition
+    };
+
+    // Partitions in routing order
+    std::vector<Partition> partitions_;
+
+    // Latency histograms of the calls the router served
+    ServerStats stats_;
+
+    // Gathers the reply GetStats returns; the first partition error is returned
+    grpc::Status collectStats(fre::StatsRep* reply);
+
+    // Prefixes a partition's error with its address so clients can tell which server failed
+    grpc::Status partitionError(size_t partition, const grpc::Status& status) const;
+
+    // Handlers without latency recording, wrapped by the overrides above
+    grpc::Status routeIndexStream(grpc::ServerReader<fre::IndexBatch>* reader, fre::IndexStreamRep* response);
+    grpc::Status scatterSearch(const fre::SearchReq* request, fre::SearchRep* response);
+    grpc::Status scatterSearchBatch(const fre::SearchBatchReq* request, fre::SearchBatchRep* response);
+    grpc::Status routeDelete(const fre::DeleteReq* request, fre::DeleteRep* response);
+};
+
+#endif // PARTITION_ROUTER_HPP
@@ -0,0 +1,189 @@
+#ifndef POSTING_LIST_HPP
+#define POSTING_LIST_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "IndexSnapshot.hpp" // For PostingView
+
+// Metadata of one frozen, bit-packed block of postings
+struct PostingBlock {
+    int lastDocument;       // Largest document number in the block; lets iterators skip the block without decoding it
+    int maxFrequency;       // Largest frequency in the block; bounds the score any of its documents can add
+    uint32_t offset;        // Index of the block's first word in the packed array
+    uint16_t count;         // Number of postings in the block
+    uint8_t documentBits;   // Bit width of each document number gap
+    uint8_t frequencyBits;  // Bit width of each frequency
+};
+
+// Frozen blocks of a list and their packed words. Copies of a list share them until one side changes a block,
+// which then gets its own copy first; readers holding a copy never see the blocks change under them.
+struct FrozenPostings {
+    std::vector<PostingBlock> blocks; // Frozen blocks in document order
+    std::vector<uint32_t> packed;     // Bit-packed gaps and frequencies of every frozen block
+};
+
+class PostingIterator;
+
+// Posting list sorted by ascending document number. Postings are appended to a small mutable tail; every
+// blockSize postings the tail is frozen into an immutable block that stores the gaps between document numbers
+// and the frequencies bit-packed at the narrowest width that fits the block. Copying a list shares its frozen
+// blocks and copies only the tail, so a copy costs the same however long the list is.
+// A list returned by a lookup may also lead with postings stored in the snapshot, which it reads in place from the
+// mapped file; such a list is only read, never changed.
+class PostingList {
+public:
+    // Postings per frozen block
+    static constexpr size_t blockSize = 128;
+
+    // Largest a block may grow through out-of-order inserts before it is split in two
+    static constexpr size_t maxBlockSize = 2 * blockSize;
+
+    // Number of postings in the list
+    size_t size() const { return stored_.size + count_; }
+
+    // True when the term occurs in no document
+    bool empty() const { return size() == 0; }
+
+    // Largest frequency of any posting in the list
+    int maxFrequency() const { return std::max(storedMaxFrequency_, maxFrequency_); }
+
+    // Puts snapshot postings, all numbered below the list's own documents, in front of the list without copying
+    // them; maxFrequency is their largest frequency
+    void setStored(const PostingView& stored, int maxFrequency);
+
+    // Adds the frequency to the document's posting, inserting it in document order if missing
+    void add(int documentNumber, int frequency);
+
+    // Adds postings given in ascending document order, as add() would; the blocks from the first one they fall
+    // into are decoded and rebuilt once for the whole run instead of once per posting
+    void addSorted(const int* documents, const int* frequencies, size_t count);
+
+    // Freezes a partly filled tail into a short block and releases spare capacity; used once ingest settles
+    void compact();
+
+    // Removes the postings of the given documents (sorted ascending, absent ones ignored); only the blocks holding
+    // one of them are decoded and re-encoded. Returns the number of postings removed.
+    size_t remove(const std::vector<int>& documents);
+
+    // Returns an iterator positioned at the first posting
+    PostingIterator begin() const;
+
+    // Decodes every posting, in document order, onto the end of the two arrays
+    void decode(std::vector<int>& documents, std::vector<int>& frequencies) const;
+
+    // Bytes held by the list's block table, packed words and tail
+    size_t memoryBytes() const;
+
+private:
+    friend class PostingIterator;
+
+    PostingView stored_;                     // Snapshot postings ahead of the blocks, read from the mapping
+    int storedMaxFrequency_ = 0;             // Largest frequency among stored_
+    std::shared_ptr<FrozenPostings> frozen_; // Frozen blocks, shared with copies; null until the first block
+    std::vector<int> tailDocuments_;       // Postings after the last frozen block, uncompressed
+    std::vector<int> tailFrequencies_;     // Frequencies matching tailDocuments_
+    size_t count_ = 0;                     // Postings across the blocks and the tail
+    int maxFrequency_ = 0;                 // Largest frequency across the blocks and the tail
+
+    // Frozen blocks and packed words, empty before the first block
+    const std::vector<PostingBlock>& blocks() const;
+    const std::vector<uint32_t>& packed() const { return frozen_->packed; }
+
+    // Frozen blocks for changing, copied first if a copy of the list still shares them
+    FrozenPostings& ownFrozen();
+
+    // Compresses the tail into a new block at the end of the list
+    void freezeTail();
+
+    // Re-encodes the given block after an insert or removal, splitting it when it grew too large and dropping it
+    // when nothing is left
+    void rewriteBlock(size_t block, const int* documents, const int* frequencies, size_t count);
+
+    // Encodes sorted postings as bit-packed gaps from previousDocument and appends the words to out
+    static PostingBlock encodeBlock(const int* documents, const int* frequencies, size_t count, int previousDocument,
+                                    std::vector<uint32_t>& out);
+
+    // Decodes the block into the two arrays (each with room for maxBlockSize entries)
+    void decodeBlock(size_t block, int* documents, int* frequencies) const;
+
+    // Decodes the block's gaps from previousDocument, for a block whose predecessor has just been rewritten
+    void decodeBlock(size_t block, int previousDocument, int* documents, int* frequencies) const;
+};
+
+// Forward iterator over a posting list. advance() skips whole blocks by their last document number and only
+// decodes the block the target falls in. Stored postings are walked first, in chunks of blockSize read in place.
+class PostingIterator {
+public:
+    // Constructor positions the iterator at the first posting of the list
+    explicit PostingIterator(const PostingList& list);
+
+    // True once every posting has been visited
+    bool atEnd() const { return position_ >= size_; }
+
+    // Document number at the current position
+    int document() const { return documents()[position_]; }
+
+    // Frequency at the current position
+    int frequency() const { return frequencies()[position_]; }
+
+    // Moves to the next posting
+    void next();
+
+    // Moves to the first posting whose document number is at least target (never moves backwards)
+    void advance(int target);
+
+    // Skips the rest of the current block and decodes the next one
+    void nextBlock();
+
+    // Largest frequency in the current block
+    int blockMaxFrequency() const { return blockMaxFrequency_; }
+
+    // Largest frequency in the block that would hold target, found without decoding anything; -1 past the last
+    // posting. Targets must not decrease between calls.
+    int maxFrequencyAt(int target);
+
+private:
+    const PostingList* list_;   // List being iterated
+    const std::vector<PostingBlock>* blocks_; // The list's frozen blocks
+    size_t storedChunks_;       // Chunks of stored postings, numbered before the frozen blocks
+    size_t tailBlock_;          // Number of the tail: stored chunks plus frozen blocks
+    size_t block_;              // Current stored chunk, frozen block (after the chunks) or tail
+    size_t position_ = 0;       // Position within the current block or tail
+    size_t size_ = 0;           // Postings in the current block or tail
+    int blockMaxFrequency_ = 0; // Largest frequency in the current block or tail
+    size_t shallowBlock_ = 0;   // Block last located by maxFrequencyAt, never behind block_
+    int tailMaxFrequency_ = 0;  // Largest frequency in the list's tail
+    size_t shallowChunk_ = SIZE_MAX; // Stored chunk whose largest frequency maxFrequencyAt last worked out
+    int shallowChunkMax_ = 0;   // That chunk's largest frequency
+    int decodedDocuments_[PostingList::maxBlockSize];    // Current block's document numbers
+    int decodedFrequencies_[PostingList::maxBlockSize];  // Current block's frequencies
+
+    // Decodes the given block, points at the given stored chunk, or switches to the tail at tailBlock_
+    void load(size_t block);
+
+    // Last document number of a stored chunk or frozen block
+    int lastDocument(size_t block) const;
+
+    // Postings in a stored chunk, and their largest frequency
+    size_t chunkSize(size_t chunk) const;
+    int chunkMaxFrequency(size_t chunk) const;
+
+    // Document numbers of the current chunk, block or tail
+    const int* documents() const {
+        return block_ < storedChunks_ ? list_->stored_.documents + block_ * PostingList::blockSize
+             : block_ < tailBlock_    ? decodedDocuments_
+                                      : list_->tailDocuments_.data();
+    }
+
+    // Frequencies of the current chunk, block or tail
+    const int* frequencies() const {
+        return block_ < storedChunks_ ? list_->stored_.frequencies + block_ * PostingList::blockSize
+             : block_ < tailBlock_    ? decodedFrequencies_
+                                      : list_->tailFrequencies_.data();
+    }
+};
+
+#endif // POSTING_LIST_HPP
@@ -0,0 +1,85 @@
+#ifndef REPLICA_FOLLOWER_HPP
+#define REPLICA_FOLLOWER_HPP
+
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "proto/File-Retrieval-Engine.grpc.pb.h"
+#include "IndexStore.hpp"
+
+// How far a replica is behind its primary
+struct ReplicationLag {
+    bool connected = false;        // Whether the update stream is open
+    uint64_t appliedSequence = 0;  // Last update applied to the replica's index
+    uint64_t primarySequence = 0;  // Last update the primary had published when it last reported
+    double seconds = 0.0;          // Time since the replica was last caught up (0 while it is)
+};
+
+// Keeps a read-only copy of a primary's index. bootstrap() downloads the primary's snapshot and maps it; start()
+// then follows the primary's update stream from the snapshot's last sequence number on, applying updates in order
+// on one thread while the replica's searches run. A lost stream is reopened from the last update applied.
+class ReplicaFollower {
+public:
+    // Constructor opens a channel to the primary, given as "host:port"
+    explicit ReplicaFollower(const std::string& primaryAddress);
+
+    // Stops following
+    ~ReplicaFollower();
+
+    ReplicaFollower(const ReplicaFollower&) = delete;
+    ReplicaFollower& operator=(const ReplicaFollower&) = delete;
+
+    // Downloads the primary's snapshot to snapshotPath, maps it into a new store and opens the update stream after
+    // it. Starts over if the primary dropped the updates after that snapshot in the meantime. Returns nullptr (with
+    // a message in error) if the primary cannot be reached or refuses replicas.
+    std::shared_ptr<IndexStore> bootstrap(const std::string& snapshotPath, std::string& error);
+
+    // Starts the thread applying the primary's updates to the bootstrapped store
+    void start();
+
+    // Stops the thread; the store keeps the updates applied so far
+    void stop();
+
+    // Address of the primary
+    const std::string& primary() const { return primaryAddress_; }
+
+    // Reads the replica's position against the primary's
+    ReplicationLag lag() const;
+
+private:
+    // Streams the primary's snapshot into a file; sets found to false if the primary has none
+    bool downloadSnapshot(const std::string& path, bool& found, std::string& error);
+
+    // Opens the update stream after the last update applied and waits for the primary's first heartbeat.
+    // Returns the stream status on failure (OUT_OF_RANGE when the primary no longer has those updates).
+    grpc::Status openStream();
+
+    // Thread body: applies batches until stopped, reopening the stream after a failure
+    void followLoop();
+
+    // Decodes a batch and applies the records the store does not have yet, in order
+    bool applyBatch(const fre::ReplicationBatch& batch);
+
+    // Records the primary's position after a batch was applied
+    void notePrimary(uint64_t primarySequence);
+
+    std::string primaryAddress_;                                // "host:port" of the primary
+    std::unique_ptr<fre::FileRetrievalEngine::Stub> stub_;      // Stub for the primary
+    std::shared_ptr<IndexStore> store_;                         // Index the updates are applied to
+    std::unique_ptr<grpc::ClientContext> context_;              // Context of the open update stream
+    std::unique_ptr<grpc::ClientReader<fre::ReplicationBatch>> stream_; // Open update stream, or null
+    std::mutex streamMutex_;                                    // Guards context_ so stop() can cancel the stream
+    std::thread thread_;                                        // Runs followLoop
+    std::atomic<bool> stopping_{false};                         // Set by stop()
+    std::atomic<bool> connected_{false};                        // Whether the stream is open
+    std::atomic<uint64_t> appliedSequence_{0};                  // Last update applied
+    std::atomic<uint64_t> primarySequence_{0};                  // Primary's last published update, as last reported
+    std::atomic<int64_t> caughtUpAt_{0};                        // steady_clock ticks when applied last reached the primary
+};
+
+#endif // REPLICA_FOLLOWER_HPP
@@ -0,0 +1,96 @@
+#ifndef REPLICATION_LOG_HPP
+#define REPLICATION_LOG_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Counters of the replication log
+struct ReplicationLogStats {
+    uint64_t lastSequence = 0; // Last update published in order
+    size_t bytes = 0;          // Bytes of updates held
+    size_t subscribers = 0;    // Replicas currently reading
+};
+
+// Updates read by a replica: whole publications, back to back in write-ahead log framing
+struct ReplicationUpdates {
+    uint64_t firstSequence = 0; // Sequence number of the first record
+    uint64_t lastSequence = 0;  // Sequence number of the last record
+    std::string records;        // Encoded records
+};
+
+// In-memory feed of the index updates made since the last snapshot, for replicas to follow. Updates are kept in
+// the write-ahead log's record encoding and numbered like the log, so a replica that loaded a snapshot can ask
+// for everything after the snapshot's last sequence number. Updates are dropped once a newer snapshot covers them
+// and every connected replica has read them.
+class ReplicationLog {
+public:
+    // Outcome of a read
+    enum class ReadResult {
+        Records, // Updates were copied
+        Timeout, // Nothing new arrived in time
+        Closed   // The log was closed
+    };
+
+    // Constructor starts the feed after lastSequence, the last update covered by the loaded snapshot
+    explicit ReplicationLog(uint64_t lastSequence);
+
+    // Publishes count encoded records ending at lastSequence, the number the write-ahead log gave them. Records
+    // that arrive ahead of a gap wait until the gap is filled, so readers always see log order. With lastSequence
+    // 0 (no log) the records are numbered after the last ones published. Returns the last record's number.
+    uint64_t publish(const std::string& records, size_t count, uint64_t lastSequence = 0);
+
+    // Last update published in order
+    uint64_t lastSequence() const;
+
+    // Allows updates up to sequence to be dropped once no replica still needs them; called after a snapshot
+    void trim(uint64_t sequence);
+
+    // Registers a replica that already has every update up to afterSequence. Returns false if the updates after it
+    // were already dropped, or were never published.
+    bool subscribe(uint64_t afterSequence, uint64_t& subscriber);
+
+    // Forgets a replica's position so its updates can be dropped
+    void unsubscribe(uint64_t subscriber);
+
+    // Waits up to timeout for updates after the replica's position and copies whole publications, at least one and
+    // up to about maxBytes, then advances the position past them
+    ReadResult read(uint64_t subscriber, size_t maxBytes, std::chrono::milliseconds timeout,
+                    ReplicationUpdates& updates);
+
+    // Wakes every reader and makes further reads return Closed; called before the server shuts down
+    void close();
+
+    // Returns the publication, size and reader counters
+    ReplicationLogStats stats() const;
+
+private:
+    // One publication: the records of one write-ahead log append
+    struct Entry {
+        uint64_t firstSequence; // Number of the first record
+        uint64_t lastSequence;  // Number of the last record
+        std::string records;    // Encoded records
+    };
+
+    // Drops entries nobody needs any more; mutex_ must be held
+    void trimLocked();
+
+    std::deque<Entry> entries_;             // Published entries in sequence order
+    std::map<uint64_t, Entry> pending_;     // Entries waiting for a gap before them, by first sequence number
+    uint64_t publishedSequence_;            // Last record published in order
+    uint64_t droppedSequence_;              // Records up to here are no longer held
+    uint64_t trimSequence_;                 // Records up to here may be dropped once every reader is past them
+    size_t bytes_ = 0;                      // Bytes of records held in entries_ and pending_
+    std::map<uint64_t, uint64_t> readers_;  // Position (last record read) of each subscriber
+    uint64_t nextSubscriber_ = 1;           // Identifier of the next subscriber
+    bool closed_ = false;                   // Set by close()
+    mutable std::mutex mutex_;              // Protects everything above
+    std::condition_variable publishedCv_;   // Signalled when records are published or the log is closed
+};
+
+#endif // REPLICATION_LOG_HPP
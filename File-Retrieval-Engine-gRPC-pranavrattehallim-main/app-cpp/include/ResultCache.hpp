@@ -0,0 +1,78 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Answer to one search, as stored in the cache
+struct CachedSearch {
+    std::vector<std::pair<std::string, int>> results; // "clientID:documentPath" keys and summed frequencies
+    size_t totalMatches = 0;                          // Documents matching every term (a lower bound unless exact)
+    bool totalExact = true;                           // Whether totalMatches is the full count
+    size_t expandedTerms = 0;                         // Terms the prefix terms expanded to
+    bool expansionTruncated = false;                  // Whether a prefix term hit the expansion cap
+};
+
+// Counters of the result cache
+struct ResultCacheStats {
+    uint64_t hits = 0;        // Lookups answered from the cache
+    uint64_t misses = 0;      // Lookups that found no entry, or only one computed before the index changed
+    uint64_t evictions = 0;   // Entries dropped to stay within the memory budget
+    size_t entries = 0;       // Entries currently held
+    size_t bytes = 0;         // Estimated bytes currently held
+    size_t capacityBytes = 0; // Memory budget
+};
+
+// Size-bounded LRU cache of search results. Every entry remembers the index generation it was computed at; once
+// the index has changed, the entry no longer matches and is replaced on the next miss, so invalidation costs
+// nothing on the indexing path.
+class ResultCache {
+public:
+    // Constructor sets the memory budget in bytes
+    explicit ResultCache(size_t capacityBytes);
+
+    // Builds the cache key of a query: terms sorted so word order does not matter, plus the number of results and
+    // the prefix expansion cap. Duplicate terms are kept because they count twice in the summed frequency.
+    static std::string makeKey(std::vector<std::string> terms, size_t topK, size_t maxExpansions);
+
+    // Copies the entry into result if it was computed at the given generation; counts a hit or a miss
+    bool lookup(const std::string& key, uint64_t generation, CachedSearch& result);
+
+    // Stores the result computed at the given generation, evicting the least recently used entries to fit
+    void insert(const std::string& key, uint64_t generation, const CachedSearch& result);
+
+    // Returns the hit, miss and size counters
+    ResultCacheStats stats() const;
+
+private:
+    // One cached search and where it sits in the LRU order
+    struct Entry {
+        uint64_t generation;                  // Index generation the result was computed at
+        CachedSearch search;                  // Cached answer
+        size_t bytes;                         // Estimated bytes held by the entry, key included
+        std::list<std::string>::iterator lru; // Position in lru_
+    };
+
+    // Estimates the bytes held by an entry for the key and result
+    static size_t entryBytes(const std::string& key, const CachedSearch& result);
+
+    // Removes an entry and its LRU position; mutex_ must be held
+    void eraseLocked(std::unordered_map<std::string, Entry>::iterator entry);
+
+    size_t capacityBytes_;                          // Memory budget
+    size_t bytes_ = 0;                              // Estimated bytes held
+    uint64_t hits_ = 0;                             // Lookups answered from the cache
+    uint64_t misses_ = 0;                           // Lookups not answered from the cache
+    uint64_t evictions_ = 0;                        // Entries dropped for space
+    std::list<std::string> lru_;                    // Keys, most recently used first
+    std::unordered_map<std::string, Entry> entries_; // Entries by key
+    mutable std::mutex mutex_;                      // Protects everything above except capacityBytes_
+};
+
+#endif // RESULT_CACHE_HPP
@@ -0,0 +1,84 @@
+#ifndef SEARCH_CURSOR_STORE_HPP
+#define SEARCH_CURSOR_STORE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Every match of one search, ranked, so the pages after the first are cut from it instead of recomputed
+struct RankedSearch {
+    std::vector<std::pair<int, int>> matches; // Document numbers and summed frequencies, best first
+    size_t expandedTerms = 0;                 // Terms the prefix terms expanded to
+    bool expansionTruncated = false;          // Whether a prefix term hit the expansion cap
+};
+
+// Counters of the cursor store
+struct SearchCursorStats {
+    uint64_t opened = 0;      // Result sets kept for a cursor
+    uint64_t resumed = 0;     // Lookups that found their result set
+    uint64_t expired = 0;     // Result sets dropped after their time to live
+    uint64_t evicted = 0;     // Result sets dropped to stay within the memory budget
+    uint64_t missing = 0;     // Lookups whose result set had been dropped
+    size_t resultSets = 0;    // Result sets currently kept
+    size_t bytes = 0;         // Estimated bytes currently kept
+    size_t capacityBytes = 0; // Memory budget
+};
+
+// Short-lived result sets behind search cursors. A cursor names a result set and a position in it, so fetching a
+// page again (after a lost connection, say) gives the same results. Each lookup pushes the set's expiry back by
+// the time to live; expired sets are dropped by the next open(), and the least recently used go first when a new
+// set would exceed the memory budget. Document numbers are kept rather than paths, so a set costs 8 bytes per match.
+class SearchCursorStore {
+public:
+    // Constructor sets the memory budget in bytes and how long an unused result set is kept
+    SearchCursorStore(size_t capacityBytes, std::chrono::steady_clock::duration timeToLive);
+
+    // Keeps the result set and returns its ID, or 0 when it is larger than the whole budget
+    uint64_t open(std::shared_ptr<const RankedSearch> search);
+
+    // Returns the result set with the ID and extends its life, or nullptr once it has been dropped
+    std::shared_ptr<const RankedSearch> resume(uint64_t id);
+
+    // Encodes a result set ID and the rank of the next result as an opaque cursor
+    static std::string makeCursor(uint64_t id, size_t offset);
+
+    // Decodes a cursor made by makeCursor; false if it is malformed
+    static bool parseCursor(const std::string& cursor, uint64_t& id, size_t& offset);
+
+    // Drops the expired result sets, then returns the counters
+    SearchCursorStats stats();
+
+private:
+    // One kept result set and where it sits in the LRU order
+    struct Entry {
+        std::shared_ptr<const RankedSearch> search;     // Ranked matches
+        size_t bytes;                                   // Estimated bytes held
+        std::chrono::steady_clock::time_point expires;  // When the set is dropped unless used again
+        std::list<uint64_t>::iterator lru;              // Position in lru_
+    };
+
+    // Drops the sets past their expiry; with one time to live, they are the least recently used. mutex_ must be held.
+    void expireLocked(std::chrono::steady_clock::time_point now);
+
+    // Removes an entry and its LRU position; mutex_ must be held
+    void eraseLocked(std::unordered_map<uint64_t, Entry>::iterator entry);
+
+    size_t capacityBytes_;                            // Memory budget
+    std::chrono::steady_clock::duration timeToLive_;  // Life of an unused result set
+    size_t bytes_ = 0;                                // Estimated bytes held
+    SearchCursorStats counters_;                      // Opened, resumed, expired, evicted and missing counts
+    std::list<uint64_t> lru_;                         // IDs, most recently used first
+    std::unordered_map<uint64_t, Entry> entries_;     // Result sets by ID
+    std::mt19937_64 random_;                          // IDs are random, so a cursor does not reveal the others
+    std::mutex mutex_;                                // Protects everything above except the two settings
+};
+
+#endif // SEARCH_CURSOR_STORE_HPP
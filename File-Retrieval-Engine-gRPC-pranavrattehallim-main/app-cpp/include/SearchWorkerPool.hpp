@@ -0,0 +1,59 @@
+#ifndef SEARCH_WORKER_POOL_HPP
+#define SEARCH_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of threads that runs the searches of a batch side by side. run() hands out the items of one batch to
+// whichever workers are free and works on them itself too, so a batch always makes progress even when every
+// worker is busy with other batches, and several handler threads can run batches at once.
+class SearchWorkerPool {
+public:
+    // Constructor starts the worker threads (0 leaves each batch to the thread that calls run())
+    explicit SearchWorkerPool(size_t threads);
+
+    // Stops the workers once they finish the item they are on; batches still running complete on their callers
+    ~SearchWorkerPool();
+
+    SearchWorkerPool(const SearchWorkerPool&) = delete;
+    SearchWorkerPool& operator=(const SearchWorkerPool&) = delete;
+
+    // Calls task(0) .. task(count - 1), spread over the workers and the calling thread, and returns once all have
+    // returned. Tasks must not throw.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    // Number of worker threads
+    size_t threadCount() const { return threads_.size(); }
+
+private:
+    // One batch being run
+    struct Job {
+        const std::function<void(size_t)>* task; // Called once per item
+        size_t count;                            // Items in the batch
+        std::atomic<size_t> next{0};             // Next item to hand out
+        std::atomic<size_t> done{0};             // Items finished
+        std::mutex mutex;                        // Guards the wait for the last item
+        std::condition_variable finished;        // Signalled when the last item finishes
+    };
+
+    // Runs items of the job until none are left to hand out
+    static void work(Job& job);
+
+    // Worker thread body: helps with the oldest job that still has items
+    void workerLoop();
+
+    std::vector<std::thread> threads_;            // Worker threads
+    std::deque<std::shared_ptr<Job>> jobs_;       // Jobs that may still have items to hand out, oldest first
+    std::mutex mutex_;                            // Guards jobs_ and stopping_
+    std::condition_variable available_;           // Signalled when a job arrives or the pool stops
+    bool stopping_ = false;                       // Set by the destructor
+};
+
+#endif // SEARCH_WORKER_POOL_HPP
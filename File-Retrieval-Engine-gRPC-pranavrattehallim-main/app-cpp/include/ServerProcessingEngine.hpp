@@ -7,8 +7,11 @@
 #include <vector>
 #include <thread>
 #include <mutex>  // Include for mutex to protect client list
+#include <atomic> // Include for the client ID counter
+#include <cstdint>
 #include "IndexStore.hpp"                 // Include IndexStore for indexing functionalities
 #include "FileRetrievalEngineImpl.hpp"     // Include FileRetrievalEngineImpl for indexing and search services
+#include "AsyncServer.hpp"                 // Include AsyncServer for the completion queue server mode
 
 // Client connection structure
 class ClientConnection {
@@ -28,18 +31,81 @@ public:
     // Shuts down the server gracefully and joins the server thread
     void shutdown();
 
+    // Logs indexing operations to the write-ahead log before acknowledging them
+    void setWriteAheadLog(std::shared_ptr<WriteAheadLog> wal);
+
+    // Serves RPCs from the async server with separate ingest and query thread pools instead of the sync server
+    void setAsyncOptions(const AsyncServerOptions& options);
+
+    // Compresses replies with the algorithm (requests are decompressed whatever the client chose)
+    void setCompression(grpc_compression_algorithm algorithm) { compression = algorithm; }
+
+    // Answers repeated searches from the result cache until the index changes (nullptr disables caching)
+    void setResultCache(std::shared_ptr<ResultCache> cache);
+
+    // Keeps the ranked results of streamed searches so clients can page through them (nullptr: one page only)
+    void setSearchCursors(std::shared_ptr<SearchCursorStore> cursors);
+
+    // Runs the searches of a batch on the pool's threads (nullptr: in turn on the handler's thread)
+    void setSearchWorkers(std::shared_ptr<SearchWorkerPool> workers);
+
+    // Keeps indexing operations for replicas to follow and serves them the snapshot file
+    void setReplicationLog(std::shared_ptr<ReplicationLog> replication);
+
+    // Serves searches as a read-only replica kept up to date by the follower
+    void setReplica(std::shared_ptr<ReplicaFollower> replica);
+
+    // Prints the result cache's hit rate and memory use
+    void reportCacheStats() const;
+
+    // Prints per-RPC latency percentiles and rates, lock waits, index size and memory, and the cache counters
+    void reportStats() const;
+
+    // Sets the file the index snapshot is written to (empty disables snapshots)
+    void setSnapshotPath(const std::string& path);
+
+    // Writes the index to the snapshot file, empties the write-ahead log and reports the time taken
+    bool saveSnapshot();
+
+    // Compresses the posting list tails and freezes the term dictionary, reporting the memory saved
+    void compactIndex();
+
     // gRPC remote procedure for indexing
     grpc::Status ComputeIndex(
         grpc::ServerContext* context,
         const fre::IndexReq* request,
         fre::IndexRep* response) override;
 
+    // gRPC remote procedure for streaming batches of documents to index
+    grpc::Status ComputeIndexStream(
+        grpc::ServerContext* context,
+        grpc::ServerReader<fre::IndexBatch>* reader,
+        fre::IndexStreamRep* response) override;
+
     // gRPC remote procedure for searching
     grpc::Status ComputeSearch(
         grpc::ServerContext* context,
         const fre::SearchReq* request,
         fre::SearchRep* response) override;
 
+    // gRPC remote procedure streaming one page of search results
+    grpc::Status ComputeSearchStream(
+        grpc::ServerContext* context,
+        const fre::SearchStreamReq* request,
+        grpc::ServerWriter<fre::SearchChunk>* writer) override;
+
+    // gRPC remote procedure running a batch of searches
+    grpc::Status ComputeSearchBatch(
+        grpc::ServerContext* context,
+        const fre::SearchBatchReq* request,
+        fre::SearchBatchRep* response) override;
+
+    // gRPC remote procedure for deleting documents
+    grpc::Status ComputeDelete(
+        grpc::ServerContext* context,
+        const fre::DeleteReq* request,
+        fre::DeleteRep* response) override;
+
     // gRPC remote procedure to provide a client ID
     grpc::Status GetClientID(
         grpc::ServerContext* context,
@@ -52,6 +118,24 @@ public:
         const fre::ShutdownReq* request,
         fre::ShutdownRep* response) override;
 
+    // gRPC remote procedure for server statistics
+    grpc::Status GetStats(
+        grpc::ServerContext* context,
+        const fre::StatsReq* request,
+        fre::StatsRep* response) override;
+
+    // gRPC remote procedure streaming the snapshot file to a bootstrapping replica
+    grpc::Status GetSnapshot(
+        grpc::ServerContext* context,
+        const fre::SnapshotReq* request,
+        grpc::ServerWriter<fre::SnapshotChunk>* writer) override;
+
+    // gRPC remote procedure streaming index updates to a replica
+    grpc::Status Replicate(
+        grpc::ServerContext* context,
+        const fre::ReplicateReq* request,
+        grpc::ServerWriter<fre::ReplicationBatch>* writer) override;
+
 private:
     // Method that builds and starts the gRPC server
     void rungRPCServer(int serverPort);
@@ -72,9 +156,18 @@ private:
     std::shared_ptr<IndexStore> store;                        // Shared pointer to IndexStore instance
     std::shared_ptr<FileRetrievalEngineImpl> fileRetrievalEngineImpl; // FileRetrievalEngineImpl instance for indexing/search
     std::unique_ptr<grpc::Server> server;                     // Unique pointer to the gRPC server
+    std::unique_ptr<AsyncServer> asyncServer;                 // Async server, when running in async mode
+    std::unique_ptr<AsyncServerOptions> asyncOptions;         // Thread layout of the async server, or nullptr for sync
+    grpc_compression_algorithm compression = GRPC_COMPRESS_NONE; // Compression of the server's replies
     std::thread serverThread;                                 // Thread to run the gRPC server
+    std::string serverAddress;                                // This server's own port, where shutdown notices go
     std::vector<ClientConnection> connectedClients;           // Vector to hold connected clients
     std::mutex clientsMutex;                                  // Mutex for thread-safe access to connected clients
+    std::atomic<uint64_t> clientCount;                        // Last client ID handed out, seeded from the index
+    std::string snapshotPath;                                 // File the index snapshot is written to
+    std::shared_ptr<ResultCache> resultCache;                 // Search result cache, or nullptr when caching is off
+    std::shared_ptr<ReplicationLog> replicationLog;           // Updates kept for replicas, closed on shutdown
+    std::shared_ptr<ReplicaFollower> replicaFollower;         // Follower of the primary, stopped on shutdown
 };
 
 #endif // SERVERPROCESSINGENGINE_HPP
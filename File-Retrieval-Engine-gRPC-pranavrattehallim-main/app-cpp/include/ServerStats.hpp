@@ -0,0 +1,185 @@
+#ifndef SERVER_STATS_HPP
+#define SERVER_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace fre {
+class StatsRep; // GetStats reply, generated from File-Retrieval-Engine.proto
+}
+
+// Point-in-time copy of a latency histogram
+struct LatencySummary {
+    uint64_t count = 0;      // Samples recorded
+    double meanMicros = 0.0; // Average latency
+    double p50Micros = 0.0;  // Latency percentiles, each the upper edge of the bucket it falls in
+    double p90Micros = 0.0;
+    double p99Micros = 0.0;
+    double p999Micros = 0.0;
+    double maxMicros = 0.0;  // Largest latency recorded
+};
+
+// Lock-free latency histogram. Buckets are log-linear: every power of two of nanoseconds is split into
+// subBuckets equal parts, so a percentile is off by at most 1/subBuckets of its value. Recording is a few
+// relaxed atomic adds and never blocks.
+class LatencyHistogram {
+public:
+    // Buckets per power of two
+    static constexpr size_t subBuckets = 8;
+
+    // Powers of two covered above the first subBuckets nanoseconds; larger samples land in the last bucket
+    static constexpr size_t octaves = 40;
+
+    // Records one sample
+    void record(uint64_t nanoseconds) {
+        buckets_[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sumNanos_.fetch_add(nanoseconds, std::memory_order_relaxed);
+        uint64_t max = maxNanos_.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !maxNanos_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Reads the counters into percentiles; samples recorded meanwhile may or may not be included
+    LatencySummary summary() const;
+
+private:
+    static constexpr size_t bucketCount = subBuckets * (octaves + 1);
+
+    // Bucket a sample falls in: values below subBuckets map to themselves, larger ones by their top bits
+    static size_t bucketFor(uint64_t nanoseconds) {
+        if (nanoseconds < subBuckets) {
+            return nanoseconds;
+        }
+        size_t shift = std::bit_width(nanoseconds) - std::bit_width(subBuckets); // Bits below the top four
+        size_t bucket = (shift + 1) * subBuckets + ((nanoseconds >> shift) - subBuckets);
+        return bucket < bucketCount ? bucket : bucketCount - 1;
+    }
+
+    // Largest value, in nanoseconds, that falls in the bucket
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, bucketCount> buckets_{}; // Samples per bucket
+    std::atomic<uint64_t> count_{0};                           // Samples recorded
+    std::atomic<uint64_t> sumNanos_{0};                        // Sum of the samples
+    std::atomic<uint64_t> maxNanos_{0};                        // Largest sample
+};
+
+// Point-in-time copy of a lock's wait counters
+struct LockWaitSummary {
+    uint64_t acquisitions = 0; // Times the lock was taken
+    uint64_t contended = 0;    // Acquisitions that had to wait
+    double waitSeconds = 0.0;  // Time spent waiting, summed over threads
+};
+
+// Counts how often a lock (or a group of locks) is taken and how long threads wait for it. The clock is read only
+// when an initial try_lock fails, so an uncontended acquisition costs one relaxed atomic add.
+class LockWaitCounter {
+public:
+    // Acquires the mutex into a std::unique_lock or std::shared_lock, timing the wait if it is held elsewhere
+    template <typename Lock, typename Mutex>
+    Lock acquire(Mutex& mutex) {
+        Lock lock(mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            auto start = std::chrono::steady_clock::now();
+            lock.lock();
+            waitNanos_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - start).count(),
+                                 std::memory_order_relaxed);
+            contended_.fetch_add(1, std::memory_order_relaxed);
+        }
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        return lock;
+    }
+
+    // Reads the counters
+    LockWaitSummary summary() const {
+        return {acquisitions_.load(std::memory_order_relaxed), contended_.load(std::memory_order_relaxed),
+                waitNanos_.load(std::memory_order_relaxed) / 1e9};
+    }
+
+private:
+    std::atomic<uint64_t> acquisitions_{0}; // Times the lock was taken
+    std::atomic<uint64_t> contended_{0};    // Acquisitions that found the lock held
+    std::atomic<uint64_t> waitNanos_{0};    // Nanoseconds spent blocked
+};
+
+// RPCs the server keeps statistics for
+enum class RpcMethod {
+    ComputeIndex,
+    ComputeIndexStream,
+    ComputeSearch,
+    ComputeSearchStream,
+    ComputeSearchBatch,
+    ComputeDelete,
+    GetClientID,
+    Shutdown,
+    GetStats,
+    GetSnapshot,
+    Replicate,
+    Count
+};
+
+// Per-RPC latency histograms and error counts, plus the server's start time for rates
+class ServerStats {
+public:
+    // Constructor starts the uptime clock
+    ServerStats() : start_(std::chrono::steady_clock::now()) {}
+
+    // Records one finished call of the method and whether it failed
+    void recordRpc(RpcMethod method, std::chrono::steady_clock::duration latency, bool failed) {
+        Rpc& rpc = rpcs_[static_cast<size_t>(method)];
+        rpc.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        if (failed) {
+            rpc.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Runs an RPC handler, recording its latency and whether the status it returned was an error
+    template <typename Handler>
+    auto recordCall(RpcMethod method, Handler handler) {
+        auto start = std::chrono::steady_clock::now();
+        auto status = handler();
+        recordRpc(method, std::chrono::steady_clock::now() - start, !status.ok());
+        return status;
+    }
+
+    // Latency distribution of the method's calls
+    LatencySummary latency(RpcMethod method) const { return rpcs_[static_cast<size_t>(method)].latency.summary(); }
+
+    // Calls of the method that returned an error status
+    uint64_t errors(RpcMethod method) const {
+        return rpcs_[static_cast<size_t>(method)].errors.load(std::memory_order_relaxed);
+    }
+
+    // Seconds since the server started
+    double uptimeSeconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    // Name of the method as it appears in the proto
+    static const char* methodName(RpcMethod method);
+
+    // Fills in the uptime, the process memory and the per-RPC entries of a GetStats reply
+    void collect(fre::StatsRep* reply) const;
+
+    // Prints a GetStats reply, except its cache counters, to standard output
+    static void print(const fre::StatsRep& stats);
+
+private:
+    // Counters of one RPC
+    struct Rpc {
+        LatencyHistogram latency;          // Call latencies
+        std::atomic<uint64_t> errors{0};   // Calls that failed
+    };
+
+    std::chrono::steady_clock::time_point start_;                      // Server start
+    std::array<Rpc, static_cast<size_t>(RpcMethod::Count)> rpcs_;      // Counters by method
+};
+
+#endif // SERVER_STATS_HPP
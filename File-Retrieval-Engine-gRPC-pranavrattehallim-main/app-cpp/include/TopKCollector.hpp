@@ -0,0 +1,33 @@
+#ifndef TOP_K_COLLECTOR_HPP
+#define TOP_K_COLLECTOR_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Keeps the K best (document, score) pairs seen so far in a bounded min-heap. Documents must be offered in
+// increasing order; a later document only displaces an earlier one with a strictly higher score, so ties keep
+// the lower document number, as a stable sort by score would.
+class TopKCollector {
+public:
+    // Constructor sets K, the number of results to keep
+    explicit TopKCollector(size_t k);
+
+    // True once K results are held, from which point threshold() is meaningful
+    bool full() const { return k_ > 0 && heap_.size() == k_; }
+
+    // Score a new document must exceed to enter the results
+    int threshold() const { return heap_.front().second; }
+
+    // Offers a document; it is kept if fewer than K are held or it beats the current K-th score
+    void push(int document, int score);
+
+    // Returns the kept results, best score first and ties in document order
+    std::vector<std::pair<int, int>> results() const;
+
+private:
+    size_t k_;                                 // Number of results to keep
+    std::vector<std::pair<int, int>> heap_;    // (document, score), worst result at the front
+};
+
+#endif // TOP_K_COLLECTOR_HPP
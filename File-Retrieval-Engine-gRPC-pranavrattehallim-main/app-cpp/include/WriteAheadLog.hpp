@@ -0,0 +1,114 @@
+#ifndef WRITE_AHEAD_LOG_HPP
+#define WRITE_AHEAD_LOG_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Group commit settings of the write-ahead log
+struct WalOptions {
+    // Extra time a record waits for other records to share its fsync. With 0, records still group up while the
+    // previous fsync is running, which gives the best throughput; a longer interval trades latency for fewer fsyncs.
+    std::chrono::microseconds flushInterval{0};
+    size_t flushBytes = 1 << 20; // Pending bytes that trigger a flush before the interval ends
+};
+
+// One logged operation: a client's document and its term frequencies, or the deletion of the document
+struct LogRecord {
+    uint64_t sequence = 0;                                  // Position of the record in the log, starting at 1
+    std::string clientID;                                   // Client that indexed the document
+    std::string documentPath;                               // Path of the document on the client
+    std::vector<std::pair<std::string, int>> termFrequencies; // Terms of the document and their frequencies
+    bool deleted = false;                                   // Set for a deletion, which carries no terms
+};
+
+// On-disk layout of a log file (version 2), in host byte order:
+//
+//   "FREWAL" followed by two NUL bytes, uint32 version, uint32 reserved, uint64 sequence of the first record
+//   records back to back, each: uint32 payload length, uint32 CRC-32 of the payload, payload
+//   payload: uint32 length + client ID, uint32 length + document path, uint32 term count,
+//            then per term: uint32 length + term, int32 frequency
+//   a deletion has the term count 0xFFFFFFFF and no terms
+//
+// Version 1 lacks deletions; such a log is replayed as is and its header rewritten to version 2 before appending.
+//
+// A record is acknowledged only once it is on disk. A torn record at the tail of the file (from a crash mid-write)
+// fails its length or checksum test and is dropped on replay.
+class WriteAheadLog {
+public:
+    // Current format version
+    static constexpr uint32_t formatVersion = 2;
+
+    // Replays the records after afterSequence through apply, drops a torn tail and opens the log for appending.
+    // Creates the file if it is missing. Returns nullptr (with a message in error) if the log cannot be used.
+    static std::shared_ptr<WriteAheadLog> open(const std::string& path, const WalOptions& options, uint64_t afterSequence,
+                                               const std::function<void(const LogRecord&)>& apply, std::string& error);
+
+    // Encodes one indexing operation as a framed record and appends it to out; done outside any lock
+    static void encodeRecord(std::string& out, const std::string& clientID, const std::string& documentPath,
+                             const std::vector<std::pair<std::string, int>>& termFrequencies);
+
+    // Encodes the deletion of a client's document as a framed record and appends it to out
+    static void encodeDeleteRecord(std::string& out, const std::string& clientID, const std::string& documentPath);
+
+    // Decodes encoded records back to back, numbering them from firstSequence; returns false if any record is
+    // truncated, fails its checksum or is malformed
+    static bool decodeRecords(const std::string& encoded, uint64_t firstSequence, std::vector<LogRecord>& records);
+
+    // Stops the flusher after writing everything still pending, then closes the file
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Queues encoded records for the next group commit and returns the sequence number of the last one
+    uint64_t append(const std::string& encodedRecords, size_t recordCount);
+
+    // Blocks until every record up to sequence is on disk; returns false if the log could not be written
+    bool waitDurable(uint64_t sequence);
+
+    // Flushes everything queued so far and waits for it to reach the disk
+    bool sync();
+
+    // Empties the log once a snapshot covers every record in it; appends must be paused by the caller
+    bool truncate();
+
+    // Sequence number of the last record appended
+    uint64_t lastSequence() const;
+
+    // Number of fsyncs issued and records they covered, for reporting the group commit ratio
+    std::pair<uint64_t, uint64_t> commitStats() const;
+
+private:
+    // Constructor adopts an open, recovered log file
+    WriteAheadLog(int fd, const WalOptions& options, uint64_t lastSequence);
+
+    // Flusher thread: waits for records, lets a group build up, then writes and syncs it with one fsync
+    void flushLoop();
+
+    int fd_;                             // Log file, positioned at its end
+    WalOptions options_;                 // Group commit settings
+    std::string pending_;                // Encoded records waiting for the next flush
+    uint64_t appendedSequence_;          // Sequence number of the last record appended
+    uint64_t durableSequence_;           // Sequence number of the last record on disk
+    std::chrono::steady_clock::time_point pendingSince_; // When the oldest pending record was queued
+    bool flushRequested_ = false;        // Set by sync() to skip the rest of the flush interval
+    bool failed_ = false;                // Set once a write or fsync fails; no further record is acknowledged
+    bool stopping_ = false;              // Set by the destructor
+    uint64_t fsyncs_ = 0;                // Group commits issued
+    uint64_t recordsSynced_ = 0;         // Records made durable by those group commits
+    mutable std::mutex mutex_;           // Protects everything above except fd_ and options_
+    std::condition_variable pendingCv_;  // Signalled when records are queued or a flush is requested
+    std::condition_variable durableCv_;  // Signalled after every group commit
+    std::thread flusher_;                // Runs flushLoop
+};
+
+#endif // WRITE_AHEAD_LOG_HPP
@@ -0,0 +1,343 @@
+#include "AsyncServer.hpp"
+#include <chrono>   // For timing the batches of index streams
+#include <climits>  // For INT_MAX
+#include <iostream> // For reporting startup and pinning errors
+#include <string>
+#include <pthread.h> // For pthread_setaffinity_np
+
+namespace {
+
+// Signature of the AsyncQueueService methods that request the next unary call of one RPC
+template <typename Request, typename Reply>
+using RequestMethod = void (AsyncQueueService::*)(
+    grpc::ServerContext*, Request*, grpc::ServerAsyncResponseWriter<Reply>*, grpc::CompletionQueue*,
+    grpc::ServerCompletionQueue*, void*);
+
+// Signature of the synchronous handler that answers a unary call
+template <typename Request, typename Reply>
+using HandlerMethod = grpc::Status (fre::FileRetrievalEngine::Service::*)(grpc::ServerContext*, const Request*, Reply*);
+
+// One unary call: waits for a request, answers it with the handler on the polling thread, then sends the reply
+template <typename Request, typename Reply>
+class UnaryCall : public AsyncServer::Call {
+public:
+    // Constructor registers the call with the queue; it deletes itself once finished or cancelled
+    UnaryCall(AsyncQueueService* service, grpc::ServerCompletionQueue* queue,
+              RequestMethod<Request, Reply> request, fre::FileRetrievalEngine::Service* handlers,
+              HandlerMethod<Request, Reply> handler)
+        : service_(service), queue_(queue), request_(request), handlers_(handlers), handler_(handler),
+          responder_(&context_) {
+        (service_->*request_)(&context_, &request_message_, &responder_, queue_, queue_, this);
+    }
+
+    void proceed(bool ok) override {
+        if (!ok || finishing_) {
+            delete this; // Server shut down before a request arrived, or the reply has been sent
+            return;
+        }
+        new UnaryCall(service_, queue_, request_, handlers_, handler_); // Keep accepting while this one runs
+        grpc::Status status = (handlers_->*handler_)(&context_, &request_message_, &reply_);
+        finishing_ = true;
+        responder_.Finish(reply_, status, this);
+    }
+
+private:
+    AsyncQueueService* service_;                          // Service the call is requested from
+    grpc::ServerCompletionQueue* queue_;                  // Queue the call completes on
+    RequestMethod<Request, Reply> request_;               // Requests the next call of this RPC
+    fre::FileRetrievalEngine::Service* handlers_;         // Object answering the call
+    HandlerMethod<Request, Reply> handler_;               // Handler answering the call
+    grpc::ServerContext context_;                         // Per-call context
+    Request request_message_;                             // Request received
+    Reply reply_;                                         // Reply to send
+    grpc::ServerAsyncResponseWriter<Reply> responder_;    // Sends the reply
+    bool finishing_ = false;                              // Set once Finish has been issued
+};
+
+// One ComputeIndexStream call: applies each batch as it is read and acknowledges once the client is done
+class IndexStreamCall : public AsyncServer::Call {
+public:
+    // Constructor registers the call with the queue; it deletes itself once finished or cancelled
+    IndexStreamCall(AsyncQueueService* service, grpc::ServerCompletionQueue* queue,
+                    FileRetrievalEngineImpl* engine)
+        : service_(service), queue_(queue), engine_(engine), reader_(&context_) {
+        service_->RequestComputeIndexStream(&context_, &reader_, queue_, queue_, this);
+    }
+
+    void proceed(bool ok) override {
+        switch (state_) {
+        case State::Waiting:
+            if (!ok) {
+                delete this; // Server shut down before a stream arrived
+                return;
+            }
+            new IndexStreamCall(service_, queue_, engine_); // Keep accepting while this one runs
+            start_ = std::chrono::steady_clock::now();
+            state_ = State::Reading;
+            reader_.Read(&batch_, this);
+            break;
+        case State::Reading:
+            if (ok) {
+                ++batchesReceived_;
+                auto applyStart = std::chrono::steady_clock::now();
+                grpc::Status status = engine_->applyIndexBatch(batch_, terms_, sequence_);
+                if (!status.ok()) {
+                    finish(status); // The batch did not decode; earlier batches stay applied
+                    break;
+                }
+                applyTime_ += std::chrono::steady_clock::now() - applyStart;
+                documentsIndexed_ += batch_.documents_size();
+                reader_.Read(&batch_, this); // gRPC flow control holds the client back until this read is posted
+            } else {
+                // The client called WritesDone (or went away); acknowledge once every record is durable
+                finish(engine_->completeIndexStream(sequence_, documentsIndexed_, batchesReceived_,
+                                                    applyTime_.count(), &reply_));
+            }
+            break;
+        case State::Finishing:
+            delete this;
+            break;
+        }
+    }
+
+private:
+    enum class State { Waiting, Reading, Finishing };
+
+    // Records the call and sends the acknowledgement, or the error that ended the stream
+    void finish(const grpc::Status& status) {
+        engine_->stats().recordRpc(RpcMethod::ComputeIndexStream, std::chrono::steady_clock::now() - start_,
+                                   !status.ok());
+        state_ = State::Finishing;
+        reader_.Finish(reply_, status, this);
+    }
+
+    AsyncQueueService* service_;                          // Service the call is requested from
+    grpc::ServerCompletionQueue* queue_;                  // Queue the call completes on
+    FileRetrievalEngineImpl* engine_;                     // Applies the batches
+    grpc::ServerContext context_;                         // Per-call context
+    grpc::ServerAsyncReader<fre::IndexStreamRep, fre::IndexBatch> reader_; // Reads batches, sends the reply
+    fre::IndexBatch batch_;                               // Batch being read
+    SessionTermDecoder terms_;                            // Dictionary the stream's term IDs refer to
+    fre::IndexStreamRep reply_;                           // Summary acknowledgement
+    State state_ = State::Waiting;                        // Position in the call's life cycle
+    int64_t documentsIndexed_ = 0;                        // Documents applied so far
+    int64_t batchesReceived_ = 0;                         // Batches read so far
+    uint64_t sequence_ = 0;                               // Log record of the last document applied
+    std::chrono::duration<double> applyTime_{0};          // Time spent logging and applying batches
+    std::chrono::steady_clock::time_point start_;         // When the stream arrived
+};
+
+// One ComputeSearchStream call: opens the page on the polling thread, then writes one chunk per completed write,
+// so a slow reader holds no thread while it catches up
+class SearchStreamCall : public AsyncServer::Call {
+public:
+    // Constructor registers the call with the queue; it deletes itself once finished or cancelled
+    SearchStreamCall(AsyncQueueService* service, grpc::ServerCompletionQueue* queue,
+                     FileRetrievalEngineImpl* engine)
+        : service_(service), queue_(queue), engine_(engine), writer_(&context_) {
+        service_->RequestComputeSearchStream(&context_, &request_, &writer_, queue_, queue_, this);
+    }
+
+    void proceed(bool ok) override {
+        switch (state_) {
+        case State::Waiting: {
+            if (!ok) {
+                delete this; // Server shut down before a request arrived
+                return;
+            }
+            new SearchStreamCall(service_, queue_, engine_); // Keep accepting while this one runs
+            start_ = std::chrono::steady_clock::now();
+            grpc::Status status = engine_->openSearchPage(request_, page_);
+            if (!status.ok()) {
+                finish(status);
+                return;
+            }
+            state_ = State::Writing;
+            writeNext();
+            break;
+        }
+        case State::Writing:
+            if (!ok) {
+                finish(grpc::Status(grpc::CANCELLED, "Client stopped reading the search results."));
+                return;
+            }
+            writeNext();
+            break;
+        case State::Finishing:
+            delete this;
+            break;
+        }
+    }
+
+private:
+    enum class State { Waiting, Writing, Finishing };
+
+    // Writes the next chunk, or finishes once the page has been sent
+    void writeNext() {
+        if (engine_->nextSearchChunk(page_, &chunk_)) {
+            writer_.Write(chunk_, this);
+        } else {
+            finish(grpc::Status::OK);
+        }
+    }
+
+    // Records the call and ends the stream with the status
+    void finish(const grpc::Status& status) {
+        engine_->stats().recordRpc(RpcMethod::ComputeSearchStream, std::chrono::steady_clock::now() - start_,
+                                   !status.ok());
+        state_ = State::Finishing;
+        writer_.Finish(status, this);
+    }
+
+    AsyncQueueService* service_;                          // Service the call is requested from
+    grpc::ServerCompletionQueue* queue_;                  // Queue the call completes on
+    FileRetrievalEngineImpl* engine_;                     // Ranks the matches and fills in the chunks
+    grpc::ServerContext context_;                         // Per-call context
+    fre::SearchStreamReq request_;                        // Request received
+    grpc::ServerAsyncWriter<fre::SearchChunk> writer_;    // Sends the chunks and the status
+    SearchPage page_;                                     // Page being sent
+    fre::SearchChunk chunk_;                              // Chunk being written
+    State state_ = State::Waiting;                        // Position in the call's life cycle
+    std::chrono::steady_clock::time_point start_;         // When the request arrived
+};
+
+} // namespace
+
+// Constructor stores the handlers and the layout; nothing runs until start()
+AsyncServer::AsyncServer(fre::FileRetrievalEngine::Service& handlers, FileRetrievalEngineImpl& engine,
+                         const AsyncServerOptions& options)
+    : handlers_(handlers), engine_(engine), options_(options), service_(handlers) {
+    // Every queue needs at least one thread polling it
+    options_.ingestThreads = std::max<size_t>(1, options_.ingestThreads);
+    options_.queryThreads = std::max<size_t>(1, options_.queryThreads);
+    options_.ingestQueues = std::clamp<size_t>(options_.ingestQueues, 1, options_.ingestThreads);
+    options_.queryQueues = std::clamp<size_t>(options_.queryQueues, 1, options_.queryThreads);
+}
+
+// Shuts the server down if it is still running
+AsyncServer::~AsyncServer() {
+    shutdown();
+    wait();
+}
+
+// Builds the server, posts the first calls on every queue and starts both pools
+bool AsyncServer::start(int port, grpc_compression_algorithm compression) {
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("0.0.0.0:" + std::to_string(port), grpc::InsecureServerCredentials());
+    builder.SetDefaultCompressionAlgorithm(compression);
+    builder.SetMaxReceiveMessageSize(INT_MAX); // An indexing batch holding one large document may pass 4 MB
+    builder.RegisterService(&service_);
+    for (size_t i = 0; i < options_.ingestQueues; ++i) {
+        ingestQueues_.push_back(builder.AddCompletionQueue());
+    }
+    for (size_t i = 0; i < options_.queryQueues; ++i) {
+        queryQueues_.push_back(builder.AddCompletionQueue());
+    }
+    server_ = builder.BuildAndStart();
+    if (!server_) {
+        std::cerr << "Error: could not start the gRPC server on port " << port << std::endl;
+        return false;
+    }
+
+    // Enough outstanding calls per queue that every thread polling it can be busy at once
+    for (const auto& queue : ingestQueues_) {
+        postIngestCalls(queue.get(), (options_.ingestThreads + options_.ingestQueues - 1) / options_.ingestQueues);
+    }
+    for (const auto& queue : queryQueues_) {
+        postQueryCalls(queue.get(), (options_.queryThreads + options_.queryQueues - 1) / options_.queryQueues);
+    }
+
+    // Query threads take the first CPUs so indexing can never crowd them out when pinned
+    startPool(queryQueues_, options_.queryThreads, 0, "query");
+    startPool(ingestQueues_, options_.ingestThreads, options_.queryThreads, "ingest");
+    std::cout << "Server is listening on port " << port << " (async: " << options_.queryThreads << " query threads on "
+              << options_.queryQueues << " queues, " << options_.ingestThreads << " ingest threads on "
+              << options_.ingestQueues << " queues" << (options_.pinThreads ? ", pinned" : "") << ")" << std::endl;
+    return true;
+}
+
+// Posts the indexing and deletion calls a queue accepts
+void AsyncServer::postIngestCalls(grpc::ServerCompletionQueue* queue, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        new UnaryCall<fre::IndexReq, fre::IndexRep>(&service_, queue,
+                                                    &AsyncQueueService::RequestComputeIndex,
+                                                    &handlers_, &fre::FileRetrievalEngine::Service::ComputeIndex);
+        new IndexStreamCall(&service_, queue, &engine_);
+    }
+    new UnaryCall<fre::DeleteReq, fre::DeleteRep>(&service_, queue,
+                                                  &AsyncQueueService::RequestComputeDelete,
+                                                  &handlers_, &fre::FileRetrievalEngine::Service::ComputeDelete);
+}
+
+// Posts the search and control calls a queue accepts
+void AsyncServer::postQueryCalls(grpc::ServerCompletionQueue* queue, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        new UnaryCall<fre::SearchReq, fre::SearchRep>(&service_, queue,
+                                                      &AsyncQueueService::RequestComputeSearch,
+                                                      &handlers_, &fre::FileRetrievalEngine::Service::ComputeSearch);
+        new SearchStreamCall(&service_, queue, &engine_);
+        new UnaryCall<fre::SearchBatchReq, fre::SearchBatchRep>(&service_, queue,
+                                                                &AsyncQueueService::RequestComputeSearchBatch,
+                                                                &handlers_, &fre::FileRetrievalEngine::Service::ComputeSearchBatch);
+    }
+    new UnaryCall<fre::ConnectReq, fre::ConnectRep>(&service_, queue,
+                                                    &AsyncQueueService::RequestGetClientID,
+                                                    &handlers_, &fre::FileRetrievalEngine::Service::GetClientID);
+    new UnaryCall<fre::ShutdownReq, fre::ShutdownRep>(&service_, queue,
+                                                      &AsyncQueueService::RequestShutdown,
+                                                      &handlers_, &fre::FileRetrievalEngine::Service::Shutdown);
+    new UnaryCall<fre::StatsReq, fre::StatsRep>(&service_, queue,
+                                                &AsyncQueueService::RequestGetStats,
+                                                &handlers_, &fre::FileRetrievalEngine::Service::GetStats);
+}
+
+// Hands every completed operation back to its call until the queue is shut down and drained
+void AsyncServer::poll(grpc::ServerCompletionQueue* queue) {
+    void* tag = nullptr;
+    bool ok = false;
+    while (queue->Next(&tag, &ok)) {
+        static_cast<Call*>(tag)->proceed(ok);
+    }
+}
+
+// Starts threads spread round-robin over the queues
+void AsyncServer::startPool(const std::vector<std::unique_ptr<grpc::ServerCompletionQueue>>& queues, size_t threads,
+                            size_t firstCpu, const char* name) {
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&AsyncServer::poll, queues[i % queues.size()].get());
+        if (options_.pinThreads) {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET((firstCpu + i) % cpus, &cpuSet);
+            if (pthread_setaffinity_np(threads_.back().native_handle(), sizeof(cpuSet), &cpuSet) != 0) {
+                std::cerr << "Warning: could not pin " << name << " thread " << i << " to CPU "
+                          << (firstCpu + i) % cpus << std::endl;
+            }
+        }
+    }
+}
+
+// Waits for both pools to exit
+void AsyncServer::wait() {
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+// Stops the server first so in-flight calls can still complete on the queues, then drains the queues
+void AsyncServer::shutdown() {
+    if (shutDown_ || !server_) {
+        return;
+    }
+    shutDown_ = true;
+    server_->Shutdown();
+    for (auto& queue : ingestQueues_) {
+        queue->Shutdown();
+    }
+    for (auto& queue : queryQueues_) {
+        queue->Shutdown();
+    }
+}
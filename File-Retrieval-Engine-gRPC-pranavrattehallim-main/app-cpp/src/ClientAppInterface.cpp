@@ -44,9 +44,9 @@ void ClientAppInterface::run() {
     while (true) {
         // Display available options based on whether indexing has been performed
         if (indexed) {
-            std::cout << "> Options available: search <Terms> | quit" << std::endl;  // Options if indexed
+            std::cout << "> Options available: index <Folder path> | search <Terms> | batch <Terms> ; <Terms> ... | page <Terms> | more | delete <Path> | replica <IP:Port> | quit" << std::endl;  // Re-indexing replaces documents
         } else {
-            std::cout << "> Options available: index <Folder path> | search <Terms> | quit" << std::endl;  // Options if not indexed
+            std::cout << "> Options available: index <Folder path> | search <Terms> | batch <Terms> ; <Terms> ... | page <Terms> | more | delete <Path> | replica <IP:Port> | quit" << std::endl;  // Options if not indexed
         }
 
         std::cout << "> ";  // Display the command prompt
@@ -87,6 +87,57 @@ void ClientAppInterface::run() {
                 std::cout << "Please provide at least 1 search term." << std::endl;  // In case no terms were provided
             }
         }
+        // Handle the "batch" command to run several searches, separated by ';', in one call
+        else if (command.rfind("batch ", 0) == 0) {
+            std::istringstream searches(command.substr(6));
+            std::vector<std::vector<std::string>> queries;  // Terms of each search
+            std::string search;
+            while (std::getline(searches, search, ';')) {
+                std::istringstream ss(search);
+                std::vector<std::string> terms;
+                std::string term;
+                while (ss >> term) {
+                    terms.push_back(term);
+                }
+                if (!terms.empty()) {
+                    queries.push_back(terms);  // Empty searches between separators are skipped
+                }
+            }
+            if (!queries.empty()) {
+                processingEngine.searchBatch(queries);  // Every search in one ComputeSearchBatch call
+            } else {
+                std::cout << "Please provide at least 1 search term." << std::endl;
+            }
+        }
+        // Handle the "page" command to read every match a page at a time, and "more" for the next page
+        else if (command.rfind("page ", 0) == 0) {  // Check if command starts with "page "
+            std::istringstream ss(command.substr(5));  // Create a string stream from the search terms
+            std::vector<std::string> terms;  // Vector to hold the search terms
+            std::string term;  // Variable to hold each term
+            while (ss >> term) {
+                terms.push_back(term);  // Add the term to the vector
+            }
+            if (!terms.empty()) {
+                processingEngine.searchPage(terms);  // Streams the first page and keeps its cursor
+            } else {
+                std::cout << "Please provide at least 1 search term." << std::endl;  // In case no terms were provided
+            }
+        }
+        else if (command == "more") {
+            processingEngine.nextSearchPage();  // Streams the page after the last one
+        }
+        // Handle the "delete" command to remove a file or a folder's files from the index
+        else if (command.rfind("delete ", 0) == 0) {  // Check if command starts with "delete "
+            std::string path = command.substr(7);  // Extract the path from the command
+            if (!processingEngine.deleteDocuments(path)) {
+                std::cout << "Failed to delete. Please check the path." << std::endl;
+            }
+        }
+
+        // Handle the "replica" command to spread searches over a read-only replica of the server
+        else if (command.rfind("replica ", 0) == 0) {  // Check if command starts with "replica "
+            processingEngine.addSearchReplica(command.substr(8));
+        }
 
         // Handle invalid commands that do not match any of the expected patterns
         else {
@@ -1,4 +1,7 @@
 #include "ClientProcessingEngine.hpp"
+#include "BoundedQueue.hpp" // Bounded queues between indexing pipeline stages
+#include <mutex> // Include mutex for merging worker timings
+#include <atomic> // Include atomic for counters shared by the pipeline stages
 
 namespace fs = std::filesystem; // Alias for filesystem namespace for easier usage
 
@@ -15,6 +18,12 @@ ClientProcessingEngine::ClientProcessingEngine() {
 bool ClientProcessingEngine::connect(const std::string& server_ip, int server_port) {
     std::cout << "gRPC Client initialized and ready to connect to the server at " << server_ip << ":" << server_port << std::endl;
 
+    // Point the stub at the requested server instead of the default localhost:50051
+    grpc::ChannelArguments channel_args;
+    channel_args.SetMaxReceiveMessageSize(INT_MAX);
+    stub_ = fre::FileRetrievalEngine::NewStub(grpc::CreateCustomChannel(
+        server_ip + ":" + std::to_string(server_port), grpc::InsecureChannelCredentials(), channel_args));
+
     // Request the client ID from the server after connecting
     grpc::ClientContext context; // Create a client context for the request
     fre::ConnectReq connectRequest; // Create a ConnectReq object
@@ -48,9 +57,23 @@ grpc::Status ClientProcessingEngine::Shutdown(grpc::ServerContext* context, cons
 }
 
 
-// Method to index a folder and its contents
+// Sets the batch limits used when streaming documents to the server
+void ClientProcessingEngine::setIndexBatchLimits(size_t max_documents, size_t max_bytes) {
+    max_batch_documents_ = std::max<size_t>(max_documents, 1); // A batch holds at least one document
+    max_batch_bytes_ = max_bytes;
+}
+
+// Sets the number of tokenizer workers used by the indexing pipeline
+void ClientProcessingEngine::setIndexingWorkers(size_t workers) {
+    indexing_workers_ = std::max<size_t>(workers, 1); // At least one worker is needed to make progress
+}
+
+// Method to index a folder and its contents.
+// Runs a pipeline: a walker thread lists files into a bounded queue, tokenizer workers read and count words
+// into a second bounded queue, and this thread batches the results onto the gRPC stream.
 bool ClientProcessingEngine::indexFolder(const std::string& folder_path) {
-    auto start = std::chrono::high_resolution_clock::now(); // Start timing the indexing process
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now(); // Start timing the indexing process
 
     // Check if the provided folder path exists and is a directory
     if (!fs::exists(folder_path) || !fs::is_directory(folder_path)) {
@@ -58,48 +81,204 @@ bool ClientProcessingEngine::indexFolder(const std::string& folder_path) {
         return false; // Return failure
     }
 
-    size_t totalBytes = 0; // Initialize total bytes counter
-
-    // gRPC: Prepare to send index requests
-    for (const auto& entry : fs::recursive_directory_iterator(folder_path)) { // Iterate over each file in the directory recursively
-        if (entry.is_regular_file()) { // Check if the entry is a regular file
-            std::string filePath = entry.path().string(); // Get the file path as a string
-
-            // Extract word frequencies from the file
-            std::unordered_map<std::string, int> wordFrequencies = extractWordFrequencies(filePath);
-
-            // gRPC: Prepare computeIndex request
-            grpc::ClientContext context; // Create a client context for the request
-            fre::IndexReq request; // Create an IndexReq object for the indexing request
-            fre::IndexRep response; // Create an IndexRep object for the response
-
-            request.set_client_id(clientID); // Set the client ID in the request
-            request.set_document_path(filePath); // Set the document path in the request
-
-            // Populate the request with word frequencies
-            for (const auto& pair : wordFrequencies) {
-                auto term_freq = request.add_word_frequencies(); // Add a new word frequency to the request
-                term_freq->set_word(pair.first); // Set the word
-                term_freq->set_count(pair.second); // Set the count for the word
+    IndexingStageTimes stageTimes; // Per-stage time for this call
+    std::mutex stageTimesMutex; // Protects stageTimes while workers merge their totals
+    std::atomic<size_t> totalBytes{0}; // Total bytes read by the workers
+
+    // Bounded queues between the stages; a full queue blocks the stage feeding it
+    BoundedQueue<std::string> pathQueue(indexing_workers_ * 4);
+    BoundedQueue<fre::IndexReq> documentQueue(indexing_workers_ * 4);
+    SessionTermEncoder termEncoder; // Term dictionary of this call's stream, when term IDs are on
+
+    // Stage 1: walk the folder and queue every regular file
+    std::thread walker([&]() {
+        auto walkStart = Clock::now();
+        std::chrono::duration<double> waiting{0}; // Time blocked on a full queue is not walk time
+        std::error_code error;
+        for (fs::recursive_directory_iterator it(folder_path, error), endIt; !error && it != endIt; it.increment(error)) {
+            std::error_code statusError;
+            if (it->is_regular_file(statusError)) { // Check if the entry is a regular file
+                auto pushStart = Clock::now();
+                bool accepted = pathQueue.push(it->path().string());
+                waiting += Clock::now() - pushStart;
+                if (!accepted) {
+                    break; // The pipeline was shut down early
+                }
             }
-
-            // gRPC: Call the server to process the index request
-            grpc::Status status = stub_->ComputeIndex(&context, request, &response);
-            if (!status.ok()) { // Check if the gRPC call was successful
-                std::cerr << "gRPC call failed: " << status.error_message() << std::endl;
-                return false; // Return failure on gRPC call failure
+        }
+        pathQueue.close(); // No more files to tokenize
+        std::lock_guard<std::mutex> lock(stageTimesMutex);
+        stageTimes.walk = std::chrono::duration<double>(Clock::now() - walkStart - waiting).count();
+    });
+
+    // Stage 2: read and tokenize files in parallel, turning each into an index request
+    std::atomic<size_t> activeWorkers{indexing_workers_};
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < indexing_workers_; ++i) {
+        workers.emplace_back([&]() {
+            std::chrono::duration<double> readTime{0}, tokenizeTime{0}, serializeTime{0};
+            FileReader reader(mmap_threshold_); // Each worker owns its reader and its reusable buffer
+            std::string filePath;
+            std::string_view contents;
+            while (pathQueue.pop(filePath)) {
+                auto readStart = Clock::now();
+                bool opened = reader.read(filePath, contents);
+                auto readEnd = Clock::now();
+                readTime += readEnd - readStart;
+                if (!opened) {
+                    std::cerr << "Failed to open file: " << filePath << std::endl; // Log error if failed
+                    contents = std::string_view(); // Still sent, with no words, as the single-threaded client did
+                }
+                totalBytes += contents.size();  // Accumulate total bytes processed
+
+                // Extract word frequencies from the file
+                std::unordered_map<std::string, int> wordFrequencies = extractWordFrequencies(contents);
+                auto tokenizeEnd = Clock::now();
+                tokenizeTime += tokenizeEnd - readEnd;
+
+                fre::IndexReq document;
+                document.set_document_path(filePath); // Set the document path in the request
+                if (term_ids_) {
+                    termEncoder.encode(wordFrequencies, document); // Term IDs, new terms go with the next batch
+                } else {
+                    // Populate the request with word frequencies
+                    for (const auto& pair : wordFrequencies) {
+                        auto term_freq = document.add_word_frequencies(); // Add a new word frequency to the request
+                        term_freq->set_word(pair.first); // Set the word
+                        term_freq->set_count(pair.second); // Set the count for the word
+                    }
+                }
+                serializeTime += Clock::now() - tokenizeEnd;
+
+                if (!documentQueue.push(std::move(document))) {
+                    break; // The sender stopped; nothing more will be sent
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(stageTimesMutex);
+                stageTimes.read += readTime.count();
+                stageTimes.tokenize += tokenizeTime.count();
+                stageTimes.serialize += serializeTime.count();
+                for (auto [total, stats] : {std::pair{&stageTimes.mmapReads, &reader.mmapStats()},
+                                            std::pair{&stageTimes.preadReads, &reader.preadStats()}}) {
+                    total->files += stats->files;
+                    total->bytes += stats->bytes;
+                    total->seconds += stats->seconds;
+                }
             }
+            if (--activeWorkers == 0) {
+                documentQueue.close(); // The last worker to finish ends the sender's input
+            }
+        });
+    }
 
-            totalBytes += fs::file_size(filePath);  // Accumulate total bytes processed
+    // Stage 3: batch the documents and send them over one indexing stream
+    // gRPC: Open one indexing stream for the whole folder; the server acknowledges once when it is closed
+    grpc::ClientContext context; // Create a client context for the stream
+    context.set_compression_algorithm(compression_); // Compress the batches as configured
+    fre::IndexStreamRep summary; // Summary acknowledgement filled in when the stream finishes
+    std::unique_ptr<grpc::ClientWriter<fre::IndexBatch>> writer = stub_->ComputeIndexStream(&context, &summary);
+
+    fre::IndexBatch batch; // Batch of documents waiting to be sent
+    batch.set_client_id(clientID); // Set the client ID once per batch
+    size_t batchBytes = 0; // Serialized size of the documents in the batch
+    bool streamOpen = true; // Cleared if the server stops accepting batches
+    std::chrono::duration<double> sendTime{0};
+    // Announces the terms the batch's documents were given IDs for, then writes the batch
+    auto writeBatch = [&]() {
+        termEncoder.takeNewTerms(batch);
+        stageTimes.sentBytes += batch.ByteSizeLong();
+        return writer->Write(batch);
+    };
+    // Writes the batch and starts a new one; false once the server has closed the stream, and Finish reports why
+    auto flushBatch = [&]() {
+        if (!writeBatch()) {
+            return false;
         }
+        batch.clear_documents();
+        batch.clear_new_terms();
+        batchBytes = 0;
+        return true;
+    };
+
+    fre::IndexReq document;
+    while (documentQueue.pop(document)) {
+        auto sendStart = Clock::now();
+        size_t documentBytes = document.ByteSizeLong();
+
+        // gRPC: Send the pending batch first if this document would take it past the byte limit, so only a single
+        // document larger than the limit makes a batch that size; Write blocks while the flow-control window is full
+        if (batch.documents_size() > 0 && batchBytes + documentBytes > max_batch_bytes_ && !flushBatch()) {
+            streamOpen = false;
+            sendTime += Clock::now() - sendStart;
+            break;
+        }
+        batchBytes += documentBytes;
+        *batch.add_documents() = std::move(document); // Add the document to the current batch
+
+        // gRPC: Send the batch once it is full
+        if ((static_cast<size_t>(batch.documents_size()) >= max_batch_documents_ || batchBytes >= max_batch_bytes_) &&
+            !flushBatch()) {
+            streamOpen = false;
+            sendTime += Clock::now() - sendStart;
+            break;
+        }
+        sendTime += Clock::now() - sendStart;
+    }
+
+    // Stop the upstream stages if the stream failed, then wait for them
+    pathQueue.close();
+    documentQueue.close();
+    walker.join();
+    for (auto& worker : workers) {
+        worker.join();
     }
 
-    auto end = std::chrono::high_resolution_clock::now(); // End timing the process
+    // gRPC: Send the final partial batch and close the stream
+    auto sendStart = Clock::now();
+    if (streamOpen && batch.documents_size() > 0) {
+        streamOpen = writeBatch();
+    }
+    if (streamOpen) {
+        writer->WritesDone(); // Tell the server no more batches are coming
+    }
+    grpc::Status status = writer->Finish(); // Wait for the summary acknowledgement
+    sendTime += Clock::now() - sendStart;
+    if (!status.ok()) { // Check if the gRPC call was successful
+        std::cerr << "gRPC call failed: " << status.error_message() << std::endl;
+        return false; // Return failure on gRPC call failure
+    }
+
+    auto end = Clock::now(); // End timing the process
     std::chrono::duration<double> duration = end - start; // Calculate duration
+    stageTimes.send = sendTime.count();
+    stageTimes.serverApply = summary.apply_seconds();
+    stageTimes.serverLogWait = summary.log_wait_seconds();
+    stageTimes.total = duration.count();
+    stageTimes.documents = static_cast<size_t>(summary.documents_indexed());
+    stageTimes.bytes = totalBytes;
+    stageTimes.dictionaryTerms = termEncoder.termCount();
+    last_stage_times_ = stageTimes;
+    if (!verbose_) {
+        return true; // The caller reports lastIndexingStageTimes() itself
+    }
 
     // Log total bytes indexed and duration
     std::cout << "Completed indexing " << totalBytes << " bytes of data" << std::endl;
     std::cout << "Completed indexing in " << duration.count() << " seconds" << std::endl;
+    std::cout << "Stage times with " << indexing_workers_ << " workers (read/tokenize/serialize summed across workers): walk "
+              << stageTimes.walk << "s, read " << stageTimes.read << "s, tokenize " << stageTimes.tokenize
+              << "s, serialize " << stageTimes.serialize << "s, send " << stageTimes.send << "s (server apply "
+              << stageTimes.serverApply << "s, log wait " << stageTimes.serverLogWait << "s)" << std::endl;
+    std::cout << "Read throughput: mmap " << stageTimes.mmapReads.files << " files at "
+              << stageTimes.mmapReads.bytesPerSecond() / 1e6 << " MB/s, pread " << stageTimes.preadReads.files
+              << " files at " << stageTimes.preadReads.bytesPerSecond() / 1e6 << " MB/s" << std::endl;
+    std::cout << "Sent " << stageTimes.sentBytes << " bytes in batches";
+    if (term_ids_) {
+        std::cout << ", with " << stageTimes.dictionaryTerms << " terms sent once each";
+    }
+    std::cout << " (before compression)" << std::endl;
+    std::cout << "Server message: " << summary.message() << std::endl; // Log the server's summary acknowledgement
 
     return true; // Return success after timing and logging
 }
@@ -119,9 +298,14 @@ bool ClientProcessingEngine::search(const std::vector<std::string>& query_terms)
     for (const auto& term : query_terms) {
         request.add_terms(term); // Add each term to the search request
     }
+    request.set_top_k(search_top_k_); // Number of results wanted
 
-    // gRPC: Call the server to process the search request
-    grpc::Status status = stub_->ComputeSearch(&context, request, &response);
+    // gRPC: Call the server to process the search request, or the next replica when there are any
+    fre::FileRetrievalEngine::Stub* stub = stub_.get();
+    if (!replica_stubs_.empty()) {
+        stub = replica_stubs_[next_replica_++ % replica_stubs_.size()].get();
+    }
+    grpc::Status status = stub->ComputeSearch(&context, request, &response);
     if (!status.ok()) { // Check if the gRPC call was successful
         std::cerr << "gRPC search failed: " << status.error_message() << std::endl;
         return false; // Return failure on gRPC call failure
@@ -137,19 +321,157 @@ bool ClientProcessingEngine::search(const std::vector<std::string>& query_terms)
     return true; // Return success
 }
 
-// Helper method to extract word frequencies from a document
-std::unordered_map<std::string, int> ClientProcessingEngine::extractWordFrequencies(const std::string& file_path) {
-    std::unordered_map<std::string, int> wordFrequencies; // Map to hold word frequencies
-    std::ifstream file(file_path); // Open the file
-    if (!file) { // Check if the file opened successfully
-        std::cerr << "Failed to open file: " << file_path << std::endl; // Log error if failed
-        return wordFrequencies; // Return empty map
+// Sends every query in one batch to the server, or to the next replica
+bool ClientProcessingEngine::searchBatch(const std::vector<std::vector<std::string>>& queries) {
+    if (queries.empty()) {
+        std::cerr << "Please provide at least 1 search." << std::endl;
+        return false;
+    }
+    grpc::ClientContext context;
+    fre::SearchBatchReq request;
+    fre::SearchBatchRep response;
+    for (const auto& query_terms : queries) {
+        fre::SearchReq* search = request.add_searches();
+        for (const auto& term : query_terms) {
+            search->add_terms(term);
+        }
+        search->set_top_k(search_top_k_);
+    }
+
+    fre::FileRetrievalEngine::Stub* stub = stub_.get();
+    if (!replica_stubs_.empty()) {
+        stub = replica_stubs_[next_replica_++ % replica_stubs_.size()].get();
+    }
+    grpc::Status status = stub->ComputeSearchBatch(&context, request, &response);
+    if (!status.ok()) {
+        std::cerr << "gRPC batch search failed: " << status.error_message() << std::endl;
+        return false;
+    }
+
+    std::cout << "Server message: " << response.message() << std::endl;
+    for (int i = 0; i < response.results_size(); ++i) {
+        const fre::SearchRep& result = response.results(i);
+        std::cout << "Search " << i + 1 << ": " << result.message() << std::endl;
+        for (const auto& document : result.documents()) {
+            std::cout << "ClientID:Document Path: " << document.path() << ", Count: " << document.count() << std::endl;
+        }
     }
+    return true;
+}
+
+// Starts a paged search on the server, or on the next replica; its later pages must come from the same one
+bool ClientProcessingEngine::searchPage(const std::vector<std::string>& query_terms) {
+    if (query_terms.empty()) { // Check if there are no search terms
+        std::cerr << "Please provide at least 1 search term." << std::endl; // Log error for no terms
+        return false; // Return failure
+    }
+    fre::SearchStreamReq request;
+    for (const auto& term : query_terms) {
+        request.add_terms(term); // Add each term to the search request
+    }
+    request.set_page_size(search_page_size_);
+
+    fre::FileRetrievalEngine::Stub* stub = stub_.get();
+    if (!replica_stubs_.empty()) {
+        stub = replica_stubs_[next_replica_++ % replica_stubs_.size()].get();
+    }
+    search_cursor_.clear();
+    return streamSearchPage(stub, request);
+}
+
+// Presents the last page's cursor to the server that issued it
+bool ClientProcessingEngine::nextSearchPage() {
+    if (search_cursor_.empty()) {
+        std::cerr << "No more results; start a paged search first." << std::endl;
+        return false;
+    }
+    fre::SearchStreamReq request;
+    request.set_cursor(search_cursor_);
+    request.set_page_size(search_page_size_);
+    return streamSearchPage(search_cursor_stub_, request);
+}
+
+// Prints the results chunk by chunk as they arrive; the first chunk carries the page's summary and cursor
+bool ClientProcessingEngine::streamSearchPage(fre::FileRetrievalEngine::Stub* stub,
+                                              const fre::SearchStreamReq& request) {
+    grpc::ClientContext context;
+    std::unique_ptr<grpc::ClientReader<fre::SearchChunk>> reader = stub->ComputeSearchStream(&context, request);
+    fre::SearchChunk chunk;
+    bool first = true;
+    std::string cursor;
+    while (reader->Read(&chunk)) {
+        if (first) {
+            std::cout << "Server message: " << chunk.message() << std::endl; // Log the server's message
+            cursor = chunk.next_cursor();
+            first = false;
+        }
+        for (const auto& result : chunk.documents()) {
+            std::cout << "ClientID:Document Path: " << result.path() << ", Count: " << result.count() << std::endl;
+        }
+    }
+    grpc::Status status = reader->Finish();
+    if (!status.ok()) {
+        std::cerr << "gRPC search failed: " << status.error_message() << std::endl;
+        search_cursor_.clear();
+        return false;
+    }
+    search_cursor_ = cursor;
+    search_cursor_stub_ = stub;
+    if (!search_cursor_.empty()) {
+        std::cout << "More results: type \"more\" for the next page." << std::endl;
+    }
+    return true;
+}
+
+// Opens a channel to a replica; indexing and deletes keep going to the server
+void ClientProcessingEngine::addSearchReplica(const std::string& address) {
+    grpc::ChannelArguments channel_args;
+    channel_args.SetMaxReceiveMessageSize(INT_MAX);
+    replica_stubs_.push_back(fre::FileRetrievalEngine::NewStub(
+        grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), channel_args)));
+    std::cout << "Searches now rotate over " << replica_stubs_.size() << " replicas" << std::endl;
+}
+
+// Method to remove a file or a folder's files from the index
+bool ClientProcessingEngine::deleteDocuments(const std::string& path) {
+    fre::DeleteReq request;
+    request.set_client_id(clientID);
+
+    // Paths are spelled the way indexFolder walked them, so the server finds the same keys
+    std::error_code error;
+    if (fs::is_directory(path, error)) {
+        for (fs::recursive_directory_iterator it(path, error), endIt; !error && it != endIt; it.increment(error)) {
+            std::error_code statusError;
+            if (it->is_regular_file(statusError)) {
+                request.add_document_paths(it->path().string());
+            }
+        }
+        if (error) {
+            std::cerr << "Error: could not walk " << path << ": " << error.message() << std::endl;
+            return false;
+        }
+    } else {
+        request.add_document_paths(path); // A single file, which may no longer exist locally
+    }
+
+    grpc::ClientContext context;
+    fre::DeleteRep response;
+    grpc::Status status = stub_->ComputeDelete(&context, request, &response);
+    if (!status.ok()) {
+        std::cerr << "gRPC delete failed: " << status.error_message() << std::endl;
+        return false;
+    }
+    std::cout << "Server message: " << response.message() << std::endl;
+    return true;
+}
+
+// Helper method to extract word frequencies from a document's contents
+std::unordered_map<std::string, int> ClientProcessingEngine::extractWordFrequencies(std::string_view contents) {
+    std::unordered_map<std::string, int> wordFrequencies; // Map to hold word frequencies
 
     std::string word; // String to hold the current word
-    char ch; // Variable to hold each character read from the file
-    while (file.get(ch)) { // Read characters from the file one by one
-        if (std::isalnum(ch)) { // Check if the character is alphanumeric
+    for (char ch : contents) { // Scan the characters of the document
+        if (std::isalnum(static_cast<unsigned char>(ch))) { // Check if the character is alphanumeric
             word += ch; // Retain case-sensitive characters
         } else { // If not alphanumeric
             if (!word.empty() && word.back() == 's' && ch == '\'') { // Handle possessive case
@@ -167,4 +489,3 @@ std::unordered_map<std::string, int> ClientProcessingEngine::extractWordFrequenc
 
     return wordFrequencies; // Return the map of word frequencies
 }
-
@@ -0,0 +1,108 @@
+#include "CorpusGenerator.hpp"
+#include <algorithm>  // For std::upper_bound
+#include <cmath>      // For std::pow
+#include <filesystem> // For creating the corpus folders
+#include <fstream>    // For writing documents
+#include <map>        // For counting words in a stable order
+
+namespace fs = std::filesystem;
+
+// Constructor builds the cumulative distribution of word ranks
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options) : options_(options) {
+    cumulative_.reserve(options_.vocabulary);
+    double total = 0.0;
+    for (size_t rank = 0; rank < options_.vocabulary; ++rank) {
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), options_.zipfExponent);
+        cumulative_.push_back(total);
+    }
+    for (double& value : cumulative_) {
+        value /= total; // Normalize so the last entry is 1
+    }
+}
+
+// Spells the rank as consonant-vowel syllables; adding 100 guarantees at least two syllables
+std::string CorpusGenerator::word(size_t rank) {
+    static const char consonants[] = "bcdfghjklmnprstvwxyz"; // 20 consonants
+    static const char vowels[] = "aeiou";                     // 5 vowels
+    std::string spelled;
+    for (size_t value = rank + 100; value > 0; value /= 100) {
+        size_t syllable = value % 100;
+        spelled += consonants[syllable / 5];
+        spelled += vowels[syllable % 5];
+    }
+    return spelled;
+}
+
+// Mixes the corpus seed with the document number (splitmix64) so documents are independent
+std::mt19937_64 CorpusGenerator::documentRng(size_t document) const {
+    uint64_t z = options_.seed + 0x9E3779B97F4A7C15ull * (document + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return std::mt19937_64(z ^ (z >> 31));
+}
+
+// Draws a uniform number from the top 53 bits and looks it up in the cumulative distribution
+size_t CorpusGenerator::sampleRank(std::mt19937_64& rng) const {
+    double uniform = static_cast<double>(rng() >> 11) * (1.0 / 9007199254740992.0); // [0, 1)
+    size_t rank = std::upper_bound(cumulative_.begin(), cumulative_.end(), uniform) - cumulative_.begin();
+    return std::min(rank, cumulative_.size() - 1);
+}
+
+// Generates the words of the document, breaking lines every 12 words and adding punctuation from the same stream
+std::string CorpusGenerator::documentText(size_t document) const {
+    std::mt19937_64 rng = documentRng(document);
+    std::string text;
+    text.reserve(options_.wordsPerDocument * 8);
+    for (size_t i = 0; i < options_.wordsPerDocument; ++i) {
+        text += word(sampleRank(rng));
+        uint64_t separator = rng() % 16;
+        if ((i + 1) % 12 == 0) {
+            text += ".\n";
+        } else if (separator == 0) {
+            text += ", ";
+        } else {
+            text += ' ';
+        }
+    }
+    return text;
+}
+
+// Counts the sampled words; every generated word is alphanumeric and longer than two characters, so the client
+// tokenizer counts exactly these
+std::vector<std::pair<std::string, int>> CorpusGenerator::termFrequencies(size_t document) const {
+    std::mt19937_64 rng = documentRng(document);
+    std::map<size_t, int> counts;
+    for (size_t i = 0; i < options_.wordsPerDocument; ++i) {
+        ++counts[sampleRank(rng)];
+        rng(); // The separator draw of documentText
+    }
+    std::vector<std::pair<std::string, int>> frequencies;
+    frequencies.reserve(counts.size());
+    for (const auto& [rank, count] : counts) {
+        frequencies.emplace_back(word(rank), count);
+    }
+    return frequencies;
+}
+
+// Writes folder/part_NNN/document_N.txt for every document
+bool CorpusGenerator::writeFolder(const std::string& folder, size_t& bytesWritten, std::string& error) const {
+    bytesWritten = 0;
+    std::error_code code;
+    for (size_t document = 0; document < options_.documents; ++document) {
+        fs::path directory = fs::path(folder) / ("part_" + std::to_string(document / 1000));
+        if (document % 1000 == 0 && !fs::create_directories(directory, code) && code) {
+            error = "could not create " + directory.string() + ": " + code.message();
+            return false;
+        }
+        fs::path path = directory / ("document_" + std::to_string(document) + ".txt");
+        std::ofstream out(path, std::ios::binary);
+        std::string text = documentText(document);
+        out << text;
+        if (!out) {
+            error = "could not write " + path.string();
+            return false;
+        }
+        bytesWritten += text.size();
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+#include "DeltaSegment.hpp"
+#include "FrozenTermDictionary.hpp" // For the term hash the dictionary shards with
+#include <algorithm>
+
+// Sorts one record per posting by shard, hash and term, so the postings of a term end up adjacent and in
+// document order; string comparisons happen only between terms whose hashes collide
+DeltaSegment::DeltaSegment(const std::vector<DocumentTerms>& documents, size_t shardCount) : shardStart_(shardCount + 1, 0) {
+    struct Record {
+        uint64_t hash;                                    // Hash of the term
+        uint32_t shard;                                   // Shard owning the term
+        int documentNumber;                               // Document the term occurs in
+        const std::pair<std::string, int>* termFrequency; // Term and its frequency in the document
+    };
+    std::vector<Record> records;
+    size_t termCount = 0;
+    for (const auto& document : documents) {
+        termCount += document.second.size();
+    }
+    records.reserve(termCount);
+    for (const auto& [documentNumber, termFrequencyList] : documents) {
+        for (const auto& termFrequency : termFrequencyList) {
+            uint64_t termHash = FrozenTermDictionary::hash(termFrequency.first);
+            records.push_back({termHash, static_cast<uint32_t>(termHash % shardCount), documentNumber, &termFrequency});
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+        if (a.shard != b.shard) {
+            return a.shard < b.shard;
+        }
+        if (a.hash != b.hash) {
+            return a.hash < b.hash;
+        }
+        int order = a.termFrequency->first.compare(b.termFrequency->first);
+        return order != 0 ? order < 0 : a.documentNumber < b.documentNumber;
+    });
+
+    documents_.reserve(records.size());
+    frequencies_.reserve(records.size());
+    for (size_t i = 0; i < records.size();) {
+        const Record& first = records[i];
+        const std::string& term = first.termFrequency->first;
+        Entry entry{first.hash, static_cast<uint32_t>(termBytes_.size()), static_cast<uint32_t>(term.size()),
+                    static_cast<uint32_t>(documents_.size()), 0};
+        termBytes_.insert(termBytes_.end(), term.begin(), term.end());
+        for (; i < records.size() && records[i].hash == first.hash && records[i].termFrequency->first == term; ++i) {
+            if (entry.postingCount > 0 && documents_.back() == records[i].documentNumber) {
+                frequencies_.back() += records[i].termFrequency->second; // A term listed twice for one document
+                continue;
+            }
+            documents_.push_back(records[i].documentNumber);
+            frequencies_.push_back(records[i].termFrequency->second);
+            ++entry.postingCount;
+        }
+        ++shardStart_[first.shard + 1];
+        entries_.push_back(entry);
+    }
+    for (size_t shard = 1; shard < shardStart_.size(); ++shard) {
+        shardStart_[shard] += shardStart_[shard - 1];
+    }
+
+    termOrder_.resize(entries_.size());
+    for (size_t entry = 0; entry < entries_.size(); ++entry) {
+        termOrder_[entry] = static_cast<uint32_t>(entry);
+    }
+    std::sort(termOrder_.begin(), termOrder_.end(), [&](uint32_t a, uint32_t b) { return term(a) < term(b); });
+}
+
+// Binary search of the term order table
+size_t DeltaSegment::lowerBound(std::string_view termToFind) const {
+    return std::lower_bound(termOrder_.begin(), termOrder_.end(), termToFind,
+                            [&](uint32_t entry, std::string_view t) { return term(entry) < t; }) -
+           termOrder_.begin();
+}
+
+// Binary search of the shard's range by hash, then a scan of the (rarely more than one) entries sharing it
+PostingView DeltaSegment::find(std::string_view term, uint64_t termHash) const {
+    size_t shard = termHash % (shardStart_.size() - 1);
+    auto first = entries_.begin() + shardStart_[shard];
+    auto last = entries_.begin() + shardStart_[shard + 1];
+    for (auto entry = std::lower_bound(first, last, termHash, [](const Entry& e, uint64_t h) { return e.hash < h; });
+         entry != last && entry->hash == termHash; ++entry) {
+        if (this->term(entry - entries_.begin()) == term) {
+            return postings(entry - entries_.begin());
+        }
+    }
+    return {};
+}
+
+size_t DeltaSegment::memoryBytes() const {
+    return sizeof(DeltaSegment) + entries_.capacity() * sizeof(Entry) +
+           (shardStart_.capacity() + termOrder_.capacity()) * sizeof(uint32_t) +
+           termBytes_.capacity() + (documents_.capacity() + frequencies_.capacity()) * sizeof(int32_t);
+}
@@ -0,0 +1,48 @@
+#include "DocumentTombstones.hpp"
+
+// Directory of empty chunk pointers; 32768 entries cover every document number
+DocumentTombstones::DocumentTombstones() : chunks_(new std::atomic<std::atomic<uint64_t>*>[chunkCount]) {
+    for (size_t i = 0; i < chunkCount; ++i) {
+        chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+// Frees the chunks; no reader may be running
+DocumentTombstones::~DocumentTombstones() {
+    for (size_t i = 0; i < chunkCount; ++i) {
+        delete[] chunks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+// Sets the document's bit, allocating its chunk first if no document in it was marked before
+bool DocumentTombstones::insert(int document) {
+    if (document < 0) {
+        return false;
+    }
+    std::atomic<std::atomic<uint64_t>*>& slot = chunks_[static_cast<size_t>(document) / chunkBits];
+    std::atomic<uint64_t>* chunk = slot.load(std::memory_order_acquire);
+    if (!chunk) {
+        std::lock_guard<std::mutex> lock(allocationMutex_);
+        chunk = slot.load(std::memory_order_acquire);
+        if (!chunk) {
+            chunk = new std::atomic<uint64_t>[chunkBits / 64];
+            for (size_t i = 0; i < chunkBits / 64; ++i) {
+                chunk[i].store(0, std::memory_order_relaxed);
+            }
+            slot.store(chunk, std::memory_order_release); // Readers see a zeroed chunk or none
+            allocatedChunks_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    size_t bit = static_cast<size_t>(document) % chunkBits;
+    uint64_t mask = uint64_t{1} << (bit % 64);
+    if (chunk[bit / 64].fetch_or(mask, std::memory_order_release) & mask) {
+        return false;
+    }
+    count_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// Directory plus allocated chunks
+size_t DocumentTombstones::memoryBytes() const {
+    return chunkCount * sizeof(void*) + allocatedChunks_.load(std::memory_order_relaxed) * (chunkBits / 8);
+}
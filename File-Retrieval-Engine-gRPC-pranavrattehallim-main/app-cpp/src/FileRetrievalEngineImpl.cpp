@@ -3,6 +3,7 @@
 #include <algorithm> // Include for sorting operations
 #include <chrono>
 #include <sstream> // For constructing the result message
+#include <fstream> // For streaming the snapshot file to replicas
 
 // Constructor for FileRetrievalEngineImpl
 FileRetrievalEngineImpl::FileRetrievalEngineImpl(std::shared_ptr<IndexStore> store) : store_(std::move(store)) {
@@ -15,21 +16,56 @@ grpc::Status FileRetrievalEngineImpl::ComputeIndex(
         const fre::IndexReq* request,
         fre::IndexRep* reply)
 {
+    if (replica_) {
+        return rejectOnReplica();
+    }
+
+    if (request->term_ids_size() > 0) {
+        return grpc::Status(grpc::INVALID_ARGUMENT, "Term IDs need the dictionary of an indexing stream.");
+    }
+
     // Extract document path and client ID from the request
     std::string documentPath = request->document_path();
     std::string clientID = request->client_id();
 
-    // Get document number for the path and store word frequencies
-    int documentNumber = store_->putDocument(documentPath); // Store the document and get its ID
-
     // Populate term frequencies vector from request
     std::vector<std::pair<std::string, int>> termFrequencies;
     for (const auto& wordFreq : request->word_frequencies()) {
+        if (wordFreq.count() < 1) { // Counts feed posting lists, scores and the log, which all assume at least 1
+            return grpc::Status(grpc::INVALID_ARGUMENT, "Word " + wordFreq.word() + " has count " +
+                                std::to_string(wordFreq.count()) + "; counts must be at least 1.");
+        }
         termFrequencies.emplace_back(wordFreq.word(), wordFreq.count()); // Store word and its frequency
     }
 
-    // Update the index with document number, client ID, and term frequencies
-    store_->updateIndex(clientID, documentNumber, termFrequencies);
+    // Encode the log record before taking any lock
+    std::string record;
+    if (wal_ || replication_) {
+        WriteAheadLog::encodeRecord(record, clientID, documentPath, termFrequencies);
+    }
+
+    uint64_t sequence = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(checkpointMutex_); // Keeps a checkpoint from splitting log and index
+        std::vector<int> replaced; // Earlier version of the document, searchable until the new one is
+        int documentNumber = 0;
+        {
+            std::lock_guard<std::mutex> orderLock(logOrderMutex_); // Log order must be document table order
+            sequence = logRecords(record, 1); // Queue the record for the next group commit
+
+            // Get document number for the client's path and store word frequencies
+            documentNumber = store_->putDocument(clientID, documentPath, &replaced); // Store the document and get its ID
+        }
+
+        // Update the index with document number and term frequencies, then retire the version it replaces
+        store_->updateIndex(documentNumber, termFrequencies);
+        store_->retireDocuments(replaced);
+    }
+
+    // Acknowledge only once the record is on disk
+    if (wal_ && !wal_->waitDurable(sequence)) {
+        return grpc::Status(grpc::UNAVAILABLE, "Write-ahead log is not writable; document was not persisted.");
+    }
 
     // Set acknowledgment message in the reply
     reply->set_message("Indexing complete for document: " + documentPath);
@@ -39,88 +75,650 @@ grpc::Status FileRetrievalEngineImpl::ComputeIndex(
     return grpc::Status::OK; // Return OK status for successful indexing
 }
 
+// Handles a stream of indexing batches from the client
+grpc::Status FileRetrievalEngineImpl::ComputeIndexStream(
+        grpc::ServerContext* context,
+        grpc::ServerReader<fre::IndexBatch>* reader,
+        fre::IndexStreamRep* reply)
+{
+    if (replica_) {
+        return rejectOnReplica();
+    }
+
+    fre::IndexBatch batch;          // Batch currently being applied
+    SessionTermDecoder terms;       // Dictionary the stream's term IDs refer to
+    int64_t documentsIndexed = 0;   // Documents applied over the whole stream
+    int64_t batchesReceived = 0;    // Batches received over the whole stream
+    uint64_t sequence = 0;          // Log record of the last document applied
+    std::chrono::duration<double> applyTime{0}; // Time spent logging and applying batches
+
+    // Read batches until the client calls WritesDone; gRPC flow control holds the client back while we apply
+    while (reader->Read(&batch)) {
+        ++batchesReceived;
+        auto applyStart = std::chrono::steady_clock::now();
+        grpc::Status status = applyIndexBatch(batch, terms, sequence);
+        if (!status.ok()) {
+            return status; // Earlier batches stay applied, as they would if the client had gone away
+        }
+        applyTime += std::chrono::steady_clock::now() - applyStart;
+        documentsIndexed += batch.documents_size();
+    }
+
+    return completeIndexStream(sequence, documentsIndexed, batchesReceived, applyTime.count(), reply);
+}
+
+// Logs and applies one batch of an indexing stream
+grpc::Status FileRetrievalEngineImpl::applyIndexBatch(const fre::IndexBatch& batch, SessionTermDecoder& terms,
+                                                      uint64_t& sequence) {
+    std::vector<std::string> documentPaths;
+    documentPaths.reserve(batch.documents_size());
+    for (const auto& document : batch.documents()) {
+        documentPaths.push_back(document.document_path());
+    }
+
+    // Collect term frequencies for the whole batch, resolving term IDs, and its log records before taking any lock
+    std::vector<std::vector<std::pair<std::string, int>>> termFrequencies;
+    std::string error;
+    if (!terms.decode(batch, termFrequencies, error)) {
+        return grpc::Status(grpc::INVALID_ARGUMENT, error);
+    }
+    std::vector<IndexStore::DocumentTerms> documents;
+    documents.reserve(batch.documents_size());
+    std::string records;
+    for (int i = 0; i < batch.documents_size(); ++i) {
+        if (wal_ || replication_) {
+            WriteAheadLog::encodeRecord(records, batch.client_id(), documentPaths[i], termFrequencies[i]);
+        }
+        documents.emplace_back(0, std::move(termFrequencies[i]));
+    }
+
+    std::shared_lock<std::shared_mutex> lock(checkpointMutex_); // Keeps a checkpoint from splitting log and index
+    std::vector<int> replaced; // Earlier versions of the batch's documents, searchable until the new ones are
+    std::vector<int> documentNumbers;
+    {
+        std::lock_guard<std::mutex> orderLock(logOrderMutex_); // Log order must be document table order
+        sequence = std::max(sequence, logRecords(records, documents.size())); // One append for the whole batch
+
+        // Register every document of the batch under one document table lock
+        documentNumbers = store_->putDocuments(batch.client_id(), documentPaths, &replaced);
+    }
+    for (size_t i = 0; i < documents.size(); ++i) {
+        documents[i].first = documentNumbers[i];
+    }
+
+    // Apply the whole batch in one pass over the shards, then retire the versions it replaces
+    store_->updateIndexBatch(documents);
+    store_->retireDocuments(replaced);
+    return grpc::Status::OK;
+}
+
+// Acknowledges a finished indexing stream once all of its log records are durable
+grpc::Status FileRetrievalEngineImpl::completeIndexStream(uint64_t sequence, int64_t documentsIndexed,
+                                                          int64_t batchesReceived, double applySeconds,
+                                                          fre::IndexStreamRep* reply) {
+    // The stream is acknowledged once, so one wait covers the group commit of every batch
+    auto waitStart = std::chrono::steady_clock::now();
+    if (wal_ && sequence != 0 && !wal_->waitDurable(sequence)) {
+        return grpc::Status(grpc::UNAVAILABLE, "Write-ahead log is not writable; documents were not persisted.");
+    }
+    reply->set_log_wait_seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count());
+    reply->set_apply_seconds(applySeconds); // Lets clients split their send time into network and server work
+
+    // Send one summary acknowledgement for the whole stream
+    reply->set_documents_indexed(documentsIndexed);
+    reply->set_batches_received(batchesReceived);
+    reply->set_message("Indexing complete for " + std::to_string(documentsIndexed) + " documents in " +
+                       std::to_string(batchesReceived) + " batches");
+
+    return grpc::Status::OK; // Return OK status for successful indexing
+}
+
+// Answers repeated searches from the cache
+void FileRetrievalEngineImpl::setResultCache(std::shared_ptr<ResultCache> cache) {
+    cache_ = std::move(cache);
+}
+
+// Keeps indexing operations for replicas and remembers which file to send them first
+void FileRetrievalEngineImpl::setReplicationLog(std::shared_ptr<ReplicationLog> replication,
+                                                const std::string& snapshotPath) {
+    replication_ = std::move(replication);
+    snapshotPath_ = snapshotPath;
+}
+
+// Turns the server into a replica of the follower's primary
+void FileRetrievalEngineImpl::setReplica(std::shared_ptr<ReplicaFollower> replica) {
+    replica_ = std::move(replica);
+}
+
+// Names the primary so the client can send the write there instead
+grpc::Status FileRetrievalEngineImpl::rejectOnReplica() const {
+    return grpc::Status(grpc::FAILED_PRECONDITION,
+                        "This server is a read-only replica; send updates to the primary at " + replica_->primary() + ".");
+}
+
+// Log order is the order replicas apply operations in, so records are published with the log's numbers
+uint64_t FileRetrievalEngineImpl::logRecords(const std::string& records, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t sequence = 0;
+    if (wal_) {
+        sequence = wal_->append(records, count);
+    }
+    if (replication_) {
+        replication_->publish(records, count, sequence);
+    }
+    return wal_ ? sequence : 0;
+}
+
+// Enables write-ahead logging of indexing operations
+void FileRetrievalEngineImpl::setWriteAheadLog(std::shared_ptr<WriteAheadLog> wal) {
+    wal_ = std::move(wal);
+}
+
+// Saves a snapshot while indexing is paused, so it covers exactly the records logged so far, then empties the log
+bool FileRetrievalEngineImpl::checkpoint(const std::string& snapshotPath) {
+    std::unique_lock<std::shared_mutex> lock(checkpointMutex_);
+    uint64_t sequence = wal_ ? wal_->lastSequence() : replication_ ? replication_->lastSequence() : 0;
+    if (!store_->saveSnapshot(snapshotPath, sequence)) {
+        return false; // Keep the log; it is still needed to recover
+    }
+    if (replication_) {
+        replication_->trim(sequence); // Replicas bootstrapping from now on start from this snapshot
+    }
+    if (wal_ && !wal_->truncate()) {
+        std::cerr << "Error: could not empty the write-ahead log after the snapshot" << std::endl;
+        return false;
+    }
+    return true;
+}
+
 // Handles search requests from the client
 grpc::Status FileRetrievalEngineImpl::ComputeSearch(
         grpc::ServerContext* context,
         const fre::SearchReq* request,
         fre::SearchRep* reply)
 {
-    // Start timing the search request
-    auto start = std::chrono::high_resolution_clock::now();
-
     // Extract search terms from the request
     std::vector<std::string> terms;
-    for (const auto& term : request->terms()) {
-        if (term == "and") continue; // Skip the term if it's "and"
-        terms.push_back(term); // Store each valid search term in a vector
+    grpc::Status parsed = parseSearchTerms(request->terms(), terms);
+    if (!parsed.ok()) {
+        return parsed;
     }
+    runSearch(*request, terms, reply, nullptr, store_->generation());
+    return grpc::Status::OK;
+}
 
-    // Check if enough terms are provided (minimum of 1 as per requirements)
-    if (terms.empty()) { // Check if there are no valid search terms
-        std::cerr << "Please provide at least 1 search term." << std::endl; // Log error for no terms
-        return grpc::Status(grpc::INVALID_ARGUMENT, "No search terms provided."); // Return failure with error status
-    }
+// Answers one search whose terms have been parsed
+void FileRetrievalEngineImpl::runSearch(const fre::SearchReq& request, const std::vector<std::string>& terms,
+                                        fre::SearchRep* reply, const SharedPostings* shared, uint64_t generation)
+{
+    // Start timing the search request
+    auto start = std::chrono::high_resolution_clock::now();
 
-    // Prepare a map to hold document frequencies for term intersection and frequency accumulation
-    std::unordered_map<std::string, int> documentFrequencyMap; // Map of document IDs (as strings) to their frequencies
-    bool firstTerm = true; // Flag to check if it’s the first term in the iteration
+    // Intersect the terms' posting lists and keep the top K documents based on frequency (10 unless the request
+    // asks otherwise). Document paths are resolved only for the documents that made the cut.
+    size_t topK = request.top_k() > 0 ? std::min<size_t>(request.top_k(), maxSearchResults) : 10;
 
-    for (const auto& term : terms) {
-        // Get documents and their frequencies for the current term
-        auto termResults = store_->lookupIndex(term); // Lookup index for the term
+    // Each prefix term matches the union of at most this many dictionary terms, the first in term order
+    size_t maxExpansions = expansionLimit(request.max_expansions());
+    auto computeSearch = [&](CachedSearch& search) {
+        search.results = store_->getTopResults(terms, topK, &search.totalMatches, &search.totalExact, maxExpansions,
+                                               &search.expandedTerms, &search.expansionTruncated, shared);
+    };
 
-        if (firstTerm) {
-            // Initialize documentFrequencyMap with results from the first term
-            for (const auto& [docID, freq] : termResults) {
-                documentFrequencyMap[docID] = freq; // Store frequencies for the first term
-            }
-            firstTerm = false; // Set flag to false for subsequent terms
-        } else {
-            // Intersect documentFrequencyMap with results from the current term
-            for (auto it = documentFrequencyMap.begin(); it != documentFrequencyMap.end();) {
-                // Check if the document is also in the current term's results
-                auto found = std::find_if(termResults.begin(), termResults.end(),
-                                          [&](const auto& pair) { return pair.first == it->first; });
-
-                if (found != termResults.end()) {
-                    it->second += found->second; // Accumulate frequency for matching documents
-                    ++it; // Move to the next document
-                } else {
-                    // Remove documents not found in the current term's results
-                    it = documentFrequencyMap.erase(it);
-                }
-            }
+    // Repeated queries are answered from the cache as long as the index has not changed since they were computed
+    CachedSearch search;
+    bool cached = false;
+    if (cache_) {
+        std::string key = ResultCache::makeKey(terms, topK, maxExpansions);
+        cached = cache_->lookup(key, generation, search);
+        if (!cached) {
+            computeSearch(search);
+            cache_->insert(key, generation, search);
         }
+    } else {
+        computeSearch(search);
     }
 
-    // Sort and retain top 10 documents based on frequency
-    std::vector<std::pair<std::string, int>> sortedResults(documentFrequencyMap.begin(), documentFrequencyMap.end());
-    std::sort(sortedResults.begin(), sortedResults.end(), [](const auto& a, const auto& b) {
-        return a.second > b.second; // Sort in descending order by frequency
-    });
+    // Prefix terms say how many terms they stood for, and whether the cap left some out
+    std::string expansionNote;
+    if (std::any_of(terms.begin(), terms.end(), IndexStore::isPrefixTerm)) {
+        expansionNote = ", prefixes expanded to " + std::to_string(search.expandedTerms) + " terms" +
+                        (search.expansionTruncated ? " (capped at " + std::to_string(maxExpansions) + " per prefix)" : "");
+    }
 
-    // Capture total results and limit the results to the top 10 documents
-    int totalResults = sortedResults.size();
-    if (sortedResults.size() > 10) {
-        sortedResults.resize(10); // Keep only the top 10 results
+    // A replica says how stale its answer may be
+    std::string replicaNote;
+    if (replica_) {
+        ReplicationLag lag = replica_->lag();
+        uint64_t behind = lag.primarySequence > lag.appliedSequence ? lag.primarySequence - lag.appliedSequence : 0;
+        reply->set_replication_lag_records(behind);
+        reply->set_replication_lag_seconds(lag.seconds);
+        replicaNote = " on a replica of " + replica_->primary() + " (" + std::to_string(behind) + " updates, " +
+                      std::to_string(lag.seconds) + " seconds behind)";
     }
 
     // Prepare the reply message
     reply->set_message("Search completed in " +
                        std::to_string(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()) +
-                       " seconds. Search results (top " + std::to_string(sortedResults.size()) +
-                       " out of " + std::to_string(totalResults) + "):");
+                       (cached ? " seconds (cached)" : " seconds") + expansionNote + replicaNote + ". Search results (top " +
+                       std::to_string(search.results.size()) + (search.totalExact ? " out of " : " out of at least ") +
+                       std::to_string(search.totalMatches) + "):");
+
+    reply->set_total_matches(static_cast<int64_t>(search.totalMatches));
+    reply->set_total_exact(search.totalExact);
+    reply->set_expanded_terms(static_cast<int64_t>(search.expandedTerms));
+    reply->set_expansion_truncated(search.expansionTruncated);
 
     // Add document paths and frequencies to the reply
-    for (const auto& [docID, freq] : sortedResults) {
+    for (const auto& [documentKey, freq] : search.results) {
         auto result = reply->add_documents(); // Create a new SearchResult in the response
-        result->set_path(docID);               // Set the document path
+        result->set_path(documentKey);         // Set the "clientID:documentPath" key
         result->set_count(freq);               // Set the frequency count
     }
 
     // Log search completion
     // std::cout << "[DEBUG] Sending SearchRep message: " << reply->message() << std::endl;
+}
+
+// Handles a batch of searches: every search is checked before any runs, the terms several searches share are
+// looked up once, and the searches then run side by side on the worker pool
+grpc::Status FileRetrievalEngineImpl::ComputeSearchBatch(
+        grpc::ServerContext* context,
+        const fre::SearchBatchReq* request,
+        fre::SearchBatchRep* reply)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t count = static_cast<size_t>(request->searches_size());
+    if (count == 0) {
+        return grpc::Status(grpc::INVALID_ARGUMENT, "A search batch needs at least one search.");
+    }
+    if (count > maxBatchSearches) {
+        return grpc::Status(grpc::INVALID_ARGUMENT, "A search batch may hold at most " +
+                            std::to_string(maxBatchSearches) + " searches.");
+    }
+
+    // A malformed search fails the whole batch, naming its position
+    std::vector<std::vector<std::string>> terms(count);
+    for (size_t i = 0; i < count; ++i) {
+        grpc::Status parsed = parseSearchTerms(request->searches(static_cast<int>(i)).terms(), terms[i]);
+        if (!parsed.ok()) {
+            return grpc::Status(parsed.error_code(), "Search " + std::to_string(i) + ": " + parsed.error_message());
+        }
+    }
+
+    // Plain terms used by more than one search are looked up here, once; prefix terms expand per search, as
+    // their caps may differ
+    std::unordered_map<std::string, size_t> uses;
+    for (auto& searchTerms : terms) {
+        std::vector<std::string> distinct = searchTerms;
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        for (auto& term : distinct) {
+            if (!IndexStore::isPrefixTerm(term)) {
+                ++uses[term];
+            }
+        }
+    }
+    uint64_t generation = store_->generation(); // Read before the shared lookups, which the searches may answer from
+    SharedPostings shared;
+    for (const auto& [term, searches] : uses) {
+        if (searches > 1) {
+            shared.emplace(term, store_->lookupIndex(term));
+        }
+    }
+
+    // Each search fills in its own reply, so the workers share nothing but the looked-up lists
+    for (size_t i = 0; i < count; ++i) {
+        reply->add_results();
+    }
+    auto task = [&](size_t i) {
+        runSearch(request->searches(static_cast<int>(i)), terms[i], reply->mutable_results(static_cast<int>(i)), &shared,
+                  generation);
+    };
+    if (workers_) {
+        workers_->run(count, task);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+    }
+
+    reply->set_shared_terms(static_cast<int64_t>(shared.size()));
+    reply->set_message("Batch of " + std::to_string(count) + " searches completed in " +
+                       std::to_string(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()) +
+                       " seconds (" + std::to_string(shared.size()) + " terms looked up once for several searches).");
+    return grpc::Status::OK;
+}
+
+// Runs the searches of a batch on the pool's threads
+void FileRetrievalEngineImpl::setSearchWorkers(std::shared_ptr<SearchWorkerPool> workers) {
+    workers_ = std::move(workers);
+}
+
+// Extracts the search terms; at least one must remain once "and" is dropped
+grpc::Status FileRetrievalEngineImpl::parseSearchTerms(
+        const google::protobuf::RepeatedPtrField<std::string>& requestTerms,
+        std::vector<std::string>& terms)
+{
+    for (const auto& term : requestTerms) {
+        if (term == "and") continue; // Skip the term if it's "and"
+        if (term.find('*') != std::string::npos &&
+            (!IndexStore::isPrefixTerm(term) || term.find('*') != term.size() - 1)) {
+            // Only a trailing wildcard can be answered from the sorted dictionary
+            return grpc::Status(grpc::INVALID_ARGUMENT, "Unsupported wildcard in \"" + term +
+                                "\": only a single trailing '*' after at least one character is allowed.");
+        }
+        terms.push_back(term); // Store each valid search term in a vector
+    }
 
+    // Check if enough terms are provided (minimum of 1 as per requirements)
+    if (terms.empty()) { // Check if there are no valid search terms
+        std::cerr << "Please provide at least 1 search term." << std::endl; // Log error for no terms
+        return grpc::Status(grpc::INVALID_ARGUMENT, "No search terms provided."); // Return failure with error status
+    }
     return grpc::Status::OK;
 }
 
+// Each prefix term matches the union of at most this many dictionary terms
+size_t FileRetrievalEngineImpl::expansionLimit(int32_t requested) {
+    return requested > 0 ? std::min<size_t>(requested, maxPrefixExpansions) : IndexStore::defaultMaxExpansions;
+}
+
+// Keeps ranked results for the cursors of streamed searches
+void FileRetrievalEngineImpl::setSearchCursors(std::shared_ptr<SearchCursorStore> cursors) {
+    cursors_ = std::move(cursors);
+}
+
+// Sends the page chunk by chunk; gRPC flow control holds the handler back while the client is slow to read
+grpc::Status FileRetrievalEngineImpl::ComputeSearchStream(
+        grpc::ServerContext* context,
+        const fre::SearchStreamReq* request,
+        grpc::ServerWriter<fre::SearchChunk>* writer)
+{
+    SearchPage page;
+    grpc::Status status = openSearchPage(*request, page);
+    if (!status.ok()) {
+        return status;
+    }
+    fre::SearchChunk chunk;
+    while (nextSearchChunk(page, &chunk)) {
+        if (!writer->Write(chunk)) {
+            return grpc::Status(grpc::CANCELLED, "Client stopped reading the search results.");
+        }
+    }
+    return grpc::Status::OK;
+}
+
+// A new search ranks every match once and keeps the ranking behind a cursor if more than one page matched; a
+// cursor cuts its page from the kept ranking, so the pages of one search never overlap or skip a result even
+// while the index changes. Paths are resolved only as chunks are sent.
+grpc::Status FileRetrievalEngineImpl::openSearchPage(const fre::SearchStreamReq& request, SearchPage& page) {
+    auto start = std::chrono::steady_clock::now();
+    size_t pageSize = request.page_size() > 0 ?
+        std::min<size_t>(request.page_size(), maxSearchPageResults) : defaultSearchPageResults;
+    page.chunkSize = request.chunk_size() > 0 ?
+        std::min<size_t>(request.chunk_size(), maxSearchChunkResults) : defaultSearchChunkResults;
+
+    uint64_t id = 0;
+    size_t offset = 0;
+    if (!request.cursor().empty()) {
+        if (!SearchCursorStore::parseCursor(request.cursor(), id, offset)) {
+            return grpc::Status(grpc::INVALID_ARGUMENT, "Malformed search cursor.");
+        }
+        page.search = cursors_ ? cursors_->resume(id) : nullptr;
+        if (!page.search) {
+            return grpc::Status(grpc::NOT_FOUND, "The results behind this cursor have expired; run the search again.");
+        }
+        if (offset > page.search->matches.size()) {
+            return grpc::Status(grpc::INVALID_ARGUMENT, "Search cursor points past the last result.");
+        }
+    } else {
+        std::vector<std::string> terms;
+        grpc::Status parsed = parseSearchTerms(request.terms(), terms);
+        if (!parsed.ok()) {
+            return parsed;
+        }
+        auto search = std::make_shared<RankedSearch>();
+        search->matches = store_->rankMatches(terms, expansionLimit(request.max_expansions()),
+                                              &search->expandedTerms, &search->expansionTruncated);
+        page.search = search;
+        if (search->matches.size() > pageSize && cursors_) {
+            id = cursors_->open(page.search); // 0 if the ranking alone exceeds the cursor budget
+        }
+    }
+
+    const RankedSearch& search = *page.search;
+    page.next = offset;
+    page.end = offset + std::min(pageSize, search.matches.size() - offset);
+    bool more = page.end < search.matches.size();
+    if (more && id != 0) {
+        page.header.set_next_cursor(SearchCursorStore::makeCursor(id, page.end));
+    }
+    page.header.set_total_matches(static_cast<int64_t>(search.matches.size()));
+    page.header.set_expanded_terms(static_cast<int64_t>(search.expandedTerms));
+    page.header.set_expansion_truncated(search.expansionTruncated);
+    page.header.set_message(
+        (request.cursor().empty() ? "Search completed in " : "Page resumed in ") +
+        std::to_string(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()) +
+        " seconds. Search results " + std::to_string(page.end > offset ? offset + 1 : offset) + " to " +
+        std::to_string(page.end) + " of " + std::to_string(search.matches.size()) +
+        (more && id == 0 ? " (the server keeps no cursor for the rest)" : "") + ":");
+    return grpc::Status::OK;
+}
+
+// Documents retired since the search ran are skipped rather than replaced, so a chunk may come out short
+bool FileRetrievalEngineImpl::nextSearchChunk(SearchPage& page, fre::SearchChunk* chunk) const {
+    if (page.headerSent && page.next >= page.end) {
+        return false;
+    }
+    if (!page.headerSent) {
+        *chunk = page.header;
+        page.headerSent = true;
+    } else {
+        chunk->Clear();
+    }
+    chunk->set_offset(static_cast<int64_t>(page.next));
+    size_t last = std::min(page.next + page.chunkSize, page.end);
+    for (; page.next < last; ++page.next) {
+        const auto& [documentNumber, freq] = page.search->matches[page.next];
+        if (store_->isRetired(documentNumber)) {
+            continue;
+        }
+        auto result = chunk->add_documents();
+        result->set_path(store_->getDocument(documentNumber)); // Set the "clientID:documentPath" key
+        result->set_count(freq);
+    }
+    return true;
+}
+
+// Handles delete requests from the client
+grpc::Status FileRetrievalEngineImpl::ComputeDelete(
+        grpc::ServerContext* context,
+        const fre::DeleteReq* request,
+        fre::DeleteRep* reply)
+{
+    if (replica_) {
+        return rejectOnReplica();
+    }
+
+    std::string clientID = request->client_id();
+    std::vector<std::string> documentPaths(request->document_paths().begin(), request->document_paths().end());
+
+    // One deletion record per path, encoded before taking any lock
+    std::string records;
+    if (wal_ || replication_) {
+        for (const auto& documentPath : documentPaths) {
+            WriteAheadLog::encodeDeleteRecord(records, clientID, documentPath);
+        }
+    }
+
+    uint64_t sequence = 0;
+    size_t deleted = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(checkpointMutex_); // Keeps a checkpoint from splitting log and index
+        std::lock_guard<std::mutex> orderLock(logOrderMutex_);       // Log order must be document table order
+        sequence = logRecords(records, documentPaths.size());
+        deleted = store_->deleteDocuments(clientID, documentPaths); // Hidden from searches from here on
+    }
+
+    if (wal_ && sequence > 0 && !wal_->waitDurable(sequence)) {
+        return grpc::Status(grpc::UNAVAILABLE, "Write-ahead log is not writable; deletion was not persisted.");
+    }
+
+    reply->set_documents_deleted(static_cast<int64_t>(deleted));
+    reply->set_message("Deleted " + std::to_string(deleted) + " of " + std::to_string(documentPaths.size()) +
+                       " documents");
+    return grpc::Status::OK;
+}
+
+
+// Reports the server statistics
+grpc::Status FileRetrievalEngineImpl::GetStats(
+        grpc::ServerContext* context,
+        const fre::StatsReq* request,
+        fre::StatsRep* reply)
+{
+    collectStats(reply);
+    return grpc::Status::OK;
+}
+
+// Reads every counter; only the memory estimate walks the index, taking each shard's read lock in turn
+void FileRetrievalEngineImpl::collectStats(fre::StatsRep* reply) const {
+    stats_.collect(reply);
+
+    for (const auto& [name, waits] : {std::pair{"documentMutex", store_->documentLockWaits()},
+                                      std::pair{"shard mutexes", store_->shardLockWaits()}}) {
+        fre::LockStats* lock = reply->add_locks();
+        lock->set_lock(name);
+        lock->set_acquisitions(waits.acquisitions);
+        lock->set_contended(waits.contended);
+        lock->set_wait_seconds(waits.waitSeconds);
+    }
+
+    IndexMemoryUsage usage = store_->estimateMemoryUsage();
+    fre::IndexStats* index = reply->mutable_index();
+    index->set_documents(usage.documentCount);
+    index->set_terms(usage.termCount);
+    index->set_postings(usage.postingCount);
+    index->set_document_table_bytes(usage.documentTableBytes);
+    index->set_dictionary_bytes(usage.dictionaryBytes);
+    index->set_posting_bytes(usage.postingBytes);
+    index->set_snapshot_bytes(usage.snapshotBytes);
+    index->set_generation(store_->generation());
+    index->set_deleted_documents(usage.deletedDocuments);
+    index->set_forward_index_bytes(usage.forwardIndexBytes);
+    index->set_pending_purge(usage.pendingPurge);
+    index->set_frozen_terms(usage.frozenTermCount);
+    index->set_delta_segments(usage.deltaSegments);
+    index->set_delta_bytes(usage.deltaBytes);
+
+    fre::CacheStats* cache = reply->mutable_cache();
+    cache->set_enabled(cache_ != nullptr);
+    if (cache_) {
+        ResultCacheStats counters = cache_->stats();
+        cache->set_hits(counters.hits);
+        cache->set_misses(counters.misses);
+        cache->set_evictions(counters.evictions);
+        cache->set_entries(counters.entries);
+        cache->set_bytes(counters.bytes);
+        cache->set_capacity_bytes(counters.capacityBytes);
+    }
+
+    fre::CursorStats* cursors = reply->mutable_cursors();
+    cursors->set_enabled(cursors_ != nullptr);
+    if (cursors_) {
+        SearchCursorStats counters = cursors_->stats();
+        cursors->set_opened(counters.opened);
+        cursors->set_resumed(counters.resumed);
+        cursors->set_expired(counters.expired);
+        cursors->set_evicted(counters.evicted);
+        cursors->set_missing(counters.missing);
+        cursors->set_result_sets(counters.resultSets);
+        cursors->set_bytes(counters.bytes);
+        cursors->set_capacity_bytes(counters.capacityBytes);
+    }
+
+    fre::ReplicationStats* replication = reply->mutable_replication();
+    if (replica_) {
+        ReplicationLag lag = replica_->lag();
+        replication->set_role("replica");
+        replication->set_primary(replica_->primary());
+        replication->set_connected(lag.connected);
+        replication->set_applied_sequence(lag.appliedSequence);
+        replication->set_primary_sequence(lag.primarySequence);
+        replication->set_lag_seconds(lag.seconds);
+    } else if (replication_) {
+        ReplicationLogStats feed = replication_->stats();
+        replication->set_role("primary");
+        replication->set_applied_sequence(feed.lastSequence);
+        replication->set_feed_bytes(feed.bytes);
+        replication->set_replicas(feed.subscribers);
+    }
+}
+
+// Sends the snapshot file in chunks. A checkpoint renames a new file into place, so the open file stays the
+// snapshot the replica started with, and its header tells the replica where to join the update stream.
+grpc::Status FileRetrievalEngineImpl::GetSnapshot(
+        grpc::ServerContext* context,
+        const fre::SnapshotReq* request,
+        grpc::ServerWriter<fre::SnapshotChunk>* writer)
+{
+    if (!replication_) {
+        return grpc::Status(grpc::FAILED_PRECONDITION, "This server does not serve replicas; start it with --serve-replicas.");
+    }
+    std::ifstream in(snapshotPath_, std::ios::binary);
+    if (snapshotPath_.empty() || !in) {
+        return grpc::Status::OK; // No snapshot yet: the update stream holds every update since the server started
+    }
+
+    fre::SnapshotChunk chunk;
+    std::string buffer(snapshotChunkBytes, '\0');
+    while (in.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0) {
+        chunk.set_data(buffer.data(), static_cast<size_t>(in.gcount()));
+        if (!writer->Write(chunk)) {
+            return grpc::Status(grpc::CANCELLED, "Replica stopped reading the snapshot.");
+        }
+    }
+    return grpc::Status::OK;
+}
+
+// Holds the stream open for as long as the replica follows: a heartbeat first, then every update as it is
+// published, or a heartbeat after a quiet second so the replica can tell how far behind it is
+grpc::Status FileRetrievalEngineImpl::Replicate(
+        grpc::ServerContext* context,
+        const fre::ReplicateReq* request,
+        grpc::ServerWriter<fre::ReplicationBatch>* writer)
+{
+    if (!replication_) {
+        return grpc::Status(grpc::FAILED_PRECONDITION, "This server does not serve replicas; start it with --serve-replicas.");
+    }
+    uint64_t subscriber = 0;
+    if (!replication_->subscribe(request->after_sequence(), subscriber)) {
+        return grpc::Status(grpc::OUT_OF_RANGE, "Updates after sequence " + std::to_string(request->after_sequence()) +
+                                                    " are not available; bootstrap from the snapshot again.");
+    }
+
+    fre::ReplicationBatch batch;
+    batch.set_primary_sequence(replication_->lastSequence());
+    bool open = writer->Write(batch);
+    ReplicationUpdates updates;
+    while (open && !context->IsCancelled()) {
+        ReplicationLog::ReadResult result = replication_->read(subscriber, replicationBatchBytes,
+                                                               std::chrono::seconds(1), updates);
+        if (result == ReplicationLog::ReadResult::Closed) {
+            break;
+        }
+        batch.Clear();
+        if (result == ReplicationLog::ReadResult::Records) {
+            batch.set_first_sequence(updates.firstSequence);
+            batch.set_last_sequence(updates.lastSequence);
+            batch.set_records(std::move(updates.records));
+        }
+        batch.set_primary_sequence(replication_->lastSequence());
+        open = writer->Write(batch);
+    }
+    replication_->unsubscribe(subscriber);
+    return grpc::Status::OK;
+}
@@ -0,0 +1,189 @@
+#include "FrozenTermDictionary.hpp"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+// Average keys per bucket; fewer buckets cost less memory but make the last seeds harder to find
+constexpr size_t keysPerBucket = 3;
+
+// Seeds tried for one bucket before the build starts over with another salt
+constexpr uint32_t maxSeeds = 1u << 16;
+
+// Salts tried before giving up
+constexpr int maxSalts = 8;
+
+// Final mixing step of splitmix64
+uint64_t splitmix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+// Maps a 64-bit hash onto [0, range) without a division
+uint32_t scale(uint64_t value, size_t range) {
+    return static_cast<uint32_t>((static_cast<unsigned __int128>(value) * range) >> 64);
+}
+
+} // namespace
+
+// Same function as std::hash<std::string>, so callers can reuse the hash that picked the shard
+uint64_t FrozenTermDictionary::hash(std::string_view term) {
+    return std::hash<std::string_view>{}(term);
+}
+
+uint64_t FrozenTermDictionary::mix(uint64_t termHash) const {
+    return splitmix(termHash ^ salt_);
+}
+
+size_t FrozenTermDictionary::bucketOf(uint64_t mixed) const {
+    return scale(mixed, displacements_.size());
+}
+
+uint32_t FrozenTermDictionary::positionOf(uint64_t mixed, uint32_t seed) const {
+    return scale(splitmix(mixed + seed * 0x9e3779b97f4a7c15ull), size());
+}
+
+// Places the largest buckets first, while most numbers are still free; a bucket of one key takes the next free
+// number directly
+bool FrozenTermDictionary::place(const std::vector<uint64_t>& mixed, std::vector<uint32_t>& positions) {
+    std::vector<std::vector<uint32_t>> buckets(displacements_.size());
+    for (uint32_t key = 0; key < mixed.size(); ++key) {
+        buckets[bucketOf(mixed[key])].push_back(key);
+    }
+    std::vector<uint32_t> order(buckets.size());
+    for (uint32_t bucket = 0; bucket < order.size(); ++bucket) {
+        order[bucket] = bucket;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<bool> taken(mixed.size(), false);
+    std::vector<uint32_t> candidate;
+    uint32_t nextFree = 0;
+    for (uint32_t bucket : order) {
+        const std::vector<uint32_t>& keys = buckets[bucket];
+        if (keys.empty()) {
+            break; // Sorted by size, so every remaining bucket is empty
+        }
+        if (keys.size() == 1) {
+            while (taken[nextFree]) {
+                ++nextFree;
+            }
+            taken[nextFree] = true;
+            positions[keys[0]] = nextFree;
+            displacements_[bucket] = directBit | nextFree;
+            continue;
+        }
+
+        uint32_t seed = 1;
+        for (; seed < maxSeeds; ++seed) {
+            candidate.clear();
+            for (uint32_t key : keys) {
+                uint32_t position = positionOf(mixed[key], seed);
+                if (taken[position] || std::find(candidate.begin(), candidate.end(), position) != candidate.end()) {
+                    break;
+                }
+                candidate.push_back(position);
+            }
+            if (candidate.size() == keys.size()) {
+                break;
+            }
+        }
+        if (seed == maxSeeds) {
+            return false;
+        }
+        for (size_t k = 0; k < keys.size(); ++k) {
+            taken[candidate[k]] = true;
+            positions[keys[k]] = candidate[k];
+        }
+        displacements_[bucket] = seed;
+    }
+    return true;
+}
+
+// Finds a perfect hash, then lays the term bytes out in the order it numbers them
+bool FrozenTermDictionary::build(const std::vector<std::string_view>& terms, std::vector<uint32_t>& positions) {
+    arena_.clear();
+    offsets_.assign(1, 0);
+    displacements_.clear();
+    sorted_.clear();
+    positions.assign(terms.size(), 0);
+
+    size_t bytes = 0;
+    for (std::string_view term : terms) {
+        bytes += term.size();
+    }
+    if (bytes > UINT32_MAX || terms.size() >= directBit) {
+        return false;
+    }
+    if (terms.empty()) {
+        return true;
+    }
+
+    offsets_.assign(terms.size() + 1, 0); // size() now reports the final count, which positionOf() scales by
+    std::vector<uint64_t> mixed(terms.size());
+    bool placed = false;
+    for (int attempt = 0; attempt < maxSalts && !placed; ++attempt) {
+        salt_ = splitmix(static_cast<uint64_t>(attempt) + 1);
+        for (size_t key = 0; key < terms.size(); ++key) {
+            mixed[key] = mix(hash(terms[key]));
+        }
+        displacements_.assign(terms.size() / keysPerBucket + 1, 0);
+        placed = place(mixed, positions);
+    }
+    if (!placed) {
+        offsets_.assign(1, 0);
+        displacements_.clear();
+        return false;
+    }
+
+    // Offsets by number, then the bytes in the same order
+    std::vector<uint32_t> keyAt(terms.size());
+    for (uint32_t key = 0; key < terms.size(); ++key) {
+        keyAt[positions[key]] = key;
+    }
+    arena_.resize(bytes);
+    uint32_t offset = 0;
+    for (uint32_t position = 0; position < terms.size(); ++position) {
+        std::string_view term = terms[keyAt[position]];
+        offsets_[position] = offset;
+        std::memcpy(arena_.data() + offset, term.data(), term.size());
+        offset += static_cast<uint32_t>(term.size());
+    }
+    offsets_[terms.size()] = offset;
+
+    sorted_.resize(terms.size());
+    for (uint32_t position = 0; position < terms.size(); ++position) {
+        sorted_[position] = position;
+    }
+    std::sort(sorted_.begin(), sorted_.end(), [&](uint32_t a, uint32_t b) { return term(a) < term(b); });
+    return true;
+}
+
+// Terms with a common prefix are adjacent in term order: the range starts at the first term not below the prefix
+// and ends at the first one that no longer starts with it
+std::pair<size_t, size_t> FrozenTermDictionary::prefixRange(std::string_view prefix) const {
+    auto first = std::lower_bound(sorted_.begin(), sorted_.end(), prefix,
+                                  [&](uint32_t position, std::string_view value) { return term(position) < value; });
+    auto last = std::partition_point(first, sorted_.end(), [&](uint32_t position) {
+        return term(position).substr(0, prefix.size()) == prefix;
+    });
+    return {static_cast<size_t>(first - sorted_.begin()), static_cast<size_t>(last - sorted_.begin())};
+}
+
+// One displacement lookup gives the only number the term can have; the arena decides whether it is there
+uint32_t FrozenTermDictionary::find(std::string_view term, uint64_t termHash) const {
+    if (displacements_.empty()) {
+        return npos;
+    }
+    uint64_t mixed = mix(termHash);
+    uint32_t displacement = displacements_[bucketOf(mixed)];
+    uint32_t position = displacement & directBit ? displacement & ~directBit : positionOf(mixed, displacement);
+    return term == this->term(position) ? position : npos;
+}
+
+size_t FrozenTermDictionary::memoryBytes() const {
+    return arena_.capacity() + (offsets_.capacity() + displacements_.capacity() + sorted_.capacity()) * sizeof(uint32_t);
+}
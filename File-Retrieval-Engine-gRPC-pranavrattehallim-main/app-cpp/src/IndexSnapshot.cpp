@@ -0,0 +1,291 @@
+#include "IndexSnapshot.hpp"
+#include <algorithm>   // For std::sort and std::lower_bound
+#include <cstdio>      // For std::rename and std::remove
+#include <cstring>     // For std::memcpy and std::memcmp
+#include <fstream>     // For writing the snapshot file
+#include <numeric>     // For std::iota
+#include <fcntl.h>     // For open
+#include <sys/mman.h>  // For mmap and munmap
+#include <sys/stat.h>  // For fstat
+#include <unistd.h>    // For close and fsync
+
+namespace {
+
+// Magic bytes at the start of every snapshot
+constexpr char snapshotMagic[8] = {'F', 'R', 'E', 'S', 'N', 'A', 'P', '\0'};
+
+// Rounds an offset up to the next 8-byte boundary
+uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~uint64_t{7};
+}
+
+// Pads the stream so a section of the given length ends on an 8-byte boundary
+void writePadding(std::ofstream& out, uint64_t bytes) {
+    static const char padding[8] = {};
+    out.write(padding, static_cast<std::streamsize>(align8(bytes) - bytes));
+}
+
+// Writes raw bytes and pads the stream to the next 8-byte boundary
+void writeSection(std::ofstream& out, const void* data, size_t bytes) {
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    writePadding(out, bytes);
+}
+
+// Checks that a list of offsets starts at zero, never decreases and ends within limit
+bool offsetsValid(const uint64_t* offsets, size_t count, uint64_t limit) {
+    if (offsets[0] != 0 || offsets[count] > limit) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (offsets[i] > offsets[i + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// Serializes the contents, writing to a temporary file first so a crash never leaves a torn snapshot
+bool IndexSnapshot::write(const std::string& path, const SnapshotContents& contents) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = formatVersion;
+    header.documentCount = contents.documentKeys.size();
+    header.termCount = contents.terms.size();
+    header.postingCount = contents.postingDocuments.size();
+    header.highestClientID = contents.highestClientID;
+    header.logSequence = contents.logSequence;
+
+    // Offsets of each key and term within their byte sections
+    std::vector<uint64_t> documentOffsets(1, 0);
+    for (const auto& key : contents.documentKeys) {
+        documentOffsets.push_back(documentOffsets.back() + key.size());
+    }
+    std::vector<uint64_t> termOffsets(1, 0);
+    for (const auto& term : contents.terms) {
+        termOffsets.push_back(termOffsets.back() + term.size());
+    }
+
+    // Document numbers ordered by key, so a key can be found by binary search
+    std::vector<uint32_t> documentOrder(contents.documentKeys.size());
+    std::iota(documentOrder.begin(), documentOrder.end(), 1);
+    std::sort(documentOrder.begin(), documentOrder.end(), [&](uint32_t a, uint32_t b) {
+        return contents.documentKeys[a - 1] < contents.documentKeys[b - 1];
+    });
+
+    // Lay out the sections back to back on 8-byte boundaries
+    uint64_t offset = align8(sizeof(SnapshotHeader));
+    header.documentOffsetsOffset = offset;
+    offset = align8(offset + documentOffsets.size() * sizeof(uint64_t));
+    header.documentBytesOffset = offset;
+    offset = align8(offset + documentOffsets.back());
+    header.documentOrderOffset = offset;
+    offset = align8(offset + documentOrder.size() * sizeof(uint32_t));
+    header.termOffsetsOffset = offset;
+    offset = align8(offset + termOffsets.size() * sizeof(uint64_t));
+    header.termBytesOffset = offset;
+    offset = align8(offset + termOffsets.back());
+    header.postingOffsetsOffset = offset;
+    offset = align8(offset + contents.postingOffsets.size() * sizeof(uint64_t));
+    header.postingDocumentsOffset = offset;
+    offset = align8(offset + contents.postingDocuments.size() * sizeof(int32_t));
+    header.postingFrequenciesOffset = offset;
+    offset = align8(offset + contents.postingFrequencies.size() * sizeof(int32_t));
+    header.fileSize = offset;
+
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false; // Directory missing or not writable
+        }
+
+        writeSection(out, &header, sizeof(header));
+        writeSection(out, documentOffsets.data(), documentOffsets.size() * sizeof(uint64_t));
+        for (const auto& key : contents.documentKeys) {
+            out.write(key.data(), static_cast<std::streamsize>(key.size()));
+        }
+        writePadding(out, documentOffsets.back());
+        writeSection(out, documentOrder.data(), documentOrder.size() * sizeof(uint32_t));
+        writeSection(out, termOffsets.data(), termOffsets.size() * sizeof(uint64_t));
+        for (const auto& term : contents.terms) {
+            out.write(term.data(), static_cast<std::streamsize>(term.size()));
+        }
+        writePadding(out, termOffsets.back());
+        writeSection(out, contents.postingOffsets.data(), contents.postingOffsets.size() * sizeof(uint64_t));
+        writeSection(out, contents.postingDocuments.data(), contents.postingDocuments.size() * sizeof(int32_t));
+        writeSection(out, contents.postingFrequencies.data(), contents.postingFrequencies.size() * sizeof(int32_t));
+
+        out.flush();
+        if (!out) {
+            std::remove(temporaryPath.c_str());
+            return false; // Disk full or I/O error
+        }
+    }
+
+    // Make the contents durable before the rename, so the write-ahead log can be emptied once it returns
+    int fd = ::open(temporaryPath.c_str(), O_RDONLY | O_CLOEXEC);
+    bool synced = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!synced) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    // Atomically replace the previous snapshot
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+// Maps the snapshot and validates its header and offset tables
+std::shared_ptr<const IndexSnapshot> IndexSnapshot::open(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        error = "snapshot is truncated";
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file contents reachable
+    if (mapping == MAP_FAILED) {
+        error = "cannot map " + path;
+        return nullptr;
+    }
+    const char* data = static_cast<const char*>(mapping);
+
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    // Validate the header and the offset tables; postings themselves are not touched here
+    auto fail = [&](const std::string& reason) -> std::shared_ptr<const IndexSnapshot> {
+        munmap(mapping, size);
+        error = reason;
+        return nullptr;
+    };
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0) {
+        return fail("not a snapshot file");
+    }
+    if (header.version != formatVersion) {
+        return fail("unsupported snapshot version " + std::to_string(header.version));
+    }
+    if (header.fileSize != size) {
+        return fail("snapshot size does not match its header");
+    }
+    const uint64_t sections[] = {header.documentOffsetsOffset, header.documentBytesOffset, header.documentOrderOffset,
+                                 header.termOffsetsOffset, header.termBytesOffset, header.postingOffsetsOffset,
+                                 header.postingDocumentsOffset, header.postingFrequenciesOffset, header.fileSize};
+    for (size_t i = 0; i + 1 < std::size(sections); ++i) {
+        if (sections[i] % 8 != 0 || sections[i] > sections[i + 1]) {
+            return fail("snapshot sections are out of order");
+        }
+    }
+    if (header.documentBytesOffset - header.documentOffsetsOffset < (header.documentCount + 1) * sizeof(uint64_t) ||
+        header.termOffsetsOffset - header.documentOrderOffset < header.documentCount * sizeof(uint32_t) ||
+        header.termBytesOffset - header.termOffsetsOffset < (header.termCount + 1) * sizeof(uint64_t) ||
+        header.postingDocumentsOffset - header.postingOffsetsOffset < (header.termCount + 1) * sizeof(uint64_t) ||
+        header.postingFrequenciesOffset - header.postingDocumentsOffset < header.postingCount * sizeof(int32_t) ||
+        header.fileSize - header.postingFrequenciesOffset < header.postingCount * sizeof(int32_t)) {
+        return fail("snapshot sections are too small for their counts");
+    }
+    if (!offsetsValid(reinterpret_cast<const uint64_t*>(data + header.documentOffsetsOffset), header.documentCount,
+                      header.documentOrderOffset - header.documentBytesOffset) ||
+        !offsetsValid(reinterpret_cast<const uint64_t*>(data + header.termOffsetsOffset), header.termCount,
+                      header.postingOffsetsOffset - header.termBytesOffset) ||
+        !offsetsValid(reinterpret_cast<const uint64_t*>(data + header.postingOffsetsOffset), header.termCount,
+                      header.postingCount)) {
+        return fail("snapshot offset tables are corrupt");
+    }
+
+    return std::shared_ptr<const IndexSnapshot>(new IndexSnapshot(data, size, header));
+}
+
+// Constructor adopts a validated mapping
+IndexSnapshot::IndexSnapshot(const char* data, size_t size, const SnapshotHeader& header)
+    : data_(data), size_(size), header_(header), maxFrequencies_(new std::atomic<int>[header.termCount]()) {}
+
+// Destructor unmaps the file
+IndexSnapshot::~IndexSnapshot() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+// Returns the key of a stored document
+std::string_view IndexSnapshot::documentKey(int documentNumber) const {
+    const uint64_t* offsets = section<uint64_t>(header_.documentOffsetsOffset);
+    const char* bytes = section<char>(header_.documentBytesOffset);
+    return std::string_view(bytes + offsets[documentNumber - 1], offsets[documentNumber] - offsets[documentNumber - 1]);
+}
+
+// Binary searches the key-ordered document table
+int IndexSnapshot::findDocument(std::string_view documentKey) const {
+    const uint32_t* order = section<uint32_t>(header_.documentOrderOffset);
+    const uint32_t* end = order + header_.documentCount;
+    const uint32_t* found = std::lower_bound(order, end, documentKey, [this](uint32_t number, std::string_view key) {
+        return this->documentKey(static_cast<int>(number)) < key;
+    });
+    if (found != end && this->documentKey(static_cast<int>(*found)) == documentKey) {
+        return static_cast<int>(*found);
+    }
+    return 0; // Not stored in this snapshot
+}
+
+// Returns the term at a position of the sorted dictionary
+std::string_view IndexSnapshot::term(size_t index) const {
+    const uint64_t* offsets = section<uint64_t>(header_.termOffsetsOffset);
+    const char* bytes = section<char>(header_.termBytesOffset);
+    return std::string_view(bytes + offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+// Returns the postings stored for the term at a position of the sorted dictionary
+PostingView IndexSnapshot::postings(size_t index) const {
+    const uint64_t* offsets = section<uint64_t>(header_.postingOffsetsOffset);
+    PostingView view;
+    view.documents = section<int32_t>(header_.postingDocumentsOffset) + offsets[index];
+    view.frequencies = section<int32_t>(header_.postingFrequenciesOffset) + offsets[index];
+    view.size = offsets[index + 1] - offsets[index];
+    return view;
+}
+
+// Concurrent first calls may both scan the term's frequencies; they store the same value
+int IndexSnapshot::maxFrequency(size_t index) const {
+    int highest = maxFrequencies_[index].load(std::memory_order_relaxed);
+    if (highest == 0) {
+        PostingView view = postings(index);
+        highest = view.size > 0 ? *std::max_element(view.frequencies, view.frequencies + view.size) : 0;
+        maxFrequencies_[index].store(highest, std::memory_order_relaxed);
+    }
+    return highest;
+}
+
+// Binary searches the sorted term dictionary
+size_t IndexSnapshot::lowerBound(std::string_view termToFind) const {
+    size_t low = 0;
+    size_t high = header_.termCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (term(middle) < termToFind) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// The term, if stored, is the first one not less than it
+PostingView IndexSnapshot::findTerm(std::string_view termToFind) const {
+    size_t low = lowerBound(termToFind);
+    if (low < header_.termCount && term(low) == termToFind) {
+        return postings(low);
+    }
+    return {}; // Term not in the snapshot
+}
@@ -3,157 +3,1029 @@
 #include <algorithm>     // For sort function
 #include <iostream>      // For input and output streams
 #include <unordered_map> // For using std::unordered_map
+#include <unordered_set> // For the hits a search matched while a re-index is pending
+#include <charconv>      // For std::from_chars
+#include <climits>       // For INT_MAX
+#include <string_view>   // For snapshot keys and terms
+#include <bit>           // For std::bit_width
+#include "IntersectionEngine.hpp" // For AND intersection of sorted posting lists
 
-// Constructor initializes the document counter to 0
-IndexStore::IndexStore() : documentCounter(1) {}
+namespace {
 
-// Mutex to protect shared resources during concurrent access
-std::shared_mutex documentMutex;         // Shared mutex to protect documentMap and pathToNumber
-std::shared_mutex invertedIndexMutex;    // Shared mutex to protect termInvertedIndex
+// Merges snapshot postings with in-memory postings, summing frequencies of documents present in both
+PostingList mergePostings(const PostingView& base, const PostingList& delta) {
+    PostingList merged;
+    size_t i = 0;
+    for (PostingIterator j = delta.begin(); i < base.size || !j.atEnd();) {
+        if (j.atEnd() || (i < base.size && base.documents[i] < j.document())) {
+            merged.add(base.documents[i], base.frequencies[i]);
+            ++i;
+        } else if (i == base.size || j.document() < base.documents[i]) {
+            merged.add(j.document(), j.frequency());
+            j.next();
+        } else {
+            merged.add(base.documents[i], base.frequencies[i] + j.frequency()); // Snapshot document indexed again since the load
+            ++i;
+            j.next();
+        }
+    }
+    return merged;
+}
+
+} // namespace
+
+// Constructor initializes the document counter to 1 and creates the term dictionary shards
+IndexStore::IndexStore(size_t shardCount)
+    : documentCounter(1), shards(std::max<size_t>(shardCount, 1)), shardBits(std::bit_width(shards.size() - 1)) {}
+
+// Stops the purge and merge threads before the structures they work on go away
+IndexStore::~IndexStore() {
+    {
+        std::lock_guard<std::mutex> lock(purgeWaitMutex);
+        stopPurge = true;
+    }
+    purgeCv.notify_all();
+    if (purgeThread.joinable()) {
+        purgeThread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mergeWaitMutex);
+        stopMerge = true;
+    }
+    mergeCv.notify_all();
+    if (mergeThread.joinable()) {
+        mergeThread.join();
+    }
+}
+
+// Finds or inserts the term; a new term goes to the overlay and takes a free key table slot, or a new one
+TermEntry& IndexStore::termEntryLocked(IndexShard& shard, const std::string& term, uint64_t termHash) {
+    uint32_t position = shard.frozenTerms.find(term, termHash);
+    if (position != FrozenTermDictionary::npos) {
+        return shard.frozenEntries[position]; // Keeps its slot even while it has no postings
+    }
+    auto [entry, inserted] = shard.termInvertedIndex.try_emplace(term);
+    if (inserted) {
+        shard.overlayOrder.insert(entry->first);
+        if (shard.freeSlots.empty()) {
+            entry->second.slot = static_cast<uint32_t>(shard.termKeys.size());
+            shard.termKeys.push_back(entry->first);
+        } else {
+            entry->second.slot = shard.freeSlots.back();
+            shard.freeSlots.pop_back();
+            shard.termKeys[entry->second.slot] = entry->first;
+        }
+    }
+    return entry->second;
+}
+
+// A frozen term is found without touching the overlay's hash nodes
+const TermEntry* IndexStore::findTermLocked(const IndexShard& shard, const std::string& term, uint64_t termHash) {
+    uint32_t position = shard.frozenTerms.find(term, termHash);
+    if (position != FrozenTermDictionary::npos) {
+        return &shard.frozenEntries[position];
+    }
+    auto entry = shard.termInvertedIndex.find(term);
+    return entry != shard.termInvertedIndex.end() ? &entry->second : nullptr;
+}
+
+// 1.1. Adds a client's document to the document table, assigns a unique number, and returns it
+int IndexStore::putDocument(const std::string& clientID, const std::string& documentPath, std::vector<int>* replaced) {
+    // Build the "clientID:documentPath" key once; postings refer to it only by document number
+    std::string documentKey = clientID + ":" + documentPath;
 
-// 1.1. Adds a document to the index, assigns a unique number, and returns it
-int IndexStore::putDocument(const std::string& documentPath) {
     // Lock the mutex exclusively to ensure only one thread modifies the DocumentMap at a time
-    std::unique_lock<std::shared_mutex> lock(documentMutex);
+    auto lock = documentLockWait.acquire<std::unique_lock<std::shared_mutex>>(documentMutex);
+    noteClientLocked(clientID);
+    return putDocumentLocked(std::move(documentKey), replaced);
+}
+
+// Adds a batch of a client's documents to the document table under a single exclusive lock
+std::vector<int> IndexStore::putDocuments(const std::string& clientID, const std::vector<std::string>& documentPaths,
+                                          std::vector<int>* replaced) {
+    std::vector<int> documentNumbers;
+    documentNumbers.reserve(documentPaths.size());
+
+    auto lock = documentLockWait.acquire<std::unique_lock<std::shared_mutex>>(documentMutex);
+    noteClientLocked(clientID);
+    for (const auto& documentPath : documentPaths) {
+        documentNumbers.push_back(putDocumentLocked(clientID + ":" + documentPath, replaced));
+    }
+    return documentNumbers;
+}
+
+// Tombstones the earlier versions putDocument(s) handed back once their replacements are searchable
+void IndexStore::retireDocuments(const std::vector<int>& documentNumbers) {
+    if (documentNumbers.empty()) {
+        return;
+    }
+    auto lock = documentLockWait.acquire<std::unique_lock<std::shared_mutex>>(documentMutex);
+    for (int documentNumber : documentNumbers) {
+        tombstoneLocked(documentNumber);
+        replacedBy.erase(documentNumber);
+    }
+    pendingReplacements.store(replacedBy.size(), std::memory_order_release);
+}
 
-    // Check if the document is already indexed by its path
-    if (pathToNumber.find(documentPath) != pathToNumber.end()) {
-        return pathToNumber[documentPath];  // Return existing document number if found
+// Assigns a new document number to a key, retiring the number of any earlier version or handing it to the caller;
+// the caller holds documentMutex exclusively
+int IndexStore::putDocumentLocked(std::string documentKey, std::vector<int>* replaced) {
+    // A document indexed again replaces its earlier version rather than adding to its frequencies
+    int earlier = liveDocumentLocked(documentKey);
+    if (earlier != 0 && !replaced) {
+        tombstoneLocked(earlier);
     }
 
     // Assign a new document number and update the mappings
-    int docNumber = documentCounter++; // Increment the document counter for unique document numbe
-    documentMap[docNumber] = documentPath;         // Map document number to path (includes Client ID)
-    pathToNumber[documentPath] = docNumber;        // Map path to document number
-    // std::cout << "[DEBUG] Contents of pathToNumber:" << std::endl;
-    // for (const auto& pair : pathToNumber) {
-    //     std::cout << "Path: " << pair.first << ", Document Number: " << pair.second << std::endl;
-    // }
+    int docNumber = documentCounter++; // Increment the document counter for unique document number
+    if (earlier != 0 && replaced) {
+        replaced->push_back(earlier); // Stays searchable until the caller has applied the new postings
+        replacedBy[earlier] = docNumber; // Searches that see both keep the new one
+        pendingReplacements.store(replacedBy.size(), std::memory_order_release);
+    }
+    auto entry = pathToNumber.try_emplace(std::move(documentKey), docNumber).first; // Key is stored only here
+    entry->second = docNumber;                   // A key seen before now points at its new version
+    documentMap.push_back(&entry->first);        // Map document number to key (hash node keys are stable)
+    {
+        std::lock_guard<std::mutex> lock(forwardMutex);
+        forwardIndex.emplace_back();             // Filled in as the document's terms are applied
+    }
     return docNumber; // Return the new document number
 }
 
-// 1.2. Retrieves the document path given its unique number
+// Finds the live document stored under the key, in memory or in the snapshot
+int IndexStore::liveDocumentLocked(const std::string& documentKey) const {
+    auto existing = pathToNumber.find(documentKey);
+    if (existing != pathToNumber.end()) {
+        return existing->second; // 0 if deleted earlier and not indexed since
+    }
+    if (snapshot) {
+        int stored = snapshot->findDocument(documentKey);
+        if (stored != 0 && !tombstones.contains(stored)) {
+            return stored; // Its postings live in the mapped file until the next snapshot drops them
+        }
+    }
+    return 0;
+}
+
+// Tombstones the live document stored under the key, in memory or in the snapshot
+bool IndexStore::retireDocumentLocked(const std::string& documentKey) {
+    int live = liveDocumentLocked(documentKey);
+    if (live == 0) {
+        return false;
+    }
+    tombstoneLocked(live);
+    // An earlier version still waiting for its replacement to be applied goes with it
+    for (auto pending = replacedBy.begin(); pending != replacedBy.end();) {
+        if (pending->second == live) {
+            tombstoneLocked(pending->first);
+            pending = replacedBy.erase(pending);
+        } else {
+            ++pending;
+        }
+    }
+    pendingReplacements.store(replacedBy.size(), std::memory_order_release);
+    auto existing = pathToNumber.find(documentKey);
+    if (existing != pathToNumber.end()) {
+        existing->second = 0; // The key stays, as older document numbers still point at it
+    }
+    return true;
+}
+
+// Retires a document number and, if its postings are in memory, queues them for the purge
+void IndexStore::tombstoneLocked(int documentNumber) {
+    if (!tombstones.insert(documentNumber)) {
+        return;
+    }
+    if (documentNumber > snapshotDocuments) {
+        std::lock_guard<std::mutex> lock(forwardMutex);
+        purgeQueue.push_back(documentNumber);
+        if (purgeThreshold > 0 && purgeQueue.size() >= purgeThreshold) {
+            purgeCv.notify_one();
+        }
+    }
+    generationCounter.fetch_add(1, std::memory_order_release); // Cached results may include the retired document
+}
+
+// Drops hits on earlier versions whose replacements also matched; only looks while a replacement is pending
+size_t IndexStore::dropReplaced(std::vector<Posting>& hits) const {
+    if (pendingReplacements.load(std::memory_order_acquire) == 0 || hits.size() < 2) {
+        return 0;
+    }
+    std::unordered_set<int> matched;
+    matched.reserve(hits.size());
+    for (const auto& hit : hits) {
+        matched.insert(hit.first);
+    }
+    auto lock = documentLockWait.acquire<std::shared_lock<std::shared_mutex>>(documentMutex);
+    auto kept = std::remove_if(hits.begin(), hits.end(), [&](const Posting& hit) {
+        auto pending = replacedBy.find(hit.first);
+        return pending != replacedBy.end() && matched.count(pending->second) > 0;
+    });
+    size_t removed = static_cast<size_t>(hits.end() - kept);
+    hits.erase(kept, hits.end());
+    return removed;
+}
+
+// Tombstones each path's current document under one exclusive lock
+size_t IndexStore::deleteDocuments(const std::string& clientID, const std::vector<std::string>& documentPaths) {
+    size_t deleted = 0;
+    auto lock = documentLockWait.acquire<std::unique_lock<std::shared_mutex>>(documentMutex);
+    for (const auto& documentPath : documentPaths) {
+        if (retireDocumentLocked(clientID + ":" + documentPath)) {
+            ++deleted;
+        }
+    }
+    return deleted;
+}
+
+// Tracks the highest numeric client ID so a restarted server does not hand out an ID that owns documents
+void IndexStore::noteClientLocked(const std::string& clientID) {
+    uint64_t value = 0;
+    auto [end, error] = std::from_chars(clientID.data(), clientID.data() + clientID.size(), value);
+    if (error == std::errc() && end == clientID.data() + clientID.size()) {
+        highestClient = std::max(highestClient, value);
+    }
+}
+
+// Returns the last write-ahead log record included in the loaded snapshot
+uint64_t IndexStore::snapshotLogSequence() const {
+    std::shared_lock<std::shared_mutex> lock(documentMutex);
+    return snapshot ? snapshot->logSequence() : 0;
+}
+
+// Returns the highest numeric client ID seen so far
+uint64_t IndexStore::highestClientID() const {
+    std::shared_lock<std::shared_mutex> lock(documentMutex);
+    return highestClient;
+}
+
+// 1.2. Retrieves the "clientID:documentPath" key given its unique number
 std::string IndexStore::getDocument(int documentNumber) const {
     // Lock the shared mutex for reading, allowing multiple threads to access the documentMap simultaneously
-    std::shared_lock<std::shared_mutex> lock(documentMutex);
+    auto lock = documentLockWait.acquire<std::shared_lock<std::shared_mutex>>(documentMutex);
 
-    auto it = documentMap.find(documentNumber);   // Find the document by its number
-    if (it != documentMap.end()) {
-        return it->second;  // Return the document path (which includes Client ID) if found
+    // Document numbers are dense and start at 1: the snapshot holds the first ones, the table the rest
+    if (documentNumber >= 1 && documentNumber <= snapshotDocuments) {
+        return std::string(snapshot->documentKey(documentNumber)); // Read straight from the mapped file
+    } else if (documentNumber > snapshotDocuments &&
+               static_cast<size_t>(documentNumber - snapshotDocuments) <= documentMap.size()) {
+        return *documentMap[documentNumber - snapshotDocuments - 1];  // Return the document key (which includes Client ID) if found
     } else {
         return "Error: Document number does not exist.";  // Return error if not found
     }
 }
 
 // 1.3. Updates the inverted index with terms and their frequencies for a specific document
-void IndexStore::updateIndex(const std::string& clientID, int documentNumber, const std::vector<std::pair<std::string, int>>& termFrequencyList) {
-    // Lock the mutex exclusively to ensure only one thread modifies the TermInvertedIndex at a time
-    std::unique_lock<std::shared_mutex> lock(invertedIndexMutex);  // Acquire lock on entry, release on exit
-
-    // Get the document path using the document number
-    std::string documentPath = getDocument(documentNumber); // Get the document path
+void IndexStore::updateIndex(int documentNumber, const std::vector<std::pair<std::string, int>>& termFrequencyList) {
+    if (mergeThreshold.load(std::memory_order_relaxed) > 0) {
+        publishSegment({{documentNumber, termFrequencyList}});
+        return;
+    }
 
-    // Iterate over each term and its frequency in the list
+    // Tag each term with the shard that owns it
+    std::vector<ShardUpdate> updates;
+    updates.reserve(termFrequencyList.size());
     for (const auto& termFrequency : termFrequencyList) {
-        const std::string& term = termFrequency.first; // Get the term
-        int frequency = termFrequency.second;          // Get the frequency
+        uint64_t termHash = FrozenTermDictionary::hash(termFrequency.first);
+        updates.push_back({shardFor(termHash), termHash, documentNumber, &termFrequency, updates.size()});
+    }
+    applyShardUpdates(updates);
+}
+
+// Updates the inverted index for a batch of documents, grouping every term of every document by shard
+void IndexStore::updateIndexBatch(const std::vector<DocumentTerms>& documents) {
+    if (mergeThreshold.load(std::memory_order_relaxed) > 0) {
+        publishSegment(documents);
+        return;
+    }
+
+    std::vector<ShardUpdate> updates;
+    size_t termCount = 0;
+    for (const auto& document : documents) {
+        termCount += document.second.size();
+    }
+    updates.reserve(termCount);
+    for (const auto& [documentNumber, termFrequencyList] : documents) {
+        for (const auto& termFrequency : termFrequencyList) {
+            uint64_t termHash = FrozenTermDictionary::hash(termFrequency.first);
+            updates.push_back({shardFor(termHash), termHash, documentNumber, &termFrequency, updates.size()});
+        }
+    }
+    applyShardUpdates(updates);
+}
 
-        // Create the entry key in the format "clientID:documentPath"
-        std::string entryKey = clientID + ":" + documentPath;
+// Applies term updates shard by shard, so each shard's exclusive lock is taken once per call
+void IndexStore::applyShardUpdates(std::vector<ShardUpdate>& updates) {
+    // Group by shard; within a shard keep documents in increasing order so postings are appended at the tail
+    std::sort(updates.begin(), updates.end(), [](const ShardUpdate& a, const ShardUpdate& b) {
+        return a.shard != b.shard ? a.shard < b.shard : a.documentNumber < b.documentNumber;
+    });
 
-        // DEBUG: Print the generated entry key
-        // std::cout << "[DEBUG-UpdateIndex] Generated Entry Key: " << entryKey << std::endl;
+    // Document and term reference of every update, by its position before the sort, where each document's terms
+    // are adjacent
+    std::vector<std::pair<int, uint32_t>> forwardTerms(updates.size());
 
-        // Check if the term is already in the inverted index
-        if (termInvertedIndex.find(term) == termInvertedIndex.end()) {
-            // Add the term with the client ID and document path
-            termInvertedIndex[term] = {{entryKey, frequency}};
-        } else {
-            bool updated = false; // Flag to check if the term was updated
-            // Check if the document already exists for this term
-            for (auto& entry : termInvertedIndex[term]) {
-                if (entry.first == entryKey) {
-                    entry.second += frequency; // Correctly add the frequency to the existing value
-                    updated = true; // Mark as updated
-                    break; // Exit the loop as the entry is found
+    for (size_t i = 0; i < updates.size();) {
+        IndexShard& shard = shards[updates[i].shard];
+        auto lock = shardLockWait.acquire<std::unique_lock<std::shared_mutex>>(shard.mutex); // Other shards stay available
+
+        size_t end = i;
+        for (; end < updates.size() && updates[end].shard == updates[i].shard; ++end) {
+            const std::string& term = updates[end].termFrequency->first; // Get the term
+            int frequency = updates[end].termFrequency->second;          // Get the frequency
+
+            // Add the document to the term's posting list, which stays sorted by document number
+            TermEntry& entry = termEntryLocked(shard, term, updates[end].hash);
+            entry.postings.add(updates[end].documentNumber, frequency);
+            forwardTerms[updates[end].position] = {updates[end].documentNumber,
+                                                   termReference(updates[end].shard, entry.slot)};
+        }
+        i = end; // Continue with the next shard's group
+    }
+
+    recordForwardTerms(forwardTerms);
+    generationCounter.fetch_add(1, std::memory_order_release); // Results cached before this update are now stale
+}
+
+// Records each document's terms in the forward index, sized exactly, so a later purge knows where its postings are
+void IndexStore::recordForwardTerms(const std::vector<std::pair<int, uint32_t>>& terms) {
+    std::lock_guard<std::mutex> lock(forwardMutex);
+    for (size_t begin = 0; begin < terms.size();) {
+        int documentNumber = terms[begin].first;
+        size_t end = begin;
+        while (end < terms.size() && terms[end].first == documentNumber) {
+            ++end;
+        }
+        if (documentNumber > snapshotDocuments &&
+            static_cast<size_t>(documentNumber - snapshotDocuments) <= forwardIndex.size()) {
+            auto& references = forwardIndex[documentNumber - snapshotDocuments - 1];
+            references.reserve(references.size() + (end - begin));
+            for (size_t k = begin; k < end; ++k) {
+                references.push_back(terms[k].second);
+            }
+            if (tombstones.contains(documentNumber)) {
+                purgeQueue.push_back(documentNumber); // Retired while its postings were being applied
+            }
+        }
+        begin = end;
+    }
+}
+
+// The segment is built before any lock is taken; publishing it is a copy of the short list of pending segments
+void IndexStore::publishSegment(const std::vector<DocumentTerms>& documents) {
+    auto segment = std::make_shared<const DeltaSegment>(documents, shards.size());
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(segmentsMutex);
+        auto published = std::make_shared<DeltaSegmentList>(*pendingSegments);
+        published->push_back({++lastSegmentSequence, std::move(segment)});
+        pending = published->size();
+        pendingSegments = std::move(published);
+    }
+    generationCounter.fetch_add(1, std::memory_order_release); // Results cached before this update are now stale
+
+    size_t threshold = mergeThreshold.load(std::memory_order_relaxed);
+    if (pending >= mergeBackpressure * threshold) {
+        mergeDeltaSegments(); // The merger has fallen behind; searches would scan ever more segments
+    } else if (pending == threshold) {
+        mergeCv.notify_one();
+    }
+}
+
+std::shared_ptr<const DeltaSegmentList> IndexStore::loadSegments() const {
+    std::lock_guard<std::mutex> lock(segmentsMutex);
+    return pendingSegments;
+}
+
+// Folds each segment into each shard under the shard's exclusive lock and moves the shard's merge mark past it in
+// the same hold, so a search reading the shard counts every segment exactly once: through the shard or through the
+// list. Segments leave the list only once every shard holds them.
+size_t IndexStore::mergeDeltaSegments() {
+    std::lock_guard<std::mutex> mergeLock(mergeMutex);
+    std::shared_ptr<const DeltaSegmentList> segments = loadSegments();
+    if (segments->empty()) {
+        return 0;
+    }
+    uint64_t through = segments->back().sequence;
+
+    std::vector<std::pair<int, uint32_t>> forwardTerms;
+    std::string term;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        IndexShard& shard = shards[s];
+        for (const auto& published : *segments) {
+            // One segment per lock hold, so searches on the shard wait for a batch's worth of postings at most
+            auto lock = shardLockWait.acquire<std::unique_lock<std::shared_mutex>>(shard.mutex);
+            const DeltaSegment& segment = *published.segment;
+            for (size_t e = segment.shardBegin(s); e < segment.shardEnd(s); ++e) {
+                term.assign(segment.term(e));
+                TermEntry& entry = termEntryLocked(shard, term, segment.hash(e));
+                uint32_t reference = termReference(s, entry.slot);
+                PostingView postings = segment.postings(e);
+                entry.postings.addSorted(postings.documents, postings.frequencies, postings.size);
+                for (size_t k = 0; k < postings.size; ++k) {
+                    forwardTerms.emplace_back(postings.documents[k], reference);
                 }
             }
-            // If the document was not found, add it to the list for this term
-            if (!updated) {
-                termInvertedIndex[term].emplace_back(entryKey, frequency);
+            shard.mergedSegments = published.sequence;
+        }
+    }
+
+    std::sort(forwardTerms.begin(), forwardTerms.end()); // Brings each document's terms together
+    recordForwardTerms(forwardTerms);
+
+    std::lock_guard<std::mutex> lock(segmentsMutex);
+    auto remaining = std::make_shared<DeltaSegmentList>();
+    for (const auto& published : *pendingSegments) {
+        if (published.sequence > through) {
+            remaining->push_back(published); // Published while the merge ran
+        }
+    }
+    pendingSegments = std::move(remaining);
+    return segments->size();
+}
+
+// Merges from a background thread, early when enough segments are pending
+void IndexStore::startBackgroundMerge(size_t segments, std::chrono::milliseconds interval) {
+    if (mergeThread.joinable()) {
+        return;
+    }
+    mergeThreshold.store(std::max<size_t>(segments, 1), std::memory_order_relaxed);
+    mergeThread = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(mergeWaitMutex);
+        while (!stopMerge) {
+            mergeCv.wait_for(lock, interval);
+            if (stopMerge) {
+                break;
             }
+            lock.unlock();
+            mergeDeltaSegments(); // Returns at once when nothing is pending
+            lock.lock();
+        }
+    });
+}
+
+// Takes the queued documents' forward entries, then rewrites the affected posting lists one shard at a time
+size_t IndexStore::purgeDeleted() {
+    std::lock_guard<std::mutex> purgeLock(purgeMutex);
+
+    // (term reference, document) of every posting to remove
+    std::vector<std::pair<uint32_t, int>> removals;
+    {
+        std::lock_guard<std::mutex> lock(forwardMutex);
+        for (int documentNumber : purgeQueue) {
+            auto& terms = forwardIndex[documentNumber - snapshotDocuments - 1];
+            for (uint32_t term : terms) {
+                removals.emplace_back(term, documentNumber);
+            }
+            std::vector<uint32_t>().swap(terms); // Release the entry; the document is gone for good
+        }
+        purgeQueue.clear();
+    }
+    std::sort(removals.begin(), removals.end());
+    removals.erase(std::unique(removals.begin(), removals.end()), removals.end());
+
+    // The shard lock is taken per term, so searches and updates on the shard slip in between terms. A reference
+    // to a slot that was freed and reused names a term the document never had, and removes nothing.
+    size_t removed = 0;
+    std::vector<int> documents;
+    const uint32_t shardMask = (uint32_t{1} << shardBits) - 1;
+    for (size_t i = 0; i < removals.size();) {
+        uint32_t term = removals[i].first;
+        documents.clear();
+        for (; i < removals.size() && removals[i].first == term; ++i) {
+            documents.push_back(removals[i].second);
+        }
+
+        IndexShard& shard = shards[term & shardMask];
+        uint32_t slot = term >> shardBits;
+        auto lock = shardLockWait.acquire<std::unique_lock<std::shared_mutex>>(shard.mutex);
+        if (slot >= shard.termKeys.size() || !shard.termKeys[slot].data()) {
+            continue;
+        }
+        std::string key(shard.termKeys[slot]);
+        uint32_t position = shard.frozenTerms.find(key, FrozenTermDictionary::hash(key));
+        if (position != FrozenTermDictionary::npos) {
+            removed += shard.frozenEntries[position].postings.remove(documents); // The next freeze drops it if empty
+            continue;
+        }
+        auto entry = shard.termInvertedIndex.find(key);
+        removed += entry->second.postings.remove(documents);
+        if (entry->second.postings.empty()) {
+            // No live document has a term without postings
+            shard.termKeys[slot] = std::string_view();
+            shard.freeSlots.push_back(slot);
+            shard.overlayOrder.erase(entry->first);
+            shard.termInvertedIndex.erase(entry);
         }
     }
+    return removed;
+}
+
+// Runs purges from a background thread, early when enough documents are queued
+void IndexStore::startBackgroundPurge(size_t minimumDocuments, std::chrono::milliseconds interval) {
+    if (purgeThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(forwardMutex);
+        purgeThreshold = std::max<size_t>(minimumDocuments, 1);
+    }
+    purgeThread = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(purgeWaitMutex);
+        while (!stopPurge) {
+            purgeCv.wait_for(lock, interval);
+            if (stopPurge) {
+                break;
+            }
+            lock.unlock();
+            purgeDeleted(); // Returns at once when nothing is queued
+            lock.lock();
+        }
+    });
 }
 
 
 
-// 1.4. Retrieves a list of documents and term frequencies for a given term
-std::vector<std::pair<std::string, int>> IndexStore::lookupIndex(const std::string& termfromImpl) const {
-    // Lock the shared mutex for reading, allowing multiple threads to access the TermInvertedIndex simultaneously
-    std::shared_lock<std::shared_mutex> lock(invertedIndexMutex);
+// 1.4. Retrieves a list of document numbers and term frequencies for a given term
+PostingList IndexStore::lookupIndex(const std::string& termfromImpl) const {
+    PostingList postings;
+    uint64_t termHash = FrozenTermDictionary::hash(termfromImpl); // Picks the shard and probes its frozen terms
+    // Loaded before the shard's merge mark is read; a store indexing straight into the shards never has any
+    std::shared_ptr<const DeltaSegmentList> segments;
+    if (mergeThreshold.load(std::memory_order_relaxed) > 0) {
+        segments = loadSegments();
+    }
+    uint64_t mergedSegments;
+    {
+        // Read-lock only the shard that owns the term, leaving the other shards to writers
+        const IndexShard& shard = shards[shardFor(termHash)];
+        auto lock = shardLockWait.acquire<std::shared_lock<std::shared_mutex>>(shard.mutex);
 
-    auto it = termInvertedIndex.find(termfromImpl);  // Find the term in the inverted index
-    if (it != termInvertedIndex.end()) {
-        // Store the result in a temporary variable for logging
-        const std::vector<std::pair<std::string, int>>& results = it->second;
+        const TermEntry* entry = findTermLocked(shard, termfromImpl, termHash);  // Find the term in the inverted index
+        if (entry) {
+            postings = entry->postings;  // Shares the frozen blocks; only the short tail is copied under the lock
+        }
+        mergedSegments = shard.mergedSegments;
+    }
 
-        // Log the contents of the results
-        // std::cout << "[DEBUG] Lookup results for term '" << termfromImpl << "':\n";
-        // for (const auto& [docID, freq] : results) {
-        //     std::cout << "Document ID: " << docID << ", Frequency: " << freq << std::endl;
-        // }
+    // Add the segments the shard does not hold yet; their documents are among the newest, so only the end of the
+    // copied list is rebuilt
+    if (segments) {
+        for (const auto& published : *segments) {
+            if (published.sequence > mergedSegments) {
+                PostingView delta = published.segment->find(termfromImpl, termHash);
+                postings.addSorted(delta.documents, delta.frequencies, delta.size);
+            }
+        }
+    }
 
-        return results;  // Return the list of document IDs and frequencies
-    } else {
-        return {};  // Return an empty list if the term is not found
+    // Put the postings stored in the snapshot in front; the mapped file needs no lock, and the searches read them
+    // in place. Documents indexed since the load are numbered after the stored ones, so the two never interleave.
+    if (snapshot) {
+        size_t index = snapshot->lowerBound(termfromImpl);
+        if (index < snapshot->termCount() && snapshot->term(index) == termfromImpl && snapshot->postings(index).size > 0) {
+            PostingView stored = snapshot->postings(index);
+            if (!postings.empty() && postings.begin().document() <= stored.documents[stored.size - 1]) {
+                return mergePostings(stored, postings); // Not expected; kept so a stray overlap still sums
+            }
+            postings.setStored(stored, snapshot->maxFrequency(index));
+        }
     }
+    return postings;  // Empty if the term is not found
 }
 
 
-// Retrieves the top N documents sorted by frequency for the given search terms
-std::vector<std::pair<std::string, int>> IndexStore::getTopResults(const std::vector<std::string>& terms, size_t topN) {
-    std::unordered_map<std::string, int> docFrequencyMap; // Map to hold document frequencies
-    bool firstTerm = true; // Flag to indicate if processing the first term
+// Each source is sorted, so its matches for a prefix are one run starting at the prefix. A source contributes at
+// most limit + 1 distinct terms: the first limit overall are among them, and the extra one reveals truncation.
+std::vector<std::string> IndexStore::expandPrefix(std::string_view prefix, size_t limit, bool* truncated) const {
+    auto matches = [&](std::string_view term) { return term.substr(0, prefix.size()) == prefix; };
+    std::vector<std::string> expanded;
+    if (snapshot) {
+        size_t end = std::min(snapshot->termCount(), snapshot->lowerBound(prefix) + limit + 1);
+        for (size_t i = snapshot->lowerBound(prefix); i < end && matches(snapshot->term(i)); ++i) {
+            expanded.emplace_back(snapshot->term(i));
+        }
+    }
+    // Loaded before the shards are read: a segment a shard has merged by then is found in the shard instead
+    std::shared_ptr<const DeltaSegmentList> segments = loadSegments();
+    std::vector<uint64_t> mergedSegments(shards.size());
+    for (size_t s = 0; s < shards.size(); ++s) {
+        const IndexShard& shard = shards[s];
+        auto lock = shardLockWait.acquire<std::shared_lock<std::shared_mutex>>(shard.mutex);
+        mergedSegments[s] = shard.mergedSegments;
+        size_t taken = 0;
+        auto [first, last] = shard.frozenTerms.prefixRange(prefix);
+        for (size_t rank = first; rank < last && taken <= limit; ++rank) {
+            uint32_t position = shard.frozenTerms.byRank(rank);
+            if (!shard.frozenEntries[position].postings.empty()) {
+                expanded.emplace_back(shard.frozenTerms.term(position));
+                ++taken;
+            }
+        }
+        for (auto term = shard.overlayOrder.lower_bound(prefix);
+             term != shard.overlayOrder.end() && matches(*term) && taken <= limit; ++term) {
+            expanded.emplace_back(*term);
+            ++taken;
+        }
+    }
+    // Only the terms of shards that have not merged the segment yet count towards its limit + 1
+    for (const auto& published : *segments) {
+        const DeltaSegment& segment = *published.segment;
+        size_t taken = 0;
+        for (size_t rank = segment.lowerBound(prefix);
+             rank < segment.termCount() && taken <= limit && matches(segment.term(segment.byRank(rank))); ++rank) {
+            size_t entry = segment.byRank(rank);
+            if (published.sequence > mergedSegments[segment.shardOf(entry)]) {
+                expanded.emplace_back(segment.term(entry));
+                ++taken;
+            }
+        }
+    }
+
+    std::sort(expanded.begin(), expanded.end());
+    expanded.erase(std::unique(expanded.begin(), expanded.end()), expanded.end()); // Snapshot terms indexed again
+    if (truncated) {
+        *truncated = expanded.size() > limit;
+    }
+    if (expanded.size() > limit) {
+        expanded.resize(limit);
+    }
+    return expanded;
+}
 
-    // Collect document frequencies for each term, supporting AND searches
+// A prefix term contributes the union of the lists of its expansions
+std::vector<PostingList> IndexStore::termPostings(const std::vector<std::string>& terms, size_t maxExpansions,
+                                                  size_t* expandedTerms, bool* expansionTruncated,
+                                                  const SharedPostings* shared) const {
+    std::vector<PostingList> termResults;
+    termResults.reserve(terms.size());
+    size_t expanded = 0;
+    bool truncated = false;
     for (const auto& term : terms) {
-        std::vector<std::pair<std::string, int>> termResults = lookupIndex(term); // Get results for the current term
-        std::unordered_map<std::string, int> currentTermDocuments; // Map to hold current term documents
+        if (!isPrefixTerm(term)) {
+            auto found = shared ? shared->find(term) : SharedPostings::const_iterator();
+            if (shared && found != shared->end()) {
+                termResults.push_back(found->second); // Looked up once for the whole batch
+            } else {
+                termResults.push_back(lookupIndex(term)); // Get results for the current term
+            }
+            continue;
+        }
+        bool prefixTruncated = false;
+        std::vector<PostingList> expansions;
+        for (const auto& expansion : expandPrefix(std::string_view(term).substr(0, term.size() - 1), maxExpansions,
+                                                  &prefixTruncated)) {
+            expansions.push_back(lookupIndex(expansion));
+        }
+        std::vector<const PostingList*> expansionLists;
+        for (const auto& postings : expansions) {
+            expansionLists.push_back(&postings);
+        }
+        termResults.push_back(IntersectionEngine::unionPostings(expansionLists));
+        expanded += expansions.size();
+        truncated = truncated || prefixTruncated;
+    }
+    if (expandedTerms) {
+        *expandedTerms = expanded;
+    }
+    if (expansionTruncated) {
+        *expansionTruncated = truncated;
+    }
+    return termResults;
+}
+
+// Retrieves the top N documents sorted by frequency for the given search terms
+std::vector<std::pair<std::string, int>> IndexStore::getTopResults(const std::vector<std::string>& terms, size_t topN,
+                                                                   size_t* totalMatches, bool* totalExact,
+                                                                   size_t maxExpansions, size_t* expandedTerms,
+                                                                   bool* expansionTruncated, const SharedPostings* shared) {
+    // Fetch the posting list of every term, supporting AND searches
+    std::vector<PostingList> termResults = termPostings(terms, maxExpansions, expandedTerms, expansionTruncated, shared);
+
+    // Intersect the lists into a bounded top-N heap, skipping blocks that cannot beat the N-th best frequency
+    std::vector<const PostingList*> lists;
+    for (const auto& postings : termResults) {
+        lists.push_back(&postings);
+    }
+    // Retired documents are skipped as they match; the set is only consulted once something has been retired
+    const DocumentTombstones* deleted = tombstones.size() > 0 ? &tombstones : nullptr;
+    std::vector<Posting> sortedResults = IntersectionEngine::intersectTopK(lists, topN, totalMatches, totalExact, deleted);
+    // While a re-index is being applied both versions can match; the path is reported once
+    size_t duplicates = dropReplaced(sortedResults);
+    if (totalMatches) {
+        *totalMatches -= std::min(*totalMatches, duplicates);
+    }
+
+    // Resolve document keys only for the documents that made the cut
+    std::vector<std::pair<std::string, int>> topResults;
+    topResults.reserve(sortedResults.size());
+    for (const auto& [docNumber, freq] : sortedResults) {
+        topResults.emplace_back(getDocument(docNumber), freq);
+    }
 
-        // Collect frequencies of documents for the current term
-        for (const auto& result : termResults) {
-            currentTermDocuments[result.first] = result.second; // Store document ID and frequency
+    return topResults; // Return the sorted top results
+}
+
+// Intersects everything, then ranks it. The intersection comes out in document order, so a stable counting sort
+// on frequency gives intersectTopK's order (frequency descending, then document) in linear time; a comparison
+// sort takes over only when the frequencies spread far wider than the matches.
+std::vector<IndexStore::Posting> IndexStore::rankMatches(const std::vector<std::string>& terms, size_t maxExpansions,
+                                                         size_t* expandedTerms, bool* expansionTruncated) const {
+    std::vector<PostingList> termResults = termPostings(terms, maxExpansions, expandedTerms, expansionTruncated);
+    std::vector<const PostingList*> lists;
+    for (const auto& postings : termResults) {
+        lists.push_back(&postings);
+    }
+    const DocumentTombstones* deleted = tombstones.size() > 0 ? &tombstones : nullptr;
+    std::vector<Posting> matches = IntersectionEngine::intersect(lists, deleted);
+    dropReplaced(matches); // A path being re-indexed is ranked once, as its new version
+
+    int highest = 0;
+    int lowest = 1;
+    for (const auto& match : matches) {
+        highest = std::max(highest, match.second);
+        lowest = std::min(lowest, match.second);
+    }
+    // Buckets cover frequencies 1..highest only; anything else (a count below 1 or an overflowed sum) is compared
+    if (lowest < 1 || static_cast<size_t>(highest) > countingSortSpread * matches.size()) {
+        std::sort(matches.begin(), matches.end(), [](const Posting& a, const Posting& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        return matches;
+    }
+    std::vector<size_t> start(static_cast<size_t>(highest) + 2, 0); // Slot of the first match of each frequency
+    for (const auto& match : matches) {
+        ++start[static_cast<size_t>(highest - match.second) + 1];
+    }
+    for (size_t bucket = 1; bucket < start.size(); ++bucket) {
+        start[bucket] += start[bucket - 1];
+    }
+    std::vector<Posting> ranked(matches.size());
+    for (const auto& match : matches) {
+        ranked[start[static_cast<size_t>(highest - match.second)]++] = match;
+    }
+    return ranked;
+}
+
+// Estimates the memory held by the index, counting container payloads, hash nodes and heap-allocated strings
+IndexMemoryUsage IndexStore::estimateMemoryUsage() const {
+    // Approximate per-node overhead of std::unordered_map (next pointer + cached hash) and a bucket slot
+    constexpr size_t hashNodeOverhead = 2 * sizeof(void*);
+    constexpr size_t bucketBytes = sizeof(void*);
+    // Approximate size of a std::set node holding a string_view (three pointers and a color, then the value)
+    constexpr size_t orderNodeBytes = 4 * sizeof(void*) + sizeof(std::string_view);
+
+    // Bytes a string owns on the heap beyond its inline object (zero when the short-string buffer is used)
+    auto heapBytes = [](const std::string& s) {
+        return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+    };
+
+    std::lock_guard<std::mutex> mergeLock(mergeMutex);
+    IndexMemoryUsage usage;
+    if (snapshot) {
+        usage.documentCount = snapshot->documentCount();
+        usage.termCount = snapshot->termCount();
+        usage.postingCount = snapshot->postingCount();
+        usage.snapshotBytes = snapshot->mappedBytes();
+    }
+    {
+        std::shared_lock<std::shared_mutex> lock(documentMutex);
+        usage.documentCount += documentMap.size();
+        usage.deletedDocuments = tombstones.size();
+        usage.documentCount -= std::min(usage.documentCount, usage.deletedDocuments);
+        std::lock_guard<std::mutex> forwardLock(forwardMutex);
+        usage.pendingPurge = purgeQueue.size();
+        usage.forwardIndexBytes = forwardIndex.capacity() * sizeof(forwardIndex[0]) + tombstones.memoryBytes();
+        for (const auto& terms : forwardIndex) {
+            usage.forwardIndexBytes += terms.capacity() * sizeof(uint32_t);
+        }
+        usage.documentTableBytes = documentMap.capacity() * sizeof(const std::string*) +
+                                   pathToNumber.bucket_count() * bucketBytes;
+        for (const auto& [key, docNumber] : pathToNumber) {
+            usage.documentTableBytes += sizeof(std::pair<const std::string, int>) + hashNodeOverhead + heapBytes(key);
+        }
+    }
+    for (const auto& published : *loadSegments()) {
+        ++usage.deltaSegments;
+        usage.deltaBytes += published.segment->memoryBytes();
+        usage.postingCount += published.segment->postingCount(); // Their terms are counted once merged
+    }
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        usage.termCount += shard.termInvertedIndex.size();
+        usage.dictionaryBytes += sizeof(IndexShard) + shard.termInvertedIndex.bucket_count() * bucketBytes +
+                                 shard.termKeys.capacity() * sizeof(std::string_view) +
+                                 shard.freeSlots.capacity() * sizeof(uint32_t) + shard.frozenTerms.memoryBytes() +
+                                 shard.overlayOrder.size() * orderNodeBytes +
+                                 shard.frozenEntries.capacity() * sizeof(TermEntry);
+        for (const auto& [term, entry] : shard.termInvertedIndex) {
+            const PostingList& postings = entry.postings;
+            if (snapshot && snapshot->findTerm(term).size > 0) {
+                --usage.termCount; // Term already counted from the snapshot
+            }
+            usage.dictionaryBytes += sizeof(std::pair<const std::string, TermEntry>) + hashNodeOverhead + heapBytes(term);
+            usage.postingCount += postings.size();
+            usage.postingBytes += postings.memoryBytes();
+        }
+        for (uint32_t position = 0; position < shard.frozenEntries.size(); ++position) {
+            const PostingList& postings = shard.frozenEntries[position].postings;
+            if (postings.empty()) {
+                continue; // Purged since the freeze
+            }
+            ++usage.frozenTermCount;
+            if (!snapshot || snapshot->findTerm(shard.frozenTerms.term(position)).size == 0) {
+                ++usage.termCount;
+            }
+            usage.postingCount += postings.size();
+            usage.postingBytes += postings.memoryBytes();
         }
+    }
+    return usage;
+}
 
-        if (firstTerm) {
-            docFrequencyMap = currentTermDocuments; // Initialize with first term results
-            firstTerm = false; // Update flag
-        } else {
-            // Perform intersection of documents for AND search (common in both terms)
-            for (auto it = docFrequencyMap.begin(); it != docFrequencyMap.end();) {
-                if (currentTermDocuments.find(it->first) != currentTermDocuments.end()) {
-                    it->second += currentTermDocuments[it->first];  // Sum frequencies if document is in both
-                    ++it; // Move to the next document
-                } else {
-                    it = docFrequencyMap.erase(it);  // Remove documents not in the current term
-                }
+// Freezes the tails of every posting list, locking one shard at a time so searches keep running elsewhere
+void IndexStore::compactPostings() {
+    mergeDeltaSegments();
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto& [term, entry] : shard.termInvertedIndex) {
+            entry.postings.compact();
+        }
+        for (auto& entry : shard.frozenEntries) {
+            entry.postings.compact();
+        }
+    }
+}
+
+// Rebuilds each shard's frozen dictionary from its live frozen terms plus the overlay. Entries keep their key
+// table slots, so the forward index stays valid; only the slots of dropped terms are freed.
+size_t IndexStore::freezeDictionary() {
+    mergeDeltaSegments();
+    size_t frozen = 0;
+    std::vector<std::string_view> terms;
+    std::vector<TermEntry*> entries;
+    std::vector<uint32_t> positions;
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        terms.clear();
+        entries.clear();
+        for (uint32_t position = 0; position < shard.frozenEntries.size(); ++position) {
+            if (!shard.frozenEntries[position].postings.empty()) {
+                terms.push_back(shard.frozenTerms.term(position));
+                entries.push_back(&shard.frozenEntries[position]);
             }
         }
+        for (auto& [term, entry] : shard.termInvertedIndex) {
+            terms.push_back(term);
+            entries.push_back(&entry);
+        }
+
+        FrozenTermDictionary rebuilt;
+        if (!rebuilt.build(terms, positions)) {
+            std::cerr << "Warning: could not freeze a term dictionary shard of " << terms.size() << " terms" << std::endl;
+            frozen += shard.frozenTerms.size();
+            continue; // The shard keeps working as it is
+        }
+        for (const auto& entry : shard.frozenEntries) {
+            if (entry.postings.empty()) {
+                shard.termKeys[entry.slot] = std::string_view(); // Dropped; any forward references now remove nothing
+                shard.freeSlots.push_back(entry.slot);
+            }
+        }
+        std::vector<TermEntry> rebuiltEntries(terms.size());
+        for (size_t k = 0; k < terms.size(); ++k) {
+            rebuiltEntries[positions[k]] = std::move(*entries[k]);
+        }
+
+        shard.frozenTerms = std::move(rebuilt);
+        shard.frozenEntries = std::move(rebuiltEntries);
+        std::unordered_map<std::string, TermEntry>().swap(shard.termInvertedIndex); // Also releases the buckets
+        shard.overlayOrder.clear();
+        for (uint32_t position = 0; position < shard.frozenEntries.size(); ++position) {
+            shard.termKeys[shard.frozenEntries[position].slot] = shard.frozenTerms.term(position);
+        }
+        frozen += shard.frozenEntries.size();
+    }
+    return frozen;
+}
+
+// Writes the snapshot base and every in-memory update into one snapshot file
+bool IndexStore::saveSnapshot(const std::string& path, uint64_t logSequence) {
+    mergeDeltaSegments(); // The image is written from the shards alone
+    // Hold every lock for reading so the image is consistent; searches keep running while it is written
+    std::shared_lock<std::shared_mutex> documentLock(documentMutex);
+    std::vector<std::shared_lock<std::shared_mutex>> shardLocks;
+    shardLocks.reserve(shards.size());
+    for (const auto& shard : shards) {
+        shardLocks.emplace_back(shard.mutex);
     }
 
-    // Convert the map to a vector for sorting
-    std::vector<std::pair<std::string, int>> sortedResults(docFrequencyMap.begin(), docFrequencyMap.end());
+    SnapshotContents contents;
+    contents.highestClientID = highestClient;
+    contents.logSequence = logSequence;
 
-    // Sort results by frequency in descending order
-    std::sort(sortedResults.begin(), sortedResults.end(), [](const auto& a, const auto& b) {
-        return a.second > b.second; // Sort by frequency
-    });
+    // Live document keys in document number order, the snapshot's first, then the in-memory table. Retired
+    // documents are dropped and the rest renumbered densely; renumber[old] is 0 for a dropped document.
+    int totalDocuments = snapshotDocuments + static_cast<int>(documentMap.size());
+    std::vector<int> renumber(totalDocuments + 1, 0);
+    contents.documentKeys.reserve(totalDocuments - std::min<size_t>(totalDocuments, tombstones.size()));
+    for (int documentNumber = 1; documentNumber <= totalDocuments; ++documentNumber) {
+        if (tombstones.contains(documentNumber)) {
+            continue;
+        }
+        contents.documentKeys.push_back(documentNumber <= snapshotDocuments
+                                            ? snapshot->documentKey(documentNumber)
+                                            : std::string_view(*documentMap[documentNumber - snapshotDocuments - 1]));
+        renumber[documentNumber] = static_cast<int>(contents.documentKeys.size());
+    }
 
-    // Limit results to the top N
-    if (sortedResults.size() > topN) {
-        sortedResults.resize(topN); // Resize to top N results
+    // In-memory terms in byte order, so they can be merged with the snapshot's sorted dictionary
+    std::vector<std::pair<std::string_view, const PostingList*>> memoryTerms;
+    for (const auto& shard : shards) {
+        for (const auto& [term, entry] : shard.termInvertedIndex) {
+            memoryTerms.emplace_back(term, &entry.postings);
+        }
+        for (uint32_t position = 0; position < shard.frozenEntries.size(); ++position) {
+            if (!shard.frozenEntries[position].postings.empty()) {
+                memoryTerms.emplace_back(shard.frozenTerms.term(position), &shard.frozenEntries[position].postings);
+            }
+        }
+    }
+    std::sort(memoryTerms.begin(), memoryTerms.end());
+
+    // Appends one term with its live postings renumbered; a term left without postings is dropped. Renumbering
+    // preserves order, so the postings stay sorted.
+    auto appendTerm = [&contents, &renumber](std::string_view term, const int* documents, const int* frequencies,
+                                             size_t size) {
+        size_t before = contents.postingDocuments.size();
+        for (size_t k = 0; k < size; ++k) {
+            int documentNumber = renumber[documents[k]];
+            if (documentNumber != 0) {
+                contents.postingDocuments.push_back(documentNumber);
+                contents.postingFrequencies.push_back(frequencies[k]);
+            }
+        }
+        if (contents.postingDocuments.size() != before) {
+            contents.terms.push_back(term);
+            contents.postingOffsets.push_back(contents.postingDocuments.size());
+        }
+    };
+
+    // Appends a term whose postings are compressed in memory
+    std::vector<int> decodedDocuments, decodedFrequencies;
+    auto appendList = [&](std::string_view term, const PostingList& postings) {
+        decodedDocuments.clear();
+        decodedFrequencies.clear();
+        postings.decode(decodedDocuments, decodedFrequencies);
+        appendTerm(term, decodedDocuments.data(), decodedFrequencies.data(), decodedDocuments.size());
+    };
+
+    // Walk both sorted dictionaries together, merging the postings of terms present in both
+    contents.postingOffsets.push_back(0);
+    size_t storedTerms = snapshot ? snapshot->termCount() : 0;
+    size_t i = 0, j = 0;
+    while (i < storedTerms || j < memoryTerms.size()) {
+        std::string_view storedTerm = i < storedTerms ? snapshot->term(i) : std::string_view();
+        if (j == memoryTerms.size() || (i < storedTerms && storedTerm < memoryTerms[j].first)) {
+            PostingView stored = snapshot->postings(i++); // Untouched since the load: copy the live postings
+            appendTerm(storedTerm, stored.documents, stored.frequencies, stored.size);
+        } else if (i == storedTerms || memoryTerms[j].first < storedTerm) {
+            const auto& [term, postings] = memoryTerms[j++]; // Term added since the load
+            appendList(term, *postings);
+        } else {
+            appendList(storedTerm, mergePostings(snapshot->postings(i++), *memoryTerms[j++].second));
+        }
+    }
+
+    if (!IndexSnapshot::write(path, contents)) {
+        std::cerr << "Error: could not write snapshot to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Adopts a snapshot file as the read-only base of the index; only an empty store can load one
+bool IndexStore::loadSnapshot(const std::string& path, std::string& error) {
+    std::unique_lock<std::shared_mutex> lock(documentMutex);
+    if (documentCounter != 1 || snapshot) {
+        error = "the index already holds documents";
+        return false;
+    }
+
+    std::shared_ptr<const IndexSnapshot> opened = IndexSnapshot::open(path, error);
+    if (!opened) {
+        return false;
+    }
+    if (opened->documentCount() >= static_cast<size_t>(INT_MAX)) {
+        error = "snapshot holds more documents than a document number can address";
+        return false;
     }
 
-    return sortedResults; // Return the sorted top results
+    snapshot = std::move(opened);
+    snapshotDocuments = static_cast<int>(snapshot->documentCount());
+    documentCounter = snapshotDocuments + 1; // New documents are numbered after the stored ones
+    highestClient = std::max(highestClient, snapshot->highestClientID());
+    generationCounter.fetch_add(1, std::memory_order_release);
+    return true;
 }
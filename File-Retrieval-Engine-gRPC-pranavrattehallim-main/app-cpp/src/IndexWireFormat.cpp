@@ -0,0 +1,106 @@
+#include "IndexWireFormat.hpp"
+#include <climits> // For INT_MAX
+#include <mutex>
+
+// Looks every term up under the shared lock first; the vocabulary of a folder saturates quickly, so most
+// documents never take the exclusive lock
+void SessionTermEncoder::encode(const std::unordered_map<std::string, int>& wordFrequencies, fre::IndexReq& document) {
+    document.mutable_term_ids()->Reserve(static_cast<int>(wordFrequencies.size()));
+    document.mutable_term_counts()->Reserve(static_cast<int>(wordFrequencies.size()));
+    std::vector<const std::pair<const std::string, int>*> unknown; // Terms without an ID at the first look
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& wordFrequency : wordFrequencies) {
+            auto it = ids_.find(wordFrequency.first);
+            if (it == ids_.end()) {
+                unknown.push_back(&wordFrequency);
+                continue;
+            }
+            document.add_term_ids(it->second);
+            document.add_term_counts(static_cast<uint32_t>(wordFrequency.second));
+        }
+    }
+    if (unknown.empty()) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (const auto* wordFrequency : unknown) {
+        auto [it, inserted] = ids_.try_emplace(wordFrequency->first, static_cast<uint32_t>(ids_.size()));
+        if (inserted) {
+            newTerms_.push_back(wordFrequency->first); // Another worker may have added it since the first look
+        }
+        document.add_term_ids(it->second);
+        document.add_term_counts(static_cast<uint32_t>(wordFrequency->second));
+    }
+}
+
+void SessionTermEncoder::takeNewTerms(fre::IndexBatch& batch) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto& term : newTerms_) {
+        batch.add_new_terms(std::move(term));
+    }
+    newTerms_.clear();
+}
+
+size_t SessionTermEncoder::termCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return ids_.size();
+}
+
+bool SessionTermDecoder::decode(const fre::IndexBatch& batch,
+                                std::vector<std::vector<std::pair<std::string, int>>>& documents, std::string& error) {
+    if (terms_.size() + batch.new_terms_size() > maxTerms) {
+        error = "Indexing stream's term dictionary would exceed " + std::to_string(maxTerms) + " terms";
+        return false;
+    }
+    terms_.insert(terms_.end(), batch.new_terms().begin(), batch.new_terms().end());
+
+    documents.clear();
+    documents.reserve(batch.documents_size());
+    for (const auto& document : batch.documents()) {
+        if (document.term_ids_size() != document.term_counts_size()) {
+            error = "Document " + document.document_path() + " has " + std::to_string(document.term_ids_size()) +
+                    " term IDs but " + std::to_string(document.term_counts_size()) + " counts";
+            return false;
+        }
+        std::vector<std::pair<std::string, int>>& termFrequencies = documents.emplace_back();
+        termFrequencies.reserve(document.term_ids_size() + document.word_frequencies_size());
+        for (int i = 0; i < document.term_ids_size(); ++i) {
+            uint32_t id = document.term_ids(i);
+            if (id >= terms_.size()) {
+                error = "Document " + document.document_path() + " uses term ID " + std::to_string(id) +
+                        ", but the stream's dictionary holds " + std::to_string(terms_.size()) + " terms";
+                return false;
+            }
+            uint32_t count = document.term_counts(i);
+            if (count < 1 || count > static_cast<uint32_t>(INT_MAX)) {
+                error = "Document " + document.document_path() + " gives term " + terms_[id] + " the count " +
+                        std::to_string(count) + "; counts must be from 1 to " + std::to_string(INT_MAX);
+                return false;
+            }
+            termFrequencies.emplace_back(terms_[id], static_cast<int>(count));
+        }
+        for (const auto& wordFreq : document.word_frequencies()) {
+            if (wordFreq.count() < 1) {
+                error = "Document " + document.document_path() + " gives word " + wordFreq.word() + " the count " +
+                        std::to_string(wordFreq.count()) + "; counts must be at least 1";
+                return false;
+            }
+            termFrequencies.emplace_back(wordFreq.word(), wordFreq.count());
+        }
+    }
+    return true;
+}
+
+bool parseCompressionAlgorithm(const std::string& name, grpc_compression_algorithm& algorithm) {
+    if (name == "none") {
+        algorithm = GRPC_COMPRESS_NONE;
+    } else if (name == "deflate") {
+        algorithm = GRPC_COMPRESS_DEFLATE;
+    } else if (name == "gzip") {
+        algorithm = GRPC_COMPRESS_GZIP;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,268 @@
+#include "IntersectionEngine.hpp"
+#include <algorithm> // For std::sort and std::min
+#include <queue>     // For the union's merge heap
+#include "TopKCollector.hpp"
+
+#if defined(FRE_SIMD_INTERSECTION) && defined(__SSE2__)
+#include <emmintrin.h> // SSE2 intrinsics for the block kernel
+#define FRE_USE_SIMD_KERNEL 1
+#endif
+
+namespace {
+
+// Once galloping has narrowed the search to this many postings, finish with a block scan
+constexpr size_t blockSize = 16;
+
+// Lists a union merges through its heap before an accumulator array is considered
+constexpr size_t heapUnionLists = 16;
+
+// Largest document range per posting for which the accumulator array beats the heap
+constexpr size_t accumulatorSpanPerPosting = 4;
+
+// Returns the number of documents in [first, first + count) that are smaller than target
+inline size_t countBelow(const int* first, size_t count, int target) {
+#ifdef FRE_USE_SIMD_KERNEL
+    size_t below = 0;
+    size_t i = 0;
+    const __m128i targetVector = _mm_set1_epi32(target); // Broadcast the target to all four lanes
+    for (; i + 4 <= count; i += 4) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(targetVector, block))); // Lanes below target
+        below += __builtin_popcount(mask);
+        if (mask != 0xF) {
+            return below; // The list is sorted, so the first lane at or above target ends the scan
+        }
+    }
+    for (; i < count && first[i] < target; ++i) {
+        ++below; // Scalar tail for the last few postings
+    }
+    return below;
+#else
+    size_t below = 0;
+    while (below < count && first[below] < target) {
+        ++below; // Linear scan is cheapest for a handful of postings
+    }
+    return below;
+#endif
+}
+
+} // namespace
+
+// Gallops forward from 'from' to bracket the target, then binary searches and block-scans the bracket
+size_t IntersectionEngine::advanceTo(const int* documents, size_t size, size_t from, int target) {
+    if (from >= size || documents[from] >= target) {
+        return from; // Already positioned at or past the target
+    }
+
+    // Exponential search: double the step until we pass the target or the end of the list
+    size_t low = from;
+    size_t step = 1;
+    size_t high = from + step;
+    while (high < size && documents[high] < target) {
+        low = high;
+        step <<= 1;
+        high = from + step;
+    }
+    high = std::min(high, size);
+
+    // Binary search down to a small block, then finish with the block kernel
+    while (high - low > blockSize) {
+        size_t middle = low + (high - low) / 2;
+        if (documents[middle] < target) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low + countBelow(documents + low, high - low, target);
+}
+
+// Intersects posting lists for an AND query, summing frequencies of the documents present in every list
+std::vector<std::pair<int, int>> IntersectionEngine::intersect(std::vector<const PostingList*> lists,
+                                                               const DocumentTombstones* deleted) {
+    std::vector<std::pair<int, int>> results;
+    if (lists.empty()) {
+        return results; // No terms, no matches
+    }
+
+    // Cost-based ordering: start from the rarest term so the candidate set is as small as possible
+    std::sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) {
+        return a->size() < b->size();
+    });
+    if (lists.front()->empty()) {
+        return results; // Some term matches nothing, so the AND matches nothing
+    }
+
+    // Seed the candidates with the rarest list
+    results.reserve(lists.front()->size());
+    for (PostingIterator rarest = lists.front()->begin(); !rarest.atEnd(); rarest.next()) {
+        if (!deleted || !deleted->contains(rarest.document())) {
+            results.emplace_back(rarest.document(), rarest.frequency());
+        }
+    }
+
+    // Filter the candidates through each longer list, skipping blocks and galloping past documents that cannot match
+    for (size_t listIndex = 1; listIndex < lists.size() && !results.empty(); ++listIndex) {
+        PostingIterator list = lists[listIndex]->begin();
+        size_t kept = 0;
+        for (const auto& candidate : results) {
+            list.advance(candidate.first);
+            if (list.atEnd()) {
+                break; // No further candidate can appear in this list
+            }
+            if (list.document() == candidate.first) {
+                results[kept++] = {candidate.first, candidate.second + list.frequency()};
+            }
+        }
+        results.resize(kept); // Drop candidates missing from this list
+    }
+
+    return results;
+}
+
+// MaxScore-style top-k evaluation: the rarest list leads, and the others are only probed for candidates whose
+// score bound (the lead's frequency plus each other list's block maximum) can still beat the k-th best score
+std::vector<std::pair<int, int>> IntersectionEngine::intersectTopK(std::vector<const PostingList*> lists, size_t k,
+                                                                   size_t* matches, bool* exact,
+                                                                   const DocumentTombstones* deleted) {
+    size_t matchCount = 0;
+    bool complete = true;
+    TopKCollector collector(k);
+
+    std::sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) {
+        return a->size() < b->size();
+    });
+    if (!lists.empty() && !lists.front()->empty()) {
+        PostingIterator lead = lists.front()->begin();
+        std::vector<PostingIterator> others;
+        others.reserve(lists.size() - 1);
+        int othersMaxFrequency = 0; // Most the other lists can add to any document
+        for (size_t i = 1; i < lists.size(); ++i) {
+            others.push_back(lists[i]->begin());
+            othersMaxFrequency += lists[i]->maxFrequency();
+        }
+
+        bool done = false;
+        while (!done && !lead.atEnd()) {
+            if (collector.full()) {
+                // Skip the lead's whole block when even its best posting cannot enter the results
+                if (lead.blockMaxFrequency() + othersMaxFrequency <= collector.threshold()) {
+                    lead.nextBlock();
+                    complete = false;
+                    continue;
+                }
+
+                // Tighter bound for this document from the blocks of the other lists that would hold it
+                int bound = lead.frequency();
+                for (auto& other : others) {
+                    int blockMax = other.maxFrequencyAt(lead.document());
+                    if (blockMax < 0) {
+                        done = true; // That list has nothing left at or after this document
+                        break;
+                    }
+                    bound += blockMax;
+                }
+                if (done) {
+                    break;
+                }
+                if (bound <= collector.threshold()) {
+                    lead.next(); // Ties lose to earlier documents, so an equal score cannot enter either
+                    complete = false;
+                    continue;
+                }
+            }
+
+            // Probe the other lists; on a miss, jump the lead to the document the missing list moved to
+            int document = lead.document();
+            int score = lead.frequency();
+            int nextDocument = document;
+            for (auto& other : others) {
+                other.advance(document);
+                if (other.atEnd()) {
+                    done = true;
+                    break;
+                }
+                if (other.document() != document) {
+                    nextDocument = other.document();
+                    break;
+                }
+                score += other.frequency();
+            }
+            if (done) {
+                break;
+            }
+            if (nextDocument == document) {
+                if (!deleted || !deleted->contains(document)) {
+                    ++matchCount;
+                    collector.push(document, score);
+                }
+                lead.next();
+            } else {
+                lead.advance(nextDocument);
+            }
+        }
+    }
+
+    if (matches) {
+        *matches = matchCount;
+    }
+    if (exact) {
+        *exact = complete;
+    }
+    return collector.results();
+}
+
+// k-way merge: the heap holds one entry per unfinished list, ordered by its current document. With many lists the
+// heap costs more per posting than touching every document number in range once.
+PostingList IntersectionEngine::unionPostings(const std::vector<const PostingList*>& lists) {
+    PostingList merged;
+    if (lists.size() > heapUnionLists) {
+        std::vector<int> documents, frequencies;
+        for (const PostingList* list : lists) {
+            list->decode(documents, frequencies);
+        }
+        int last = documents.empty() ? 0 : *std::max_element(documents.begin(), documents.end());
+        if (static_cast<size_t>(last) < accumulatorSpanPerPosting * documents.size()) {
+            std::vector<int> sums(static_cast<size_t>(last) + 1, 0);
+            std::vector<bool> present(sums.size(), false); // Kept apart from sums so every document seen stays, as
+                                                           // in the heap merge, whatever its summed frequency
+            for (size_t i = 0; i < documents.size(); ++i) {
+                sums[documents[i]] += frequencies[i];
+                present[documents[i]] = true;
+            }
+            for (int document = 0; document <= last; ++document) {
+                if (present[document]) {
+                    merged.add(document, sums[document]);
+                }
+            }
+            return merged;
+        }
+    }
+
+    std::vector<PostingIterator> iterators;
+    iterators.reserve(lists.size());
+    auto laterDocument = [&](size_t a, size_t b) { return iterators[a].document() > iterators[b].document(); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(laterDocument)> heap(laterDocument);
+    for (const PostingList* list : lists) {
+        iterators.emplace_back(*list);
+        if (!iterators.back().atEnd()) {
+            heap.push(iterators.size() - 1);
+        }
+    }
+
+    while (!heap.empty()) {
+        int document = iterators[heap.top()].document();
+        int frequency = 0;
+        while (!heap.empty() && iterators[heap.top()].document() == document) {
+            size_t list = heap.top();
+            heap.pop();
+            frequency += iterators[list].frequency();
+            iterators[list].next();
+            if (!iterators[list].atEnd()) {
+                heap.push(list);
+            }
+        }
+        merged.add(document, frequency);
+    }
+    return merged;
+}
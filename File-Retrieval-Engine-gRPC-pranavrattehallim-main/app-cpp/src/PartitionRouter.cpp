@@ -0,0 +1,466 @@
+#include "PartitionRouter.hpp"
+#include "FileRetrievalEngineImpl.hpp" // For the server's result limit
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+
+namespace {
+
+// One outstanding unary call to a partition
+template <typename Reply>
+struct PartitionCall {
+    grpc::ClientContext context; // Context of the call
+    Reply reply;                 // Partition's reply, valid once the call finished with an OK status
+    grpc::Status status;         // Status of the call
+    bool sent = false;           // False for partitions the request did not concern
+};
+
+// Starts the marked calls together on one completion queue and waits for all of them, so a scatter costs the
+// slowest partition's latency rather than the sum. start(i, context, queue) prepares the call to partition i.
+template <typename Reply, typename Start>
+void callPartitions(std::vector<PartitionCall<Reply>>& calls, Start start) {
+    grpc::CompletionQueue queue;
+    std::vector<std::unique_ptr<grpc::ClientAsyncResponseReader<Reply>>> readers(calls.size());
+    size_t pending = 0;
+    for (size_t i = 0; i < calls.size(); ++i) {
+        if (!calls[i].sent) {
+            continue;
+        }
+        readers[i] = start(i, &calls[i].context, &queue);
+        readers[i]->StartCall();
+        readers[i]->Finish(&calls[i].reply, &calls[i].status, reinterpret_cast<void*>(i));
+        ++pending;
+    }
+
+    void* tag = nullptr;
+    bool ok = false;
+    while (pending > 0 && queue.Next(&tag, &ok)) {
+        --pending; // Finish always completes, with the status telling how the call went
+    }
+    queue.Shutdown();
+    while (queue.Next(&tag, &ok)) {
+        // Drain the queue before it is destroyed
+    }
+}
+
+// 64-bit FNV-1a, stable across builds and platforms so a key keeps its partition across restarts
+uint64_t fnv1a(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Merges the partitions' replies to one search into the reply the client gets. Counts are comparable across
+// partitions because each document's frequencies live on a single partition. Each partition expands prefix terms
+// against its own dictionary; the largest expansion stands for the query, since the same term is usually in many.
+void mergeSearchReplies(const fre::SearchReq& request, const std::vector<fre::SearchRep*>& replies,
+                        std::chrono::high_resolution_clock::time_point start, fre::SearchRep* response) {
+    // Merge the lists; the stable sort keeps partition order between equal counts
+    std::vector<fre::SearchResult*> merged;
+    int64_t totalMatches = 0;
+    bool totalExact = true;
+    int64_t expandedTerms = 0;
+    bool expansionTruncated = false;
+    for (fre::SearchRep* reply : replies) {
+        totalMatches += reply->total_matches();
+        totalExact = totalExact && reply->total_exact();
+        expandedTerms = std::max(expandedTerms, reply->expanded_terms());
+        expansionTruncated = expansionTruncated || reply->expansion_truncated();
+        for (auto& result : *reply->mutable_documents()) {
+            merged.push_back(&result);
+        }
+    }
+    std::stable_sort(merged.begin(), merged.end(), [](const fre::SearchResult* a, const fre::SearchResult* b) {
+        return a->count() > b->count();
+    });
+    size_t topK = request.top_k() > 0
+                      ? std::min<size_t>(request.top_k(), FileRetrievalEngineImpl::maxSearchResults)
+                      : 10;
+    merged.resize(std::min(merged.size(), topK));
+
+    response->set_message("Search completed in " +
+                          std::to_string(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()) +
+                          " seconds" +
+                          (expandedTerms > 0 ? ", prefixes expanded to " + std::to_string(expandedTerms) + " terms" +
+                                                   (expansionTruncated ? " (capped)" : "")
+                                             : "") +
+                          ". Search results (top " + std::to_string(merged.size()) +
+                          (totalExact ? " out of " : " out of at least ") + std::to_string(totalMatches) + "):");
+    response->set_total_matches(totalMatches);
+    response->set_total_exact(totalExact);
+    response->set_expanded_terms(expandedTerms);
+    response->set_expansion_truncated(expansionTruncated);
+    for (fre::SearchResult* result : merged) {
+        response->add_documents()->Swap(result);
+    }
+}
+
+} // namespace
+
+// Opens one channel per partition with the same message size limit as the client
+PartitionRouter::PartitionRouter(const std::vector<std::string>& partitionAddresses) {
+    grpc::ChannelArguments channelArgs;
+    channelArgs.SetMaxReceiveMessageSize(INT_MAX);
+    for (const auto& address : partitionAddresses) {
+        partitions_.push_back({address, fre::FileRetrievalEngine::NewStub(grpc::CreateCustomChannel(
+                                            address, grpc::InsecureChannelCredentials(), channelArgs))});
+    }
+}
+
+// Hashes the same "clientID:documentPath" key the document table uses, so a re-index or delete of a path reaches
+// the partition holding it
+size_t PartitionRouter::partitionFor(const std::string& clientID, const std::string& documentPath,
+                                     size_t partitionCount) {
+    uint64_t hash = fnv1a(documentPath, fnv1a(":", fnv1a(clientID)));
+    return static_cast<size_t>(hash % partitionCount);
+}
+
+// Keeps the partition's error code and names the partition in the message
+grpc::Status PartitionRouter::partitionError(size_t partition, const grpc::Status& status) const {
+    return grpc::Status(status.error_code(), "Partition " + partitions_[partition].address + ": " +
+                                                 status.error_message());
+}
+
+// Forwards the document unchanged to its partition
+grpc::Status PartitionRouter::ComputeIndex(
+        grpc::ServerContext* context,
+        const fre::IndexReq* request,
+        fre::IndexRep* response) {
+    return stats_.recordCall(RpcMethod::ComputeIndex, [&]() {
+        size_t partition = partitionFor(request->client_id(), request->document_path(), partitions_.size());
+        grpc::ClientContext partitionContext;
+        grpc::Status status = partitions_[partition].stub->ComputeIndex(&partitionContext, *request, response);
+        return status.ok() ? status : partitionError(partition, status);
+    });
+}
+
+// gRPC remote procedure for streaming batches of documents to index
+grpc::Status PartitionRouter::ComputeIndexStream(
+        grpc::ServerContext* context,
+        grpc::ServerReader<fre::IndexBatch>* reader,
+        fre::IndexStreamRep* response) {
+    return stats_.recordCall(RpcMethod::ComputeIndexStream, [&]() { return routeIndexStream(reader, response); });
+}
+
+// Opens a stream to a partition the first time a batch has documents for it. Each partition acknowledges its own
+// stream once all of its documents are durable; the router answers after the last of them. Term IDs pass through
+// untouched: every partition's stream gets all of the client's new terms, in order, ahead of its first document
+// after them, so each partition rebuilds the client's dictionary.
+grpc::Status PartitionRouter::routeIndexStream(grpc::ServerReader<fre::IndexBatch>* reader,
+                                               fre::IndexStreamRep* response) {
+    struct PartitionStream {
+        grpc::ClientContext context;                             // Context of the partition's stream
+        fre::IndexStreamRep reply;                               // Partition's acknowledgement
+        std::unique_ptr<grpc::ClientWriter<fre::IndexBatch>> writer; // Null until the partition gets a document
+        bool failed = false;                                     // Set when a write was refused; Finish tells why
+        std::vector<std::string> newTerms;                       // Client's new terms not yet sent to the partition
+    };
+    std::vector<PartitionStream> streams(partitions_.size());
+    std::vector<fre::IndexBatch> pieces(partitions_.size());
+
+    fre::IndexBatch batch;        // Batch currently being split
+    int64_t batchesReceived = 0;  // Batches received from the client
+    while (reader->Read(&batch)) {
+        ++batchesReceived;
+
+        // Move every document into its partition's piece of the batch
+        for (auto& piece : pieces) {
+            piece.Clear();
+            piece.set_client_id(batch.client_id());
+        }
+        for (auto& document : *batch.mutable_documents()) {
+            size_t partition = partitionFor(batch.client_id(), document.document_path(), partitions_.size());
+            pieces[partition].add_documents()->Swap(&document);
+        }
+        for (auto& stream : streams) {
+            stream.newTerms.insert(stream.newTerms.end(), batch.new_terms().begin(), batch.new_terms().end());
+        }
+
+        for (size_t i = 0; i < partitions_.size(); ++i) {
+            PartitionStream& stream = streams[i];
+            if (pieces[i].documents_size() == 0 || stream.failed) {
+                continue;
+            }
+            for (auto& term : stream.newTerms) {
+                pieces[i].add_new_terms(std::move(term));
+            }
+            stream.newTerms.clear();
+            if (!stream.writer) {
+                stream.writer = partitions_[i].stub->ComputeIndexStream(&stream.context, &stream.reply);
+            }
+            if (!stream.writer->Write(pieces[i])) {
+                stream.failed = true; // The partition closed its stream; its status is read below
+            }
+        }
+    }
+
+    // Close every stream, then report the first failure or the combined acknowledgement
+    grpc::Status result = grpc::Status::OK;
+    int64_t documentsIndexed = 0;
+    double applySeconds = 0;
+    double logWaitSeconds = 0;
+    for (size_t i = 0; i < streams.size(); ++i) {
+        PartitionStream& stream = streams[i];
+        if (!stream.writer) {
+            continue;
+        }
+        stream.writer->WritesDone();
+        grpc::Status status = stream.writer->Finish();
+        if (!status.ok()) {
+            if (result.ok()) {
+                result = partitionError(i, status);
+            }
+            continue;
+        }
+        documentsIndexed += stream.reply.documents_indexed();
+        applySeconds = std::max(applySeconds, stream.reply.apply_seconds()); // Partitions apply in parallel
+        logWaitSeconds = std::max(logWaitSeconds, stream.reply.log_wait_seconds());
+    }
+    if (!result.ok()) {
+        return result;
+    }
+
+    response->set_documents_indexed(documentsIndexed);
+    response->set_batches_received(batchesReceived);
+    response->set_apply_seconds(applySeconds);
+    response->set_log_wait_seconds(logWaitSeconds);
+    response->set_message("Indexing complete for " + std::to_string(documentsIndexed) + " documents in " +
+                          std::to_string(batchesReceived) + " batches");
+    return grpc::Status::OK;
+}
+
+// gRPC remote procedure for searching
+grpc::Status PartitionRouter::ComputeSearch(
+        grpc::ServerContext* context,
+        const fre::SearchReq* request,
+        fre::SearchRep* response) {
+    return stats_.recordCall(RpcMethod::ComputeSearch, [&]() { return scatterSearch(request, response); });
+}
+
+// Every partition returns its own top K, so the global top K is among them
+grpc::Status PartitionRouter::scatterSearch(const fre::SearchReq* request, fre::SearchRep* response) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<PartitionCall<fre::SearchRep>> calls(partitions_.size());
+    for (auto& call : calls) {
+        call.sent = true;
+    }
+    callPartitions(calls, [&](size_t i, grpc::ClientContext* context, grpc::CompletionQueue* queue) {
+        return partitions_[i].stub->PrepareAsyncComputeSearch(context, *request, queue);
+    });
+
+    std::vector<fre::SearchRep*> replies;
+    for (size_t i = 0; i < calls.size(); ++i) {
+        if (!calls[i].status.ok()) {
+            return partitionError(i, calls[i].status);
+        }
+        replies.push_back(&calls[i].reply);
+    }
+    mergeSearchReplies(*request, replies, start, response);
+    return grpc::Status::OK;
+}
+
+// gRPC remote procedure for a batch of searches
+grpc::Status PartitionRouter::ComputeSearchBatch(
+        grpc::ServerContext* context,
+        const fre::SearchBatchReq* request,
+        fre::SearchBatchRep* response) {
+    return stats_.recordCall(RpcMethod::ComputeSearchBatch, [&]() { return scatterSearchBatch(request, response); });
+}
+
+// The whole batch goes to every partition as one call, so each partition shares its own lookups across the
+// searches; the replies are then merged search by search. Shared terms are reported as the largest count of any
+// partition, since each partition looks up the same terms.
+grpc::Status PartitionRouter::scatterSearchBatch(const fre::SearchBatchReq* request, fre::SearchBatchRep* response) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<PartitionCall<fre::SearchBatchRep>> calls(partitions_.size());
+    for (auto& call : calls) {
+        call.sent = true;
+    }
+    callPartitions(calls, [&](size_t i, grpc::ClientContext* context, grpc::CompletionQueue* queue) {
+        return partitions_[i].stub->PrepareAsyncComputeSearchBatch(context, *request, queue);
+    });
+
+    int64_t sharedTerms = 0;
+    for (size_t i = 0; i < calls.size(); ++i) {
+        if (!calls[i].status.ok()) {
+            return partitionError(i, calls[i].status);
+        }
+        if (calls[i].reply.results_size() != request->searches_size()) {
+            return grpc::Status(grpc::INTERNAL, "Partition " + partitions_[i].address + " answered " +
+                                std::to_string(calls[i].reply.results_size()) + " of " +
+                                std::to_string(request->searches_size()) + " searches");
+        }
+        sharedTerms = std::max(sharedTerms, calls[i].reply.shared_terms());
+    }
+    std::vector<fre::SearchRep*> replies(calls.size());
+    for (int search = 0; search < request->searches_size(); ++search) {
+        for (size_t i = 0; i < calls.size(); ++i) {
+            replies[i] = calls[i].reply.mutable_results(search);
+        }
+        mergeSearchReplies(request->searches(search), replies, start, response->add_results());
+    }
+    response->set_shared_terms(sharedTerms);
+    response->set_message("Batch of " + std::to_string(request->searches_size()) + " searches completed in " +
+                          std::to_string(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()) +
+                          " seconds across " + std::to_string(partitions_.size()) + " partitions.");
+    return grpc::Status::OK;
+}
+
+// gRPC remote procedure for removing documents
+grpc::Status PartitionRouter::ComputeDelete(
+        grpc::ServerContext* context,
+        const fre::DeleteReq* request,
+        fre::DeleteRep* response) {
+    return stats_.recordCall(RpcMethod::ComputeDelete, [&]() { return routeDelete(request, response); });
+}
+
+// Groups the paths by partition and deletes them on the partitions concerned in parallel
+grpc::Status PartitionRouter::routeDelete(const fre::DeleteReq* request, fre::DeleteRep* response) {
+    std::vector<fre::DeleteReq> pieces(partitions_.size());
+    std::vector<PartitionCall<fre::DeleteRep>> calls(partitions_.size());
+    for (const auto& documentPath : request->document_paths()) {
+        size_t partition = partitionFor(request->client_id(), documentPath, partitions_.size());
+        pieces[partition].add_document_paths(documentPath);
+        calls[partition].sent = true;
+    }
+    for (auto& piece : pieces) {
+        piece.set_client_id(request->client_id());
+    }
+    callPartitions(calls, [&](size_t i, grpc::ClientContext* context, grpc::CompletionQueue* queue) {
+        return partitions_[i].stub->PrepareAsyncComputeDelete(context, pieces[i], queue);
+    });
+
+    int64_t deleted = 0;
+    for (size_t i = 0; i < calls.size(); ++i) {
+        if (!calls[i].sent) {
+            continue;
+        }
+        if (!calls[i].status.ok()) {
+            return partitionError(i, calls[i].status);
+        }
+        deleted += calls[i].reply.documents_deleted();
+    }
+    response->set_documents_deleted(deleted);
+    response->set_message("Deleted " + std::to_string(deleted) + " of " +
+                          std::to_string(request->document_paths_size()) + " documents");
+    return grpc::Status::OK;
+}
+
+// Forwards the request to the first partition
+grpc::Status PartitionRouter::GetClientID(
+        grpc::ServerContext* context,
+        const fre::ConnectReq* request,
+        fre::ConnectRep* response) {
+    return stats_.recordCall(RpcMethod::GetClientID, [&]() {
+        grpc::ClientContext partitionContext;
+        grpc::Status status = partitions_[0].stub->GetClientID(&partitionContext, *request, response);
+        return status.ok() ? status : partitionError(0, status);
+    });
+}
+
+// Nothing to stop locally; the router keeps serving
+grpc::Status PartitionRouter::Shutdown(
+        grpc::ServerContext* context,
+        const fre::ShutdownReq* request,
+        fre::ShutdownRep* response) {
+    return stats_.recordCall(RpcMethod::Shutdown, [&]() {
+        response->set_message("Router is shutting down.");
+        return grpc::Status::OK;
+    });
+}
+
+// gRPC remote procedure for server statistics
+grpc::Status PartitionRouter::GetStats(
+        grpc::ServerContext* context,
+        const fre::StatsReq* request,
+        fre::StatsRep* response) {
+    return stats_.recordCall(RpcMethod::GetStats, [&]() { return collectStats(response); });
+}
+
+// RPC latencies are the router's, as clients see them; lock, index and cache counters are summed over the
+// partitions, whose own latencies are available from each server's stats command
+grpc::Status PartitionRouter::collectStats(fre::StatsRep* reply) {
+    std::vector<PartitionCall<fre::StatsRep>> calls(partitions_.size());
+    for (auto& call : calls) {
+        call.sent = true;
+    }
+    fre::StatsReq request;
+    callPartitions(calls, [&](size_t i, grpc::ClientContext* context, grpc::CompletionQueue* queue) {
+        return partitions_[i].stub->PrepareAsyncGetStats(context, request, queue);
+    });
+
+    stats_.collect(reply);
+    fre::IndexStats* index = reply->mutable_index();
+    fre::CacheStats* cache = reply->mutable_cache();
+    for (size_t i = 0; i < calls.size(); ++i) {
+        if (!calls[i].status.ok()) {
+            return partitionError(i, calls[i].status);
+        }
+        const fre::StatsRep& partition = calls[i].reply;
+
+        // Every server reports the same locks in the same order
+        for (int l = 0; l < partition.locks_size(); ++l) {
+            const fre::LockStats& source = partition.locks(l);
+            fre::LockStats* lock = l < reply->locks_size() ? reply->mutable_locks(l) : reply->add_locks();
+            lock->set_lock(source.lock());
+            lock->set_acquisitions(lock->acquisitions() + source.acquisitions());
+            lock->set_contended(lock->contended() + source.contended());
+            lock->set_wait_seconds(lock->wait_seconds() + source.wait_seconds());
+        }
+
+        const fre::IndexStats& source = partition.index();
+        index->set_documents(index->documents() + source.documents());
+        index->set_terms(index->terms() + source.terms()); // Terms found on several partitions count once each
+        index->set_postings(index->postings() + source.postings());
+        index->set_document_table_bytes(index->document_table_bytes() + source.document_table_bytes());
+        index->set_dictionary_bytes(index->dictionary_bytes() + source.dictionary_bytes());
+        index->set_posting_bytes(index->posting_bytes() + source.posting_bytes());
+        index->set_snapshot_bytes(index->snapshot_bytes() + source.snapshot_bytes());
+        index->set_generation(index->generation() + source.generation());
+        index->set_deleted_documents(index->deleted_documents() + source.deleted_documents());
+        index->set_forward_index_bytes(index->forward_index_bytes() + source.forward_index_bytes());
+        index->set_pending_purge(index->pending_purge() + source.pending_purge());
+        index->set_frozen_terms(index->frozen_terms() + source.frozen_terms());
+        index->set_delta_segments(index->delta_segments() + source.delta_segments());
+        index->set_delta_bytes(index->delta_bytes() + source.delta_bytes());
+
+        const fre::CacheStats& partitionCache = partition.cache();
+        cache->set_enabled(cache->enabled() || partitionCache.enabled());
+        cache->set_hits(cache->hits() + partitionCache.hits());
+        cache->set_misses(cache->misses() + partitionCache.misses());
+        cache->set_evictions(cache->evictions() + partitionCache.evictions());
+        cache->set_entries(cache->entries() + partitionCache.entries());
+        cache->set_bytes(cache->bytes() + partitionCache.bytes());
+        cache->set_capacity_bytes(cache->capacity_bytes() + partitionCache.capacity_bytes());
+    }
+    return grpc::Status::OK;
+}
+
+// Prints the same report as the server's stats command, with the partitions' counters summed
+void PartitionRouter::reportStats() {
+    fre::StatsRep stats;
+    grpc::Status status = collectStats(&stats);
+    if (!status.ok()) {
+        std::cerr << "Error: could not read the partition statistics: " << status.error_message() << std::endl;
+        return;
+    }
+    std::cout << "Partitions: " << partitions_.size() << std::endl;
+    ServerStats::print(stats);
+
+    const fre::CacheStats& cache = stats.cache();
+    if (!cache.enabled()) {
+        std::cout << "Result cache is disabled" << std::endl;
+        return;
+    }
+    uint64_t lookups = cache.hits() + cache.misses();
+    std::cout << "Result cache: " << cache.hits() << " hits, " << cache.misses() << " misses ("
+              << (lookups ? 100.0 * cache.hits() / lookups : 0.0) << "% hit rate), " << cache.entries() << " entries, "
+              << cache.bytes() << " of " << cache.capacity_bytes() << " bytes, " << cache.evictions() << " evictions"
+              << std::endl;
+}
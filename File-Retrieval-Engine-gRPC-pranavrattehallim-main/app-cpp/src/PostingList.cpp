@@ -0,0 +1,548 @@
+#include "PostingList.hpp"
+#include <algorithm> // For std::lower_bound, std::fill and std::max
+#include <array>     // For the table of unpackers
+#include <atomic>    // For std::atomic_thread_fence
+#include <utility>   // For std::index_sequence
+#include "IntersectionEngine.hpp" // For the block search kernel
+
+namespace {
+
+// Number of bits needed to store the value
+inline unsigned bitWidth(uint32_t value) {
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+// Appends count values of the given width to out, least significant bits first
+void packBits(const uint32_t* values, size_t count, unsigned bits, std::vector<uint32_t>& out) {
+    if (bits == 0) {
+        return; // Every value is zero; nothing to store
+    }
+    uint64_t buffer = 0;
+    unsigned filled = 0;
+    for (size_t i = 0; i < count; ++i) {
+        buffer |= static_cast<uint64_t>(values[i]) << filled;
+        filled += bits;
+        if (filled >= 32) {
+            out.push_back(static_cast<uint32_t>(buffer));
+            buffer >>= 32;
+            filled -= 32;
+        }
+    }
+    if (filled > 0) {
+        out.push_back(static_cast<uint32_t>(buffer));
+    }
+}
+
+// Reads count values of a fixed width; the constant width lets the compiler unroll the shifts and masks
+template <unsigned Bits>
+const uint32_t* unpackFixed(const uint32_t* in, size_t count, uint32_t* values) {
+    constexpr uint64_t mask = (uint64_t{1} << Bits) - 1;
+    uint64_t buffer = 0;
+    unsigned available = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (available < Bits) {
+            buffer |= static_cast<uint64_t>(*in++) << available;
+            available += 32;
+        }
+        values[i] = static_cast<uint32_t>(buffer & mask);
+        buffer >>= Bits;
+        available -= Bits;
+    }
+    return in;
+}
+
+// Table of unpackers indexed by bit width
+template <size_t... Widths>
+constexpr auto makeUnpackers(std::index_sequence<Widths...>) {
+    return std::array<const uint32_t* (*)(const uint32_t*, size_t, uint32_t*), sizeof...(Widths)>{
+        &unpackFixed<Widths + 1>...};
+}
+
+constexpr auto unpackers = makeUnpackers(std::make_index_sequence<32>());
+
+// Reads count values of the given width from in and returns the first word after them
+const uint32_t* unpackBits(const uint32_t* in, size_t count, unsigned bits, uint32_t* values) {
+    if (bits == 0) {
+        std::fill(values, values + count, 0u);
+        return in;
+    }
+    return unpackers[bits - 1](in, count, values);
+}
+
+} // namespace
+
+// Adds the frequency to the document's posting, keeping the list sorted by document number
+void PostingList::add(int documentNumber, int frequency) {
+    maxFrequency_ = std::max(maxFrequency_, frequency);
+
+    // Documents usually arrive in increasing order, so they land at the end of the tail
+    bool pastBlocks = blocks().empty() || documentNumber > blocks().back().lastDocument;
+    if (pastBlocks && (tailDocuments_.empty() || tailDocuments_.back() < documentNumber)) {
+        tailDocuments_.push_back(documentNumber);
+        tailFrequencies_.push_back(frequency);
+        ++count_;
+        if (tailDocuments_.size() == blockSize) {
+            freezeTail(); // The tail is full; compress it
+        }
+        return;
+    }
+
+    // Out-of-order arrival within the mutable tail
+    if (pastBlocks) {
+        auto position = std::lower_bound(tailDocuments_.begin(), tailDocuments_.end(), documentNumber);
+        size_t index = position - tailDocuments_.begin();
+        if (position != tailDocuments_.end() && *position == documentNumber) {
+            tailFrequencies_[index] += frequency; // Document already has a posting for this term
+            maxFrequency_ = std::max(maxFrequency_, tailFrequencies_[index]);
+        } else {
+            tailDocuments_.insert(position, documentNumber); // Out-of-order arrival from a concurrent indexer
+            tailFrequencies_.insert(tailFrequencies_.begin() + index, frequency);
+            ++count_;
+            if (tailDocuments_.size() == blockSize) {
+                freezeTail();
+            }
+        }
+        return;
+    }
+
+    // The document belongs in a frozen block: decode it, update it and encode it again
+    size_t block = std::lower_bound(blocks().begin(), blocks().end(), documentNumber,
+                                    [](const PostingBlock& b, int document) { return b.lastDocument < document; }) -
+                   blocks().begin();
+    std::vector<int> documents(blocks()[block].count), frequencies(blocks()[block].count);
+    decodeBlock(block, documents.data(), frequencies.data());
+
+    auto position = std::lower_bound(documents.begin(), documents.end(), documentNumber);
+    size_t index = position - documents.begin();
+    if (*position == documentNumber) {
+        frequencies[index] += frequency;
+        maxFrequency_ = std::max(maxFrequency_, frequencies[index]);
+    } else {
+        documents.insert(position, documentNumber);
+        frequencies.insert(frequencies.begin() + index, frequency);
+        ++count_;
+    }
+    rewriteBlock(block, documents.data(), frequencies.data(), documents.size());
+}
+
+const std::vector<PostingBlock>& PostingList::blocks() const {
+    static const std::vector<PostingBlock> none;
+    return frozen_ ? frozen_->blocks : none;
+}
+
+// Blocks are changed in place only when no copy of the list shares them. The shard lock the owner holds keeps new
+// copies from being made meanwhile, so a count of one cannot rise before the change is done.
+FrozenPostings& PostingList::ownFrozen() {
+    if (!frozen_) {
+        frozen_ = std::make_shared<FrozenPostings>();
+    } else if (frozen_.use_count() > 1) {
+        frozen_ = std::make_shared<FrozenPostings>(*frozen_); // Readers keep the version they copied
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire); // Orders the last reader's release before the change
+    }
+    return *frozen_;
+}
+
+// Postings from concurrent indexers land just before the end of the list, so usually only the last block or two
+// are rebuilt
+void PostingList::addSorted(const int* documents, const int* frequencies, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    size_t first = std::lower_bound(blocks().begin(), blocks().end(), documents[0],
+                                    [](const PostingBlock& b, int document) { return b.lastDocument < document; }) -
+                   blocks().begin();
+    if (first == blocks().size()) {
+        for (size_t i = 0; i < count; ++i) {
+            add(documents[i], frequencies[i]); // Past every frozen block: appended or inserted in the tail
+        }
+        return;
+    }
+
+    // Take the postings from the first affected block on out of the list, then append the merged run
+    std::vector<int> keptDocuments, keptFrequencies;
+    int blockDocuments[maxBlockSize];
+    int blockFrequencies[maxBlockSize];
+    for (size_t block = first; block < blocks().size(); ++block) {
+        decodeBlock(block, blockDocuments, blockFrequencies);
+        keptDocuments.insert(keptDocuments.end(), blockDocuments, blockDocuments + blocks()[block].count);
+        keptFrequencies.insert(keptFrequencies.end(), blockFrequencies, blockFrequencies + blocks()[block].count);
+    }
+    keptDocuments.insert(keptDocuments.end(), tailDocuments_.begin(), tailDocuments_.end());
+    keptFrequencies.insert(keptFrequencies.end(), tailFrequencies_.begin(), tailFrequencies_.end());
+    FrozenPostings& frozen = ownFrozen();
+    frozen.packed.resize(frozen.blocks[first].offset);
+    frozen.blocks.resize(first);
+    tailDocuments_.clear();
+    tailFrequencies_.clear();
+    count_ -= keptDocuments.size();
+
+    size_t i = 0, j = 0;
+    while (i < keptDocuments.size() || j < count) {
+        if (j == count || (i < keptDocuments.size() && keptDocuments[i] < documents[j])) {
+            add(keptDocuments[i], keptFrequencies[i]);
+            ++i;
+        } else if (i == keptDocuments.size() || documents[j] < keptDocuments[i]) {
+            add(documents[j], frequencies[j]);
+            ++j;
+        } else {
+            add(keptDocuments[i], keptFrequencies[i] + frequencies[j]);
+            ++i;
+            ++j;
+        }
+    }
+}
+
+// Walks the removed documents block by block. Gaps are encoded from the previous block's last document, so when a
+// rewrite changes that document the following block is re-encoded too, even if it loses nothing itself.
+size_t PostingList::remove(const std::vector<int>& documents) {
+    size_t before = count_;
+    size_t next = 0;            // First removed document not yet passed
+    size_t block = 0;           // Block being examined
+    bool rebase = false;        // Whether the block's gaps must be re-encoded from a new previous document
+    int encodedPrevious = -1;   // Document the block's first gap was encoded from
+    int blockDocuments[maxBlockSize];
+    int blockFrequencies[maxBlockSize];
+    while (block < blocks().size()) {
+        if (!rebase) {
+            if (next == documents.size()) {
+                break;
+            }
+            // Jump to the block that would hold the next removed document
+            block = std::lower_bound(blocks().begin() + block, blocks().end(), documents[next],
+                                     [](const PostingBlock& b, int document) { return b.lastDocument < document; }) -
+                    blocks().begin();
+            if (block == blocks().size()) {
+                break;
+            }
+            encodedPrevious = block == 0 ? -1 : blocks()[block - 1].lastDocument;
+        }
+
+        int lastDocument = blocks()[block].lastDocument;
+        size_t count = blocks()[block].count;
+        decodeBlock(block, encodedPrevious, blockDocuments, blockFrequencies);
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            while (next < documents.size() && documents[next] < blockDocuments[i]) {
+                ++next;
+            }
+            if (next < documents.size() && documents[next] == blockDocuments[i]) {
+                ++next;
+                continue; // Posting of a removed document
+            }
+            blockDocuments[kept] = blockDocuments[i];
+            blockFrequencies[kept] = blockFrequencies[i];
+            ++kept;
+        }
+        while (next < documents.size() && documents[next] <= lastDocument) {
+            ++next; // Removed documents with no posting in this block
+        }
+        if (kept == count && !rebase) {
+            ++block;
+            continue;
+        }
+
+        count_ -= count - kept;
+        encodedPrevious = lastDocument; // The following block's first gap still starts from the old last document
+        rewriteBlock(block, blockDocuments, blockFrequencies, kept);
+        rebase = kept == 0 || blockDocuments[kept - 1] != lastDocument;
+        if (kept > 0) {
+            ++block; // Removal only shrinks blocks, so there is no split to step over; an erased block's successor
+                     // now sits at the same index
+        }
+    }
+
+    // The tail holds absolute document numbers, so it is filtered in place
+    if (next < documents.size() && !tailDocuments_.empty()) {
+        size_t kept = 0;
+        for (size_t i = 0; i < tailDocuments_.size(); ++i) {
+            if (!std::binary_search(documents.begin() + next, documents.end(), tailDocuments_[i])) {
+                tailDocuments_[kept] = tailDocuments_[i];
+                tailFrequencies_[kept] = tailFrequencies_[i];
+                ++kept;
+            }
+        }
+        count_ -= tailDocuments_.size() - kept;
+        tailDocuments_.resize(kept);
+        tailFrequencies_.resize(kept);
+    }
+
+    // Tighten the list-wide bound from the blocks' own maxima
+    if (count_ != before) {
+        maxFrequency_ = 0;
+        for (const auto& metadata : blocks()) {
+            maxFrequency_ = std::max(maxFrequency_, metadata.maxFrequency);
+        }
+        for (int frequency : tailFrequencies_) {
+            maxFrequency_ = std::max(maxFrequency_, frequency);
+        }
+    }
+    return before - count_;
+}
+
+// Freezes whatever is in the tail and trims every array to its size
+void PostingList::compact() {
+    freezeTail();
+    if (frozen_) {
+        FrozenPostings& frozen = ownFrozen();
+        frozen.blocks.shrink_to_fit();
+        frozen.packed.shrink_to_fit();
+    }
+    tailDocuments_.shrink_to_fit();
+    tailFrequencies_.shrink_to_fit();
+}
+
+// Compresses the tail into a block appended after the last one
+void PostingList::freezeTail() {
+    if (tailDocuments_.empty()) {
+        return;
+    }
+    FrozenPostings& frozen = ownFrozen();
+    int previousDocument = frozen.blocks.empty() ? -1 : frozen.blocks.back().lastDocument;
+    frozen.blocks.push_back(encodeBlock(tailDocuments_.data(), tailFrequencies_.data(), tailDocuments_.size(),
+                                        previousDocument, frozen.packed));
+    tailDocuments_.clear(); // Capacity is kept for the next blockSize postings
+    tailFrequencies_.clear();
+}
+
+// Replaces a block's words with a fresh encoding, splitting the block in two if it has grown past maxBlockSize and
+// removing it if it is now empty
+void PostingList::rewriteBlock(size_t block, const int* documents, const int* frequencies, size_t count) {
+    FrozenPostings& frozen = ownFrozen();
+    int previousDocument = block == 0 ? -1 : frozen.blocks[block - 1].lastDocument;
+    std::vector<uint32_t> words;
+    std::vector<PostingBlock> replacement;
+    if (count == 0) {
+        // Nothing left to encode; the block's words are spliced out below
+    } else if (count <= maxBlockSize) {
+        replacement.push_back(encodeBlock(documents, frequencies, count, previousDocument, words));
+    } else {
+        size_t half = count / 2;
+        replacement.push_back(encodeBlock(documents, frequencies, half, previousDocument, words));
+        replacement.push_back(encodeBlock(documents + half, frequencies + half, count - half, documents[half - 1], words));
+    }
+
+    // Splice the new words over the old ones and shift the offsets of the blocks after them
+    uint32_t begin = frozen.blocks[block].offset;
+    uint32_t end = block + 1 < frozen.blocks.size() ? frozen.blocks[block + 1].offset : static_cast<uint32_t>(frozen.packed.size());
+    int64_t shift = static_cast<int64_t>(words.size()) - static_cast<int64_t>(end - begin);
+    frozen.packed.erase(frozen.packed.begin() + begin, frozen.packed.begin() + end);
+    frozen.packed.insert(frozen.packed.begin() + begin, words.begin(), words.end());
+    for (size_t later = block + 1; later < frozen.blocks.size(); ++later) {
+        frozen.blocks[later].offset = static_cast<uint32_t>(frozen.blocks[later].offset + shift);
+    }
+    for (auto& replaced : replacement) {
+        replaced.offset += begin;
+    }
+    if (replacement.empty()) {
+        frozen.blocks.erase(frozen.blocks.begin() + block);
+        return;
+    }
+    frozen.blocks[block] = replacement[0];
+    if (replacement.size() > 1) {
+        frozen.blocks.insert(frozen.blocks.begin() + block + 1, replacement[1]);
+    }
+}
+
+// Stores the gaps between consecutive documents (minus one) and the frequencies, each at its block-wide bit width
+PostingBlock PostingList::encodeBlock(const int* documents, const int* frequencies, size_t count, int previousDocument,
+                                      std::vector<uint32_t>& out) {
+    uint32_t gaps[maxBlockSize];
+    uint32_t maxGap = 0;
+    uint32_t frequencyMask = 0;
+    int maxFrequency = frequencies[0];
+    for (size_t i = 0; i < count; ++i) {
+        gaps[i] = static_cast<uint32_t>(documents[i] - previousDocument - 1); // Sorted and distinct, so never negative
+        previousDocument = documents[i];
+        maxGap = std::max(maxGap, gaps[i]);
+        frequencyMask |= static_cast<uint32_t>(frequencies[i]);
+        maxFrequency = std::max(maxFrequency, frequencies[i]);
+    }
+
+    PostingBlock block;
+    block.lastDocument = documents[count - 1];
+    block.maxFrequency = maxFrequency;
+    block.offset = static_cast<uint32_t>(out.size());
+    block.count = static_cast<uint16_t>(count);
+    block.documentBits = static_cast<uint8_t>(bitWidth(maxGap));
+    block.frequencyBits = static_cast<uint8_t>(bitWidth(frequencyMask));
+    packBits(gaps, count, block.documentBits, out);
+    packBits(reinterpret_cast<const uint32_t*>(frequencies), count, block.frequencyBits, out);
+    return block;
+}
+
+// Unpacks a block and turns its gaps back into document numbers
+void PostingList::decodeBlock(size_t block, int* documents, int* frequencies) const {
+    decodeBlock(block, block == 0 ? -1 : blocks()[block - 1].lastDocument, documents, frequencies);
+}
+
+// Unpacks a block whose first gap counts from previousDocument
+void PostingList::decodeBlock(size_t block, int previousDocument, int* documents, int* frequencies) const {
+    const PostingBlock& metadata = blocks()[block];
+    const uint32_t* words = packed().data() + metadata.offset;
+    words = unpackBits(words, metadata.count, metadata.documentBits, reinterpret_cast<uint32_t*>(documents));
+    unpackBits(words, metadata.count, metadata.frequencyBits, reinterpret_cast<uint32_t*>(frequencies));
+
+    int document = previousDocument;
+    for (size_t i = 0; i < metadata.count; ++i) {
+        document += documents[i] + 1;
+        documents[i] = document;
+    }
+}
+
+// Returns an iterator positioned at the first posting
+PostingIterator PostingList::begin() const {
+    return PostingIterator(*this);
+}
+
+// Keeps a view of the stored postings; the snapshot stays mapped for as long as the store that looked them up
+void PostingList::setStored(const PostingView& stored, int maxFrequency) {
+    stored_ = stored;
+    storedMaxFrequency_ = maxFrequency;
+}
+
+// Copies the stored postings, decodes every block, then copies the tail
+void PostingList::decode(std::vector<int>& documents, std::vector<int>& frequencies) const {
+    documents.insert(documents.end(), stored_.documents, stored_.documents + stored_.size);
+    frequencies.insert(frequencies.end(), stored_.frequencies, stored_.frequencies + stored_.size);
+    int blockDocuments[maxBlockSize];
+    int blockFrequencies[maxBlockSize];
+    for (size_t block = 0; block < blocks().size(); ++block) {
+        decodeBlock(block, blockDocuments, blockFrequencies);
+        documents.insert(documents.end(), blockDocuments, blockDocuments + blocks()[block].count);
+        frequencies.insert(frequencies.end(), blockFrequencies, blockFrequencies + blocks()[block].count);
+    }
+    documents.insert(documents.end(), tailDocuments_.begin(), tailDocuments_.end());
+    frequencies.insert(frequencies.end(), tailFrequencies_.begin(), tailFrequencies_.end());
+}
+
+// Bytes held by the block table, the packed words and the tail
+size_t PostingList::memoryBytes() const {
+    size_t bytes = (tailDocuments_.capacity() + tailFrequencies_.capacity()) * sizeof(int);
+    if (frozen_) {
+        bytes += frozen_->blocks.capacity() * sizeof(PostingBlock) + frozen_->packed.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+// Constructor loads the first stored chunk or block (or points at the tail when there is neither)
+PostingIterator::PostingIterator(const PostingList& list)
+    : list_(&list), blocks_(&list.blocks()),
+      storedChunks_((list.stored_.size + PostingList::blockSize - 1) / PostingList::blockSize),
+      tailBlock_(storedChunks_ + blocks_->size()), block_(0) {
+    for (int frequency : list.tailFrequencies_) {
+        tailMaxFrequency_ = std::max(tailMaxFrequency_, frequency);
+    }
+    load(0);
+}
+
+// Postings in a stored chunk; only the last one may be short
+size_t PostingIterator::chunkSize(size_t chunk) const {
+    return std::min(PostingList::blockSize, list_->stored_.size - chunk * PostingList::blockSize);
+}
+
+// Stored chunks carry no block header, so their largest frequency is read off the mapped frequencies
+int PostingIterator::chunkMaxFrequency(size_t chunk) const {
+    const int* frequencies = list_->stored_.frequencies + chunk * PostingList::blockSize;
+    return *std::max_element(frequencies, frequencies + chunkSize(chunk));
+}
+
+// A stored chunk's last document is read from the mapping, a frozen block's from its header
+int PostingIterator::lastDocument(size_t block) const {
+    if (block < storedChunks_) {
+        return list_->stored_.documents[block * PostingList::blockSize + chunkSize(block) - 1];
+    }
+    return (*blocks_)[block - storedChunks_].lastDocument;
+}
+
+// Points at a stored chunk, decodes a frozen block, or switches to the tail
+void PostingIterator::load(size_t block) {
+    block_ = block;
+    shallowBlock_ = std::max(shallowBlock_, block_);
+    position_ = 0;
+    if (block_ < storedChunks_) {
+        size_ = chunkSize(block_);
+        blockMaxFrequency_ = chunkMaxFrequency(block_);
+    } else if (block_ < tailBlock_) {
+        list_->decodeBlock(block_ - storedChunks_, decodedDocuments_, decodedFrequencies_);
+        size_ = (*blocks_)[block_ - storedChunks_].count;
+        blockMaxFrequency_ = (*blocks_)[block_ - storedChunks_].maxFrequency;
+    } else {
+        size_ = list_->tailDocuments_.size();
+        blockMaxFrequency_ = tailMaxFrequency_;
+    }
+}
+
+// Skips the rest of the current block
+void PostingIterator::nextBlock() {
+    if (block_ < tailBlock_) {
+        load(block_ + 1);
+    } else {
+        position_ = size_; // The tail was the last block
+    }
+}
+
+// Walks the chunks and block table forward to the block that would hold target and returns its largest frequency
+int PostingIterator::maxFrequencyAt(int target) {
+    while (shallowBlock_ < tailBlock_ && lastDocument(shallowBlock_) < target) {
+        ++shallowBlock_; // Targets only move forward, so the walk is amortized over the whole query
+    }
+    if (shallowBlock_ == block_ && block_ < tailBlock_) {
+        return blockMaxFrequency_;
+    }
+    if (shallowBlock_ < storedChunks_) {
+        if (shallowChunk_ != shallowBlock_) {
+            shallowChunk_ = shallowBlock_; // Read once per chunk, however many targets fall in it
+            shallowChunkMax_ = chunkMaxFrequency(shallowChunk_);
+        }
+        return shallowChunkMax_;
+    }
+    if (shallowBlock_ < tailBlock_) {
+        return (*blocks_)[shallowBlock_ - storedChunks_].maxFrequency;
+    }
+    const std::vector<int>& tail = list_->tailDocuments_;
+    if (tail.empty() || tail.back() < target) {
+        return -1; // Nothing at or after target
+    }
+    return tailMaxFrequency_;
+}
+
+// Moves to the next posting, loading the next chunk or block when the current one is used up
+void PostingIterator::next() {
+    ++position_;
+    if (position_ == size_ && block_ < tailBlock_) {
+        load(block_ + 1);
+    }
+}
+
+// Skips whole chunks and blocks whose last document is below the target, then searches inside the one the target
+// falls in
+void PostingIterator::advance(int target) {
+    if (atEnd() || document() >= target) {
+        return; // Already positioned at or past the target
+    }
+
+    if (block_ < tailBlock_ && lastDocument(block_) < target) {
+        // Gallop over the chunks and block table to bracket the target, then binary search the bracket
+        size_t low = block_ + 1;
+        size_t step = 1;
+        size_t high = low;
+        while (high < tailBlock_ && lastDocument(high) < target) {
+            low = high + 1;
+            step <<= 1;
+            high = block_ + step;
+        }
+        high = std::min(high, tailBlock_);
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (lastDocument(middle) < target) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        load(low); // Only the block holding the target is decoded
+    }
+
+    position_ = IntersectionEngine::advanceTo(documents(), size_, position_, target);
+}
@@ -0,0 +1,242 @@
+#include "ReplicaFollower.hpp"
+#include "WriteAheadLog.hpp" // For decoding the primary's records
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// Times a replica starts over because the primary dropped the updates after the snapshot it downloaded
+constexpr int maxBootstrapAttempts = 3;
+
+// Pause before reopening a lost update stream
+constexpr std::chrono::seconds reconnectDelay{1};
+
+// Current time as steady_clock ticks, for the atomic caught-up timestamp
+int64_t steadyTicks() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+} // namespace
+
+// Opens the channel; batches of a whole indexing stream can exceed gRPC's default message size
+ReplicaFollower::ReplicaFollower(const std::string& primaryAddress) : primaryAddress_(primaryAddress) {
+    grpc::ChannelArguments channelArgs;
+    channelArgs.SetMaxReceiveMessageSize(INT_MAX);
+    stub_ = fre::FileRetrievalEngine::NewStub(
+        grpc::CreateCustomChannel(primaryAddress, grpc::InsecureChannelCredentials(), channelArgs));
+}
+
+// Stops the thread before the stub goes away
+ReplicaFollower::~ReplicaFollower() {
+    stop();
+}
+
+// Downloads, maps, then subscribes; a checkpoint on the primary between the download and the subscription drops
+// the updates the snapshot lacks, in which case the newer snapshot is fetched
+std::shared_ptr<IndexStore> ReplicaFollower::bootstrap(const std::string& snapshotPath, std::string& error) {
+    caughtUpAt_.store(steadyTicks(), std::memory_order_release); // The snapshot is current as the download starts
+    for (int attempt = 0; attempt < maxBootstrapAttempts; ++attempt) {
+        bool found = false;
+        if (!downloadSnapshot(snapshotPath, found, error)) {
+            return nullptr;
+        }
+        auto store = std::make_shared<IndexStore>();
+        if (found && !store->loadSnapshot(snapshotPath, error)) {
+            return nullptr;
+        }
+        store_ = store;
+        appliedSequence_.store(store->snapshotLogSequence(), std::memory_order_release);
+
+        grpc::Status status = openStream();
+        if (status.ok()) {
+            return store;
+        }
+        if (status.error_code() != grpc::OUT_OF_RANGE) {
+            error = "cannot follow " + primaryAddress_ + ": " + status.error_message();
+            return nullptr;
+        }
+    }
+    error = primaryAddress_ + " kept dropping the updates after its snapshot; is it checkpointing continuously?";
+    return nullptr;
+}
+
+// Writes the chunks to a temporary file and renames it into place once complete
+bool ReplicaFollower::downloadSnapshot(const std::string& path, bool& found, std::string& error) {
+    std::string temporaryPath = path + ".download";
+    grpc::ClientContext context;
+    std::unique_ptr<grpc::ClientReader<fre::SnapshotChunk>> reader = stub_->GetSnapshot(&context, fre::SnapshotReq());
+    std::ofstream out;
+    fre::SnapshotChunk chunk;
+    found = false;
+    while (reader->Read(&chunk)) {
+        if (!found) {
+            out.open(temporaryPath, std::ios::binary | std::ios::trunc);
+            found = true;
+        }
+        out.write(chunk.data().data(), static_cast<std::streamsize>(chunk.data().size()));
+    }
+    grpc::Status status = reader->Finish();
+    if (!status.ok()) {
+        error = "cannot download the snapshot of " + primaryAddress_ + ": " + status.error_message();
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    if (!found) {
+        return true; // The primary has not saved a snapshot; its update stream starts from the beginning
+    }
+    out.close();
+    if (!out || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        error = "cannot write the snapshot to " + path;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// The primary answers a subscription with a heartbeat, so a refused one fails here rather than in the thread
+grpc::Status ReplicaFollower::openStream() {
+    fre::ReplicateReq request;
+    request.set_after_sequence(appliedSequence_.load(std::memory_order_acquire));
+    grpc::ClientContext* context;
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        context_ = std::make_unique<grpc::ClientContext>();
+        context = context_.get();
+    }
+    stream_ = stub_->Replicate(context, request);
+
+    fre::ReplicationBatch heartbeat;
+    if (!stream_->Read(&heartbeat)) {
+        grpc::Status status = stream_->Finish();
+        stream_.reset();
+        return status;
+    }
+    connected_.store(true, std::memory_order_release);
+    notePrimary(heartbeat.primary_sequence());
+    return grpc::Status::OK;
+}
+
+// Starts applying updates
+void ReplicaFollower::start() {
+    stopping_.store(false, std::memory_order_release);
+    thread_ = std::thread(&ReplicaFollower::followLoop, this);
+}
+
+// Cancels the open stream so the thread's blocking read returns
+void ReplicaFollower::stop() {
+    stopping_.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(streamMutex_);
+        if (context_) {
+            context_->TryCancel();
+        }
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+// Applies batches until the stream ends, then reopens it after the last update applied
+void ReplicaFollower::followLoop() {
+    while (!stopping_.load(std::memory_order_acquire)) {
+        if (!stream_) {
+            grpc::Status status = openStream();
+            if (!status.ok()) {
+                if (status.error_code() == grpc::OUT_OF_RANGE) {
+                    // The primary checkpointed past us while we were away; only a new bootstrap can catch up
+                    std::cerr << "Error: " << primaryAddress_ << " no longer has the updates after sequence "
+                              << appliedSequence_.load() << "; restart the replica to bootstrap again" << std::endl;
+                    return;
+                }
+                std::this_thread::sleep_for(reconnectDelay);
+                continue;
+            }
+        }
+
+        fre::ReplicationBatch batch;
+        bool applied = true;
+        while (stream_->Read(&batch)) {
+            if (!applyBatch(batch)) {
+                applied = false;
+                break;
+            }
+            notePrimary(batch.primary_sequence());
+        }
+        connected_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(streamMutex_);
+            context_->TryCancel(); // Ends the stream if the batch was rejected; harmless otherwise
+        }
+        grpc::Status status = stream_->Finish();
+        stream_.reset();
+        if (stopping_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::cerr << "Replication stream from " << primaryAddress_ << " lost ("
+                  << (applied ? status.error_message() : "malformed batch") << "); reconnecting" << std::endl;
+        std::this_thread::sleep_for(reconnectDelay);
+    }
+}
+
+// Groups consecutive indexing records into one batch update; a deletion applies the group before it first so
+// the order of operations on a document is kept
+bool ReplicaFollower::applyBatch(const fre::ReplicationBatch& batch) {
+    if (batch.records().empty()) {
+        return true; // Heartbeat
+    }
+    std::vector<LogRecord> records;
+    if (!WriteAheadLog::decodeRecords(batch.records(), batch.first_sequence(), records) || records.empty() ||
+        records.back().sequence != batch.last_sequence()) {
+        return false;
+    }
+
+    uint64_t applied = appliedSequence_.load(std::memory_order_acquire);
+    std::vector<IndexStore::DocumentTerms> documents;
+    std::vector<int> replaced; // Earlier versions of the documents, searchable until their replacements are
+    auto applyDocuments = [&]() {
+        if (!documents.empty()) {
+            store_->updateIndexBatch(documents);
+            store_->retireDocuments(replaced);
+            documents.clear();
+            replaced.clear();
+        }
+    };
+    for (auto& record : records) {
+        if (record.sequence <= applied) {
+            continue; // Already in the snapshot or applied before a reconnect
+        }
+        if (record.deleted) {
+            applyDocuments();
+            store_->deleteDocuments(record.clientID, {record.documentPath});
+        } else {
+            int documentNumber = store_->putDocument(record.clientID, record.documentPath, &replaced);
+            documents.emplace_back(documentNumber, std::move(record.termFrequencies));
+        }
+    }
+    applyDocuments();
+    appliedSequence_.store(std::max(applied, batch.last_sequence()), std::memory_order_release);
+    return true;
+}
+
+// A replica is caught up when it has applied everything the primary reported
+void ReplicaFollower::notePrimary(uint64_t primarySequence) {
+    primarySequence_.store(primarySequence, std::memory_order_release);
+    if (appliedSequence_.load(std::memory_order_acquire) >= primarySequence) {
+        caughtUpAt_.store(steadyTicks(), std::memory_order_release);
+    }
+}
+
+// Lag in seconds counts from the last time the replica was caught up
+ReplicationLag ReplicaFollower::lag() const {
+    ReplicationLag lag;
+    lag.connected = connected_.load(std::memory_order_acquire);
+    lag.appliedSequence = appliedSequence_.load(std::memory_order_acquire);
+    lag.primarySequence = primarySequence_.load(std::memory_order_acquire);
+    if (!lag.connected || lag.appliedSequence < lag.primarySequence) {
+        std::chrono::steady_clock::duration behind(steadyTicks() - caughtUpAt_.load(std::memory_order_acquire));
+        lag.seconds = std::chrono::duration<double>(behind).count();
+    }
+    return lag;
+}
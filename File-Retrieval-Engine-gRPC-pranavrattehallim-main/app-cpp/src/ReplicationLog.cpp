@@ -0,0 +1,125 @@
+#include "ReplicationLog.hpp"
+#include <algorithm>
+
+// Nothing is held yet; updates up to lastSequence are in the snapshot
+ReplicationLog::ReplicationLog(uint64_t lastSequence)
+    : publishedSequence_(lastSequence), droppedSequence_(lastSequence), trimSequence_(lastSequence) {}
+
+// Appends in order, parking early arrivals until the records before them show up
+uint64_t ReplicationLog::publish(const std::string& records, size_t count, uint64_t lastSequence) {
+    if (count == 0) {
+        return lastSequence;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (lastSequence == 0) {
+            lastSequence = publishedSequence_ + count;
+        }
+        uint64_t firstSequence = lastSequence - count + 1;
+        bytes_ += records.size();
+        if (firstSequence != publishedSequence_ + 1) {
+            pending_.emplace(firstSequence, Entry{firstSequence, lastSequence, records});
+            return lastSequence; // A concurrent append with earlier numbers has not published yet
+        }
+        entries_.push_back({firstSequence, lastSequence, records});
+        publishedSequence_ = lastSequence;
+        for (auto next = pending_.begin(); next != pending_.end() && next->first == publishedSequence_ + 1;
+             next = pending_.erase(next)) {
+            publishedSequence_ = next->second.lastSequence;
+            entries_.push_back(std::move(next->second));
+        }
+    }
+    publishedCv_.notify_all();
+    return lastSequence;
+}
+
+// Returns the last update readers can see
+uint64_t ReplicationLog::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return publishedSequence_;
+}
+
+// Raises the trim point; entries go once the slowest reader is past them
+void ReplicationLog::trim(uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trimSequence_ = std::max(trimSequence_, std::min(sequence, publishedSequence_));
+    trimLocked();
+}
+
+// Drops whole entries up to the trim point and the slowest reader's position
+void ReplicationLog::trimLocked() {
+    uint64_t limit = trimSequence_;
+    for (const auto& [subscriber, position] : readers_) {
+        limit = std::min(limit, position);
+    }
+    while (!entries_.empty() && entries_.front().lastSequence <= limit) {
+        droppedSequence_ = entries_.front().lastSequence;
+        bytes_ -= entries_.front().records.size();
+        entries_.pop_front();
+    }
+}
+
+// A replica can start anywhere between the oldest record held and the newest one
+bool ReplicationLog::subscribe(uint64_t afterSequence, uint64_t& subscriber) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (afterSequence < droppedSequence_ || afterSequence > publishedSequence_) {
+        return false;
+    }
+    subscriber = nextSubscriber_++;
+    readers_[subscriber] = afterSequence;
+    return true;
+}
+
+// Removes the reader and drops whatever only it was holding back
+void ReplicationLog::unsubscribe(uint64_t subscriber) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    readers_.erase(subscriber);
+    trimLocked();
+}
+
+// Copies the entries after the reader's position; the first one may start before it if the reader subscribed
+// in the middle of an entry, and the replica skips the records it already has
+ReplicationLog::ReadResult ReplicationLog::read(uint64_t subscriber, size_t maxBytes,
+                                                std::chrono::milliseconds timeout, ReplicationUpdates& updates) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t& position = readers_[subscriber];
+    if (!publishedCv_.wait_for(lock, timeout, [&]() { return closed_ || publishedSequence_ > position; })) {
+        return ReadResult::Timeout;
+    }
+    if (closed_) {
+        return ReadResult::Closed;
+    }
+
+    // Entries are in order, so the first one still needed is found by binary search
+    auto entry = std::partition_point(entries_.begin(), entries_.end(),
+                                      [&](const Entry& candidate) { return candidate.lastSequence <= position; });
+    updates.records.clear();
+    updates.firstSequence = entry->firstSequence;
+    for (; entry != entries_.end() && (updates.records.empty() || updates.records.size() + entry->records.size() <= maxBytes);
+         ++entry) {
+        updates.records.append(entry->records);
+        updates.lastSequence = entry->lastSequence;
+    }
+    position = updates.lastSequence;
+    trimLocked();
+    return ReadResult::Records;
+}
+
+// Releases every waiting reader
+void ReplicationLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    publishedCv_.notify_all();
+}
+
+// Reads the counters under the lock
+ReplicationLogStats ReplicationLog::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ReplicationLogStats stats;
+    stats.lastSequence = publishedSequence_;
+    stats.bytes = bytes_;
+    stats.subscribers = readers_.size();
+    return stats;
+}
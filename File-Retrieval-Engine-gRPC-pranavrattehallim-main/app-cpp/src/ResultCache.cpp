@@ -0,0 +1,87 @@
+#include "ResultCache.hpp"
+#include <algorithm> // For std::sort
+
+// Constructor sets the memory budget
+ResultCache::ResultCache(size_t capacityBytes) : capacityBytes_(capacityBytes) {}
+
+// Joins the sorted terms with NUL separators, which cannot occur inside a term, and appends K and the cap
+std::string ResultCache::makeKey(std::vector<std::string> terms, size_t topK, size_t maxExpansions) {
+    std::sort(terms.begin(), terms.end());
+    std::string key;
+    for (const auto& term : terms) {
+        key += term;
+        key += '\0';
+    }
+    key += std::to_string(topK);
+    key += '/';
+    key += std::to_string(maxExpansions);
+    return key;
+}
+
+// Estimates the heap bytes of an entry: key (stored twice, in the map and the LRU list), result strings and nodes
+size_t ResultCache::entryBytes(const std::string& key, const CachedSearch& result) {
+    size_t bytes = 2 * (sizeof(std::string) + key.size()) + sizeof(Entry) + 4 * sizeof(void*);
+    for (const auto& [documentKey, frequency] : result.results) {
+        bytes += sizeof(std::pair<std::string, int>) + documentKey.size();
+    }
+    return bytes;
+}
+
+// Returns a copy of a current entry and marks it most recently used
+bool ResultCache::lookup(const std::string& key, uint64_t generation, CachedSearch& result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = entries_.find(key);
+    if (entry == entries_.end() || entry->second.generation != generation) {
+        ++misses_; // A stale entry stays until insert() replaces it or it ages out
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, entry->second.lru); // Move to the front without reallocating the key
+    result = entry->second.search;
+    ++hits_;
+    return true;
+}
+
+// Stores a result, replacing an older entry for the same key and evicting from the LRU end to stay in budget
+void ResultCache::insert(const std::string& key, uint64_t generation, const CachedSearch& result) {
+    size_t bytes = entryBytes(key, result);
+    if (bytes > capacityBytes_) {
+        return; // Would never fit; also covers a zero budget
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto existing = entries_.find(key);
+    if (existing != entries_.end()) {
+        if (existing->second.generation > generation) {
+            return; // A concurrent search already stored a newer answer
+        }
+        eraseLocked(existing);
+    }
+    while (bytes_ + bytes > capacityBytes_ && !lru_.empty()) {
+        eraseLocked(entries_.find(lru_.back()));
+        ++evictions_;
+    }
+
+    lru_.push_front(key);
+    entries_.emplace(key, Entry{generation, result, bytes, lru_.begin()});
+    bytes_ += bytes;
+}
+
+// Removes an entry and its LRU position
+void ResultCache::eraseLocked(std::unordered_map<std::string, Entry>::iterator entry) {
+    bytes_ -= entry->second.bytes;
+    lru_.erase(entry->second.lru);
+    entries_.erase(entry);
+}
+
+// Returns a consistent copy of the counters
+ResultCacheStats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ResultCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.entries = entries_.size();
+    stats.bytes = bytes_;
+    stats.capacityBytes = capacityBytes_;
+    return stats;
+}
@@ -0,0 +1,104 @@
+#include "SearchCursorStore.hpp"
+#include <charconv> // For parsing cursors
+#include <cstdio>   // For std::snprintf
+
+// Constructor sets the budget and the time to live, and seeds the ID generator
+SearchCursorStore::SearchCursorStore(size_t capacityBytes, std::chrono::steady_clock::duration timeToLive)
+    : capacityBytes_(capacityBytes), timeToLive_(timeToLive), random_(std::random_device{}()) {}
+
+// Sweeps expired sets first, then evicts from the LRU end until the new set fits
+uint64_t SearchCursorStore::open(std::shared_ptr<const RankedSearch> search) {
+    size_t bytes = sizeof(RankedSearch) + sizeof(Entry) + 4 * sizeof(void*) +
+                   search->matches.capacity() * sizeof(search->matches[0]);
+    if (bytes > capacityBytes_) {
+        return 0; // Would never fit; also covers a zero budget
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    expireLocked(now);
+    while (bytes_ + bytes > capacityBytes_ && !lru_.empty()) {
+        eraseLocked(entries_.find(lru_.back()));
+        ++counters_.evicted;
+    }
+
+    uint64_t id = 0;
+    while (id == 0 || entries_.count(id) > 0) {
+        id = random_();
+    }
+    lru_.push_front(id);
+    entries_.emplace(id, Entry{std::move(search), bytes, now + timeToLive_, lru_.begin()});
+    bytes_ += bytes;
+    ++counters_.opened;
+    return id;
+}
+
+// A set past its expiry that no open() has swept yet counts as dropped
+std::shared_ptr<const RankedSearch> SearchCursorStore::resume(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    auto entry = entries_.find(id);
+    if (entry != entries_.end() && entry->second.expires <= now) {
+        eraseLocked(entry);
+        ++counters_.expired;
+        entry = entries_.end();
+    }
+    if (entry == entries_.end()) {
+        ++counters_.missing;
+        return nullptr;
+    }
+    entry->second.expires = now + timeToLive_;
+    lru_.splice(lru_.begin(), lru_, entry->second.lru);
+    ++counters_.resumed;
+    return entry->second.search;
+}
+
+// Sixteen hex digits of ID, a colon and the offset in decimal
+std::string SearchCursorStore::makeCursor(uint64_t id, size_t offset) {
+    char cursor[48];
+    std::snprintf(cursor, sizeof(cursor), "%016llx:%zu", static_cast<unsigned long long>(id), offset);
+    return cursor;
+}
+
+// Accepts exactly what makeCursor produces
+bool SearchCursorStore::parseCursor(const std::string& cursor, uint64_t& id, size_t& offset) {
+    const char* end = cursor.data() + cursor.size();
+    if (cursor.size() < 18 || cursor[16] != ':') {
+        return false;
+    }
+    auto idParse = std::from_chars(cursor.data(), cursor.data() + 16, id, 16);
+    auto offsetParse = std::from_chars(cursor.data() + 17, end, offset);
+    return idParse.ec == std::errc() && idParse.ptr == cursor.data() + 16 && offsetParse.ec == std::errc() &&
+           offsetParse.ptr == end && id != 0;
+}
+
+// Returns a consistent copy of the counters, without the sets no cursor can reach any more
+SearchCursorStats SearchCursorStore::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    expireLocked(std::chrono::steady_clock::now());
+    SearchCursorStats stats = counters_;
+    stats.resultSets = entries_.size();
+    stats.bytes = bytes_;
+    stats.capacityBytes = capacityBytes_;
+    return stats;
+}
+
+// Every use moves a set to the front and sets its expiry to now plus the same time to live, so the back of the
+// list expires first
+void SearchCursorStore::expireLocked(std::chrono::steady_clock::time_point now) {
+    while (!lru_.empty()) {
+        auto entry = entries_.find(lru_.back());
+        if (entry->second.expires > now) {
+            break;
+        }
+        eraseLocked(entry);
+        ++counters_.expired;
+    }
+}
+
+// Removes an entry and its LRU position
+void SearchCursorStore::eraseLocked(std::unordered_map<uint64_t, Entry>::iterator entry) {
+    bytes_ -= entry->second.bytes;
+    lru_.erase(entry->second.lru);
+    entries_.erase(entry);
+}
@@ -0,0 +1,76 @@
+#include "SearchWorkerPool.hpp"
+
+SearchWorkerPool::SearchWorkerPool(size_t threads) {
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back(&SearchWorkerPool::workerLoop, this);
+    }
+}
+
+SearchWorkerPool::~SearchWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    available_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+// Items are claimed with one atomic increment each, so the threads sharing a job never wait on each other
+void SearchWorkerPool::work(Job& job) {
+    for (size_t item = job.next.fetch_add(1); item < job.count; item = job.next.fetch_add(1)) {
+        (*job.task)(item);
+        if (job.done.fetch_add(1) + 1 == job.count) {
+            std::lock_guard<std::mutex> lock(job.mutex); // The caller checks done under this lock before waiting
+            job.finished.notify_all();
+        }
+    }
+}
+
+// The job is queued for the workers, and the caller works on it like one of them; it leaves the queue as soon as
+// its last item has been handed out, whoever takes it
+void SearchWorkerPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    auto job = std::make_shared<Job>();
+    job->task = &task;
+    job->count = count;
+    if (!threads_.empty() && count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+        }
+        if (count == 2) {
+            available_.notify_one();
+        } else {
+            available_.notify_all();
+        }
+    }
+    work(*job);
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&]() { return job->done.load() == count; });
+}
+
+// A worker holds a reference to its job, so the job outlives the last item even if its caller has already left
+void SearchWorkerPool::workerLoop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            available_.wait(lock, [&]() {
+                while (!jobs_.empty() && jobs_.front()->next.load() >= jobs_.front()->count) {
+                    jobs_.pop_front(); // Every item handed out already
+                }
+                return stopping_ || !jobs_.empty();
+            });
+            if (stopping_) {
+                return;
+            }
+            job = jobs_.front();
+        }
+        work(*job);
+    }
+}
@@ -19,8 +19,17 @@ void ServerAppInterface::run() {
             if (command == "quit" || command == "exit") {
                 std::cout << "Shutting down the server..." << std::endl;
                 serverEngine.shutdown(); // Call shutdown on the server engine to stop the gRPC server
+                serverEngine.saveSnapshot(); // Persist the index once no more updates can arrive
                 std::cout << "Server application exited." << std::endl;
                 exit(0);  // Safely exit the application after shutdown
+            } else if (command == "snapshot") {
+                serverEngine.saveSnapshot(); // Persist the index without stopping the server
+            } else if (command == "cache") {
+                serverEngine.reportCacheStats(); // Show how often searches were answered from the cache
+            } else if (command == "compact") {
+                serverEngine.compactIndex(); // Freeze the term dictionary once the index is mostly static
+            } else if (command == "stats") {
+                serverEngine.reportStats(); // Show RPC latencies, lock waits, index size and cache counters
             } else {
                 std::cout << "Invalid command. Please try again." << std::endl; // Handle invalid input
             }
@@ -38,6 +47,10 @@ void ServerAppInterface::run() {
 // Display available menu options to the user
 void ServerAppInterface::showMenu() {
     std::cout << "\n=== Server Command Menu ===" << std::endl; // Header for the menu
-    std::cout << "1. quit/exit - Exit the server application" << std::endl; // Option to quit
+    std::cout << "1. snapshot - Save the index to the snapshot file" << std::endl; // Option to save the index
+    std::cout << "2. cache - Show result cache hits, misses and memory use" << std::endl; // Option to inspect the cache
+    std::cout << "3. stats - Show RPC latencies, lock waits, index size and memory" << std::endl; // Option to inspect the server
+    std::cout << "4. compact - Compress posting lists and freeze the term dictionary" << std::endl; // Option to compact the index
+    std::cout << "5. quit/exit - Save the index and exit the server application" << std::endl; // Option to quit
 }
 
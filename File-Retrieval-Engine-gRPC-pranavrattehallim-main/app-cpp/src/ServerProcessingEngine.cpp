@@ -9,6 +9,7 @@
 #include <string> // Include for std::string
 #include <memory> // Include for std::shared_ptr
 #include <mutex>  // Include for std::mutex to protect client list
+#include <climits> // Include for INT_MAX, the receive size limit
 
 // Vector to maintain connected clients
 std::vector<ClientConnection> connectedClients;
@@ -16,21 +17,115 @@ std::mutex clientsMutex; // Mutex for thread-safe access to connected clients
 
 // Constructor: initializes the IndexStore and FileRetrievalEngineImpl
 ServerProcessingEngine::ServerProcessingEngine(std::shared_ptr<IndexStore> store)
-    : store(std::move(store)), fileRetrievalEngineImpl(std::make_shared<FileRetrievalEngineImpl>(this->store)) {
-    // Initialize FileRetrievalEngineImpl with the shared IndexStore
+    : store(std::move(store)), fileRetrievalEngineImpl(std::make_shared<FileRetrievalEngineImpl>(this->store)),
+      clientCount(this->store->highestClientID()) {
+    // Initialize FileRetrievalEngineImpl with the shared IndexStore; client IDs continue after those in a loaded snapshot
 }
 
 // Starts the gRPC server in a separate thread
 void ServerProcessingEngine::initialize(int serverPort) {
+    serverAddress = "localhost:" + std::to_string(serverPort); // Set before any client can connect
     serverThread = std::thread(&ServerProcessingEngine::rungRPCServer, this, serverPort);
 }
 
 // Generates a unique client ID as a simple numeric string
 std::string ServerProcessingEngine::generateUniqueClientID() {
-    static int clientCount = 0; // Simple counter for unique IDs
     return std::to_string(++clientCount); // Increment and return as string
 }
 
+// Logs indexing operations to the write-ahead log before acknowledging them
+void ServerProcessingEngine::setWriteAheadLog(std::shared_ptr<WriteAheadLog> wal) {
+    fileRetrievalEngineImpl->setWriteAheadLog(std::move(wal));
+}
+
+// Switches to the async server with the given thread layout
+void ServerProcessingEngine::setAsyncOptions(const AsyncServerOptions& options) {
+    asyncOptions = std::make_unique<AsyncServerOptions>(options);
+}
+
+// Shares the result cache with the search path and keeps it for reporting
+void ServerProcessingEngine::setResultCache(std::shared_ptr<ResultCache> cache) {
+    resultCache = cache;
+    fileRetrievalEngineImpl->setResultCache(std::move(cache));
+}
+
+// Shares the cursor store with the streamed search path
+void ServerProcessingEngine::setSearchCursors(std::shared_ptr<SearchCursorStore> cursors) {
+    fileRetrievalEngineImpl->setSearchCursors(std::move(cursors));
+}
+
+// Hands the batch search path its worker threads
+void ServerProcessingEngine::setSearchWorkers(std::shared_ptr<SearchWorkerPool> workers) {
+    fileRetrievalEngineImpl->setSearchWorkers(std::move(workers));
+}
+
+// Shares the replication log with the write path; the snapshot path must be set first
+void ServerProcessingEngine::setReplicationLog(std::shared_ptr<ReplicationLog> replication) {
+    replicationLog = replication;
+    fileRetrievalEngineImpl->setReplicationLog(std::move(replication), snapshotPath);
+}
+
+// Routes searches to the follower's store and refuses writes
+void ServerProcessingEngine::setReplica(std::shared_ptr<ReplicaFollower> replica) {
+    replicaFollower = replica;
+    fileRetrievalEngineImpl->setReplica(std::move(replica));
+}
+
+// Prints the result cache's counters
+void ServerProcessingEngine::reportCacheStats() const {
+    if (!resultCache) {
+        std::cout << "Result cache is disabled" << std::endl;
+        return;
+    }
+    ResultCacheStats stats = resultCache->stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    std::cout << "Result cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+              << (lookups ? 100.0 * stats.hits / lookups : 0.0) << "% hit rate), " << stats.entries << " entries, "
+              << stats.bytes << " of " << stats.capacityBytes << " bytes, " << stats.evictions << " evictions"
+              << std::endl;
+}
+
+// Prints the statistics the GetStats RPC returns
+void ServerProcessingEngine::reportStats() const {
+    fre::StatsRep stats;
+    fileRetrievalEngineImpl->collectStats(&stats);
+
+    ServerStats::print(stats);
+    reportCacheStats();
+}
+
+// Sets the file the index snapshot is written to
+void ServerProcessingEngine::setSnapshotPath(const std::string& path) {
+    snapshotPath = path;
+}
+
+// Writes the index to the snapshot file
+bool ServerProcessingEngine::saveSnapshot() {
+    if (snapshotPath.empty()) {
+        return false; // Snapshots are disabled
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!fileRetrievalEngineImpl->checkpoint(snapshotPath)) {
+        return false;
+    }
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Saved index snapshot to " << snapshotPath << " in " << duration.count() << " seconds" << std::endl;
+    return true;
+}
+
+// Compacts the index in place; searches and indexing keep running, waiting only on the shard being rebuilt
+void ServerProcessingEngine::compactIndex() {
+    IndexMemoryUsage before = store->estimateMemoryUsage();
+    auto start = std::chrono::high_resolution_clock::now();
+    store->compactPostings();
+    size_t frozen = store->freezeDictionary();
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    IndexMemoryUsage after = store->estimateMemoryUsage();
+    std::cout << "Compacted the index in " << duration.count() << " seconds: " << frozen << " terms frozen, term dictionary "
+              << before.dictionaryBytes << " -> " << after.dictionaryBytes << " bytes, posting lists "
+              << before.postingBytes << " -> " << after.postingBytes << " bytes" << std::endl;
+}
+
 // Adds a client to the connected clients list
 void ServerProcessingEngine::addClient(const std::string& clientID, std::unique_ptr<fre::FileRetrievalEngine::Stub> clientStub) {
     std::lock_guard<std::mutex> lock(clientsMutex);
@@ -70,9 +165,20 @@ void ServerProcessingEngine::notifyClientsToShutdown() {
 
 // Builds and starts the gRPC server
 void ServerProcessingEngine::rungRPCServer(int serverPort) {
+    if (asyncOptions) {
+        // Completion queue server: this service only answers requests, the pools poll the queues
+        asyncServer = std::make_unique<AsyncServer>(*this, *fileRetrievalEngineImpl, *asyncOptions);
+        if (asyncServer->start(serverPort, compression)) {
+            asyncServer->wait(); // Keep the server running until it is stopped
+        }
+        return;
+    }
+
     grpc::ServerBuilder builder; // Create a gRPC server builder
     builder.AddListeningPort("0.0.0.0:" + std::to_string(serverPort), grpc::InsecureServerCredentials()); // Add a listening port
     builder.RegisterService(this); // Register this service (ServerProcessingEngine) with the server
+    builder.SetDefaultCompressionAlgorithm(compression); // Compress replies as configured
+    builder.SetMaxReceiveMessageSize(INT_MAX); // An indexing batch holding one large document may pass 4 MB
     server = builder.BuildAndStart(); // Build and start the server
     std::cout << "Server is listening on port " << serverPort << std::endl;
     server->Wait(); // Keep the server running until it is stopped
@@ -80,9 +186,19 @@ void ServerProcessingEngine::rungRPCServer(int serverPort) {
 
 // Shuts down the gRPC server
 void ServerProcessingEngine::shutdown() {
-    if (server) {
+    if (server || asyncServer) {
         notifyClientsToShutdown(); // Notify clients before shutting down
-        server->Shutdown(); // Initiate server shutdown
+        if (replicationLog) {
+            replicationLog->close(); // Ends the replicas' streams, which would otherwise hold the shutdown up
+        }
+        if (replicaFollower) {
+            replicaFollower->stop(); // No updates may arrive while the index is saved
+        }
+        if (server) {
+            server->Shutdown(); // Initiate server shutdown
+        } else {
+            asyncServer->shutdown(); // Stop accepting calls and drain the completion queues
+        }
 
         // Wait for the server thread to finish
         if (serverThread.joinable()) {
@@ -97,16 +213,19 @@ grpc::Status ServerProcessingEngine::GetClientID(
         grpc::ServerContext* context,
         const fre::ConnectReq* request,
         fre::ConnectRep* response) {
+    auto start = std::chrono::steady_clock::now();
+
     // Generate a unique client ID
     std::string clientID = generateUniqueClientID();
     
     // Create a new client stub for this connection
-    auto clientStub = fre::FileRetrievalEngine::NewStub(grpc::CreateChannel("localhost:50051", grpc::InsecureChannelCredentials()));
+    auto clientStub = fre::FileRetrievalEngine::NewStub(grpc::CreateChannel(serverAddress, grpc::InsecureChannelCredentials()));
 
     addClient(clientID, std::move(clientStub)); // Add the new client to the list
     response->set_client_id(clientID); // Set the client ID in the response
 
     std::cout << "[INFO] Provided Client ID: " << clientID << std::endl; // Log the provided Client ID
+    fileRetrievalEngineImpl->stats().recordRpc(RpcMethod::GetClientID, std::chrono::steady_clock::now() - start, false);
     return grpc::Status::OK; // Indicate success
 }
 
@@ -115,7 +234,17 @@ grpc::Status ServerProcessingEngine::ComputeIndex(
         grpc::ServerContext* context,
         const fre::IndexReq* request,
         fre::IndexRep* response) {
-    return fileRetrievalEngineImpl->ComputeIndex(context, request, response);
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::ComputeIndex,
+        [&]() { return fileRetrievalEngineImpl->ComputeIndex(context, request, response); });
+}
+
+// gRPC remote procedure for streaming batches of documents to index
+grpc::Status ServerProcessingEngine::ComputeIndexStream(
+        grpc::ServerContext* context,
+        grpc::ServerReader<fre::IndexBatch>* reader,
+        fre::IndexStreamRep* response) {
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::ComputeIndexStream,
+        [&]() { return fileRetrievalEngineImpl->ComputeIndexStream(context, reader, response); });
 }
 
 // gRPC remote procedure for searching
@@ -123,7 +252,35 @@ grpc::Status ServerProcessingEngine::ComputeSearch(
         grpc::ServerContext* context,
         const fre::SearchReq* request,
         fre::SearchRep* response) {
-    return fileRetrievalEngineImpl->ComputeSearch(context, request, response);
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::ComputeSearch,
+        [&]() { return fileRetrievalEngineImpl->ComputeSearch(context, request, response); });
+}
+
+// gRPC remote procedure streaming one page of search results
+grpc::Status ServerProcessingEngine::ComputeSearchStream(
+        grpc::ServerContext* context,
+        const fre::SearchStreamReq* request,
+        grpc::ServerWriter<fre::SearchChunk>* writer) {
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::ComputeSearchStream,
+        [&]() { return fileRetrievalEngineImpl->ComputeSearchStream(context, request, writer); });
+}
+
+// gRPC remote procedure running a batch of searches
+grpc::Status ServerProcessingEngine::ComputeSearchBatch(
+        grpc::ServerContext* context,
+        const fre::SearchBatchReq* request,
+        fre::SearchBatchRep* response) {
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::ComputeSearchBatch,
+        [&]() { return fileRetrievalEngineImpl->ComputeSearchBatch(context, request, response); });
+}
+
+// gRPC remote procedure for deleting documents
+grpc::Status ServerProcessingEngine::ComputeDelete(
+        grpc::ServerContext* context,
+        const fre::DeleteReq* request,
+        fre::DeleteRep* response) {
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::ComputeDelete,
+        [&]() { return fileRetrievalEngineImpl->ComputeDelete(context, request, response); });
 }
 
 // gRPC remote procedure for shutdown (to notify clients)
@@ -131,7 +288,35 @@ grpc::Status ServerProcessingEngine::Shutdown(
         grpc::ServerContext* context,
         const fre::ShutdownReq* request,
         fre::ShutdownRep* response) {
+    auto start = std::chrono::steady_clock::now();
     response->set_message("Server is shutting down."); // Optional message
+    fileRetrievalEngineImpl->stats().recordRpc(RpcMethod::Shutdown, std::chrono::steady_clock::now() - start, false);
     return grpc::Status::OK; // Indicate success
 }
 
+// gRPC remote procedure for server statistics
+grpc::Status ServerProcessingEngine::GetStats(
+        grpc::ServerContext* context,
+        const fre::StatsReq* request,
+        fre::StatsRep* response) {
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::GetStats,
+        [&]() { return fileRetrievalEngineImpl->GetStats(context, request, response); });
+}
+
+// gRPC remote procedure for a replica's snapshot download
+grpc::Status ServerProcessingEngine::GetSnapshot(
+        grpc::ServerContext* context,
+        const fre::SnapshotReq* request,
+        grpc::ServerWriter<fre::SnapshotChunk>* writer) {
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::GetSnapshot,
+        [&]() { return fileRetrievalEngineImpl->GetSnapshot(context, request, writer); });
+}
+
+// gRPC remote procedure for a replica's update stream
+grpc::Status ServerProcessingEngine::Replicate(
+        grpc::ServerContext* context,
+        const fre::ReplicateReq* request,
+        grpc::ServerWriter<fre::ReplicationBatch>* writer) {
+    return fileRetrievalEngineImpl->stats().recordCall(RpcMethod::Replicate,
+        [&]() { return fileRetrievalEngineImpl->Replicate(context, request, writer); });
+}
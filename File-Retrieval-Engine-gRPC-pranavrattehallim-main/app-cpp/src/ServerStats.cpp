@@ -0,0 +1,169 @@
+#include "ServerStats.hpp"
+#include "proto/File-Retrieval-Engine.pb.h" // For the GetStats reply
+#include <algorithm> // For std::min
+#include <cstdlib>   // For std::strtoull
+#include <fstream>   // For reading the resident memory from /proc
+#include <sys/resource.h> // For getrusage
+#include <iostream>  // For the stats report
+#include <string>
+
+// Largest value that falls in the bucket
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket < subBuckets) {
+        return bucket;
+    }
+    size_t shift = bucket / subBuckets - 1;
+    uint64_t sub = bucket % subBuckets;
+    return ((subBuckets + sub + 1) << shift) - 1;
+}
+
+// Copies the buckets once and walks them for each percentile
+LatencySummary LatencyHistogram::summary() const {
+    std::array<uint64_t, bucketCount> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < bucketCount; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    LatencySummary summary;
+    summary.count = total; // Sum of the copied buckets, so the percentiles below are consistent with it
+    if (total == 0) {
+        return summary;
+    }
+    uint64_t maxNanos = maxNanos_.load(std::memory_order_relaxed);
+    summary.meanMicros = sumNanos_.load(std::memory_order_relaxed) / 1e3 / std::max<uint64_t>(count_.load(std::memory_order_relaxed), 1);
+    summary.maxMicros = maxNanos / 1e3;
+
+    // Smallest bucket edge with at least the fraction of samples at or below it; never above the largest sample
+    auto percentile = [&](double fraction) {
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * total + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(bucketUpperBound(i), maxNanos) / 1e3;
+            }
+        }
+        return maxNanos / 1e3;
+    };
+    summary.p50Micros = percentile(0.50);
+    summary.p90Micros = percentile(0.90);
+    summary.p99Micros = percentile(0.99);
+    summary.p999Micros = percentile(0.999);
+    return summary;
+}
+
+// Names match the rpc declarations in File-Retrieval-Engine.proto
+const char* ServerStats::methodName(RpcMethod method) {
+    switch (method) {
+    case RpcMethod::ComputeIndex:
+        return "ComputeIndex";
+    case RpcMethod::ComputeIndexStream:
+        return "ComputeIndexStream";
+    case RpcMethod::ComputeSearch:
+        return "ComputeSearch";
+    case RpcMethod::ComputeSearchStream:
+        return "ComputeSearchStream";
+    case RpcMethod::ComputeSearchBatch:
+        return "ComputeSearchBatch";
+    case RpcMethod::ComputeDelete:
+        return "ComputeDelete";
+    case RpcMethod::GetClientID:
+        return "GetClientID";
+    case RpcMethod::Shutdown:
+        return "Shutdown";
+    case RpcMethod::GetStats:
+        return "GetStats";
+    case RpcMethod::GetSnapshot:
+        return "GetSnapshot";
+    case RpcMethod::Replicate:
+        return "Replicate";
+    case RpcMethod::Count:
+        break;
+    }
+    return "Unknown";
+}
+
+// Copies the uptime, the resident memory from /proc, the process CPU time and every method's counters into the reply
+void ServerStats::collect(fre::StatsRep* reply) const {
+    double uptime = uptimeSeconds();
+    reply->set_uptime_seconds(uptime);
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        // Lines such as "VmRSS:     123456 kB"
+        if (line.rfind("VmRSS:", 0) == 0) {
+            reply->set_resident_bytes(std::strtoull(line.c_str() + 6, nullptr, 10) * 1024);
+        } else if (line.rfind("VmHWM:", 0) == 0) {
+            reply->set_peak_resident_bytes(std::strtoull(line.c_str() + 6, nullptr, 10) * 1024);
+        }
+    }
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        reply->set_cpu_seconds(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                               (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6);
+    }
+    for (size_t i = 0; i < static_cast<size_t>(RpcMethod::Count); ++i) {
+        RpcMethod method = static_cast<RpcMethod>(i);
+        LatencySummary summary = latency(method);
+        fre::RpcStats* rpc = reply->add_rpcs();
+        rpc->set_method(methodName(method));
+        rpc->set_calls(summary.count);
+        rpc->set_errors(errors(method));
+        rpc->set_calls_per_second(uptime > 0 ? summary.count / uptime : 0.0);
+        rpc->set_mean_us(summary.meanMicros);
+        rpc->set_p50_us(summary.p50Micros);
+        rpc->set_p90_us(summary.p90Micros);
+        rpc->set_p99_us(summary.p99Micros);
+        rpc->set_p999_us(summary.p999Micros);
+        rpc->set_max_us(summary.maxMicros);
+    }
+}
+
+// One line per RPC in use, then the lock, index, deletion and replication counters
+void ServerStats::print(const fre::StatsRep& stats) {
+    std::cout << "Uptime: " << stats.uptime_seconds() << " seconds" << std::endl;
+    for (const auto& rpc : stats.rpcs()) {
+        if (rpc.calls() == 0) {
+            continue; // Keep the report to the RPCs in use
+        }
+        std::cout << rpc.method() << ": " << rpc.calls() << " calls (" << rpc.calls_per_second() << "/s), "
+                  << rpc.errors() << " errors, mean " << rpc.mean_us() << " us, p50 " << rpc.p50_us() << " us, p90 "
+                  << rpc.p90_us() << " us, p99 " << rpc.p99_us() << " us, p99.9 " << rpc.p999_us() << " us, max "
+                  << rpc.max_us() << " us" << std::endl;
+    }
+    for (const auto& lock : stats.locks()) {
+        std::cout << "Lock " << lock.lock() << ": " << lock.acquisitions() << " acquisitions, " << lock.contended()
+                  << " contended, " << lock.wait_seconds() << " seconds waiting" << std::endl;
+    }
+    const fre::IndexStats& index = stats.index();
+    std::cout << "Index: " << index.documents() << " documents, " << index.terms() << " terms, " << index.postings()
+              << " postings, generation " << index.generation() << std::endl;
+    std::cout << "Index memory: document table " << index.document_table_bytes() << " bytes, term dictionary "
+              << index.dictionary_bytes() << " bytes (" << index.frozen_terms() << " terms frozen), posting lists " << index.posting_bytes() << " bytes, snapshot "
+              << index.snapshot_bytes() << " bytes mapped" << std::endl;
+    std::cout << "Deleted documents: " << index.deleted_documents() << " hidden, " << index.pending_purge()
+              << " awaiting purge; forward index " << index.forward_index_bytes() << " bytes" << std::endl;
+    std::cout << "Delta segments: " << index.delta_segments() << " awaiting merge, " << index.delta_bytes() << " bytes"
+              << std::endl;
+    std::cout << "Process memory: " << stats.resident_bytes() << " bytes resident, peak "
+              << stats.peak_resident_bytes() << " bytes; CPU time " << stats.cpu_seconds() << " seconds" << std::endl;
+    const fre::CursorStats& cursors = stats.cursors();
+    if (cursors.enabled()) {
+        std::cout << "Search cursors: " << cursors.result_sets() << " result sets, " << cursors.bytes() << " of "
+                  << cursors.capacity_bytes() << " bytes; " << cursors.opened() << " opened, " << cursors.resumed()
+                  << " pages resumed, " << cursors.expired() << " expired, " << cursors.evicted() << " evicted, "
+                  << cursors.missing() << " presented after expiry" << std::endl;
+    }
+    const fre::ReplicationStats& replication = stats.replication();
+    if (replication.role() == "primary") {
+        std::cout << "Replication: primary at update " << replication.applied_sequence() << ", "
+                  << replication.replicas() << " replicas following, " << replication.feed_bytes()
+                  << " bytes of updates kept since the last snapshot" << std::endl;
+    } else if (replication.role() == "replica") {
+        std::cout << "Replication: replica of " << replication.primary() << " ("
+                  << (replication.connected() ? "connected" : "disconnected") << "), applied update "
+                  << replication.applied_sequence() << " of " << replication.primary_sequence() << ", "
+                  << replication.lag_seconds() << " seconds behind" << std::endl;
+    }
+}
@@ -0,0 +1,38 @@
+#include "TopKCollector.hpp"
+#include <algorithm> // For the heap algorithms and std::sort
+
+namespace {
+
+// Orders results from best to worst: higher score first, then lower document number
+bool better(const std::pair<int, int>& a, const std::pair<int, int>& b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+}
+
+} // namespace
+
+// Constructor reserves room for K results
+TopKCollector::TopKCollector(size_t k) : k_(k) {
+    heap_.reserve(k);
+}
+
+// Keeps the document if it belongs in the top K
+void TopKCollector::push(int document, int score) {
+    if (k_ == 0) {
+        return;
+    }
+    if (heap_.size() < k_) {
+        heap_.emplace_back(document, score);
+        std::push_heap(heap_.begin(), heap_.end(), better); // "better" as the comparator keeps the worst at the front
+    } else if (score > heap_.front().second) {
+        std::pop_heap(heap_.begin(), heap_.end(), better); // Drop the current K-th result
+        heap_.back() = {document, score};
+        std::push_heap(heap_.begin(), heap_.end(), better);
+    }
+}
+
+// Sorts a copy of the heap from best to worst
+std::vector<std::pair<int, int>> TopKCollector::results() const {
+    std::vector<std::pair<int, int>> sorted = heap_;
+    std::sort(sorted.begin(), sorted.end(), better);
+    return sorted;
+}
@@ -0,0 +1,413 @@
+#include "WriteAheadLog.hpp"
+#include <algorithm>   // For std::min and std::max
+#include <array>       // For the CRC table
+#include <cerrno>      // For EINTR
+#include <cstring>     // For std::memcpy, std::memcmp and std::strerror
+#include <fcntl.h>     // For open and fcntl
+#include <sys/stat.h>  // For fstat
+#include <unistd.h>    // For write, pread, pwrite, fdatasync, ftruncate and close
+
+namespace {
+
+// Magic bytes at the start of every log file
+constexpr char logMagic[8] = {'F', 'R', 'E', 'W', 'A', 'L', '\0', '\0'};
+
+// Size of the file header: magic, version, reserved, first sequence
+constexpr size_t headerSize = 8 + 4 + 4 + 8;
+
+// Term count that marks a deletion record
+constexpr uint32_t deleteMarker = 0xFFFFFFFF;
+
+// Size of a record frame: payload length and checksum
+constexpr size_t frameSize = 4 + 4;
+
+// Largest payload accepted on replay; anything larger is treated as a torn length field
+constexpr uint32_t maxPayloadBytes = 1u << 30;
+
+// Builds the lookup table of the reflected CRC-32 polynomial (the one used by zlib)
+constexpr std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> crcTable = makeCrcTable();
+
+// Computes the CRC-32 of a byte range
+uint32_t crc32(const char* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = crcTable[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Appends a fixed-width integer in host byte order
+template <typename T>
+void putInteger(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Appends a length-prefixed string
+void putString(std::string& out, const std::string& value) {
+    putInteger<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+// Sequential reader over a record payload; every read fails once the payload is exhausted
+struct PayloadReader {
+    const char* data;
+    size_t size;
+    size_t position = 0;
+
+    // Reads a fixed-width integer
+    template <typename T>
+    bool integer(T& value) {
+        if (size - position < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data + position, sizeof(T));
+        position += sizeof(T);
+        return true;
+    }
+
+    // Reads a length-prefixed string
+    bool string(std::string& value) {
+        uint32_t length = 0;
+        if (!integer(length) || size - position < length) {
+            return false;
+        }
+        value.assign(data + position, length);
+        position += length;
+        return true;
+    }
+};
+
+// Decodes a record payload; returns false if the payload is malformed
+bool decodeRecord(const char* data, size_t size, LogRecord& record) {
+    PayloadReader reader{data, size};
+    uint32_t termCount = 0;
+    if (!reader.string(record.clientID) || !reader.string(record.documentPath) || !reader.integer(termCount)) {
+        return false;
+    }
+    record.termFrequencies.clear();
+    record.deleted = termCount == deleteMarker;
+    if (record.deleted) {
+        return reader.position == size;
+    }
+    record.termFrequencies.reserve(std::min<uint32_t>(termCount, static_cast<uint32_t>(size / 8)));
+    for (uint32_t i = 0; i < termCount; ++i) {
+        std::string term;
+        int32_t frequency = 0;
+        if (!reader.string(term) || !reader.integer(frequency)) {
+            return false;
+        }
+        record.termFrequencies.emplace_back(std::move(term), frequency);
+    }
+    return reader.position == size;
+}
+
+// Writes the whole buffer, retrying short writes and interrupted calls
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Writes a fresh header to an empty log file
+bool writeHeader(int fd, uint64_t firstSequence) {
+    std::string header(logMagic, sizeof(logMagic));
+    putInteger<uint32_t>(header, WriteAheadLog::formatVersion);
+    putInteger<uint32_t>(header, 0);
+    putInteger<uint64_t>(header, firstSequence);
+    return writeAll(fd, header.data(), header.size());
+}
+
+// Fills in the length and checksum of the record whose frame starts at frameStart
+void finishRecord(std::string& out, size_t frameStart) {
+    const char* payload = out.data() + frameStart + frameSize;
+    uint32_t payloadSize = static_cast<uint32_t>(out.size() - frameStart - frameSize);
+    uint32_t checksum = crc32(payload, payloadSize);
+    std::memcpy(&out[frameStart], &payloadSize, sizeof(payloadSize));
+    std::memcpy(&out[frameStart + 4], &checksum, sizeof(checksum));
+}
+
+} // namespace
+
+// Encodes one indexing operation as a length- and checksum-framed record
+void WriteAheadLog::encodeRecord(std::string& out, const std::string& clientID, const std::string& documentPath,
+                                 const std::vector<std::pair<std::string, int>>& termFrequencies) {
+    size_t frameStart = out.size();
+    out.append(frameSize, '\0'); // Filled in once the payload length is known
+
+    putString(out, clientID);
+    putString(out, documentPath);
+    putInteger<uint32_t>(out, static_cast<uint32_t>(termFrequencies.size()));
+    for (const auto& [term, frequency] : termFrequencies) {
+        putString(out, term);
+        putInteger<int32_t>(out, frequency);
+    }
+    finishRecord(out, frameStart);
+}
+
+// Encodes a deletion: the document's key and the marker in place of the term count
+void WriteAheadLog::encodeDeleteRecord(std::string& out, const std::string& clientID, const std::string& documentPath) {
+    size_t frameStart = out.size();
+    out.append(frameSize, '\0');
+    putString(out, clientID);
+    putString(out, documentPath);
+    putInteger<uint32_t>(out, deleteMarker);
+    finishRecord(out, frameStart);
+}
+
+// Walks framed records like replay does, but treats any damage as an error: these records were sent whole
+bool WriteAheadLog::decodeRecords(const std::string& encoded, uint64_t firstSequence, std::vector<LogRecord>& records) {
+    size_t offset = 0;
+    uint64_t sequence = firstSequence;
+    while (offset < encoded.size()) {
+        uint32_t payloadSize = 0, checksum = 0;
+        if (encoded.size() - offset < frameSize) {
+            return false;
+        }
+        std::memcpy(&payloadSize, encoded.data() + offset, sizeof(payloadSize));
+        std::memcpy(&checksum, encoded.data() + offset + 4, sizeof(checksum));
+        const char* payload = encoded.data() + offset + frameSize;
+        LogRecord record;
+        if (payloadSize > maxPayloadBytes || encoded.size() - offset - frameSize < payloadSize ||
+            crc32(payload, payloadSize) != checksum || !decodeRecord(payload, payloadSize, record)) {
+            return false;
+        }
+        record.sequence = sequence++;
+        records.push_back(std::move(record));
+        offset += frameSize + payloadSize;
+    }
+    return true;
+}
+
+// Recovers the log: replays every intact record after afterSequence and cuts off a torn tail
+std::shared_ptr<WriteAheadLog> WriteAheadLog::open(const std::string& path, const WalOptions& options,
+                                                   uint64_t afterSequence,
+                                                   const std::function<void(const LogRecord&)>& apply,
+                                                   std::string& error) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return nullptr;
+    }
+    auto fail = [&](const std::string& reason) -> std::shared_ptr<WriteAheadLog> {
+        ::close(fd);
+        error = reason;
+        return nullptr;
+    };
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return fail("cannot stat " + path);
+    }
+    size_t fileSize = static_cast<size_t>(info.st_size);
+
+    // A new (or never written) log starts right after the snapshot's last record
+    if (fileSize < headerSize) {
+        if (ftruncate(fd, 0) != 0 || !writeHeader(fd, afterSequence + 1) || fdatasync(fd) != 0) {
+            return fail("cannot initialize " + path);
+        }
+        return std::shared_ptr<WriteAheadLog>(new WriteAheadLog(fd, options, afterSequence));
+    }
+
+    // Read the whole log; it is bounded by the snapshot interval and replayed once at startup
+    std::string contents(fileSize, '\0');
+    for (size_t done = 0; done < fileSize;) {
+        ssize_t bytes = pread(fd, &contents[done], fileSize - done, static_cast<off_t>(done));
+        if (bytes <= 0) {
+            return fail("cannot read " + path);
+        }
+        done += static_cast<size_t>(bytes);
+    }
+
+    uint32_t version = 0;
+    uint64_t firstSequence = 0;
+    std::memcpy(&version, contents.data() + 8, sizeof(version));
+    std::memcpy(&firstSequence, contents.data() + 16, sizeof(firstSequence));
+    if (std::memcmp(contents.data(), logMagic, sizeof(logMagic)) != 0) {
+        return fail(path + " is not a write-ahead log");
+    }
+    if (version != 1 && version != formatVersion) {
+        return fail("unsupported write-ahead log version " + std::to_string(version));
+    }
+    if (firstSequence == 0) {
+        return fail(path + " has an invalid first sequence number");
+    }
+
+    // Walk the records until the end of the file or the first torn one
+    size_t offset = headerSize;
+    uint64_t sequence = firstSequence - 1;
+    LogRecord record;
+    while (fileSize - offset >= frameSize) {
+        uint32_t payloadSize = 0, checksum = 0;
+        std::memcpy(&payloadSize, contents.data() + offset, sizeof(payloadSize));
+        std::memcpy(&checksum, contents.data() + offset + 4, sizeof(checksum));
+        const char* payload = contents.data() + offset + frameSize;
+        if (payloadSize > maxPayloadBytes || fileSize - offset - frameSize < payloadSize ||
+            crc32(payload, payloadSize) != checksum || !decodeRecord(payload, payloadSize, record)) {
+            break; // Torn write: nothing after it was ever acknowledged
+        }
+        record.sequence = ++sequence;
+        if (record.sequence > afterSequence) {
+            apply(record); // Records at or before afterSequence are already in the snapshot
+        }
+        offset += frameSize + payloadSize;
+    }
+    if (offset < fileSize && (ftruncate(fd, static_cast<off_t>(offset)) != 0 || fdatasync(fd) != 0)) {
+        return fail("cannot drop the torn tail of " + path);
+    }
+
+    // Mark an older log as current before records it could not hold are appended; O_APPEND would redirect pwrite
+    if (version != formatVersion) {
+        uint32_t current = formatVersion;
+        int flags = fcntl(fd, F_GETFL);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_APPEND) != 0 ||
+            pwrite(fd, &current, sizeof(current), 8) != static_cast<ssize_t>(sizeof(current)) ||
+            fcntl(fd, F_SETFL, flags) != 0 || fdatasync(fd) != 0) {
+            return fail("cannot upgrade " + path + " to version " + std::to_string(formatVersion));
+        }
+    }
+
+    return std::shared_ptr<WriteAheadLog>(new WriteAheadLog(fd, options, std::max(sequence, afterSequence)));
+}
+
+// Constructor starts the flusher thread
+WriteAheadLog::WriteAheadLog(int fd, const WalOptions& options, uint64_t lastSequence)
+    : fd_(fd), options_(options), appendedSequence_(lastSequence), durableSequence_(lastSequence) {
+    flusher_ = std::thread(&WriteAheadLog::flushLoop, this);
+}
+
+// Destructor writes whatever is still pending, stops the flusher and closes the file
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    pendingCv_.notify_all();
+    flusher_.join();
+    ::close(fd_);
+}
+
+// Queues encoded records; the caller waits for durability separately so it can apply them to the index meanwhile
+uint64_t WriteAheadLog::append(const std::string& encodedRecords, size_t recordCount) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.empty()) {
+        pendingSince_ = std::chrono::steady_clock::now(); // Starts this group's flush interval
+    }
+    pending_.append(encodedRecords);
+    appendedSequence_ += recordCount;
+    pendingCv_.notify_one();
+    return appendedSequence_;
+}
+
+// Waits for the group commit that covers the sequence number
+bool WriteAheadLog::waitDurable(uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    durableCv_.wait(lock, [&]() { return failed_ || durableSequence_ >= sequence; });
+    return !failed_;
+}
+
+// Flushes without waiting out the interval and waits for the result
+bool WriteAheadLog::sync() {
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sequence = appendedSequence_;
+        flushRequested_ = true;
+    }
+    pendingCv_.notify_one();
+    return waitDurable(sequence);
+}
+
+// Rewrites the log as empty; the next record keeps the sequence numbering going
+bool WriteAheadLog::truncate() {
+    if (!sync()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pending_.empty()) {
+        return false; // Appends were not paused; keep the records
+    }
+    if (ftruncate(fd_, 0) != 0 || !writeHeader(fd_, appendedSequence_ + 1) || fdatasync(fd_) != 0) {
+        failed_ = true; // The file is in an unknown state, so stop acknowledging
+        durableCv_.notify_all();
+        return false;
+    }
+    return true;
+}
+
+// Returns the sequence number of the last record appended
+uint64_t WriteAheadLog::lastSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appendedSequence_;
+}
+
+// Returns the number of group commits and the records they covered
+std::pair<uint64_t, uint64_t> WriteAheadLog::commitStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {fsyncs_, recordsSynced_};
+}
+
+// Writes pending records in groups: every record queued during the flush interval shares one fsync
+void WriteAheadLog::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        pendingCv_.wait(lock, [this]() { return stopping_ || !pending_.empty() || flushRequested_; });
+        if (pending_.empty()) {
+            flushRequested_ = false;
+            if (stopping_) {
+                break;
+            }
+            continue; // Nothing to write for this sync request
+        }
+        if (failed_) {
+            pending_.clear(); // The log is unusable; waiters are already being failed
+            durableCv_.notify_all();
+            continue;
+        }
+
+        // Let the group grow until the interval ends, the size limit is reached, or someone asks for a flush
+        pendingCv_.wait_until(lock, pendingSince_ + options_.flushInterval, [this]() {
+            return stopping_ || flushRequested_ || pending_.size() >= options_.flushBytes;
+        });
+        flushRequested_ = false;
+
+        std::string group;
+        group.swap(pending_);
+        uint64_t groupSequence = appendedSequence_;
+        uint64_t groupRecords = groupSequence - durableSequence_;
+
+        // Write and sync without the lock so RPCs can keep queueing the next group
+        lock.unlock();
+        bool written = writeAll(fd_, group.data(), group.size()) && fdatasync(fd_) == 0;
+        lock.lock();
+
+        if (written) {
+            durableSequence_ = groupSequence;
+            ++fsyncs_;
+            recordsSynced_ += groupRecords;
+        } else {
+            failed_ = true; // Records may be partly on disk; fail every waiter rather than acknowledge them
+        }
+        durableCv_.notify_all();
+    }
+}
@@ -1,107 +1,363 @@
 #include <iostream>
+#include <fstream>
 #include <thread>
 #include <vector>
 #include <string>
 #include <sstream>
+#include <chrono>
+#include <limits>
 #include <cstdlib> // for exit
 #include <algorithm> // for std::transform
 #include "ClientProcessingEngine.hpp" // Ensure this header is included
 #include "Benchmark.hpp"
 
-void benchmarkClient(ClientProcessingEngine& clientEngine, const std::string& dataset_path) {
+// Settings of a benchmark run, from the command line or (without arguments) from prompts
+struct BenchmarkConfig {
+    int numClients = 1;                     // Concurrent clients, each with its own connection and client ID
+    std::string serverIP = "127.0.0.1";     // Server address
+    int serverPort = 50051;                 // Server port
+    std::vector<std::string> datasetPaths;  // Client i indexes dataset i % M
+    int repetitions = 1;                    // Times the whole indexing run is repeated
+    size_t indexWorkers = 0;                // Tokenizer workers per client (0 keeps the client default)
+    std::vector<std::string> queryTerms;    // Search run once after indexing (optional)
+    std::string jsonPath;                   // File the JSON report is written to ("-" for stdout)
+    bool termIds = false;                   // Encode the indexing streams with a term dictionary
+    std::string compressionName = "none";   // Compression of the indexing streams, as named on the command line
+    grpc_compression_algorithm compression = GRPC_COMPRESS_NONE; // The same, as gRPC names it
+};
+
+// Totals of one or more indexing runs; stage times are summed across clients
+struct RunTotals {
+    double seconds = 0.0;    // Wall-clock time, from the first client starting to the last one finishing
+    size_t documents = 0;    // Documents acknowledged by the server
+    size_t bytes = 0;        // File bytes read by the clients
+    double serverCpuSeconds = 0.0; // CPU time the server process used during the run
+    uint64_t loopbackBytes = 0;    // Bytes over the loopback interface during the run (0 unless the server is local)
+    IndexingStageTimes stages; // Per-stage time summed across clients
+};
+
+// CPU time the server process has used, from GetStats; negative if the server did not answer
+static double serverCpuSeconds(fre::FileRetrievalEngine::Stub& stub) {
+    grpc::ClientContext context;
+    fre::StatsReq request;
+    fre::StatsRep reply;
+    return stub.GetStats(&context, request, &reply).ok() ? reply.cpu_seconds() : -1.0;
+}
+
+// Bytes the loopback interface has transmitted, from /proc/net/dev; every packet between a local client and
+// server crosses it once, headers included. 0 if the counter cannot be read.
+static uint64_t loopbackBytes() {
+    std::ifstream devices("/proc/net/dev");
+    for (std::string line; std::getline(devices, line);) {
+        // Lines such as "    lo: 1234 10 0 0 0 0 0 0 1234 10 ...", received counters first
+        size_t colon = line.find(':');
+        std::string device;
+        std::istringstream(line.substr(0, colon == std::string::npos ? 0 : colon)) >> device;
+        if (device != "lo") {
+            continue;
+        }
+        std::istringstream fields(line.substr(colon + 1));
+        uint64_t value = 0;
+        for (int i = 0; i < 9 && fields >> value; ++i) {
+        }
+        return value; // Ninth field: bytes transmitted
+    }
+    return 0;
+}
+
+// Indexes one dataset with one client
+bool benchmarkClient(ClientProcessingEngine& clientEngine, const std::string& dataset_path) {
     // Index the folder
     if (!clientEngine.indexFolder(dataset_path)) {
         std::cerr << "Failed to index folder: " << dataset_path << std::endl;
-        return;
+        return false;
     }
+    return true;
+}
 
-    std::cout << "Client finished indexing: " << dataset_path << std::endl;
+// Adds one client's stage times to the run totals
+static void addStages(IndexingStageTimes& total, const IndexingStageTimes& stages) {
+    total.walk += stages.walk;
+    total.read += stages.read;
+    total.tokenize += stages.tokenize;
+    total.serialize += stages.serialize;
+    total.send += stages.send;
+    total.serverApply += stages.serverApply;
+    total.serverLogWait += stages.serverLogWait;
+    total.total += stages.total;
+    total.documents += stages.documents;
+    total.bytes += stages.bytes;
+    total.sentBytes += stages.sentBytes;
+    total.dictionaryTerms += stages.dictionaryTerms;
 }
 
-int main() {
-    int num_clients;
-    std::string server_ip;
-    int server_port;
+// Writes the throughput and wire cost fields of a run as JSON members
+static void writeThroughput(std::ostream& out, const RunTotals& totals) {
+    out << "\"seconds\": " << totals.seconds << ", \"documents\": " << totals.documents << ", \"bytes\": "
+        << totals.bytes << ", \"mb_per_s\": " << (totals.seconds > 0 ? totals.bytes / totals.seconds / 1e6 : 0.0)
+        << ", \"docs_per_s\": " << (totals.seconds > 0 ? totals.documents / totals.seconds : 0.0)
+        << ", \"sent_bytes\": " << totals.stages.sentBytes << ", \"dictionary_terms\": "
+        << totals.stages.dictionaryTerms << ", \"loopback_bytes\": " << totals.loopbackBytes
+        << ", \"server_cpu_seconds\": " << totals.serverCpuSeconds;
+}
+
+// One line with the bytes sent and the server CPU time per document
+static void printWireCost(const RunTotals& totals) {
+    double documents = std::max<size_t>(totals.documents, 1);
+    std::cout << "Per document: " << totals.stages.sentBytes / documents << " bytes serialized";
+    if (totals.loopbackBytes > 0) {
+        std::cout << ", " << totals.loopbackBytes / documents << " bytes over loopback";
+    }
+    std::cout << ", server CPU " << totals.serverCpuSeconds / documents * 1e6 << " us";
+    if (totals.stages.dictionaryTerms > 0) {
+        std::cout << " (" << totals.stages.dictionaryTerms << " dictionary terms sent)";
+    }
+    std::cout << std::endl;
+}
+
+// Writes a JSON string literal, escaping quotes, backslashes and control characters
+static void writeString(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xF] << "0123456789abcdef"[c & 0xF];
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// Writes the whole report. Phase times are summed over clients and repetitions, and the pipeline stages overlap
+// (the server applies one batch while the client tokenizes the next), so together they can exceed wall time.
+static void writeJson(std::ostream& out, const BenchmarkConfig& config, const std::vector<RunTotals>& runs,
+                      const RunTotals& aggregate, double searchSeconds) {
+    out.precision(6);
+    out << "{\n  \"clients\": " << config.numClients << ",\n  \"server\": ";
+    writeString(out, config.serverIP + ":" + std::to_string(config.serverPort));
+    out << ",\n  \"datasets\": [";
+    for (size_t i = 0; i < config.datasetPaths.size(); ++i) {
+        out << (i ? ", " : "");
+        writeString(out, config.datasetPaths[i]);
+    }
+    out << "],\n  \"repetitions\": " << config.repetitions << ",\n  \"index_workers\": " << config.indexWorkers
+        << ",\n  \"term_ids\": " << (config.termIds ? "true" : "false") << ",\n  \"compression\": ";
+    writeString(out, config.compressionName);
+    out << ",\n  \"runs\": [\n";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        out << "    {\"repetition\": " << i + 1 << ", ";
+        writeThroughput(out, runs[i]);
+        out << "}" << (i + 1 < runs.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"aggregate\": {";
+    writeThroughput(out, aggregate);
+    const IndexingStageTimes& stages = aggregate.stages;
+    out << "},\n  \"phases\": {\"walk\": " << stages.walk << ", \"read\": " << stages.read << ", \"tokenize\": "
+        << stages.tokenize << ", \"serialize\": " << stages.serialize << ", \"rpc\": "
+        << stages.send << ", \"server_apply\": " << stages.serverApply
+        << ", \"server_log_wait\": " << stages.serverLogWait << "}";
+    if (!config.queryTerms.empty()) {
+        out << ",\n  \"search_seconds\": " << searchSeconds;
+    }
+    out << "\n}\n";
+}
 
+// Reads the settings from prompts, as the benchmark did before it took arguments
+static void promptConfig(BenchmarkConfig& config) {
     // Ask for the number of clients
     std::cout << "Enter the number of clients: ";
-    std::cin >> num_clients;
+    std::cin >> config.numClients;
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Clear input buffer
 
     // Ask for the server IP address
     std::cout << "Enter the server IP address: ";
-    std::getline(std::cin, server_ip);  // Use getline to ensure the full input is captured
+    std::getline(std::cin, config.serverIP);  // Use getline to ensure the full input is captured
 
     // Ask for the server port
     std::cout << "Enter the server port: ";
-    std::cin >> server_port;
+    std::cin >> config.serverPort;
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Clear input buffer
 
-    std::vector<std::string> dataset_paths(num_clients); // Allocate space for the dataset paths
-    for (int i = 0; i < num_clients; ++i) {
+    config.datasetPaths.resize(std::max(config.numClients, 0)); // Allocate space for the dataset paths
+    for (int i = 0; i < config.numClients; ++i) {
         std::cout << "Enter the path for dataset " << (i + 1) << ": ";
-        std::getline(std::cin, dataset_paths[i]);  // Ensure each dataset path is properly inputted
+        std::getline(std::cin, config.datasetPaths[i]);  // Ensure each dataset path is properly inputted
     }
 
     // Collect search terms at the start
     std::cout << "Enter search command: ";
     std::string search_command;
     std::getline(std::cin, search_command); // Collect search terms once
-
-    // Trim whitespace and prepare the search command
-    search_command.erase(0, search_command.find_first_not_of(' ')); // Trim leading spaces
-    search_command.erase(search_command.find_last_not_of(' ') + 1); // Trim trailing spaces
-
-    // Split the command into search terms
     std::istringstream iss(search_command);
-    std::vector<std::string> query_terms;
-    std::string term;
-
-    // Extract each term from the input and add it to the vector
-    while (iss >> term) {
-    query_terms.push_back(term);  // Add the term to the vector
+    for (std::string term; iss >> term;) {
+        config.queryTerms.push_back(term);  // Add the term to the vector
     }
+}
 
-    // Check if any search terms were provided
-    if (query_terms.empty()) {
-    std::cerr << "No search terms provided." << std::endl;
-    return EXIT_FAILURE;
+// Parses the command line; returns false on an unknown or incomplete option
+static bool parseArguments(int argc, char* argv[], BenchmarkConfig& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            return false; // Every option takes a value
+        }
+        std::string value = argv[++i];
+        if (option == "--clients") {
+            config.numClients = std::atoi(value.c_str());
+        } else if (option == "--server") {
+            size_t colon = value.rfind(':');
+            if (colon == std::string::npos) {
+                return false;
+            }
+            config.serverIP = value.substr(0, colon);
+            config.serverPort = std::atoi(value.c_str() + colon + 1);
+        } else if (option == "--dataset") {
+            config.datasetPaths.push_back(value);
+        } else if (option == "--repetitions") {
+            config.repetitions = std::atoi(value.c_str());
+        } else if (option == "--index-workers") {
+            config.indexWorkers = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (option == "--query") {
+            std::istringstream iss(value);
+            for (std::string term; iss >> term;) {
+                config.queryTerms.push_back(term);
+            }
+        } else if (option == "--json") {
+            config.jsonPath = value;
+        } else if (option == "--term-ids") {
+            if (value != "on" && value != "off") {
+                return false;
+            }
+            config.termIds = value == "on";
+        } else if (option == "--compression") {
+            if (!parseCompressionAlgorithm(value, config.compression)) {
+                return false;
+            }
+            config.compressionName = value;
+        } else {
+            return false;
+        }
     }
+    return true;
+}
 
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    if (argc == 1) {
+        promptConfig(config); // Interactive use, as before
+        if (config.queryTerms.empty()) {
+            std::cerr << "No search terms provided." << std::endl;
+            return EXIT_FAILURE;
+        }
+    } else if (!parseArguments(argc, argv, config)) {
+        std::cerr << "Usage: file-retrieval-benchmark --dataset PATH [--dataset PATH ...] [--clients N] "
+                     "[--server HOST:PORT] [--repetitions N] [--index-workers N] [--query \"TERMS\"] "
+                     "[--term-ids on|off] [--compression none|deflate|gzip] [--json FILE|-]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (config.numClients <= 0 || config.datasetPaths.empty() || config.repetitions <= 0) {
+        std::cerr << "At least one client, one dataset and one repetition are needed." << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    std::vector<ClientProcessingEngine> clients(num_clients);
-    std::vector<std::thread> threads;
-
-    // Create and run threads for each client
-    for (int i = 0; i < num_clients; ++i) {
-        // std::cout << "[DEBUG] Connecting client " << (i + 1) << " to the server..." << std::endl;
-        if (!clients[i].connect(server_ip, server_port)) {
+    std::vector<ClientProcessingEngine> clients(config.numClients);
+    for (int i = 0; i < config.numClients; ++i) {
+        if (!clients[i].connect(config.serverIP, config.serverPort)) {
             std::cerr << "Failed to connect client " << (i + 1) << std::endl;
             return EXIT_FAILURE;
         }
-        threads.emplace_back(benchmarkClient, std::ref(clients[i]), dataset_paths[i]);
+        if (config.indexWorkers > 0) {
+            clients[i].setIndexingWorkers(config.indexWorkers);
+        }
+        clients[i].setVerbose(config.jsonPath.empty()); // Scripted runs only want the report
+        clients[i].setTermIds(config.termIds);
+        clients[i].setCompression(config.compression);
     }
+    // Separate connection for the server's CPU counter, so reading it adds no traffic to the clients' channels
+    auto statsStub = fre::FileRetrievalEngine::NewStub(grpc::CreateChannel(
+        config.serverIP + ":" + std::to_string(config.serverPort), grpc::InsecureChannelCredentials()));
+    bool localServer = config.serverIP == "127.0.0.1" || config.serverIP == "localhost";
+
+    // Each repetition runs every client once, client i on dataset i % M
+    std::vector<RunTotals> runs;
+    RunTotals aggregate;
+    for (int repetition = 0; repetition < config.repetitions; ++repetition) {
+        std::vector<std::thread> threads;
+        std::vector<char> succeeded(config.numClients, 0);
+        double cpuBefore = serverCpuSeconds(*statsStub);
+        uint64_t loopbackBefore = localServer ? loopbackBytes() : 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < config.numClients; ++i) {
+            threads.emplace_back([&, i]() {
+                succeeded[i] = benchmarkClient(clients[i], config.datasetPaths[i % config.datasetPaths.size()]);
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        RunTotals run;
+        run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        run.loopbackBytes = localServer ? loopbackBytes() - loopbackBefore : 0;
+        double cpuAfter = serverCpuSeconds(*statsStub);
+        run.serverCpuSeconds = cpuBefore >= 0 && cpuAfter >= 0 ? cpuAfter - cpuBefore : 0.0;
+        for (int i = 0; i < config.numClients; ++i) {
+            if (!succeeded[i]) {
+                return EXIT_FAILURE; // benchmarkClient already reported the failure
+            }
+            addStages(run.stages, clients[i].lastIndexingStageTimes());
+        }
+        run.documents = run.stages.documents;
+        run.bytes = run.stages.bytes;
+        std::cout << "Repetition " << repetition + 1 << ": " << run.documents << " documents, " << run.bytes
+                  << " bytes in " << run.seconds << " seconds (" << run.bytes / run.seconds / 1e6 << " MB/s, "
+                  << run.documents / run.seconds << " docs/s)" << std::endl;
+        printWireCost(run);
 
-    // Join all threads
-    for (auto& t : threads) {
-        // std::cout << "[DEBUG] Waiting for thread to join..." << std::endl;
-        t.join();
+        aggregate.seconds += run.seconds;
+        aggregate.documents += run.documents;
+        aggregate.bytes += run.bytes;
+        aggregate.serverCpuSeconds += run.serverCpuSeconds;
+        aggregate.loopbackBytes += run.loopbackBytes;
+        addStages(aggregate.stages, run.stages);
+        runs.push_back(run);
     }
 
-    // std::cout << "[DEBUG] All clients finished indexing." << std::endl;
+    // Per-phase split; stages run concurrently, and the server times are measured on the server
+    const IndexingStageTimes& stages = aggregate.stages;
+    std::cout << "Aggregate: " << aggregate.bytes / aggregate.seconds / 1e6 << " MB/s, "
+              << aggregate.documents / aggregate.seconds << " docs/s" << std::endl;
+    printWireCost(aggregate);
+    std::cout << "Phases (summed over clients): read " << stages.read << "s, tokenize " << stages.tokenize
+              << "s, serialize " << stages.serialize << "s, rpc " << stages.send << "s, server apply " << stages.serverApply << "s, server log wait " << stages.serverLogWait << "s"
+              << std::endl;
 
-    // Perform search queries using the first available client after indexing
-    // std::cout << "[DEBUG] Performing search with terms: ";
-    for (const auto& term : query_terms) {
-        std::cout << term << " ";
+    // Perform the search query using the first client after indexing
+    double searchSeconds = 0.0;
+    if (!config.queryTerms.empty()) {
+        for (const auto& term : config.queryTerms) {
+            std::cout << term << " ";
+        }
+        std::cout << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        if (!clients[0].search(config.queryTerms)) { // Use search method to handle the query
+            std::cerr << "Search failed." << std::endl;
+        }
+        searchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
-    std::cout << std::endl;
 
-    // Using client 0 (or any available client) for search
-    if (!clients[0].search(query_terms)) { // Use search method to handle the query
-        std::cerr << "Search failed." << std::endl;
+    if (config.jsonPath == "-") {
+        writeJson(std::cout, config, runs, aggregate, searchSeconds);
+    } else if (!config.jsonPath.empty()) {
+        std::ofstream json(config.jsonPath);
+        writeJson(json, config, runs, aggregate, searchSeconds);
+        if (!json) {
+            std::cerr << "Error: could not write " << config.jsonPath << std::endl;
+            return EXIT_FAILURE;
+        }
     }
 
     return EXIT_SUCCESS;
 }
-
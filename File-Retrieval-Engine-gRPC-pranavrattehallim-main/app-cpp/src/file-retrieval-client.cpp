@@ -1,11 +1,37 @@
 #include "ClientAppInterface.hpp"
 #include "ClientProcessingEngine.hpp"
 #include <iostream>
+#include <string>
+#include <cstdlib>
 
-int main() {
+int main(int argc, char* argv[]) {
     // Initialize the ClientProcessingEngine
     ClientProcessingEngine clientEngine;
 
+    // Optional arguments: --index-workers N sets the number of tokenizer threads used when indexing,
+    // --top-k N the number of results each search returns, --page-size N the number each page of a paged search holds,
+    // --term-ids sends each indexing stream's terms once and IDs after that, --compression ALG compresses the streams
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        grpc_compression_algorithm compression;
+        if (option == "--index-workers" && i + 1 < argc) {
+            clientEngine.setIndexingWorkers(std::strtoul(argv[++i], nullptr, 10));
+        } else if (option == "--top-k" && i + 1 < argc) {
+            clientEngine.setSearchTopK(std::atoi(argv[++i]));
+        } else if (option == "--page-size" && i + 1 < argc) {
+            clientEngine.setSearchPageSize(std::atoi(argv[++i]));
+        } else if (option == "--term-ids") {
+            clientEngine.setTermIds(true);
+        } else if (option == "--compression" && i + 1 < argc && parseCompressionAlgorithm(argv[i + 1], compression)) {
+            clientEngine.setCompression(compression);
+            ++i;
+        } else {
+            std::cerr << "Usage: file-retrieval-client [--index-workers N] [--top-k N] [--page-size N] [--term-ids] "
+                         "[--compression none|deflate|gzip]" << std::endl;
+            return 1;
+        }
+    }
+
     // Initialize the ClientAppInterface with the ClientProcessingEngine
     ClientAppInterface clientApp(clientEngine);
 
@@ -0,0 +1,72 @@
+#include "PartitionRouter.hpp"
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    int routerPort = 50060;                 // Port clients connect to
+    std::vector<std::string> partitions;    // "host:port" of every file-retrieval-server, in routing order
+
+    // Parse arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--port" && i + 1 < argc) {
+            routerPort = std::atoi(argv[++i]);
+        } else if (option == "--partitions" && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string address;
+            while (std::getline(list, address, ',')) {
+                if (!address.empty()) {
+                    partitions.push_back(address);
+                }
+            }
+        } else {
+            partitions.clear();
+            break;
+        }
+    }
+    if (partitions.empty()) {
+        std::cerr << "Usage: file-retrieval-router --partitions HOST:PORT[,HOST:PORT...] [--port N]" << std::endl;
+        return 1;
+    }
+
+    // The partition list must stay the same across restarts: it decides which server holds each document
+    PartitionRouter router(partitions);
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("0.0.0.0:" + std::to_string(routerPort), grpc::InsecureServerCredentials());
+    builder.RegisterService(&router);
+    builder.SetMaxReceiveMessageSize(INT_MAX); // Indexing batches are forwarded whole, whatever their size
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if (!server) {
+        std::cerr << "Error: could not listen on port " << routerPort << std::endl;
+        return 1;
+    }
+    std::cout << "Router listening on port " << routerPort << " in front of " << partitions.size() << " partitions"
+              << std::endl;
+
+    // Command loop; without a terminal the router just serves until it is killed
+    std::string command;
+    while (true) {
+        std::cout << "\n=== Router Command Menu ===" << std::endl;
+        std::cout << "1. stats - Show RPC latencies and the partitions' index, lock and cache counters" << std::endl;
+        std::cout << "2. quit/exit - Stop the router (the partitions keep running)" << std::endl;
+        std::cout << "Enter command: ";
+        if (!std::getline(std::cin, command)) {
+            server->Wait();
+            return 0;
+        }
+        if (command == "quit" || command == "exit") {
+            std::cout << "Shutting down the router..." << std::endl;
+            server->Shutdown();
+            return 0;
+        } else if (command == "stats") {
+            router.reportStats();
+        } else {
+            std::cout << "Invalid command. Please try again." << std::endl;
+        }
+    }
+}
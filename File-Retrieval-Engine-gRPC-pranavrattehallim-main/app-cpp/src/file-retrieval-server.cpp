@@ -2,16 +2,222 @@
 #include "ServerAppInterface.hpp"
 #include "IndexStore.hpp"
 #include "FileRetrievalEngineImpl.hpp"
+#include "WriteAheadLog.hpp"
+#include "ResultCache.hpp"
+#include "SearchCursorStore.hpp"
+#include "SearchWorkerPool.hpp"
+#include "ReplicationLog.hpp"
+#include "ReplicaFollower.hpp"
+#include "IndexWireFormat.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <string>
+#include <thread>
 
-int main() {
+int main(int argc, char* argv[]) {
     int serverPort = 50051; // Define the server port
+    std::string snapshotPath = "index.snapshot"; // File the index is saved to and restored from
+    std::string walPath = "index.wal";           // Write-ahead log of indexing operations since the last snapshot
+    WalOptions walOptions;                       // Group commit settings
+    AsyncServerOptions asyncOptions;             // Thread layout of the async server
+    bool async = false;                          // Serve from completion queues instead of the sync server
+    size_t cacheBytes = 64 << 20;                // Memory budget of the search result cache (0 disables it)
+    size_t cursorBytes = 64 << 20;               // Memory budget of the result sets behind search cursors (0 disables them)
+    long cursorTtlSeconds = 60;                  // How long an unused search cursor stays valid
+    size_t mergeSegments = 16;                   // Pending delta segments that trigger a merge (0 indexes into the shards directly)
+    long mergeIntervalMs = 100;                  // Longest a delta segment waits to be merged
+    size_t batchThreads = std::max(1u, std::thread::hardware_concurrency()); // Workers running the searches of a batch (0: in turn)
+    grpc_compression_algorithm compression = GRPC_COMPRESS_NONE; // Compression of the server's replies
+    bool serveReplicas = false;                  // Keep updates since the last snapshot for replicas to follow
+    std::string primaryAddress;                  // Run as a read-only replica of this "host:port"
+    bool snapshotPathSet = false;                // Whether --snapshot was given
+
+    // Parse optional arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--port" && i + 1 < argc) {
+            serverPort = std::atoi(argv[++i]); // Lets several servers, e.g. the partitions behind a router, share a host
+        } else if (option == "--snapshot" && i + 1 < argc) {
+            snapshotPath = argv[++i]; // Empty path disables snapshots
+            snapshotPathSet = true;
+        } else if (option == "--wal" && i + 1 < argc) {
+            walPath = argv[++i]; // Empty path disables the log (acknowledged documents may be lost on a crash)
+        } else if (option == "--wal-flush-us" && i + 1 < argc) {
+            walOptions.flushInterval = std::chrono::microseconds(std::atol(argv[++i]));
+        } else if (option == "--wal-flush-bytes" && i + 1 < argc) {
+            walOptions.flushBytes = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (option == "--cache-bytes" && i + 1 < argc) {
+            cacheBytes = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (option == "--cursor-bytes" && i + 1 < argc) {
+            cursorBytes = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (option == "--cursor-ttl-seconds" && i + 1 < argc) {
+            cursorTtlSeconds = std::atol(argv[++i]);
+        } else if (option == "--merge-segments" && i + 1 < argc) {
+            mergeSegments = std::strtoul(argv[++i], nullptr, 10);
+        } else if (option == "--merge-interval-ms" && i + 1 < argc) {
+            mergeIntervalMs = std::atol(argv[++i]);
+        } else if (option == "--batch-threads" && i + 1 < argc) {
+            batchThreads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (option == "--compression" && i + 1 < argc && parseCompressionAlgorithm(argv[i + 1], compression)) {
+            ++i; // Clients choose how to compress their own requests
+        } else if (option == "--serve-replicas") {
+            serveReplicas = true;
+        } else if (option == "--replica-of" && i + 1 < argc) {
+            primaryAddress = argv[++i];
+        } else if (option == "--async") {
+            async = true;
+        } else if (option == "--ingest-threads" && i + 1 < argc) {
+            asyncOptions.ingestThreads = std::strtoul(argv[++i], nullptr, 10);
+            async = true;
+        } else if (option == "--ingest-queues" && i + 1 < argc) {
+            asyncOptions.ingestQueues = std::strtoul(argv[++i], nullptr, 10);
+            async = true;
+        } else if (option == "--query-threads" && i + 1 < argc) {
+            asyncOptions.queryThreads = std::strtoul(argv[++i], nullptr, 10);
+            async = true;
+        } else if (option == "--query-queues" && i + 1 < argc) {
+            asyncOptions.queryQueues = std::strtoul(argv[++i], nullptr, 10);
+            async = true;
+        } else if (option == "--pin-threads") {
+            asyncOptions.pinThreads = true;
+            async = true;
+        } else {
+            std::cerr << "Usage: file-retrieval-server [--port N] [--snapshot PATH] [--wal PATH] [--wal-flush-us N] "
+                         "[--wal-flush-bytes N] [--cache-bytes N] [--cursor-bytes N] [--cursor-ttl-seconds N] [--merge-segments N] [--merge-interval-ms N] [--batch-threads N] [--compression none|deflate|gzip] [--serve-replicas | --replica-of HOST:PORT] [--async] [--ingest-threads N] [--ingest-queues N] "
+                         "[--query-threads N] [--query-queues N] [--pin-threads]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (serveReplicas && !primaryAddress.empty()) {
+        std::cerr << "Error: a replica cannot serve replicas of its own" << std::endl;
+        return 1;
+    }
 
     // Create a shared IndexStore instance
     auto indexStore = std::make_shared<IndexStore>();
 
+    // A replica starts from the primary's snapshot and follows its updates instead of keeping its own files. The
+    // download goes to a file named after the port so several replicas can share a directory.
+    std::shared_ptr<ReplicaFollower> replica;
+    if (!primaryAddress.empty()) {
+        if (!snapshotPathSet) {
+            snapshotPath = "replica-" + std::to_string(serverPort) + ".snapshot";
+        }
+        if (snapshotPath.empty()) {
+            std::cerr << "Error: a replica needs a --snapshot file to download the primary's snapshot to" << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string error;
+        replica = std::make_shared<ReplicaFollower>(primaryAddress);
+        indexStore = replica->bootstrap(snapshotPath, error);
+        if (!indexStore) {
+            std::cerr << "Error: could not bootstrap from " << primaryAddress << ": " << error << std::endl;
+            return 1;
+        }
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+        IndexMemoryUsage usage = indexStore->estimateMemoryUsage();
+        std::cout << "Bootstrapped from " << primaryAddress << " (" << usage.documentCount << " documents at update "
+                  << indexStore->snapshotLogSequence() << ") in " << duration.count() << " seconds" << std::endl;
+        walPath.clear(); // The primary's log is the replica's durability
+    }
+
+    // Restore the index from the last snapshot; the file is mapped, not deserialized
+    if (!replica && !snapshotPath.empty() && std::filesystem::exists(snapshotPath)) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string error;
+        if (indexStore->loadSnapshot(snapshotPath, error)) {
+            std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+            IndexMemoryUsage usage = indexStore->estimateMemoryUsage();
+            std::cout << "Loaded index snapshot " << snapshotPath << " (" << usage.documentCount << " documents, "
+                      << usage.termCount << " terms, " << usage.postingCount << " postings) in "
+                      << duration.count() << " seconds" << std::endl;
+        } else {
+            std::cerr << "Error: could not load snapshot " << snapshotPath << ": " << error
+                      << "; starting with an empty index" << std::endl;
+        }
+    }
+
+    // Updates for replicas start after the snapshot; the log's records are replayed into it below
+    std::shared_ptr<ReplicationLog> replication;
+    if (serveReplicas) {
+        replication = std::make_shared<ReplicationLog>(indexStore->snapshotLogSequence());
+    }
+
+    // Replay the operations logged after the snapshot, then keep logging new ones
+    std::shared_ptr<WriteAheadLog> wal;
+    if (!walPath.empty()) {
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t replayed = 0;
+        std::string error;
+        std::string encoded;
+        wal = WriteAheadLog::open(walPath, walOptions, indexStore->snapshotLogSequence(), [&](const LogRecord& record) {
+            if (record.deleted) {
+                indexStore->deleteDocuments(record.clientID, {record.documentPath});
+            } else {
+                int documentNumber = indexStore->putDocument(record.clientID, record.documentPath);
+                indexStore->updateIndex(documentNumber, record.termFrequencies);
+            }
+            if (replication) {
+                encoded.clear();
+                if (record.deleted) {
+                    WriteAheadLog::encodeDeleteRecord(encoded, record.clientID, record.documentPath);
+                } else {
+                    WriteAheadLog::encodeRecord(encoded, record.clientID, record.documentPath, record.termFrequencies);
+                }
+                replication->publish(encoded, 1, record.sequence);
+            }
+            ++replayed;
+        }, error);
+        if (!wal) {
+            std::cerr << "Error: could not open write-ahead log " << walPath << ": " << error << std::endl;
+            return 1; // Refuse to acknowledge documents that could not be made durable
+        }
+        if (replayed > 0) {
+            std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+            std::cout << "Replayed " << replayed << " records from write-ahead log " << walPath << " in "
+                      << duration.count() << " seconds" << std::endl;
+        }
+    }
+
+    // Drop the postings of replaced and deleted documents in the background, in batches of 1024 or once a second
+    indexStore->startBackgroundPurge(1024, std::chrono::seconds(1));
+
+    // From here on indexing publishes delta segments without taking shard locks, and a background thread merges
+    // them (the log replay above went straight into the shards)
+    if (mergeSegments > 0) {
+        indexStore->startBackgroundMerge(mergeSegments, std::chrono::milliseconds(std::max(mergeIntervalMs, 1L)));
+    }
+
     // Initialize the ServerProcessingEngine with the IndexStore
     ServerProcessingEngine serverEngine(indexStore);
+    serverEngine.setSnapshotPath(replica ? "" : snapshotPath); // A replica downloads a fresh snapshot on every start
+    serverEngine.setWriteAheadLog(wal);
+    if (replication) {
+        serverEngine.setReplicationLog(replication);
+    }
+    if (replica) {
+        serverEngine.setReplica(replica);
+        replica->start();
+    }
+    if (cacheBytes > 0) {
+        serverEngine.setResultCache(std::make_shared<ResultCache>(cacheBytes));
+    }
+    if (cursorBytes > 0 && cursorTtlSeconds > 0) {
+        serverEngine.setSearchCursors(
+            std::make_shared<SearchCursorStore>(cursorBytes, std::chrono::seconds(cursorTtlSeconds)));
+    }
+    if (batchThreads > 0) {
+        serverEngine.setSearchWorkers(std::make_shared<SearchWorkerPool>(batchThreads));
+    }
+    if (async) {
+        serverEngine.setAsyncOptions(asyncOptions);
+    }
+    serverEngine.setCompression(compression);
 
     // Initialize the ServerAppInterface with a reference to the ServerProcessingEngine
     ServerAppInterface serverApp(serverEngine);
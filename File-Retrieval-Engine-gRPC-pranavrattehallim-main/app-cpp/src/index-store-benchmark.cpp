@@ -0,0 +1,809 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <cstdlib> // for EXIT_SUCCESS / EXIT_FAILURE
+#include <filesystem> // for the temporary snapshot file
+#include <algorithm> // for std::stable_sort in the exhaustive search reference
+#include <map> // for the prefix query reference
+#include <unistd.h> // for sysconf
+#include "IndexStore.hpp"
+#include "WriteAheadLog.hpp"
+#include "IntersectionEngine.hpp"
+#include "ResultCache.hpp"
+
+// Parameters of the synthetic corpus fed straight into the IndexStore (no gRPC involved)
+struct CorpusConfig {
+    int documents = 20000;        // Number of documents to index
+    int vocabulary = 50000;       // Number of distinct words the corpus draws from
+    int wordsPerDocument = 200;   // Word draws per document (duplicates fold into frequencies)
+    int repetitions = 20;         // Times each benchmarked query is repeated
+    int shards = static_cast<int>(IndexStore::defaultShardCount); // Term dictionary shards in the store
+};
+
+// Reads the resident set size of this process in bytes
+static size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    statm >> totalPages >> residentPages;
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Generates the term frequency list of one document; word ranks are log-uniform so a few words are very common
+static std::vector<std::pair<std::string, int>> generateDocument(const CorpusConfig& config, std::mt19937& rng) {
+    std::uniform_real_distribution<double> rankDistribution(0.0, 1.0);
+    std::uniform_int_distribution<int> countDistribution(1, 5);
+
+    std::unordered_map<std::string, int> frequencies;
+    for (int i = 0; i < config.wordsPerDocument; ++i) {
+        int rank = static_cast<int>(std::pow(static_cast<double>(config.vocabulary), rankDistribution(rng)));
+        frequencies["term" + std::to_string(rank)] += countDistribution(rng);
+    }
+    return {frequencies.begin(), frequencies.end()};
+}
+
+// Builds the path a client would send for the given document
+static std::string documentPath(int document) {
+    return "/data/corpus/folder_" + std::to_string(document % 100) + "/document_" + std::to_string(document) + ".txt";
+}
+
+// Indexes the synthetic corpus into the store and returns the number of postings added
+static size_t buildIndex(IndexStore& store, const CorpusConfig& config) {
+    std::mt19937 rng(42); // Fixed seed so runs are comparable
+    size_t postings = 0;
+    for (int document = 0; document < config.documents; ++document) {
+        auto termFrequencies = generateDocument(config, rng);
+        postings += termFrequencies.size();
+        int documentNumber = store.putDocument("1", documentPath(document));
+        store.updateIndex(documentNumber, termFrequencies);
+    }
+    return postings;
+}
+
+// Indexes the synthetic corpus and reports memory per document, both measured (RSS) and estimated by the store
+static void benchmarkMemory(const CorpusConfig& config) {
+    IndexStore store(config.shards);
+
+    size_t residentBefore = residentBytes();
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t postings = buildIndex(store, config);
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    size_t residentGrowth = residentBytes() - residentBefore;
+
+    IndexMemoryUsage usage = store.estimateMemoryUsage();
+    std::cout << "Indexed " << usage.documentCount << " documents, " << usage.termCount << " terms, "
+              << postings << " postings in " << duration.count() << " seconds" << std::endl;
+    std::cout << "Resident memory growth: " << residentGrowth << " bytes ("
+              << residentGrowth / config.documents << " bytes/document, "
+              << static_cast<double>(residentGrowth) / postings << " bytes/posting)" << std::endl;
+    std::cout << "Estimated index memory: " << usage.totalBytes() << " bytes ("
+              << usage.totalBytes() / config.documents << " bytes/document)" << std::endl;
+    std::cout << "  document table: " << usage.documentTableBytes << " bytes" << std::endl;
+    std::cout << "  term dictionary: " << usage.dictionaryBytes << " bytes" << std::endl;
+    std::cout << "  posting lists: " << usage.postingBytes << " bytes ("
+              << static_cast<double>(usage.postingBytes) / postings << " bytes/posting)" << std::endl;
+    std::cout << "  forward index: " << usage.forwardIndexBytes << " bytes" << std::endl;
+
+    // Compress the tails left behind by terms that never filled a block
+    start = std::chrono::high_resolution_clock::now();
+    store.compactPostings();
+    duration = std::chrono::high_resolution_clock::now() - start;
+    usage = store.estimateMemoryUsage();
+    std::cout << "After compacting posting tails (" << duration.count() << " seconds): posting lists "
+              << usage.postingBytes << " bytes (" << static_cast<double>(usage.postingBytes) / postings
+              << " bytes/posting), index " << usage.totalBytes() << " bytes" << std::endl;
+}
+
+// Times term lookups and measures the term dictionary's memory per term, before and after freezing it, then with
+// new terms in the mutable overlay. Most vocabulary words are rare, so their posting list copies are short and a
+// lookup costs mostly the dictionary probe; a missing word costs the probe alone.
+static void benchmarkDictionary(const CorpusConfig& config) {
+    IndexStore store(config.shards);
+    buildIndex(store, config);
+    store.compactPostings();
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> rankDistribution(1, config.vocabulary);
+    std::vector<std::string> vocabulary, missing;
+    for (int i = 0; i < 10000; ++i) {
+        vocabulary.push_back("term" + std::to_string(rankDistribution(rng)));
+        missing.push_back("absent" + std::to_string(i));
+    }
+
+    // Returns the lookup time in nanoseconds and the postings found, which must not change with the layout
+    auto timeLookups = [&](const std::vector<std::string>& terms, size_t& postings) {
+        postings = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < config.repetitions; ++i) {
+            for (const auto& term : terms) {
+                postings += store.lookupIndex(term).size();
+            }
+        }
+        std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - start;
+        return duration.count() / (static_cast<double>(terms.size()) * config.repetitions);
+    };
+    auto report = [&](const std::string& phase) {
+        IndexMemoryUsage usage = store.estimateMemoryUsage();
+        size_t found = 0, notFound = 0;
+        double vocabularyNs = timeLookups(vocabulary, found);
+        double missingNs = timeLookups(missing, notFound);
+        // Every term also has a TermEntry (the posting list header and its slot), whichever structure holds it
+        double keyBytes = static_cast<double>(usage.dictionaryBytes) - usage.termCount * sizeof(TermEntry);
+        std::cout << phase << ": " << usage.termCount << " terms (" << usage.frozenTermCount << " frozen), "
+                  << static_cast<double>(usage.dictionaryBytes) / usage.termCount << " dictionary bytes/term ("
+                  << keyBytes / usage.termCount << " besides the TermEntry), lookup " << vocabularyNs
+                  << " ns/op for vocabulary words, " << missingNs << " ns/op for missing words" << std::endl;
+        return found;
+    };
+
+    size_t mutablePostings = report("Mutable dictionary");
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t frozen = store.freezeDictionary();
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Froze " << frozen << " terms in " << duration.count() << " seconds" << std::endl;
+    size_t frozenPostings = report("Frozen dictionary");
+    std::cout << "Lookups found the same postings: " << (mutablePostings == frozenPostings ? "yes" : "NO") << std::endl;
+
+    // New words land in the overlay; lookups of frozen words do not see it
+    std::mt19937 documentRng(43);
+    int extraDocuments = std::max(1, config.documents / 20);
+    for (int document = 0; document < extraDocuments; ++document) {
+        auto termFrequencies = generateDocument(config, documentRng);
+        for (int word = 0; word < 10; ++word) {
+            termFrequencies.emplace_back("newterm" + std::to_string(document * 10 + word), 1);
+        }
+        int documentNumber = store.putDocument("1", documentPath(config.documents + document));
+        store.updateIndex(documentNumber, termFrequencies);
+    }
+    report("After " + std::to_string(extraDocuments) + " more documents");
+    store.freezeDictionary();
+    report("Frozen again");
+
+    // The two structures alone, without the shard lock and the posting list copy, over every indexed word
+    std::vector<std::string> indexed;
+    for (int rank = 1; rank <= config.vocabulary; ++rank) {
+        std::string term = "term" + std::to_string(rank);
+        if (store.lookupIndex(term).size() > 0) {
+            indexed.push_back(term);
+        }
+    }
+    std::unordered_map<std::string, TermEntry> hashMap;
+    std::vector<std::string_view> views(indexed.begin(), indexed.end());
+    for (const auto& term : indexed) {
+        hashMap.try_emplace(term);
+    }
+    FrozenTermDictionary dictionary;
+    std::vector<uint32_t> positions;
+    dictionary.build(views, positions);
+    std::vector<std::string> probes = indexed;
+    std::shuffle(probes.begin(), probes.end(), rng); // Visit terms in no particular order, as queries do
+    auto timeProbes = [&](auto&& probe) {
+        size_t hits = 0;
+        auto probeStart = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < config.repetitions; ++i) {
+            for (const auto& term : probes) {
+                hits += probe(term);
+            }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - probeStart;
+        return hits == probes.size() * config.repetitions ? elapsed.count() / hits : -1.0;
+    };
+    double hashMapNs = timeProbes([&](const std::string& term) { return hashMap.count(term); });
+    double frozenNs = timeProbes([&](const std::string& term) {
+        return dictionary.find(term, FrozenTermDictionary::hash(term)) != FrozenTermDictionary::npos ? 1 : 0;
+    });
+    std::cout << "Finding " << indexed.size() << " indexed words: std::unordered_map " << hashMapNs
+              << " ns/op, frozen dictionary " << frozenNs << " ns/op ("
+              << static_cast<double>(dictionary.memoryBytes()) / indexed.size() << " bytes/term)" << std::endl;
+}
+
+// Times prefix queries against the number of terms they expand to, under the default cap and the largest one, with
+// the terms in each place the dictionary keeps them: the mutable overlays, the frozen dictionaries plus an overlay,
+// and a loaded snapshot plus an overlay. Each answer is checked against a reference that scans the whole
+// vocabulary for the prefix and merges the postings with a std::map.
+static void benchmarkPrefix(const CorpusConfig& config) {
+    std::string path = (std::filesystem::temp_directory_path() / "index-store-benchmark-prefix.snapshot").string();
+    std::vector<std::string> prefixes = {"term12345", "term1234", "term123", "term12", "term1", "term"};
+
+    // Later documents add words past the vocabulary, so some expansions span two places
+    int extraDocuments = std::max(1, config.documents / 20);
+    auto addDocuments = [&](IndexStore& store) {
+        std::mt19937 rng(43);
+        for (int document = 0; document < extraDocuments; ++document) {
+            auto termFrequencies = generateDocument(config, rng);
+            termFrequencies.emplace_back("term" + std::to_string(config.vocabulary + document), 1);
+            int documentNumber = store.putDocument("1", documentPath(config.documents + document));
+            store.updateIndex(documentNumber, termFrequencies);
+        }
+    };
+
+    auto run = [&](IndexStore& store, const std::string& phase) {
+        std::vector<std::string> words; // The reference's dictionary: every word indexed, in term order
+        for (int rank = 1; rank < config.vocabulary + extraDocuments; ++rank) {
+            words.push_back("term" + std::to_string(rank));
+        }
+        std::sort(words.begin(), words.end());
+
+        std::cout << phase << ":" << std::endl;
+        for (const auto& prefix : prefixes) {
+            for (size_t cap : {IndexStore::defaultMaxExpansions, size_t{4096}}) {
+                std::vector<std::pair<std::string, int>> results;
+                size_t matches = 0, expanded = 0;
+                bool exact = true, truncated = false;
+                std::vector<std::string> query = {prefix + "*"};
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < config.repetitions; ++i) {
+                    results = store.getTopResults(query, 10, &matches, &exact, cap, &expanded, &truncated);
+                }
+                std::chrono::duration<double, std::milli> prefixTime = std::chrono::high_resolution_clock::now() - start;
+
+                // Reference: test every word, keep the first cap that have postings, sum the frequencies per document
+                std::vector<std::pair<int, int>> merged;
+                size_t referenceExpanded = 0;
+                start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < config.repetitions; ++i) {
+                    std::map<int, int> documents;
+                    referenceExpanded = 0;
+                    for (const auto& word : words) {
+                        if (referenceExpanded == cap || word.compare(0, prefix.size(), prefix) != 0) {
+                            continue;
+                        }
+                        PostingList postings = store.lookupIndex(word);
+                        if (postings.empty()) {
+                            continue;
+                        }
+                        ++referenceExpanded;
+                        for (PostingIterator it = postings.begin(); !it.atEnd(); it.next()) {
+                            documents[it.document()] += it.frequency();
+                        }
+                    }
+                    merged.assign(documents.begin(), documents.end());
+                }
+                std::chrono::duration<double, std::milli> scanTime = std::chrono::high_resolution_clock::now() - start;
+                std::stable_sort(merged.begin(), merged.end(), [](const auto& a, const auto& b) {
+                    return a.second > b.second;
+                });
+                std::vector<std::pair<std::string, int>> referenceResults;
+                for (size_t i = 0; i < std::min<size_t>(merged.size(), 10); ++i) {
+                    referenceResults.emplace_back(store.getDocument(merged[i].first), merged[i].second);
+                }
+                bool match = results == referenceResults && expanded == referenceExpanded &&
+                             (exact ? matches == merged.size() : matches <= merged.size());
+
+                std::cout << "  " << prefix << "* (cap " << cap << "): " << expanded << " terms expanded"
+                          << (truncated ? " (capped)" : "") << ", " << merged.size() << " matches, "
+                          << prefixTime.count() / config.repetitions << " ms/query; vocabulary scan "
+                          << scanTime.count() / config.repetitions << " ms/query; results "
+                          << (match ? "match" : "DIFFER") << std::endl;
+            }
+        }
+    };
+
+    IndexStore store(config.shards);
+    buildIndex(store, config);
+    addDocuments(store);
+    run(store, "Mutable dictionary");
+
+    IndexStore frozen(config.shards);
+    buildIndex(frozen, config);
+    if (!frozen.saveSnapshot(path)) { // Before the later documents, which the restored store indexes itself
+        return;
+    }
+    frozen.freezeDictionary();
+    addDocuments(frozen);
+    run(frozen, "Frozen dictionary plus overlay");
+
+    IndexStore restored(config.shards);
+    std::string error;
+    if (!restored.loadSnapshot(path, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return;
+    }
+    std::filesystem::remove(path);
+    addDocuments(restored);
+    run(restored, "Snapshot plus overlay");
+}
+
+// Measures how fast compressed posting lists decode, both by full scans and through block-skipping advance()
+static void benchmarkDecode(const CorpusConfig& config) {
+    IndexStore store(config.shards);
+    buildIndex(store, config);
+    store.compactPostings();
+
+    // The most common terms have the longest lists; term1 is the most common word
+    std::vector<PostingList> lists;
+    size_t postings = 0;
+    for (int rank = 1; rank <= 100; ++rank) {
+        lists.push_back(store.lookupIndex("term" + std::to_string(rank)));
+        postings += lists.back().size();
+    }
+
+    // Full scan with next()
+    long long checksum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        for (const auto& list : lists) {
+            for (PostingIterator it = list.begin(); !it.atEnd(); it.next()) {
+                checksum += it.document() + it.frequency();
+            }
+        }
+    }
+    std::chrono::duration<double> scan = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Iterator scan: " << postings * config.repetitions / scan.count() / 1e6 << " million postings/s"
+              << std::endl;
+
+    // Bulk decode into arrays
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        for (const auto& list : lists) {
+            std::vector<int> documents, frequencies;
+            list.decode(documents, frequencies);
+            checksum += documents.back();
+        }
+    }
+    std::chrono::duration<double> bulk = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Bulk decode: " << postings * config.repetitions / bulk.count() / 1e6 << " million postings/s"
+              << std::endl;
+
+    // advance() to every 1000th document, as when intersecting with a rare term
+    size_t probes = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        for (const auto& list : lists) {
+            PostingIterator it = list.begin();
+            for (int target = 1; !it.atEnd(); target += 1000, ++probes) {
+                it.advance(target);
+                checksum += it.atEnd() ? 0 : it.document();
+            }
+        }
+    }
+    std::chrono::duration<double> skip = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Sparse advance: " << skip.count() * 1e9 / probes << " ns/probe (checksum " << checksum << ")"
+              << std::endl;
+}
+
+// Times AND queries of 2, 4 and 8 terms, both over common words only and mixed with one rarer word
+static void benchmarkSearch(const CorpusConfig& config) {
+    IndexStore store(config.shards);
+    buildIndex(store, config);
+
+    for (int termCount : {2, 4, 8}) {
+        // Ranks 1..N are the most frequent words; rank 500 is far rarer and drives the mixed query
+        std::vector<std::string> commonTerms;
+        for (int rank = 1; rank <= termCount; ++rank) {
+            commonTerms.push_back("term" + std::to_string(rank));
+        }
+        std::vector<std::string> mixedTerms = commonTerms;
+        mixedTerms.back() = "term500";
+
+        for (const auto& [label, terms] : {std::pair{"common", commonTerms}, std::pair{"mixed", mixedTerms}}) {
+            // Exhaustive reference: intersect everything, then sort all matches and cut to the top 10
+            std::vector<std::pair<std::string, int>> exhaustiveResults;
+            size_t allMatches = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < config.repetitions; ++i) {
+                std::vector<PostingList> postings;
+                std::vector<const PostingList*> lists;
+                for (const auto& term : terms) {
+                    postings.push_back(store.lookupIndex(term));
+                }
+                for (const auto& list : postings) {
+                    lists.push_back(&list);
+                }
+                std::vector<std::pair<int, int>> matches = IntersectionEngine::intersect(lists);
+                allMatches = matches.size();
+                std::stable_sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) {
+                    return a.second > b.second;
+                });
+                matches.resize(std::min<size_t>(matches.size(), 10));
+                exhaustiveResults.clear();
+                for (const auto& [document, frequency] : matches) {
+                    exhaustiveResults.emplace_back(store.getDocument(document), frequency);
+                }
+            }
+            std::chrono::duration<double, std::milli> exhaustive = std::chrono::high_resolution_clock::now() - start;
+
+            // Bounded top-10 heap with block-max early termination
+            std::vector<std::pair<std::string, int>> topResults;
+            size_t totalMatches = 0;
+            bool totalExact = true;
+            start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < config.repetitions; ++i) {
+                topResults = store.getTopResults(terms, 10, &totalMatches, &totalExact);
+            }
+            std::chrono::duration<double, std::milli> topK = std::chrono::high_resolution_clock::now() - start;
+
+            std::cout << termCount << "-term " << label << " query: " << allMatches << " matches, exhaustive "
+                      << exhaustive.count() / config.repetitions << " ms/query, top-10 "
+                      << topK.count() / config.repetitions << " ms/query (" << (totalExact ? "" : "at least ")
+                      << totalMatches << " matches seen, results "
+                      << (topResults == exhaustiveResults ? "match" : "DIFFER") << ")" << std::endl;
+        }
+    }
+}
+
+// Runs a repeating set of queries straight against the store and through the result cache, then again with a
+// document indexed between rounds so every round starts from a stale cache
+static void benchmarkCache(const CorpusConfig& config) {
+    IndexStore store(config.shards);
+    buildIndex(store, config);
+
+    // Ten 2-term queries over common words, the kind users repeat
+    std::vector<std::vector<std::string>> queries;
+    for (int rank = 1; rank <= 10; ++rank) {
+        queries.push_back({"term" + std::to_string(rank), "term" + std::to_string(rank + 10)});
+    }
+
+    // Answers one query through the cache, as ComputeSearch does
+    ResultCache cache(64 << 20);
+    auto cachedSearch = [&](const std::vector<std::string>& terms) {
+        std::string key = ResultCache::makeKey(terms, 10, IndexStore::defaultMaxExpansions);
+        uint64_t generation = store.generation();
+        CachedSearch search;
+        if (!cache.lookup(key, generation, search)) {
+            search.results = store.getTopResults(terms, 10, &search.totalMatches, &search.totalExact);
+            cache.insert(key, generation, search);
+        }
+        return search.results;
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        for (const auto& terms : queries) {
+            store.getTopResults(terms, 10);
+        }
+    }
+    std::chrono::duration<double, std::milli> uncached = std::chrono::high_resolution_clock::now() - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        for (const auto& terms : queries) {
+            cachedSearch(terms);
+        }
+    }
+    std::chrono::duration<double, std::milli> cached = std::chrono::high_resolution_clock::now() - start;
+    ResultCacheStats stats = cache.stats();
+    bool match = true;
+    for (const auto& terms : queries) {
+        match = cachedSearch(terms) == store.getTopResults(terms, 10) && match;
+    }
+    size_t searches = queries.size() * config.repetitions;
+    std::cout << "Without cache: " << uncached.count() / searches << " ms/query" << std::endl;
+    std::cout << "With cache: " << cached.count() / searches << " ms/query (" << stats.hits << " hits, "
+              << stats.misses << " misses, " << stats.bytes << " bytes, results " << (match ? "match" : "DIFFER")
+              << ")" << std::endl;
+
+    // Each new document invalidates every entry, so the first round after it misses once per query
+    std::mt19937 rng(7);
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        int documentNumber = store.putDocument("2", documentPath(config.documents + i));
+        store.updateIndex(documentNumber, generateDocument(config, rng));
+        for (int repeat = 0; repeat < 5; ++repeat) {
+            for (const auto& terms : queries) {
+                cachedSearch(terms);
+            }
+        }
+    }
+    std::chrono::duration<double, std::milli> invalidated = std::chrono::high_resolution_clock::now() - start;
+    ResultCacheStats after = cache.stats();
+    stats.hits += queries.size(); // The verification pass hit once per query
+    std::cout << "With one update per 5 rounds of queries: " << invalidated.count() / (searches * 5) << " ms/query ("
+              << after.hits - stats.hits << " hits, " << after.misses - stats.misses << " misses)" << std::endl;
+}
+
+// Measures indexing throughput with 1 to 32 threads each feeding its share of the corpus, like concurrent clients
+static void benchmarkIngest(const CorpusConfig& config) {
+    // Generate the corpus up front so only IndexStore work is timed
+    std::mt19937 rng(42);
+    std::vector<std::vector<std::pair<std::string, int>>> corpus;
+    corpus.reserve(config.documents);
+    for (int document = 0; document < config.documents; ++document) {
+        corpus.push_back(generateDocument(config, rng));
+    }
+
+    for (int clients : {1, 2, 4, 8, 16, 32}) {
+        IndexStore store(config.shards);
+        std::vector<std::thread> threads;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int client = 0; client < clients; ++client) {
+            threads.emplace_back([&, client]() {
+                std::string clientID = std::to_string(client + 1);
+                for (int document = client; document < config.documents; document += clients) {
+                    int documentNumber = store.putDocument(clientID, documentPath(document));
+                    store.updateIndex(documentNumber, corpus[document]);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+
+        std::cout << clients << " clients: " << config.documents / duration.count() << " documents/s ("
+                  << duration.count() << " seconds)" << std::endl;
+    }
+}
+
+// Compares restarting from a snapshot (save, map, first query) with rebuilding the index from scratch
+static void benchmarkSnapshot(const CorpusConfig& config) {
+    std::string path = (std::filesystem::temp_directory_path() / "index-store-benchmark.snapshot").string();
+    std::vector<std::string> query = {"term1", "term2", "term3", "term500"};
+
+    IndexStore built(config.shards);
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t postings = buildIndex(built, config);
+    std::chrono::duration<double> rebuild = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Rebuilt " << config.documents << " documents, " << postings << " postings in "
+              << rebuild.count() << " seconds" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    if (!built.saveSnapshot(path)) {
+        return;
+    }
+    std::chrono::duration<double> save = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Saved snapshot: " << std::filesystem::file_size(path) << " bytes in " << save.count()
+              << " seconds" << std::endl;
+
+    IndexStore restored(config.shards);
+    std::string error;
+    start = std::chrono::high_resolution_clock::now();
+    if (!restored.loadSnapshot(path, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return;
+    }
+    std::chrono::duration<double, std::milli> load = std::chrono::high_resolution_clock::now() - start;
+
+    start = std::chrono::high_resolution_clock::now();
+    auto restoredResults = restored.getTopResults(query, 10);
+    std::chrono::duration<double, std::milli> firstQuery = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Loaded snapshot in " << load.count() << " ms, first query answered after "
+              << load.count() + firstQuery.count() << " ms (" << rebuild.count() * 1000.0 / (load.count() + firstQuery.count())
+              << "x faster than rebuilding)" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        restored.getTopResults(query, 10);
+    }
+    std::chrono::duration<double, std::milli> warm = std::chrono::high_resolution_clock::now() - start;
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < config.repetitions; ++i) {
+        built.getTopResults(query, 10);
+    }
+    std::chrono::duration<double, std::milli> inMemory = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Query from snapshot: " << warm.count() / config.repetitions << " ms/query, from memory: "
+              << inMemory.count() / config.repetitions << " ms/query" << std::endl;
+    std::cout << "Results match: " << (restoredResults == built.getTopResults(query, 10) ? "yes" : "no") << std::endl;
+
+    std::filesystem::remove(path);
+}
+
+// Measures the cost of durable indexing: concurrent clients wait for the group commit of their document before the
+// next one, as ComputeIndex does, compared with indexing straight into memory
+static void benchmarkWal(const CorpusConfig& config) {
+    std::string path = (std::filesystem::temp_directory_path() / "index-store-benchmark.wal").string();
+
+    std::mt19937 rng(42);
+    std::vector<std::vector<std::pair<std::string, int>>> corpus;
+    corpus.reserve(config.documents);
+    for (int document = 0; document < config.documents; ++document) {
+        corpus.push_back(generateDocument(config, rng));
+    }
+
+    for (int clients : {1, 4, 16, 32}) {
+        // Interval 0 syncs each group as soon as the previous fsync finishes; -1 runs without a log
+        for (int flushMicroseconds : {-1, 0, 1000, 5000}) {
+            std::filesystem::remove(path);
+            std::shared_ptr<WriteAheadLog> wal;
+            if (flushMicroseconds >= 0) {
+                WalOptions options;
+                options.flushInterval = std::chrono::microseconds(flushMicroseconds);
+                std::string error;
+                wal = WriteAheadLog::open(path, options, 0, [](const LogRecord&) {}, error);
+                if (!wal) {
+                    std::cerr << "Error: " << error << std::endl;
+                    return;
+                }
+            }
+
+            IndexStore store(config.shards);
+            std::vector<std::thread> threads;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int client = 0; client < clients; ++client) {
+                threads.emplace_back([&, client]() {
+                    std::string clientID = std::to_string(client + 1);
+                    std::string record;
+                    for (int document = client; document < config.documents; document += clients) {
+                        uint64_t sequence = 0;
+                        if (wal) {
+                            record.clear();
+                            WriteAheadLog::encodeRecord(record, clientID, documentPath(document), corpus[document]);
+                            sequence = wal->append(record, 1);
+                        }
+                        int documentNumber = store.putDocument(clientID, documentPath(document));
+                        store.updateIndex(documentNumber, corpus[document]);
+                        if (wal) {
+                            wal->waitDurable(sequence);
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+
+            std::cout << clients << " clients, ";
+            if (wal) {
+                auto [fsyncs, records] = wal->commitStats();
+                std::cout << "log flush interval " << flushMicroseconds << " us: " << config.documents / duration.count()
+                          << " documents/s (" << fsyncs << " fsyncs, "
+                          << static_cast<double>(records) / std::max<uint64_t>(fsyncs, 1) << " documents/fsync)" << std::endl;
+            } else {
+                std::cout << "no log: " << config.documents / duration.count() << " documents/s" << std::endl;
+            }
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+// Indexes a corpus version under the standard document paths and returns the seconds taken
+static double indexVersion(IndexStore& store, const std::vector<std::vector<std::pair<std::string, int>>>& corpus,
+                           const std::vector<int>& documents) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int document : documents) {
+        int documentNumber = store.putDocument("1", documentPath(document));
+        store.updateIndex(documentNumber, corpus[document]);
+    }
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Counts the queries whose top 10 (or exact match count) differ between the two stores
+static int compareResults(IndexStore& store, IndexStore& reference) {
+    int mismatches = 0;
+    for (int first = 1; first <= 20; ++first) {
+        std::vector<std::string> terms = {"term" + std::to_string(first), "term" + std::to_string(first * 7 + 3)};
+        size_t matches = 0, referenceMatches = 0;
+        bool exact = false, referenceExact = false;
+        // Early termination makes a count a lower bound that depends on the list layout, so only exact ones compare
+        if (store.getTopResults(terms, 10, &matches, &exact) !=
+                reference.getTopResults(terms, 10, &referenceMatches, &referenceExact) ||
+            (exact && referenceExact && matches != referenceMatches)) {
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+// Re-indexes and deletes documents, then checks that searches and posting counts match a store built fresh from
+// what is left, before and after the purge
+static void benchmarkUpdate(const CorpusConfig& config) {
+    std::mt19937 rng(42);
+    std::vector<std::vector<std::pair<std::string, int>>> original, revised;
+    for (int document = 0; document < config.documents; ++document) {
+        original.push_back(generateDocument(config, rng));
+    }
+    for (int document = 0; document < config.documents; ++document) {
+        revised.push_back(generateDocument(config, rng)); // Same paths, new contents
+    }
+    std::vector<int> all(config.documents), kept;
+    std::vector<std::string> removed;
+    for (int document = 0; document < config.documents; ++document) {
+        all[document] = document;
+        if (document % 2 == 0) {
+            kept.push_back(document);
+        } else {
+            removed.push_back(documentPath(document));
+        }
+    }
+
+    IndexStore store(config.shards);
+    double freshSeconds = indexVersion(store, original, all);
+    std::cout << "Fresh index: " << config.documents / freshSeconds << " documents/s" << std::endl;
+
+    // Re-index every path: each one retires its old version
+    double replaceSeconds = indexVersion(store, revised, all);
+    IndexMemoryUsage usage = store.estimateMemoryUsage();
+    std::cout << "Re-index: " << config.documents / replaceSeconds << " documents/s (" << usage.documentCount
+              << " live, " << usage.deletedDocuments << " replaced, forward index " << usage.forwardIndexBytes
+              << " bytes, " << static_cast<double>(usage.forwardIndexBytes) / usage.totalBytes() * 100
+              << "% of the index)" << std::endl;
+
+    IndexStore revisedOnly(config.shards);
+    indexVersion(revisedOnly, revised, all);
+    std::cout << "  queries differing from a fresh index of the new contents: " << compareResults(store, revisedOnly)
+              << " of 20" << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t purged = store.purgeDeleted();
+    std::chrono::duration<double> purge = std::chrono::high_resolution_clock::now() - start;
+    usage = store.estimateMemoryUsage();
+    std::cout << "Purge: " << purged << " postings in " << purge.count() << " seconds; " << usage.postingCount
+              << " postings left, fresh index holds " << revisedOnly.estimateMemoryUsage().postingCount
+              << "; forward index now " << usage.forwardIndexBytes << " bytes" << std::endl;
+
+    // Delete every other document in one call
+    start = std::chrono::high_resolution_clock::now();
+    size_t deleted = store.deleteDocuments("1", removed);
+    std::chrono::duration<double> deletion = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Delete: " << deleted / deletion.count() << " documents/s (" << deleted << " documents)" << std::endl;
+
+    IndexStore keptOnly(config.shards);
+    indexVersion(keptOnly, revised, kept);
+    std::cout << "  queries differing from a fresh index of the remaining documents: "
+              << compareResults(store, keptOnly) << " of 20" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    purged = store.purgeDeleted();
+    purge = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Purge: " << purged << " postings in " << purge.count() << " seconds; "
+              << store.estimateMemoryUsage().postingCount << " postings left, fresh index holds "
+              << keptOnly.estimateMemoryUsage().postingCount << "; queries differing after the purge: "
+              << compareResults(store, keptOnly) << " of 20" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    CorpusConfig config;
+
+    // First argument selects the benchmark; the rest are optional corpus parameters
+    std::string mode = argc > 1 ? argv[1] : "memory";
+    if (mode != "memory" && mode != "search" && mode != "ingest" && mode != "snapshot" && mode != "wal" &&
+        mode != "decode" && mode != "cache" && mode != "update" && mode != "dictionary" && mode != "prefix") {
+        std::cerr << "Usage: index-store-benchmark <memory|search|ingest|snapshot|wal|decode|cache|update|dictionary|prefix> [--documents N] [--vocabulary N] "
+                     "[--words-per-document N] [--repetitions N] [--shards N]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = std::atoi(argv[i + 1]);
+        if (option == "--documents") {
+            config.documents = value;
+        } else if (option == "--vocabulary") {
+            config.vocabulary = value;
+        } else if (option == "--words-per-document") {
+            config.wordsPerDocument = value;
+        } else if (option == "--repetitions") {
+            config.repetitions = value;
+        } else if (option == "--shards") {
+            config.shards = value;
+        } else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (config.documents <= 0 || config.vocabulary <= 1 || config.wordsPerDocument <= 0 || config.repetitions <= 0 ||
+        config.shards <= 0) {
+        std::cerr << "Corpus parameters must be positive." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mode == "memory") {
+        benchmarkMemory(config);
+    } else if (mode == "search") {
+        benchmarkSearch(config);
+    } else if (mode == "ingest") {
+        benchmarkIngest(config);
+    } else if (mode == "decode") {
+        benchmarkDecode(config);
+    } else if (mode == "cache") {
+        benchmarkCache(config);
+    } else if (mode == "update") {
+        benchmarkUpdate(config);
+    } else if (mode == "dictionary") {
+        benchmarkDictionary(config);
+    } else if (mode == "prefix") {
+        benchmarkPrefix(config);
+    } else if (mode == "snapshot") {
+        benchmarkSnapshot(config);
+    } else {
+        benchmarkWal(config);
+    }
+    return EXIT_SUCCESS;
+}
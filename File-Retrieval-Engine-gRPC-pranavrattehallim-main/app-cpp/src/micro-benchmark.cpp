@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib> // for EXIT_SUCCESS / EXIT_FAILURE
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ClientProcessingEngine.hpp" // For the client tokenizer
+#include "CorpusGenerator.hpp"
+#include "IndexStore.hpp"
+
+// Settings of a run: corpus shape plus harness options
+struct MicroConfig {
+    CorpusOptions corpus;         // Synthetic corpus the benchmarks run on
+    int trials = 5;               // Runs per benchmark; the median is reported
+    std::string saveBaseline;     // File the results are written to as the new baseline
+    std::string compareBaseline;  // Baseline file the results are compared against
+    double tolerance = 10.0;      // Percentage a result may worsen before it is flagged as a regression
+};
+
+// Result of one microbenchmark
+struct Measurement {
+    std::string name;      // Stable identifier, used to match baseline entries
+    double value;          // Median over the trials
+    std::string unit;      // Unit of value
+    bool higherIsBetter;   // Direction in which value improves
+};
+
+// Runs the body once per trial and returns the median of the values it reports
+template <typename Body>
+static double medianOf(int trials, Body body) {
+    std::vector<double> values;
+    for (int trial = 0; trial < trials; ++trial) {
+        values.push_back(body());
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// Seconds elapsed since start
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Indexes every generated document into the store
+static void indexCorpus(IndexStore& store, const std::vector<std::vector<std::pair<std::string, int>>>& documents) {
+    for (size_t document = 0; document < documents.size(); ++document) {
+        int documentNumber = store.putDocument("1", "/corpus/document_" + std::to_string(document) + ".txt");
+        store.updateIndex(documentNumber, documents[document]);
+    }
+}
+
+// Runs every microbenchmark on the generated corpus
+static std::vector<Measurement> runBenchmarks(const MicroConfig& config) {
+    CorpusGenerator generator(config.corpus);
+    std::vector<Measurement> results;
+
+    // Generate up front so only the code under test is timed
+    std::vector<std::string> texts;
+    std::vector<std::vector<std::pair<std::string, int>>> documents;
+    size_t textBytes = 0;
+    for (size_t document = 0; document < config.corpus.documents; ++document) {
+        documents.push_back(generator.termFrequencies(document));
+        if (document < 2000) {
+            texts.push_back(generator.documentText(document)); // The tokenizer needs text; 2000 documents suffice
+            textBytes += texts.back().size();
+        }
+    }
+
+    // Client tokenizer
+    double tokenizeSeconds = medianOf(config.trials, [&]() {
+        auto start = std::chrono::steady_clock::now();
+        size_t words = 0;
+        for (const auto& text : texts) {
+            words += ClientProcessingEngine::extractWordFrequencies(text).size();
+        }
+        double seconds = secondsSince(start);
+        return words > 0 ? seconds : seconds; // Keeps the result alive
+    });
+    results.push_back({"tokenizer.extractWordFrequencies", textBytes / tokenizeSeconds / 1e6, "MB/s", true});
+
+    // Indexing into an empty store
+    double indexSeconds = medianOf(config.trials, [&]() {
+        IndexStore store;
+        auto start = std::chrono::steady_clock::now();
+        indexCorpus(store, documents);
+        return secondsSince(start);
+    });
+    results.push_back({"IndexStore.updateIndex", documents.size() / indexSeconds, "docs/s", true});
+
+    // Lookups and searches run against one fully built, compacted store with a frozen term dictionary
+    IndexStore store;
+    indexCorpus(store, documents);
+    store.compactPostings();
+    store.freezeDictionary();
+
+    const size_t rareRank = std::min<size_t>(5000, config.corpus.vocabulary - 1);
+    const size_t middleRank = std::min<size_t>(100, config.corpus.vocabulary - 1);
+    for (auto [label, rank] : {std::pair{"common", size_t{0}}, std::pair{"middle", middleRank}, std::pair{"rare", rareRank}}) {
+        std::string term = CorpusGenerator::word(rank);
+        int repetitions = rank == 0 ? 200 : 2000;
+        double seconds = medianOf(config.trials, [&]() {
+            size_t postings = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; ++i) {
+                postings += store.lookupIndex(term).size();
+            }
+            double elapsed = secondsSince(start);
+            return postings > 0 ? elapsed : elapsed;
+        });
+        results.push_back({std::string("IndexStore.lookupIndex.") + label, seconds * 1e9 / repetitions, "ns/op", false});
+    }
+
+    // A word that was never indexed costs the dictionary probe alone
+    {
+        const int repetitions = 20000;
+        double seconds = medianOf(config.trials, [&]() {
+            size_t postings = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; ++i) {
+                postings += store.lookupIndex("missing" + std::to_string(i % 64)).size();
+            }
+            double elapsed = secondsSince(start);
+            return postings == 0 ? elapsed : elapsed;
+        });
+        results.push_back({"IndexStore.lookupIndex.missing", seconds * 1e9 / repetitions, "ns/op", false});
+    }
+
+    std::vector<std::pair<std::string, std::vector<std::string>>> queries = {
+        {"common2", {CorpusGenerator::word(0), CorpusGenerator::word(1)}},
+        {"mixed2", {CorpusGenerator::word(0), CorpusGenerator::word(middleRank)}},
+        {"common4", {CorpusGenerator::word(0), CorpusGenerator::word(1), CorpusGenerator::word(2), CorpusGenerator::word(3)}},
+    };
+    for (const auto& [label, terms] : queries) {
+        const int repetitions = 50;
+        double seconds = medianOf(config.trials, [&]() {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repetitions; ++i) {
+                store.getTopResults(terms, 10);
+            }
+            return secondsSince(start);
+        });
+        results.push_back({"IndexStore.getTopResults." + label, seconds * 1e6 / repetitions, "us/op", false});
+    }
+    return results;
+}
+
+// Writes one "name value unit direction" line per measurement
+static bool saveBaseline(const std::string& path, const std::vector<Measurement>& results) {
+    std::ofstream out(path);
+    out << std::setprecision(10);
+    for (const auto& result : results) {
+        out << result.name << '\t' << result.value << '\t' << result.unit << '\t'
+            << (result.higherIsBetter ? "higher" : "lower") << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+// Reads a baseline written by saveBaseline into name -> value
+static bool loadBaseline(const std::string& path, std::map<std::string, double>& baseline) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        double value = 0.0;
+        if (fields >> name >> value) {
+            baseline[name] = value;
+        }
+    }
+    return true;
+}
+
+// Prints the results, with the change against the baseline when there is one; returns the number of regressions
+static int report(const std::vector<Measurement>& results, const std::map<std::string, double>* baseline,
+                  double tolerance) {
+    int regressions = 0;
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(36) << result.name << std::right << std::setw(14) << std::fixed
+                  << std::setprecision(2) << result.value << ' ' << std::setw(6) << std::left << result.unit;
+        if (baseline) {
+            auto entry = baseline->find(result.name);
+            if (entry == baseline->end() || entry->second <= 0.0) {
+                std::cout << "  (no baseline)";
+            } else {
+                // Positive change means better, whichever direction the metric improves in
+                double change = (result.value / entry->second - 1.0) * 100.0;
+                if (!result.higherIsBetter) {
+                    change = (entry->second / result.value - 1.0) * 100.0;
+                }
+                std::cout << "  baseline " << entry->second << std::showpos << " (" << change << "%)" << std::noshowpos;
+                if (change < -tolerance) {
+                    std::cout << "  REGRESSION";
+                    ++regressions;
+                }
+            }
+        }
+        std::cout << std::right << std::endl;
+    }
+    return regressions;
+}
+
+// Parses the shared corpus options; returns false on an unknown option
+static bool parseOptions(int argc, char* argv[], int first, MicroConfig& config) {
+    for (int i = first; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[i + 1];
+        if (option == "--documents") {
+            config.corpus.documents = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (option == "--vocabulary") {
+            config.corpus.vocabulary = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (option == "--zipf") {
+            config.corpus.zipfExponent = std::atof(value.c_str());
+        } else if (option == "--words-per-document") {
+            config.corpus.wordsPerDocument = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (option == "--seed") {
+            config.corpus.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (option == "--trials") {
+            config.trials = std::atoi(value.c_str());
+        } else if (option == "--save-baseline") {
+            config.saveBaseline = value;
+        } else if (option == "--compare") {
+            config.compareBaseline = value;
+        } else if (option == "--tolerance") {
+            config.tolerance = std::atof(value.c_str());
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const char* usage =
+        "Usage: micro-benchmark run [--trials N] [--save-baseline FILE] [--compare FILE] [--tolerance PCT] [corpus options]\n"
+        "       micro-benchmark corpus DIR [corpus options]\n"
+        "Corpus options: [--documents N] [--vocabulary N] [--zipf S] [--words-per-document N] [--seed N]";
+
+    // First argument selects the mode: run the benchmarks, or write a corpus to disk
+    std::string mode = argc > 1 ? argv[1] : "run";
+    MicroConfig config;
+    int first = mode == "corpus" ? 3 : 2;
+    if ((mode != "run" && mode != "corpus") || (mode == "corpus" && argc < 3) || !parseOptions(argc, argv, first, config)) {
+        std::cerr << usage << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (config.corpus.documents == 0 || config.corpus.vocabulary == 0 || config.corpus.wordsPerDocument == 0 ||
+        config.corpus.zipfExponent < 0.0 || config.trials <= 0) {
+        std::cerr << "Corpus parameters and trials must be positive." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (mode == "corpus") {
+        CorpusGenerator generator(config.corpus);
+        size_t bytes = 0;
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        if (!generator.writeFolder(argv[2], bytes, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "Wrote " << config.corpus.documents << " documents (" << bytes << " bytes) to " << argv[2]
+                  << " in " << secondsSince(start) << " seconds" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << "Corpus: " << config.corpus.documents << " documents, " << config.corpus.vocabulary
+              << " words, Zipf exponent " << config.corpus.zipfExponent << ", " << config.corpus.wordsPerDocument
+              << " words/document, seed " << config.corpus.seed << "; median of " << config.trials << " trials"
+              << std::endl;
+    std::vector<Measurement> results = runBenchmarks(config);
+
+    std::map<std::string, double> baseline;
+    if (!config.compareBaseline.empty() && !loadBaseline(config.compareBaseline, baseline)) {
+        std::cerr << "Error: could not read baseline " << config.compareBaseline << std::endl;
+        return EXIT_FAILURE;
+    }
+    int regressions = report(results, config.compareBaseline.empty() ? nullptr : &baseline, config.tolerance);
+
+    if (!config.saveBaseline.empty() && !saveBaseline(config.saveBaseline, results)) {
+        std::cerr << "Error: could not write baseline " << config.saveBaseline << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (regressions > 0) {
+        std::cout << regressions << " regression(s) beyond " << config.tolerance << "%" << std::endl;
+        return EXIT_FAILURE; // Lets scripts fail the run
+    }
+    return EXIT_SUCCESS;
+}
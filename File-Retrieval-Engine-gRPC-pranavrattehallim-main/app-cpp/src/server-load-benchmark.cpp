@@ -0,0 +1,530 @@
+#include <grpcpp/grpcpp.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib> // for EXIT_SUCCESS / EXIT_FAILURE
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "proto/File-Retrieval-Engine.grpc.pb.h"
+
+// Parameters of the load run against a live server
+struct LoadConfig {
+    std::string server = "localhost:50051"; // Address of the server under test
+    std::vector<std::string> searchServers; // Replicas the searches go to instead of the server (empty: the server)
+    int preloadDocuments = 20000;           // Documents indexed before the measurements start
+    int vocabulary = 50000;                 // Number of distinct words the corpus draws from
+    int wordsPerDocument = 200;             // Word draws per document (duplicates fold into frequencies)
+    int searchThreads = 4;                  // Concurrent search clients
+    int indexClients = 8;                   // Concurrent indexing streams during the storm
+    int seconds = 5;                        // Length of each measured phase
+    std::string deepTerm;                   // Word whose every match is paged through after the preload (empty: skip)
+    std::vector<int> batchSizes;            // Searches per ComputeSearchBatch call, one phase each (empty: skip)
+};
+
+// Latencies of the searches of one phase
+struct SearchLatencies {
+    std::vector<double> micros; // Latency of every search, in microseconds
+    double seconds = 0.0;       // Length of the phase
+};
+
+// Generates one document; word ranks are log-uniform so a few words are very common
+static fre::IndexReq generateDocument(const LoadConfig& config, std::mt19937& rng, int document) {
+    std::uniform_real_distribution<double> rankDistribution(0.0, 1.0);
+    std::uniform_int_distribution<int> countDistribution(1, 5);
+
+    std::unordered_map<std::string, int> frequencies;
+    for (int i = 0; i < config.wordsPerDocument; ++i) {
+        int rank = static_cast<int>(std::pow(static_cast<double>(config.vocabulary), rankDistribution(rng)));
+        frequencies["term" + std::to_string(rank)] += countDistribution(rng);
+    }
+
+    fre::IndexReq request;
+    request.set_document_path("/data/load/document_" + std::to_string(document) + ".txt");
+    for (const auto& [word, count] : frequencies) {
+        fre::WordFrequency* wordFrequency = request.add_word_frequencies();
+        wordFrequency->set_word(word);
+        wordFrequency->set_count(count);
+    }
+    return request;
+}
+
+// Builds batches of 256 generated documents, reused by every indexing stream
+static std::vector<fre::IndexBatch> generateBatches(const LoadConfig& config, const std::string& clientID, int documents) {
+    std::mt19937 rng(42); // Fixed seed so runs are comparable
+    std::vector<fre::IndexBatch> batches;
+    for (int document = 0; document < documents; ++document) {
+        if (document % 256 == 0) {
+            batches.emplace_back();
+            batches.back().set_client_id(clientID);
+        }
+        *batches.back().add_documents() = generateDocument(config, rng, document);
+    }
+    return batches;
+}
+
+// Sends the batches over one ComputeIndexStream call; returns the number of documents acknowledged
+static int64_t streamBatches(fre::FileRetrievalEngine::Stub& stub, const std::vector<fre::IndexBatch>& batches) {
+    grpc::ClientContext context;
+    fre::IndexStreamRep reply;
+    std::unique_ptr<grpc::ClientWriter<fre::IndexBatch>> writer = stub.ComputeIndexStream(&context, &reply);
+    for (const auto& batch : batches) {
+        if (!writer->Write(batch)) {
+            break; // The server closed the stream; Finish reports why
+        }
+    }
+    writer->WritesDone();
+    grpc::Status status = writer->Finish();
+    if (!status.ok()) {
+        std::cerr << "Indexing stream failed: " << status.error_message() << std::endl;
+        return 0;
+    }
+    return reply.documents_indexed();
+}
+
+// A common word ANDed with a rarer one, as typical user queries are
+static fre::SearchReq generateQuery(std::mt19937& rng) {
+    std::uniform_int_distribution<int> commonRank(1, 20), rarerRank(100, 1000);
+    fre::SearchReq request;
+    request.add_terms("term" + std::to_string(commonRank(rng)));
+    request.add_terms("term" + std::to_string(rarerRank(rng)));
+    return request;
+}
+
+// Runs searches from several threads until the deadline and records the latency of each; the threads are spread
+// evenly over the channels
+static SearchLatencies runSearches(const LoadConfig& config, const std::vector<std::shared_ptr<grpc::Channel>>& channels) {
+    std::vector<std::vector<double>> perThread(config.searchThreads);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(config.seconds);
+    for (int thread = 0; thread < config.searchThreads; ++thread) {
+        threads.emplace_back([&, thread]() {
+            auto stub = fre::FileRetrievalEngine::NewStub(channels[thread % channels.size()]);
+            std::mt19937 rng(thread);
+            while (std::chrono::steady_clock::now() < deadline) {
+                fre::SearchReq request = generateQuery(rng);
+                fre::SearchRep reply;
+                grpc::ClientContext context;
+                auto begin = std::chrono::steady_clock::now();
+                grpc::Status status = stub->ComputeSearch(&context, request, &reply);
+                std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - begin;
+                if (status.ok()) {
+                    perThread[thread].push_back(latency.count());
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    SearchLatencies latencies;
+    latencies.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& samples : perThread) {
+        latencies.micros.insert(latencies.micros.end(), samples.begin(), samples.end());
+    }
+    std::sort(latencies.micros.begin(), latencies.micros.end());
+    return latencies;
+}
+
+// Runs the same searches as runSearches, batchSize to a ComputeSearchBatch call, and records the latency of each call
+static SearchLatencies runSearchBatches(const LoadConfig& config,
+                                        const std::vector<std::shared_ptr<grpc::Channel>>& channels, int batchSize) {
+    std::vector<std::vector<double>> perThread(config.searchThreads);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(config.seconds);
+    for (int thread = 0; thread < config.searchThreads; ++thread) {
+        threads.emplace_back([&, thread]() {
+            auto stub = fre::FileRetrievalEngine::NewStub(channels[thread % channels.size()]);
+            std::mt19937 rng(thread);
+            while (std::chrono::steady_clock::now() < deadline) {
+                fre::SearchBatchReq request;
+                for (int search = 0; search < batchSize; ++search) {
+                    *request.add_searches() = generateQuery(rng);
+                }
+                fre::SearchBatchRep reply;
+                grpc::ClientContext context;
+                auto begin = std::chrono::steady_clock::now();
+                grpc::Status status = stub->ComputeSearchBatch(&context, request, &reply);
+                std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - begin;
+                if (status.ok()) {
+                    perThread[thread].push_back(latency.count());
+                } else {
+                    std::cerr << "Batch search failed: " << status.error_message() << std::endl;
+                    return;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    SearchLatencies latencies;
+    latencies.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& samples : perThread) {
+        latencies.micros.insert(latencies.micros.end(), samples.begin(), samples.end());
+    }
+    std::sort(latencies.micros.begin(), latencies.micros.end());
+    return latencies;
+}
+
+// Arrival of one streamed page of search results
+struct PageTiming {
+    bool ok = false;               // Whether the stream ended without an error
+    double firstChunkMicros = 0.0; // Until the first chunk arrived
+    double pageMicros = 0.0;       // Until the stream ended
+    size_t results = 0;            // Results received
+    int64_t totalMatches = 0;      // Matches the server reported
+    std::string nextCursor;        // Cursor to the next page, empty after the last
+};
+
+// Reads one page of a streamed search, timing the first chunk and the whole page
+static PageTiming readSearchPage(fre::FileRetrievalEngine::Stub& stub, const fre::SearchStreamReq& request) {
+    PageTiming timing;
+    grpc::ClientContext context;
+    auto begin = std::chrono::steady_clock::now();
+    std::unique_ptr<grpc::ClientReader<fre::SearchChunk>> reader = stub.ComputeSearchStream(&context, request);
+    fre::SearchChunk chunk;
+    bool first = true;
+    while (reader->Read(&chunk)) {
+        if (first) {
+            timing.firstChunkMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+            timing.totalMatches = chunk.total_matches();
+            timing.nextCursor = chunk.next_cursor();
+            first = false;
+        }
+        timing.results += chunk.documents_size();
+    }
+    grpc::Status status = reader->Finish();
+    timing.pageMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    timing.ok = status.ok();
+    if (!status.ok()) {
+        std::cerr << "Search stream failed: " << status.error_message() << std::endl;
+    }
+    return timing;
+}
+
+// Prints the server's resident memory and the bytes its search cursors hold
+static void reportServerMemory(fre::FileRetrievalEngine::Stub& stub, const std::string& when) {
+    grpc::ClientContext context;
+    fre::StatsRep stats;
+    if (stub.GetStats(&context, fre::StatsReq(), &stats).ok()) {
+        std::cout << "Server memory " << when << ": " << stats.resident_bytes() / 1048576.0 << " MiB resident, peak "
+                  << stats.peak_resident_bytes() / 1048576.0 << " MiB; cursors hold " << stats.cursors().bytes()
+                  << " bytes in " << stats.cursors().result_sets() << " result sets" << std::endl;
+    }
+}
+
+// Compares the ways of reading every match of a common word: the unary top 1000, the first streamed page, every
+// page through the cursors, and all of them as one long page. Each is repeated five times and the median shown.
+static void runDeepSearch(const LoadConfig& config, fre::FileRetrievalEngine::Stub& stub) {
+    constexpr int repeats = 5;
+    auto median = [](std::vector<double> samples) {
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    };
+    reportServerMemory(stub, "before the deep searches");
+
+    std::vector<double> unary;
+    for (int run = 0; run < repeats; ++run) {
+        fre::SearchReq request;
+        request.add_terms(config.deepTerm);
+        request.set_top_k(1000);
+        fre::SearchRep reply;
+        grpc::ClientContext context;
+        auto begin = std::chrono::steady_clock::now();
+        if (stub.ComputeSearch(&context, request, &reply).ok()) {
+            unary.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+        }
+    }
+    if (unary.empty()) {
+        std::cerr << "Deep search for " << config.deepTerm << " failed" << std::endl;
+        return;
+    }
+    std::vector<double> firstChunk, firstPage, allPages, longFirstChunk, longPage;
+    size_t pages = 0, paged = 0, longResults = 0;
+    int64_t totalMatches = 0;
+    for (int run = 0; run < repeats; ++run) {
+        // Every match a page of 1000 at a time, each page resumed from the previous page's cursor
+        fre::SearchStreamReq request;
+        request.add_terms(config.deepTerm);
+        auto begin = std::chrono::steady_clock::now();
+        PageTiming page = readSearchPage(stub, request);
+        if (!page.ok) {
+            return;
+        }
+        totalMatches = page.totalMatches;
+        firstChunk.push_back(page.firstChunkMicros);
+        firstPage.push_back(page.pageMicros);
+        pages = 1;
+        paged = page.results;
+        while (!page.nextCursor.empty()) {
+            fre::SearchStreamReq next;
+            next.set_cursor(page.nextCursor);
+            page = readSearchPage(stub, next);
+            if (!page.ok) {
+                return;
+            }
+            ++pages;
+            paged += page.results;
+        }
+        allPages.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+
+        // Every match in one page, streamed in chunks of 256
+        fre::SearchStreamReq whole;
+        whole.add_terms(config.deepTerm);
+        whole.set_page_size(100000);
+        PageTiming longRead = readSearchPage(stub, whole);
+        if (!longRead.ok) {
+            return;
+        }
+        longFirstChunk.push_back(longRead.firstChunkMicros);
+        longPage.push_back(longRead.pageMicros);
+        longResults = longRead.results;
+    }
+    std::cout << "Deep search \"" << config.deepTerm << "\" matches " << totalMatches << " documents" << std::endl;
+    std::cout << "Unary top 1000: " << median(unary) << " us" << std::endl;
+    std::cout << "Streamed page of 1000: first chunk " << median(firstChunk) << " us, page " << median(firstPage)
+              << " us" << std::endl;
+    std::cout << "All " << pages << " pages through cursors: " << paged << " results in " << median(allPages) / 1000.0
+              << " ms" << std::endl;
+    std::cout << "One page of " << longResults << ": first chunk " << median(longFirstChunk) << " us, page "
+              << median(longPage) / 1000.0 << " ms" << std::endl;
+    reportServerMemory(stub, "after the deep searches");
+}
+
+// Reads one server's replication state; false if it cannot be reached
+static bool readReplication(const std::shared_ptr<grpc::Channel>& channel, fre::ReplicationStats& replication) {
+    grpc::ClientContext context;
+    fre::StatsRep stats;
+    grpc::Status status = fre::FileRetrievalEngine::NewStub(channel)->GetStats(&context, fre::StatsReq(), &stats);
+    replication = stats.replication();
+    return status.ok();
+}
+
+// Waits until every replica has applied the primary's updates so far; false if one is not a replica of it or
+// stops answering
+static bool waitForReplicas(const LoadConfig& config, const std::shared_ptr<grpc::Channel>& primary,
+                            const std::vector<std::shared_ptr<grpc::Channel>>& replicas) {
+    fre::ReplicationStats primaryState;
+    if (!readReplication(primary, primaryState) || primaryState.role() != "primary") {
+        std::cerr << config.server << " does not serve replicas; start it with --serve-replicas" << std::endl;
+        return false;
+    }
+    for (size_t replica = 0; replica < replicas.size(); ++replica) {
+        fre::ReplicationStats state;
+        while (readReplication(replicas[replica], state) && state.role() == "replica" &&
+               state.applied_sequence() < primaryState.applied_sequence()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (state.role() != "replica") {
+            std::cerr << config.searchServers[replica] << " is not a replica" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the given percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[index];
+}
+
+// Prints the throughput and latency distribution of one phase
+static void report(const std::string& phase, const SearchLatencies& latencies) {
+    std::cout << phase << ": " << latencies.micros.size() << " searches ("
+              << latencies.micros.size() / latencies.seconds << "/s), p50 " << percentile(latencies.micros, 0.50)
+              << " us, p99 " << percentile(latencies.micros, 0.99) << " us, max "
+              << (latencies.micros.empty() ? 0.0 : latencies.micros.back()) << " us" << std::endl;
+}
+
+// Prints the search throughput of a batched phase and the latency distribution of its calls
+static void reportBatches(int batchSize, const SearchLatencies& latencies) {
+    size_t searches = latencies.micros.size() * static_cast<size_t>(batchSize);
+    std::cout << "Batches of " << batchSize << ": " << searches << " searches (" << searches / latencies.seconds
+              << "/s) in " << latencies.micros.size() << " calls, per call p50 " << percentile(latencies.micros, 0.50)
+              << " us, p99 " << percentile(latencies.micros, 0.99) << " us, max "
+              << (latencies.micros.empty() ? 0.0 : latencies.micros.back()) << " us" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+
+    // Optional arguments select the server and the shape of the load
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--server") {
+            config.server = argv[i + 1];
+            continue;
+        }
+        if (option == "--deep-term") {
+            config.deepTerm = argv[i + 1];
+            continue;
+        }
+        if (option == "--batch-sizes") {
+            std::string sizes = argv[i + 1];
+            for (size_t begin = 0, end; begin <= sizes.size(); begin = end + 1) {
+                end = std::min(sizes.find(',', begin), sizes.size());
+                config.batchSizes.push_back(std::atoi(sizes.substr(begin, end - begin).c_str()));
+            }
+            continue;
+        }
+        if (option == "--search-servers") {
+            std::string addresses = argv[i + 1];
+            for (size_t begin = 0, end; begin <= addresses.size(); begin = end + 1) {
+                end = std::min(addresses.find(',', begin), addresses.size());
+                config.searchServers.push_back(addresses.substr(begin, end - begin));
+            }
+            continue;
+        }
+        int value = std::atoi(argv[i + 1]);
+        if (option == "--preload") {
+            config.preloadDocuments = value;
+        } else if (option == "--vocabulary") {
+            config.vocabulary = value;
+        } else if (option == "--words-per-document") {
+            config.wordsPerDocument = value;
+        } else if (option == "--search-threads") {
+            config.searchThreads = value;
+        } else if (option == "--index-clients") {
+            config.indexClients = value;
+        } else if (option == "--seconds") {
+            config.seconds = value;
+        } else {
+            std::cerr << "Usage: server-load-benchmark [--server HOST:PORT] [--search-servers HOST:PORT,...] [--preload N] "
+                         "[--vocabulary N] [--words-per-document N] [--search-threads N] [--index-clients N] [--seconds N] "
+                         "[--deep-term WORD] [--batch-sizes N,...]"
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    bool batchSizesValid = std::all_of(config.batchSizes.begin(), config.batchSizes.end(), [](int size) { return size > 0; });
+    if (argc % 2 == 0 || config.preloadDocuments < 0 || config.vocabulary <= 1 || config.wordsPerDocument <= 0 ||
+        config.searchThreads <= 0 || config.indexClients < 0 || config.seconds <= 0 || !batchSizesValid) {
+        std::cerr << "Usage: server-load-benchmark [--server HOST:PORT] [--search-servers HOST:PORT,...] [--preload N] "
+                     "[--vocabulary N] [--words-per-document N] [--search-threads N] [--index-clients N] [--seconds N] "
+                     "[--deep-term WORD] [--batch-sizes N,...]"
+                      << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    grpc::ChannelArguments channelArgs;
+    channelArgs.SetMaxReceiveMessageSize(INT_MAX);
+    auto channel = grpc::CreateCustomChannel(config.server, grpc::InsecureChannelCredentials(), channelArgs);
+    auto stub = fre::FileRetrievalEngine::NewStub(channel);
+    std::vector<std::shared_ptr<grpc::Channel>> searchChannels; // Replicas, or the server itself without any
+    for (const auto& address : config.searchServers) {
+        searchChannels.push_back(grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), channelArgs));
+    }
+    if (searchChannels.empty()) {
+        searchChannels.push_back(channel);
+    }
+
+    // Register as a client so documents carry a real client ID
+    grpc::ClientContext connectContext;
+    fre::ConnectReq connectRequest;
+    fre::ConnectRep connectReply;
+    grpc::Status status = stub->GetClientID(&connectContext, connectRequest, &connectReply);
+    if (!status.ok()) {
+        std::cerr << "Could not connect to " << config.server << ": " << status.error_message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Fill the index so searches have real posting lists to intersect
+    auto start = std::chrono::steady_clock::now();
+    int64_t preloaded = streamBatches(*stub, generateBatches(config, connectReply.client_id(), config.preloadDocuments));
+    std::chrono::duration<double> preload = std::chrono::steady_clock::now() - start;
+    std::cout << "Preloaded " << preloaded << " documents in " << preload.count() << " seconds" << std::endl;
+    if (!config.searchServers.empty()) {
+        if (!waitForReplicas(config, channel, searchChannels)) {
+            return EXIT_FAILURE;
+        }
+        std::chrono::duration<double> caughtUp = std::chrono::steady_clock::now() - start;
+        std::cout << config.searchServers.size() << " replicas caught up " << caughtUp.count() - preload.count()
+                  << " seconds after the preload" << std::endl;
+    }
+
+    // Paging through every match of one word, before the storm adds documents and memory
+    if (!config.deepTerm.empty()) {
+        runDeepSearch(config, *stub);
+    }
+
+    // Searches alone
+    report("Searches alone", runSearches(config, searchChannels));
+
+    // The same searches, batchSize to a call
+    for (int batchSize : config.batchSizes) {
+        reportBatches(batchSize, runSearchBatches(config, searchChannels, batchSize));
+    }
+
+    // Searches during an indexing storm: every index client streams the same batches back to back
+    std::vector<fre::IndexBatch> stormBatches = generateBatches(config, connectReply.client_id(), 2560);
+    std::atomic<bool> storming{true};
+    std::atomic<int64_t> stormDocuments{0};
+    std::vector<std::thread> indexers;
+    start = std::chrono::steady_clock::now();
+    for (int client = 0; client < config.indexClients; ++client) {
+        indexers.emplace_back([&]() {
+            // Each client gets its own channel, as separate client processes would
+            auto indexStub = fre::FileRetrievalEngine::NewStub(
+                grpc::CreateCustomChannel(config.server, grpc::InsecureChannelCredentials(), channelArgs));
+            while (storming) {
+                stormDocuments += streamBatches(*indexStub, stormBatches);
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Let the storm ramp up before measuring
+    SearchLatencies duringStorm = runSearches(config, searchChannels);
+    storming = false;
+    for (auto& indexer : indexers) {
+        indexer.join();
+    }
+    std::chrono::duration<double> storm = std::chrono::steady_clock::now() - start;
+    report("Searches during indexing storm", duringStorm);
+    std::cout << "Indexing storm: " << stormDocuments << " documents from " << config.indexClients << " clients ("
+              << stormDocuments / storm.count() << " documents/s)" << std::endl;
+
+    // How far behind the storm left each replica; the lag shrinks to nothing once they catch up
+    for (size_t replica = 0; replica < config.searchServers.size(); ++replica) {
+        fre::ReplicationStats state;
+        if (readReplication(searchChannels[replica], state)) {
+            std::cout << "Replica " << config.searchServers[replica] << ": "
+                      << state.primary_sequence() - std::min(state.primary_sequence(), state.applied_sequence())
+                      << " updates, " << state.lag_seconds() << " seconds behind after the storm" << std::endl;
+        }
+    }
+
+    // Server-side view of the same run: handler latency excludes the network, and lock waits show contention
+    grpc::ClientContext statsContext;
+    fre::StatsReq statsRequest;
+    fre::StatsRep stats;
+    status = stub->GetStats(&statsContext, statsRequest, &stats);
+    if (!status.ok()) {
+        std::cerr << "Could not read server statistics: " << status.error_message() << std::endl;
+        return EXIT_SUCCESS; // The client-side measurements above still stand
+    }
+    for (const auto& rpc : stats.rpcs()) {
+        if (rpc.method() == "ComputeSearch" || rpc.method() == "ComputeSearchBatch" || rpc.method() == "ComputeIndexStream") {
+            std::cout << "Server " << rpc.method() << ": " << rpc.calls() << " calls, p50 " << rpc.p50_us() << " us, p99 "
+                      << rpc.p99_us() << " us, p99.9 " << rpc.p999_us() << " us" << std::endl;
+        }
+    }
+    for (const auto& lock : stats.locks()) {
+        std::cout << "Server lock " << lock.lock() << ": " << lock.contended() << " of " << lock.acquisitions()
+                  << " acquisitions contended, " << lock.wait_seconds() << " seconds waiting" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}